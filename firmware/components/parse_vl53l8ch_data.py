@@ -2,25 +2,58 @@
 """
 VL53L8CH Data Parser and Visualizer
 
-This script parses VL53L8CH hex data from PlatformIO logs and generates
-PNG visualizations of the 8x8 sensor array data.
+This script parses VL53L8CH hex data from PlatformIO logs (or the binary
+.tofb logs written by the firmware/simulator, or raw .tofs captures of the
+binary UART stream) and generates PNG
+visualizations of the 8x8 sensor array data.
 """
 
 import re
+import zlib
+import binascii
+import itertools
+from concurrent.futures import ProcessPoolExecutor
 import numpy as np
 import matplotlib.pyplot as plt
 from pathlib import Path
 import argparse
 
+# 8x8 cell -> 4x4 zone covering it; 4x4 frames are returned on the 8x8 grid with each zone repeated over 2x2 cells
+UPSAMPLE_4X4 = np.array([(row // 2) * 4 + col // 2 for row in range(8) for col in range(8)])
+
+
+def upsample_4x4(values, resolution):
+    """
+    Spread the 4x4 rows of an (N, 64) zone array over the 8x8 grid, in place.
+
+    resolution holds the zone count of each row (16 or 64); rows with 16 zones
+    keep their zones in the first 16 columns. Returns values.
+    """
+    rows = np.flatnonzero(np.asarray(resolution) == 16)
+    if len(rows):
+        values[rows] = values[rows][:, UPSAMPLE_4X4]
+    return values
+
+
 def parse_hex_data(hex_string):
     """
     Parse hex string into 8x8 array of sensor values.
     
-    VL53L8CH produces 64 values (8x8 grid) where each value is 1 byte.
-    The hex string should be 128 characters (64 bytes * 2 hex chars per byte).
+    VL53L8CH produces 64 values (8x8 grid). Target status and legacy distance
+    lines use 1 byte per value (128 hex characters); current firmware prints
+    distances as full-width int16 with 4 hex digits per value (256 characters).
+    At 4x4 the firmware prints 16 values (64 distance or 32 status
+    characters), returned on the 8x8 grid with each zone over 2x2 cells.
     """
+    if len(hex_string) == 64:
+        values = np.frombuffer(bytes.fromhex(hex_string), dtype='>i2').astype(np.int16)
+        return values[UPSAMPLE_4X4].reshape(8, 8)
+    if len(hex_string) == 32:
+        return np.frombuffer(bytes.fromhex(hex_string), dtype=np.uint8)[UPSAMPLE_4X4].reshape(8, 8)
+    if len(hex_string) == 256:
+        return np.frombuffer(bytes.fromhex(hex_string), dtype='>i2').astype(np.int16).reshape(8, 8)
     if len(hex_string) != 128:
-        raise ValueError(f"Expected 128 hex characters, got {len(hex_string)}")
+        raise ValueError(f"Expected 32, 64, 128 or 256 hex characters, got {len(hex_string)}")
     
     # Convert hex string to bytes
     bytes_data = bytes.fromhex(hex_string)
@@ -30,105 +63,729 @@ def parse_hex_data(hex_string):
     
     return array_8x8
 
-def extract_hex_data_from_log(log_file_path):
+# Text log ingestion: a "TOF: HEX DATA:" line, optionally followed on the next
+# line by "TOF: TARGET STATUS:". A distance line without a status line is only
+# accepted once the next line is complete, so a chunk never ends mid-frame.
+HEX_LOG_CHUNK_SIZE = 16 * 1024 * 1024
+HEX_LOG_FRAME_PATTERN = re.compile(
+    rb'TOF: HEX DATA:[ \t]+([0-9A-Fa-f]{256}|[0-9A-Fa-f]{128}|[0-9A-Fa-f]{64})(?![0-9A-Fa-f])[^\n]*\n'
+    rb'(?:[^\n]*?TOF: TARGET STATUS:[ \t]+([0-9A-Fa-f]{128}|[0-9A-Fa-f]{32})(?![0-9A-Fa-f])|(?=[^\n]*\n))')
+# Hex characters of a line -> (dtype, zones) of its values
+HEX_DISTANCE_FORMATS = {256: ('>i2', 64), 128: ('u1', 64), 64: ('>i2', 16)}
+HEX_STATUS_FORMATS = {128: ('u1', 64), 32: ('u1', 16)}
+
+
+def _decode_hex_column(hex_values, formats, out):
+    """
+    Decode the hex strings of one column of matches into the (n, 64) array out.
+
+    The strings of each length are joined and converted with a single
+    unhexlify + np.frombuffer, 4x4 lines spread over the 8x8 grid. Empty
+    strings (no status line) leave their rows untouched.
+    """
+    lengths = np.fromiter(map(len, hex_values), dtype=np.int32, count=len(hex_values))
+    for length, (dtype, zones) in formats.items():
+        rows = lengths == length
+        if not rows.any():
+            continue
+        joined = binascii.unhexlify(b''.join(itertools.compress(hex_values, rows)))
+        values = np.frombuffer(joined, dtype=dtype).reshape(-1, zones)
+        out[rows] = values[:, UPSAMPLE_4X4] if zones == 16 else values
+
+
+def extract_hex_data_from_log(log_file_path, chunk_size=HEX_LOG_CHUNK_SIZE):
     """
     Extract all VL53L8CH hex data and target status from a log file.
-    
-    Returns tuple of (distance_arrays, target_status_arrays, valid_measurements)
-    """
-    hex_data_pattern = r'TOF: HEX DATA:\s+([0-9A-Fa-f]{128})'
-    target_status_pattern = r'TOF: TARGET STATUS: ([0-9A-Fa-f]{128})'
-    
-    distance_arrays = []
-    target_status_arrays = []
-    valid_measurements = []
-    
-    with open(log_file_path, 'r', encoding='utf-8', errors='ignore') as f:
-        lines = f.readlines()
-    
-    # Process lines in pairs (distance data followed by target status)
-    for i in range(len(lines) - 1):
-        distance_match = re.search(hex_data_pattern, lines[i])
-        if distance_match:
-            # Look for target status in the next line
-            target_match = re.search(target_status_pattern, lines[i + 1])
-            
-            if target_match:
-                try:
-                    # Parse distance data
-                    distance_hex = distance_match.group(1)
-                    distance_array = parse_hex_data(distance_hex)
-                    
-                    # Parse target status
-                    target_hex = target_match.group(1)
-                    target_array = parse_hex_data(target_hex)
-                    
-                    # Count valid measurements (target status 5 or 9 = valid target)
-                    valid_count = np.sum((target_array == 5) | (target_array == 9))
-                    
-                    distance_arrays.append(distance_array)
-                    target_status_arrays.append(target_array)
-                    valid_measurements.append(valid_count)
-                    
-                except ValueError as e:
-                    print(f"Warning: Skipping invalid hex data: {e}")
-                    continue
+
+    The log is read in chunks of chunk_size bytes, so memory is bounded by
+    the decoded frames and not by the size of the log. Each chunk is scanned
+    with one regex pass (findall, no per-line Python loop) and its frames are
+    decoded with one vectorized step per line format, straight into output
+    arrays preallocated from the frame density of the first chunk (grown if
+    the estimate falls short). Frames without a status line (legacy format)
+    get status 0, that is, no valid zone.
+
+    Returns tuple of (distance_data (N,8,8) int16, target_status_data (N,8,8)
+    uint8, valid_counts (N,) with the zones of status 5 or 9 per frame).
+    """
+    file_size = Path(log_file_path).stat().st_size
+    distance_data = np.zeros((0, 64), dtype=np.int16)
+    target_status_data = np.zeros((0, 64), dtype=np.uint8)
+    n_frames = 0
+    carry = b''
+
+    with open(log_file_path, 'rb') as f:
+        while True:
+            chunk = f.read(chunk_size)
+            at_end = len(chunk) < chunk_size
+            buffer = carry + chunk
+            if at_end:
+                # The last line also gets a line end (a distance line there has no status line), and nothing is carried over
+                if not buffer.endswith(b'\n'):
+                    buffer += b'\n'
+                scan_end = carry_start = len(buffer)
             else:
-                # No target status found, process distance only (legacy format)
-                try:
-                    distance_hex = distance_match.group(1)
-                    distance_array = parse_hex_data(distance_hex)
-                    distance_arrays.append(distance_array)
-                    target_status_arrays.append(np.zeros((8, 8), dtype=np.uint8))  # Unknown validity
-                    valid_measurements.append(0)  # Unknown validity
-                except ValueError as e:
-                    print(f"Warning: Skipping invalid hex data: {e}")
-                    continue
-    
-    return distance_arrays, target_status_arrays, valid_measurements
+                # The last complete line may be a distance line whose status line is in the next chunk
+                scan_end = buffer.rfind(b'\n') + 1
+                carry_start = buffer.rfind(b'\n', 0, max(scan_end - 1, 0)) + 1
+            matches = HEX_LOG_FRAME_PATTERN.findall(buffer, 0, scan_end) if carry_start > 0 else []
+            carry = buffer[carry_start:]
+
+            if matches:
+                count = len(matches)
+                if n_frames + count > len(distance_data):
+                    # First chunk: estimate the whole file from its density; later: grow by half
+                    estimate = count * file_size // max(len(buffer), 1) + count
+                    capacity = max(n_frames + count, estimate if n_frames == 0 else len(distance_data) * 3 // 2)
+                    distance_data, old_distances = np.zeros((capacity, 64), dtype=np.int16), distance_data
+                    target_status_data, old_statuses = np.zeros((capacity, 64), dtype=np.uint8), target_status_data
+                    distance_data[:n_frames] = old_distances[:n_frames]
+                    target_status_data[:n_frames] = old_statuses[:n_frames]
+                distances, statuses = zip(*matches)
+                rows = slice(n_frames, n_frames + count)
+                _decode_hex_column(distances, HEX_DISTANCE_FORMATS, distance_data[rows])
+                _decode_hex_column(statuses, HEX_STATUS_FORMATS, target_status_data[rows])
+                n_frames += count
+            if at_end:
+                break
+
+    distance_data = distance_data[:n_frames].reshape(-1, 8, 8)
+    target_status_data = target_status_data[:n_frames].reshape(-1, 8, 8)
+    valid_counts = np.sum((target_status_data == 5) | (target_status_data == 9), axis=(1, 2))
+    return distance_data, target_status_data, valid_counts
+
+# Binary .tofb format (see firmware/components/tof_common/inc/tof_bin.h)
+TOFB_MAGIC = b'TOFB'
+TOFB_BLOCK_SYNC = 0x4B4C4254
+TOFB_FRAME_DELTA = 0x80          # valid_count flag of a delta frame (version 3)
+TOFB_STATUS_INVALIDATED = 255    # status written in a delta frame for a zone that stopped being valid
+TOFB_FILE_HEADER_DTYPE = np.dtype([
+    ('magic', 'S4'), ('version', '<u2'), ('header_size', '<u2'),
+    ('block_header_size', '<u2'), ('frame_header_size', '<u2'),
+    ('distance_size', 'u1'), ('status_size', 'u1'), ('sigma_size', 'u1'), ('signal_size', 'u1')])
+TOFB_BLOCK_HEADER_DTYPE = np.dtype([
+    ('sync', '<u4'), ('payload_size', '<u4'), ('frame_count', '<u2'),
+    ('zone_count', '<u2'), ('crc32', '<u4')])
+TOFB_FRAME_HEADER_DTYPE = np.dtype([
+    ('timestamp_ms', '<u4'), ('streamcount', 'u1'), ('resolution', 'u1'),
+    ('valid_count', 'u1'), ('sensor_id', 'u1'), ('valid_mask', '<u8')])
 
-def create_heatmap(data, title, output_path, cmap='viridis'):
+# Side index (.idx) of a log file (see firmware/components/tof_common/inc/tof_log_index.h)
+LOG_INDEX_MAGIC = b'TIDX'
+LOG_INDEX_HEADER_DTYPE = np.dtype([('magic', 'S4'), ('version', '<u2'), ('entry_size', '<u2')])
+LOG_INDEX_ENTRY_DTYPE = np.dtype([
+    ('timestamp_us', '<i8'), ('offset', '<u4'), ('durable_end', '<u4'), ('crc32', '<u4')])
+
+
+def read_log_index(index_path):
     """
-    Create a heatmap PNG image from 8x8 data array.
+    Read the side index written next to a log file (tof_NNNN.idx for tof_NNNN.tofb).
+
+    Returns a structured array of the entries with a valid CRC, in file order:
+    timestamp_us of the first frame of the record at offset, and durable_end,
+    the bytes of the log file already synced when the entry was written.
+    Both timestamp_us and offset are non-decreasing.
     """
-    plt.figure(figsize=(10, 8))
-    im = plt.imshow(data, cmap=cmap, interpolation='nearest')
-    plt.colorbar(im, label='Value')
-    plt.title(title)
-    plt.xlabel('X Position')
-    plt.ylabel('Y Position')
-    
+    data = np.fromfile(index_path, dtype=np.uint8)
+    if len(data) < LOG_INDEX_HEADER_DTYPE.itemsize:
+        raise ValueError("File too small for an index header")
+    header = np.frombuffer(data, dtype=LOG_INDEX_HEADER_DTYPE, count=1)[0]
+    if header['magic'] != LOG_INDEX_MAGIC or header['entry_size'] != LOG_INDEX_ENTRY_DTYPE.itemsize:
+        raise ValueError(f"Unsupported index file (magic {header['magic']!r}, entry size {header['entry_size']})")
+    body = data[LOG_INDEX_HEADER_DTYPE.itemsize:]
+    count = len(body) // LOG_INDEX_ENTRY_DTYPE.itemsize
+    raw = body[:count * LOG_INDEX_ENTRY_DTYPE.itemsize].reshape(count, LOG_INDEX_ENTRY_DTYPE.itemsize)
+    entries = raw.view(LOG_INDEX_ENTRY_DTYPE).ravel()
+    # A torn entry (power cut while writing it) fails the CRC and is dropped
+    crc_size = LOG_INDEX_ENTRY_DTYPE.fields['crc32'][1]
+    valid = np.fromiter((zlib.crc32(row[:crc_size]) for row in raw), dtype=np.uint32, count=count) == entries['crc32']
+    return entries[valid]
+
+
+def log_index_range(log_file_path, start_ms=None, end_ms=None):
+    """
+    Byte range of a log file that holds the frames between start_ms and end_ms.
+
+    Uses the sibling .idx file: the range starts at the last indexed record
+    that begins at or before start_ms and ends at the first one that begins
+    after end_ms, or at the last durable_end, so a tail that was never synced
+    (or the unused part of a preallocated file) is not read. Returns
+    (start_offset, end_offset), with None for an open end, or None if there
+    is no usable index.
+    """
+    index_path = Path(log_file_path).with_suffix('.idx')
+    if not index_path.exists():
+        return None
+    try:
+        entries = read_log_index(index_path)
+    except ValueError as e:
+        print(f"Warning: Ignoring index {index_path}: {e}")
+        return None
+    if len(entries) == 0:
+        return None
+    timestamps = entries['timestamp_us']
+    start_offset = None
+    if start_ms is not None:
+        i = np.searchsorted(timestamps, int(start_ms * 1000), side='right') - 1
+        start_offset = int(entries['offset'][i]) if i >= 0 else None
+    end_offset = int(entries['durable_end'][-1])
+    if end_ms is not None:
+        j = np.searchsorted(timestamps, int(end_ms * 1000), side='right')
+        if j < len(entries):
+            end_offset = int(entries['offset'][j])
+    return start_offset, end_offset
+
+
+def select_time_window(frame_headers, time_window):
+    """
+    Mask of the frames whose timestamp_ms is inside time_window, a (start_ms, end_ms) pair where either may be None.
+    """
+    keep = np.ones(len(frame_headers), dtype=bool)
+    if time_window is None:
+        return keep
+    start_ms, end_ms = time_window
+    if start_ms is not None:
+        keep &= frame_headers['timestamp_ms'] >= start_ms
+    if end_ms is not None:
+        keep &= frame_headers['timestamp_ms'] <= end_ms
+    return keep
+
+
+def read_tofb(tofb_file_path, verify_crc=True, time_window=None):
+    """
+    Read a binary .tofb log written by the firmware or the PC simulator.
+
+    The file is memory-mapped and each block is decoded with np.frombuffer:
+    the per-frame headers are a structured array and the packed distances and
+    statuses of the valid zones are scattered into full frames through the
+    valid_mask bits, without a per-frame Python loop.
+
+    Returns tuple of (distance_data (N,8,8) int16, target_status_data (N,8,8) uint8,
+    frame_headers structured array of length N, extra) where extra maps
+    'range_sigma_mm' and 'signal_per_spad' to (N,8,8) arrays (empty dict for
+    version 1 files, which only stored distance and status). Zones that were
+    not valid are returned as 0. Frames with resolution 16 (4x4) are returned
+    on the 8x8 grid with each zone over 2x2 cells; valid_mask keeps the bits
+    of the frame's own zones.
+
+    Version 3 files may hold delta frames, which store only the zones that
+    changed since the last value written for the same sensor. They are
+    expanded into full frames by carrying forward, per sensor and zone, the
+    last stored value since the previous keyframe, and their valid_mask and
+    valid_count are rewritten to describe the reconstructed frame. Frames that
+    depend on a block skipped for a bad CRC are dropped up to the sensor's
+    next keyframe.
+
+    time_window, a (start_ms, end_ms) pair on the frames' timestamp_ms where
+    either may be None, keeps only the frames inside it. With a sibling .idx
+    file the reader seeks straight to the blocks of the window instead of
+    decoding the whole file; delta frames seeked into before their sensor's
+    next keyframe are dropped, as after a lost block. The index also bounds
+    the read at its last durable_end, which skips the garbage tail of a
+    preallocated file left by a power cut.
+    """
+    data = np.memmap(tofb_file_path, dtype=np.uint8, mode='r')
+    if len(data) < TOFB_FILE_HEADER_DTYPE.itemsize:
+        raise ValueError("File too small for a .tofb header")
+    file_header = np.frombuffer(data, dtype=TOFB_FILE_HEADER_DTYPE, count=1)[0]
+    version = int(file_header['version'])
+    if file_header['magic'] != TOFB_MAGIC or version not in (1, 2, 3):
+        raise ValueError(f"Unsupported .tofb file (magic {file_header['magic']!r}, version {file_header['version']})")
+
+    headers, distances, sigmas, signals, statuses = [], [], [], [], []
+    lost_at = []  # frame index following each block skipped for a bad CRC
+    n_read = 0
+    offset = int(file_header['header_size'])
+    data_end = len(data)
+    if time_window is not None:
+        byte_range = log_index_range(tofb_file_path, *time_window)
+        if byte_range is not None:
+            offset = max(offset, byte_range[0] or 0)
+            data_end = min(data_end, byte_range[1])
+    block_header_size = TOFB_BLOCK_HEADER_DTYPE.itemsize
+    while offset + block_header_size <= data_end:
+        block = np.frombuffer(data, dtype=TOFB_BLOCK_HEADER_DTYPE, count=1, offset=offset)[0]
+        payload_start = offset + block_header_size
+        payload_end = payload_start + int(block['payload_size'])
+        if block['sync'] != TOFB_BLOCK_SYNC or payload_end > data_end:
+            print(f"Warning: Truncated or corrupted .tofb block at offset {offset}, stopping")
+            break
+        offset = payload_end
+
+        payload = data[payload_start:payload_end]
+        if verify_crc and zlib.crc32(payload) != int(block['crc32']):
+            print(f"Warning: Skipping .tofb block with bad CRC at offset {payload_start - block_header_size}")
+            lost_at.append(n_read)
+            continue
+
+        n_frames = int(block['frame_count'])
+        n_zones = int(block['zone_count'])
+        frame_bytes = n_frames * TOFB_FRAME_HEADER_DTYPE.itemsize
+        headers.append(np.frombuffer(payload, dtype=TOFB_FRAME_HEADER_DTYPE, count=n_frames))
+        distances.append(np.frombuffer(payload, dtype='<i2', count=n_zones, offset=frame_bytes))
+        offset_status = frame_bytes + 2 * n_zones
+        if version >= 2:
+            sigmas.append(np.frombuffer(payload, dtype='<u2', count=n_zones, offset=frame_bytes + 2 * n_zones))
+            signals.append(np.frombuffer(payload, dtype='<u4', count=n_zones, offset=frame_bytes + 4 * n_zones))
+            offset_status = frame_bytes + 8 * n_zones
+        statuses.append(np.frombuffer(payload, dtype=np.uint8, count=n_zones, offset=offset_status))
+        n_read += n_frames
+
+    if not headers:
+        empty = np.zeros((0, 8, 8))
+        return empty.astype(np.int16), empty.astype(np.uint8), np.zeros(0, dtype=TOFB_FRAME_HEADER_DTYPE), {}
+
+    frame_headers = np.concatenate(headers)
+    packed_distances = np.concatenate(distances)
+    packed_statuses = np.concatenate(statuses)
+
+    # valid_mask bit i -> zone i; boolean (N, 64) in the same order the writer packed the zones
+    mask_bytes = frame_headers['valid_mask'].astype('<u8').view(np.uint8).reshape(-1, 8)
+    valid = np.unpackbits(mask_bytes, axis=1, bitorder='little').astype(bool)
+
+    distance_data = np.zeros((len(frame_headers), 64), dtype=np.int16)
+    target_status_data = np.zeros((len(frame_headers), 64), dtype=np.uint8)
+    distance_data[valid] = packed_distances
+    target_status_data[valid] = packed_statuses
+
+    extra = {}
+    if version >= 2:
+        for name, packed, dtype in (('range_sigma_mm', sigmas, np.uint16), ('signal_per_spad', signals, np.uint32)):
+            full = np.zeros((len(frame_headers), 64), dtype=dtype)
+            full[valid] = np.concatenate(packed)
+            extra[name] = full
+    if version >= 3:
+        is_delta = (frame_headers['valid_count'] & TOFB_FRAME_DELTA) != 0
+        if is_delta.any():
+            frame_headers, keep = _expand_tofb_deltas(
+                frame_headers, valid, is_delta, lost_at, [distance_data, target_status_data, *extra.values()])
+            distance_data = distance_data[keep]
+            target_status_data = target_status_data[keep]
+            extra = {name: full[keep] for name, full in extra.items()}
+    if time_window is not None:
+        keep = select_time_window(frame_headers, time_window)
+        frame_headers = frame_headers[keep]
+        distance_data = distance_data[keep]
+        target_status_data = target_status_data[keep]
+        extra = {name: full[keep] for name, full in extra.items()}
+    for full in (distance_data, target_status_data, *extra.values()):
+        upsample_4x4(full, frame_headers['resolution'])
+    extra = {name: full.reshape(-1, 8, 8) for name, full in extra.items()}
+    return distance_data.reshape(-1, 8, 8), target_status_data.reshape(-1, 8, 8), frame_headers, extra
+
+
+def _expand_tofb_deltas(frame_headers, stored, is_delta, lost_at, arrays):
+    """
+    Reconstruct full frames from the keyframes and delta frames of a .tofb file.
+
+    stored is the (N, 64) mask of zones present in each frame record; arrays
+    are (N, 64) arrays scattered from the records and updated in place. Each
+    zone takes the value of the latest record of the same sensor that wrote it,
+    where a keyframe writes every zone (the ones it omits as invalid). Returns
+    the rewritten headers and the mask of frames to keep.
+    """
+    n = len(frame_headers)
+    written = stored | ~is_delta[:, None]
+    keep = np.ones(n, dtype=bool)
+    frame_index = np.arange(n)
+    for sid in np.unique(frame_headers['sensor_id']):
+        rows = np.flatnonzero(frame_headers['sensor_id'] == sid)
+        # Per zone, the latest row (of this sensor) that wrote it; -1 before the first keyframe
+        source = np.where(written[rows], frame_index[:len(rows), None], -1)
+        np.maximum.accumulate(source, axis=0, out=source)
+        known = source >= 0
+        source_rows = rows[np.maximum(source, 0)]
+        for full in arrays:
+            full[rows] = np.where(known, full[source_rows, np.arange(64)], 0)
+        keyframes = rows[~is_delta[rows]]
+        for lost in [0] + lost_at:
+            # Before the first keyframe and after a lost block, frames up to
+            # the next keyframe rest on missing state
+            next_key = keyframes[np.searchsorted(keyframes, lost)] if np.any(keyframes >= lost) else n
+            keep[rows[(rows >= lost) & (rows < next_key)]] = False
+
+    distance_data, target_status_data = arrays[0], arrays[1]
+    invalidated = target_status_data == TOFB_STATUS_INVALIDATED
+    for full in arrays:
+        full[invalidated] = 0
+    valid = (target_status_data == 5) | (target_status_data == 9)
+    frame_headers = frame_headers.copy()
+    frame_headers['valid_mask'] = np.packbits(valid, axis=1, bitorder='little').view('<u8').ravel()
+    frame_headers['valid_count'] = valid.sum(axis=1)
+    return frame_headers[keep], keep
+
+
+# Binary UART stream (see firmware/components/tof_common/inc/tof_stream.h)
+TOFS_MSG_FRAME = 0x01
+TOFS_FRAME_HEADER_DTYPE = np.dtype([
+    ('type', 'u1'), ('resolution', 'u1'), ('streamcount', 'u1'), ('targets_per_zone', 'u1'),
+    ('sequence', '<u4'), ('timestamp_ms', '<u4'), ('silicon_temp_degc', 'i1'), ('sensor_id', 'u1'), ('reserved', 'u1', 2)])
+TOFS_TARGET_SIZE = 2 + 2 + 4 + 1
+TOFS_MSG_MOTION = 0x02
+TOFS_MOTION_SUPPRESSED = 0x01
+TOFS_MOTION_AGGREGATES = 32
+TOFS_MOTION_HEADER_DTYPE = np.dtype([
+    ('type', 'u1'), ('sensor_id', 'u1'), ('status', 'u1'), ('nb_detected_aggregates', 'u1'),
+    ('nb_aggregates', 'u1'), ('flags', 'u1'), ('reserved', 'u1', 2), ('sequence', '<u4'), ('timestamp_ms', '<u4'),
+    ('global_indicator_1', '<u4'), ('global_indicator_2', '<u4'), ('active_mask', '<u4')])
+TOFS_MOTION_DTYPE = np.dtype([
+    ('sensor_id', 'u1'), ('sequence', '<u4'), ('timestamp_ms', '<u4'), ('status', 'u1'),
+    ('nb_detected_aggregates', 'u1'), ('nb_aggregates', 'u1'), ('suppressed', '?'),
+    ('global_indicator_1', '<u4'), ('global_indicator_2', '<u4'), ('active_mask', '<u4'),
+    ('motion', '<u4', TOFS_MOTION_AGGREGATES)])
+TOFS_MSG_CNH = 0x03
+TOFS_CNH_HEADER_DTYPE = np.dtype([
+    ('type', 'u1'), ('sensor_id', 'u1'), ('nb_aggregates', 'u1'), ('nb_bins', 'u1'),
+    ('sequence', '<u4'), ('timestamp_ms', '<u4'), ('ref_residual', '<u4')])
+TOFS_MSG_TELEMETRY = 0x04
+TOFS_TELEMETRY_HEADER_DTYPE = np.dtype([
+    ('type', 'u1'), ('stage_count', 'u1'), ('reserved', 'u1', 2), ('uptime_ms', '<u4'), ('interval_ms', '<u4')])
+TOFS_LATENCY_SUMMARY_DTYPE = np.dtype([
+    ('count', '<u4'), ('p50_ns', '<u4'), ('p99_ns', '<u4'), ('max_ns', '<u4')])
+# Order of tof_latency_stage_t (firmware/components/tof_common/inc/tof_latency.h)
+TOFS_LATENCY_STAGES = ('int_to_read', 'spi_read', 'parse', 'convert', 'filter', 'uart_emit', 'sd_write',
+                       'frame_to_can')
+
+
+def cobs_decode(chunk):
+    """
+    Decode one COBS-encoded chunk (bytes between two 0x00 delimiters).
+
+    Returns the decoded bytes, or None if the encoding is invalid.
+    """
+    out = bytearray()
+    pos = 0
+    while pos < len(chunk):
+        code = chunk[pos]
+        end = pos + code
+        if code == 0 or end > len(chunk):
+            return None
+        out += chunk[pos + 1:end]
+        pos = end
+        if code != 0xFF and pos < len(chunk):
+            out.append(0)
+    return bytes(out)
+
+
+def read_tofs(tofs_file_path):
+    """
+    Read a raw capture of the firmware's binary UART stream.
+
+    The capture is split on the 0x00 delimiters; each chunk is COBS-decoded
+    and checked against its CRC-16/CCITT-FALSE trailer. Console text mixed
+    into the capture and corrupted packets are skipped.
+
+    Only the first target of each zone is returned in the (N,8,8) arrays.
+    4x4 frames (resolution 16 in the header) are returned on the 8x8 grid
+    with each zone over 2x2 cells.
+    Returns tuple of (distance_data (N,8,8) int16, target_status_data (N,8,8) uint8,
+    frame_headers structured array of length N, extra) where extra maps
+    'range_sigma_mm', 'signal_per_spad' and 'nb_target_detected' to (N,8,8) arrays.
+    Motion-indicator packets (firmware SENSOR_MOTION_MODE) are returned in
+    extra['motion'] as a TOFS_MOTION_DTYPE array, one entry per frame, with the
+    aggregates that were not sent set to 0; 'suppressed' marks the frames whose
+    distances were not sent. CNH histogram packets (firmware SENSOR_CNH_MODE,
+    also the format of the tof_cnh.tofs file on the SD card) are returned in
+    extra['cnh'] as a list of dicts, one per frame (see _decode_tofs_cnh).
+    Latency telemetry packets (firmware SENSOR_LATENCY_STATS, one per stats
+    interval) are returned in extra['telemetry'] as a list of dicts (see
+    _decode_tofs_telemetry).
+    """
+    raw = Path(tofs_file_path).read_bytes()
+    header_size = TOFS_FRAME_HEADER_DTYPE.itemsize
+    fields = {'distance_mm': [], 'range_sigma_mm': [], 'signal_per_spad': [],
+              'target_status': [], 'nb_target_detected': []}
+    headers = []
+    motion = []
+    cnh = []
+    telemetry = []
+    rejected = 0
+    for chunk in raw.split(b'\x00'):
+        if not chunk:
+            continue
+        packet = cobs_decode(chunk)
+        if packet is None or len(packet) < header_size + 2:
+            rejected += 1
+            continue
+        if packet[0] == TOFS_MSG_MOTION:
+            record = _decode_tofs_motion(packet)
+            if record is None:
+                rejected += 1
+            else:
+                motion.append(record)
+            continue
+        if packet[0] == TOFS_MSG_CNH:
+            record = _decode_tofs_cnh(packet)
+            if record is None:
+                rejected += 1
+            else:
+                cnh.append(record)
+            continue
+        if packet[0] == TOFS_MSG_TELEMETRY:
+            record = _decode_tofs_telemetry(packet)
+            if record is None:
+                rejected += 1
+            else:
+                telemetry.append(record)
+            continue
+        header = np.frombuffer(packet, dtype=TOFS_FRAME_HEADER_DTYPE, count=1)[0]
+        zones = int(header['resolution'])
+        per_zone = max(int(header['targets_per_zone']), 1)
+        targets = zones * per_zone
+        if (header['type'] != TOFS_MSG_FRAME or zones not in (16, 64) or
+                len(packet) != header_size + zones + TOFS_TARGET_SIZE * targets + 2 or
+                binascii.crc_hqx(packet[:-2], 0xFFFF) != int.from_bytes(packet[-2:], 'little')):
+            rejected += 1
+            continue
+        headers.append(header)
+        offset = header_size
+        grid = UPSAMPLE_4X4 if zones == 16 else slice(None)
+        fields['nb_target_detected'].append(np.frombuffer(packet, dtype=np.uint8, count=zones, offset=offset)[grid])
+        offset += zones
+        for name, dtype in (('distance_mm', '<i2'), ('range_sigma_mm', '<u2'),
+                            ('signal_per_spad', '<u4'), ('target_status', 'u1')):
+            values = np.frombuffer(packet, dtype=dtype, count=targets, offset=offset)
+            offset += values.nbytes
+            fields[name].append(values[::per_zone][grid])
+
+    if rejected:
+        print(f"Warning: Skipped {rejected} invalid chunks in UART stream capture")
+    extra = {'motion': np.array(motion, dtype=TOFS_MOTION_DTYPE)} if motion else {}
+    if cnh:
+        extra['cnh'] = cnh
+    if telemetry:
+        extra['telemetry'] = telemetry
+    if not headers:
+        empty = np.zeros((0, 8, 8))
+        return empty.astype(np.int16), empty.astype(np.uint8), np.zeros(0, dtype=TOFS_FRAME_HEADER_DTYPE), extra
+    arrays = {name: np.stack(values).reshape(-1, 8, 8) for name, values in fields.items()}
+    extra.update({name: arrays[name] for name in ('range_sigma_mm', 'signal_per_spad', 'nb_target_detected')})
+    return (arrays['distance_mm'], arrays['target_status'],
+            np.array(headers, dtype=TOFS_FRAME_HEADER_DTYPE), extra)
+
+
+def _decode_tofs_motion(packet):
+    """
+    Decode one motion-indicator packet (already COBS-decoded).
+
+    Returns a TOFS_MOTION_DTYPE record, or None on a length or CRC mismatch.
+    """
+    header_size = TOFS_MOTION_HEADER_DTYPE.itemsize
+    if len(packet) < header_size + 2:
+        return None
+    header = np.frombuffer(packet, dtype=TOFS_MOTION_HEADER_DTYPE, count=1)[0]
+    mask = int(header['active_mask'])
+    active = [i for i in range(TOFS_MOTION_AGGREGATES) if mask >> i & 1]
+    if (len(packet) != header_size + 4 * len(active) + 2 or
+            binascii.crc_hqx(packet[:-2], 0xFFFF) != int.from_bytes(packet[-2:], 'little')):
+        return None
+    values = np.zeros(TOFS_MOTION_AGGREGATES, dtype='<u4')
+    values[active] = np.frombuffer(packet, dtype='<u4', count=len(active), offset=header_size)
+    return (header['sensor_id'], header['sequence'], header['timestamp_ms'], header['status'],
+            header['nb_detected_aggregates'], header['nb_aggregates'],
+            bool(header['flags'] & TOFS_MOTION_SUPPRESSED), header['global_indicator_1'],
+            header['global_indicator_2'], mask, values)
+
+
+def _decode_tofs_cnh(packet):
+    """
+    Decode one CNH histogram packet (already COBS-decoded, see tof_cnh.h).
+
+    Returns a dict with the header fields, 'ambient' and 'ambient_scaler'
+    (one value per aggregate), 'hist' (aggregates x bins, int32) and
+    'hist_scaler' (int8), plus 'histograms' and 'ambient_level' as floats
+    (value x 2**-scaler), or None on a CRC or length mismatch.
+    """
+    header_size = TOFS_CNH_HEADER_DTYPE.itemsize
+    if (len(packet) < header_size + 2 or
+            binascii.crc_hqx(packet[:-2], 0xFFFF) != int.from_bytes(packet[-2:], 'little')):
+        return None
+    header = np.frombuffer(packet, dtype=TOFS_CNH_HEADER_DTYPE, count=1)[0]
+    aggregates = int(header['nb_aggregates'])
+    bins = int(header['nb_bins'])
+
+    # Zigzag varints; every aggregate is ambient, ambient_scaler, bin scaler deltas, bin deltas
+    values = []
+    acc = shift = 0
+    for byte in packet[header_size:-2]:
+        acc |= (byte & 0x7F) << shift
+        shift += 7
+        if byte & 0x80 == 0:
+            values.append((acc >> 1) ^ -(acc & 1))
+            acc = shift = 0
+    if shift != 0 or len(values) != aggregates * (2 + 2 * bins):
+        return None
+    values = np.array(values, dtype=np.int64).reshape(aggregates, 2 + 2 * bins)
+
+    # The deltas restart at every aggregate and wrap modulo 2**32, like the int32 they came from
+    hist = (np.cumsum(values[:, 2 + bins:], axis=1) & 0xFFFFFFFF).astype(np.uint32).view(np.int32)
+    hist_scaler = np.cumsum(values[:, 2:2 + bins], axis=1).astype(np.int8)
+    ambient = values[:, 0].astype(np.int32)
+    ambient_scaler = values[:, 1].astype(np.int8)
+    return {
+        'sensor_id': int(header['sensor_id']), 'sequence': int(header['sequence']),
+        'timestamp_ms': int(header['timestamp_ms']), 'ref_residual': int(header['ref_residual']),
+        'ambient': ambient, 'ambient_scaler': ambient_scaler, 'hist': hist, 'hist_scaler': hist_scaler,
+        'histograms': hist * np.exp2(-hist_scaler.astype(np.float64)),
+        'ambient_level': ambient * np.exp2(-ambient_scaler.astype(np.float64)),
+    }
+
+
+def _decode_tofs_telemetry(packet):
+    """
+    Decode one latency telemetry packet (already COBS-decoded, see tof_latency.h).
+
+    Returns a dict with 'uptime_ms', 'interval_ms' and 'stages', which maps each
+    name in TOFS_LATENCY_STAGES to a dict of count, p50_ns, p99_ns and max_ns
+    for that interval (stages the firmware did not send are omitted), or None
+    on a CRC or length mismatch.
+    """
+    header_size = TOFS_TELEMETRY_HEADER_DTYPE.itemsize
+    if len(packet) < header_size + 2:
+        return None
+    header = np.frombuffer(packet, dtype=TOFS_TELEMETRY_HEADER_DTYPE, count=1)[0]
+    count = int(header['stage_count'])
+    if (len(packet) != header_size + count * TOFS_LATENCY_SUMMARY_DTYPE.itemsize + 2 or
+            binascii.crc_hqx(packet[:-2], 0xFFFF) != int.from_bytes(packet[-2:], 'little')):
+        return None
+    summaries = np.frombuffer(packet, dtype=TOFS_LATENCY_SUMMARY_DTYPE, count=count, offset=header_size)
+    stages = {name: {field: int(summary[field]) for field in TOFS_LATENCY_SUMMARY_DTYPE.names}
+              for name, summary in zip(TOFS_LATENCY_STAGES, summaries)}
+    return {'uptime_ms': int(header['uptime_ms']), 'interval_ms': int(header['interval_ms']), 'stages': stages}
+
+
+def _draw_heatmap(fig, ax, data, title, cmap):
+    """
+    Draw one 8x8 heatmap with its colorbar and per-cell values on ax.
+    """
+    im = ax.imshow(data, cmap=cmap, interpolation='nearest')
+    fig.colorbar(im, ax=ax, label='Value')
+    ax.set_title(title)
+    ax.set_xlabel('X Position')
+    ax.set_ylabel('Y Position')
+
     # Add text annotations for each cell
     for i in range(8):
         for j in range(8):
-            text = plt.text(j, i, f'{data[i, j]:.1f}', 
-                          ha="center", va="center", color="white", fontsize=8)
-    
-    plt.tight_layout()
-    plt.savefig(output_path, dpi=300, bbox_inches='tight')
-    plt.close()
+            ax.text(j, i, f'{data[i, j]:.1f}', ha="center", va="center", color="white", fontsize=8)
+
+
+def create_heatmap(data, title, output_path, cmap='viridis', dpi=300):
+    """
+    Create a heatmap PNG image from 8x8 data array.
+    """
+    fig, ax = plt.subplots(figsize=(10, 8))
+    _draw_heatmap(fig, ax, data, title, cmap)
+    fig.tight_layout()
+    fig.savefig(output_path, dpi=dpi, bbox_inches='tight')
+    plt.close(fig)
     print(f"Saved heatmap: {output_path}")
 
-def analyze_sensor_data(log_file_path):
+
+def create_tiled_heatmap(heatmaps, output_path, dpi=300):
+    """
+    Draw several (data, title, cmap) heatmaps side by side and save them as a single PNG.
+    """
+    fig, axes = plt.subplots(1, len(heatmaps), figsize=(10 * len(heatmaps), 8), squeeze=False)
+    for ax, (data, title, cmap) in zip(axes[0], heatmaps):
+        _draw_heatmap(fig, ax, data, title, cmap)
+    fig.tight_layout()
+    fig.savefig(output_path, dpi=dpi, bbox_inches='tight')
+    plt.close(fig)
+    print(f"Saved tiled heatmap: {output_path}")
+
+
+def render_heatmaps(heatmaps, jobs=None, dpi=300):
+    """
+    Render (data, title, output_path, cmap) heatmaps, one PNG each.
+
+    Drawing the annotated 300-dpi figures dominates the analysis time, and
+    pyplot cannot draw figures concurrently in threads, so each heatmap is
+    rendered in its own worker process (jobs processes, default one per
+    heatmap; jobs=1 renders in this process).
+    """
+    jobs = len(heatmaps) if jobs is None else max(1, jobs)
+    if jobs == 1 or len(heatmaps) == 1:
+        for data, title, output_path, cmap in heatmaps:
+            create_heatmap(data, title, output_path, cmap, dpi)
+        return
+    with ProcessPoolExecutor(max_workers=min(jobs, len(heatmaps))) as pool:
+        futures = [pool.submit(create_heatmap, data, title, output_path, cmap, dpi)
+                   for data, title, output_path, cmap in heatmaps]
+        for future in futures:
+            future.result()
+
+def analyze_sensor_data(log_file_path, sensor_id=None, time_window=None, tiled=False, jobs=None, dpi=300):
     """
     Main analysis function that processes log file and generates visualizations.
+
+    Binary logs and stream captures may interleave frames from several sensors
+    (sensor_id in each frame header); the heatmaps are built for one sensor,
+    the requested one or the lowest id present. time_window, a (start_ms,
+    end_ms) pair on the device clock, restricts the analysis to those frames
+    (seeking through the .idx file of a .tofb log when there is one).
+
+    The mean, standard deviation and validity heatmaps are rendered in
+    parallel worker processes (jobs), or, with tiled, as the panels of a
+    single PNG.
     """
     print(f"Processing log file: {log_file_path}")
     
-    # Extract hex data
-    distance_arrays, target_status_arrays, valid_measurements = extract_hex_data_from_log(log_file_path)
-    
-    if not distance_arrays:
-        print("No TOF hex data found in log file!")
-        return
+    suffix = Path(log_file_path).suffix
+    if suffix in ('.tofb', '.tofs'):
+        # Binary log or UART stream capture: already decoded into (n x 8 x 8) arrays
+        if suffix == '.tofb':
+            distance_data, target_status_data, frame_headers, extra = read_tofb(log_file_path, time_window=time_window)
+        else:
+            distance_data, target_status_data, frame_headers, extra = read_tofs(log_file_path)
+            in_window = select_time_window(frame_headers, time_window)
+            distance_data = distance_data[in_window]
+            target_status_data = target_status_data[in_window]
+            frame_headers = frame_headers[in_window]
+        if 'motion' in extra:
+            motion = extra['motion']
+            print(f"Motion packets: {len(motion)}, distances suppressed in {int(motion['suppressed'].sum())} frames")
+        if 'cnh' in extra:
+            cnh = extra['cnh']
+            shape = cnh[0]['hist'].shape
+            print(f"CNH packets: {len(cnh)} ({shape[0]} aggregates x {shape[1]} bins)")
+        if 'telemetry' in extra:
+            worst = {}
+            for record in extra['telemetry']:
+                for name, summary in record['stages'].items():
+                    if summary['count'] > 0:
+                        worst[name] = max(worst.get(name, 0), summary['p99_ns'])
+            print(f"Latency telemetry packets: {len(extra['telemetry'])}; worst p99 per stage: " +
+                  ", ".join(f"{name} {ns / 1000:.1f} us" for name, ns in worst.items()))
+        if len(distance_data) == 0:
+            print(f"No frames found in {suffix} file!")
+            return
+        sensor_ids = np.unique(frame_headers['sensor_id'])
+        if sensor_id is None:
+            sensor_id = int(sensor_ids[0])
+        if len(sensor_ids) > 1 or sensor_id not in sensor_ids:
+            print(f"Frames from sensors {sensor_ids.tolist()}; analyzing sensor {sensor_id}")
+        selected = frame_headers['sensor_id'] == sensor_id
+        distance_data = distance_data[selected]
+        target_status_data = target_status_data[selected]
+        if len(distance_data) == 0:
+            print(f"No frames from sensor {sensor_id} in {suffix} file!")
+            return
+        distance_arrays = distance_data
+        valid_counts = np.sum((target_status_data == 5) | (target_status_data == 9), axis=(1, 2))
+    else:
+        if time_window is not None:
+            print("Warning: Text logs have no frame timestamps, --from/--to ignored")
+        # Extract hex data, already decoded into (n x 8 x 8) arrays
+        distance_data, target_status_data, valid_counts = extract_hex_data_from_log(log_file_path)
+
+        if len(distance_data) == 0:
+            print("No TOF hex data found in log file!")
+            return
+        distance_arrays = distance_data
     
     print(f"Found {len(distance_arrays)} sensor measurements")
     
-    # Convert to numpy arrays (n x 8 x 8)
-    distance_data = np.stack(distance_arrays, axis=0)
-    target_status_data = np.stack(target_status_arrays, axis=0)
-    valid_counts = np.array(valid_measurements)
-    
     print(f"Distance data shape: {distance_data.shape}")
     print(f"Target status data shape: {target_status_data.shape}")
     print(f"Valid measurements per frame: {np.mean(valid_counts):.1f} ± {np.std(valid_counts):.1f} (out of 64)")
@@ -152,21 +809,23 @@ def analyze_sensor_data(log_file_path):
     
     # Generate visualizations
     log_name = Path(log_file_path).stem
+    if sensor_id is not None:
+        log_name = f"{log_name}_sensor{sensor_id}"
     
-    # Distance mean heatmap
+    # Distance mean, distance standard deviation and validity percentage heatmaps
     mean_output = output_dir / f"{log_name}_distance_mean.png"
-    create_heatmap(mean_distance, f"VL53L8CH Distance Mean ({len(distance_arrays)} measurements)", 
-                   mean_output, cmap='plasma')
-    
-    # Distance standard deviation heatmap
     std_output = output_dir / f"{log_name}_distance_std.png"
-    create_heatmap(std_distance, f"VL53L8CH Distance Std Dev ({len(distance_arrays)} measurements)", 
-                   std_output, cmap='hot')
-    
-    # Validity percentage heatmap
     validity_output = output_dir / f"{log_name}_validity.png"
-    create_heatmap(validity_percentage, f"VL53L8CH Validity Percentage ({len(distance_arrays)} measurements)", 
-                   validity_output, cmap='RdYlGn')
+    heatmaps = [
+        (mean_distance, f"VL53L8CH Distance Mean ({len(distance_arrays)} measurements)", mean_output, 'plasma'),
+        (std_distance, f"VL53L8CH Distance Std Dev ({len(distance_arrays)} measurements)", std_output, 'hot'),
+        (validity_percentage, f"VL53L8CH Validity Percentage ({len(distance_arrays)} measurements)", validity_output, 'RdYlGn'),
+    ]
+    if tiled:
+        tiled_output = output_dir / f"{log_name}_heatmaps.png"
+        create_tiled_heatmap([(data, title, cmap) for data, title, _, cmap in heatmaps], tiled_output, dpi)
+    else:
+        render_heatmaps(heatmaps, jobs, dpi)
     
     # Save raw data
     np.save(output_dir / f"{log_name}_distance_data.npy", distance_data)
@@ -176,9 +835,12 @@ def analyze_sensor_data(log_file_path):
     np.save(output_dir / f"{log_name}_validity.npy", validity_percentage)
     
     print(f"\nAnalysis complete! Files saved to: {output_dir}")
-    print(f"- Distance mean heatmap: {mean_output}")
-    print(f"- Distance std heatmap: {std_output}")
-    print(f"- Validity heatmap: {validity_output}")
+    if tiled:
+        print(f"- Tiled heatmaps: {tiled_output}")
+    else:
+        print(f"- Distance mean heatmap: {mean_output}")
+        print(f"- Distance std heatmap: {std_output}")
+        print(f"- Validity heatmap: {validity_output}")
     print(f"- Raw distance data: {output_dir / f'{log_name}_distance_data.npy'}")
     print(f"- Raw target status data: {output_dir / f'{log_name}_target_status_data.npy'}")
 
@@ -217,9 +879,21 @@ def find_latest_log_with_data():
     return None
 
 def main():
-    parser = argparse.ArgumentParser(description='Parse VL53L8CH sensor data from PlatformIO logs')
+    parser = argparse.ArgumentParser(description='Parse VL53L8CH sensor data from PlatformIO logs, .tofb binary logs or .tofs UART stream captures')
     parser.add_argument('log_file', nargs='?', 
-                       help='Path to log file (default: automatically find latest)')
+                       help='Path to log file, .tofb binary log or .tofs stream capture (default: automatically find latest)')
+    parser.add_argument('--sensor', type=int, default=None,
+                       help='Sensor id to analyze in .tofb/.tofs files with several sensors (default: lowest id present)')
+    parser.add_argument('--from', dest='start_s', type=float, default=None,
+                       help='Analyze .tofb/.tofs frames from this time on, in seconds of the device clock (a .tofb log seeks through its .idx file)')
+    parser.add_argument('--to', dest='end_s', type=float, default=None,
+                       help='Analyze .tofb/.tofs frames up to this time, in seconds of the device clock')
+    parser.add_argument('--tiled', action='store_true',
+                       help='Save the three heatmaps as panels of a single PNG instead of one PNG each')
+    parser.add_argument('--jobs', type=int, default=None,
+                       help='Worker processes rendering the heatmaps (default: one per heatmap; 1 = no workers)')
+    parser.add_argument('--dpi', type=int, default=300,
+                       help='Resolution of the saved PNGs (default: 300)')
     
     args = parser.parse_args()
     
@@ -234,7 +908,11 @@ def main():
         if not log_file:
             return
     
-    analyze_sensor_data(log_file)
+    time_window = None
+    if args.start_s is not None or args.end_s is not None:
+        time_window = (None if args.start_s is None else args.start_s * 1000,
+                       None if args.end_s is None else args.end_s * 1000)
+    analyze_sensor_data(log_file, args.sensor, time_window, args.tiled, args.jobs, args.dpi)
 
 if __name__ == "__main__":
     main()
\ No newline at end of file
@@ -0,0 +1,200 @@
+/**
+ * @file tof_bin.h
+ * @brief Formato binário compacto de log de frames (.tofb).
+ *
+ * Layout do arquivo (todos os campos em little-endian):
+ *
+ *     tof_bin_file_header_t                         (uma vez, no início)
+ *     bloco 0: tof_bin_block_header_t + payload
+ *     bloco 1: ...
+ *
+ * O payload de cada bloco é colunar, para que possa ser lido diretamente
+ * com np.frombuffer() sem laço por frame:
+ *
+ *     frame_count x tof_bin_frame_header_t          (16 bytes cada)
+ *     zone_count  x int16 distance_mm               (apenas zonas válidas, em ordem de frame e de zona)
+ *     zone_count  x uint16 range_sigma_mm
+ *     zone_count  x uint32 signal_per_spad
+ *     zone_count  x uint8 target_status
+ *     preenchimento com zeros até múltiplo de 4 bytes
+ *
+ * As zonas válidas de cada frame são indicadas por valid_mask (bit i = zona i).
+ * Com mais de um alvo por zona, apenas o primeiro alvo (o mais próximo ou o
+ * mais forte, conforme a ordem configurada no sensor) é gravado.
+ * O campo payload_size do cabeçalho do bloco é o prefixo de tamanho que
+ * permite pular blocos, e crc32 (igual a zlib.crc32) cobre todo o payload.
+ *
+ * Modo delta (versão 3): a cada keyframe_interval frames de um sensor é
+ * gravado um keyframe, igual a um frame comum; nos demais, valid_count tem o
+ * bit TOF_BIN_FRAME_DELTA ligado e valid_mask passa a indicar as zonas
+ * gravadas, que são só as que mudaram em relação ao último valor gravado do
+ * mesmo sensor: zona que ficou válida ou deixou de ser (esta gravada com
+ * status TOF_BIN_STATUS_INVALIDATED), status diferente ou distância a mais de
+ * threshold_mm. O frame completo é reconstruído repetindo, em cada zona não
+ * gravada, o último valor gravado desde o keyframe. Numa cena parada quase
+ * só os keyframes ocupam espaço.
+ */
+
+#ifndef TOF_BIN_H
+#define TOF_BIN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+#define TOF_BIN_MAGIC "TOFB"                        /**< Assinatura no início do arquivo. */
+#define TOF_BIN_VERSION 3                           /**< Versão atual do formato (1: sem range_sigma_mm e signal_per_spad; 2: sem frames delta). */
+#define TOF_BIN_BLOCK_SYNC 0x4B4C4254u              /**< Marcador de início de bloco ("TBLK" em little-endian). */
+#define TOF_BIN_MAX_FRAMES_PER_BLOCK 16             /**< Frames acumulados antes de fechar um bloco. */
+#define TOF_BIN_FRAME_DELTA 0x80                    /**< Bit de valid_count que marca um frame delta; os 7 bits baixos são as zonas gravadas. */
+#define TOF_BIN_STATUS_INVALIDATED 255              /**< Status gravado num frame delta para a zona que deixou de ser válida. */
+#define TOF_BIN_DELTA_MAX_SENSORS 4                 /**< Sensores com estado delta próprio (sensor_id maior grava só keyframes). */
+
+/**
+ * @brief Cabeçalho do arquivo (16 bytes).
+ */
+typedef struct __attribute__((packed)) {
+    char magic[4];                                  /**< TOF_BIN_MAGIC. */
+    uint16_t version;                               /**< TOF_BIN_VERSION. */
+    uint16_t header_size;                           /**< sizeof(tof_bin_file_header_t). */
+    uint16_t block_header_size;                     /**< sizeof(tof_bin_block_header_t). */
+    uint16_t frame_header_size;                     /**< sizeof(tof_bin_frame_header_t). */
+    uint8_t distance_size;                          /**< Bytes por distância (2, int16 em mm). */
+    uint8_t status_size;                            /**< Bytes por status (1). */
+    uint8_t sigma_size;                             /**< Bytes por range_sigma_mm (2). */
+    uint8_t signal_size;                            /**< Bytes por signal_per_spad (4). */
+} tof_bin_file_header_t;
+
+/**
+ * @brief Cabeçalho de bloco (16 bytes).
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t sync;                                  /**< TOF_BIN_BLOCK_SYNC. */
+    uint32_t payload_size;                          /**< Bytes do payload que segue o cabeçalho (inclui preenchimento). */
+    uint16_t frame_count;                           /**< Frames no bloco. */
+    uint16_t zone_count;                            /**< Total de zonas válidas no bloco. */
+    uint32_t crc32;                                 /**< CRC-32 do payload. */
+} tof_bin_block_header_t;
+
+/**
+ * @brief Cabeçalho de frame (16 bytes).
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_ms;                          /**< Instante da aquisição, em ms. */
+    uint8_t streamcount;                            /**< Streamcount reportado pelo sensor. */
+    uint8_t resolution;                             /**< Zonas do frame (16 ou 64). */
+    uint8_t valid_count;                            /**< Zonas válidas (bits em valid_mask), com TOF_BIN_FRAME_DELTA nos frames delta. */
+    uint8_t sensor_id;                              /**< Sensor de origem (zero nos arquivos gravados antes do suporte a vários sensores). */
+    uint64_t valid_mask;                            /**< Bit i ligado = primeiro alvo da zona i válido (ver tof_frame_target_is_valid()); nos frames delta, zona i gravada. */
+} tof_bin_frame_header_t;
+
+/**
+ * @brief Acumulador de um bloco em formação.
+ */
+typedef struct {
+    tof_bin_frame_header_t headers[TOF_BIN_MAX_FRAMES_PER_BLOCK];
+    int16_t distances[TOF_BIN_MAX_FRAMES_PER_BLOCK * TOF_FRAME_MAX_ZONES];
+    uint16_t sigmas[TOF_BIN_MAX_FRAMES_PER_BLOCK * TOF_FRAME_MAX_ZONES];
+    uint32_t signals[TOF_BIN_MAX_FRAMES_PER_BLOCK * TOF_FRAME_MAX_ZONES];
+    uint8_t statuses[TOF_BIN_MAX_FRAMES_PER_BLOCK * TOF_FRAME_MAX_ZONES];
+    uint16_t frame_count;                           /**< Frames acumulados. */
+    uint16_t zone_count;                            /**< Zonas válidas acumuladas. */
+    int64_t first_frame_us;                         /**< Timestamp do primeiro frame do bloco. */
+} tof_bin_block_t;
+
+/**
+ * @brief Parâmetros do modo delta.
+ */
+typedef struct {
+    uint16_t keyframe_interval;                     /**< Frames de cada sensor entre dois keyframes (1 = só keyframes). */
+    uint16_t threshold_mm;                          /**< Variação de distância a partir da qual uma zona é regravada. */
+} tof_bin_delta_config_t;
+
+/**
+ * @brief Último valor gravado de cada zona de um sensor, base do próximo frame delta.
+ */
+typedef struct {
+    bool synced;                                    /**< Já houve um keyframe deste sensor. */
+    uint8_t resolution;                             /**< Resolução do último keyframe (uma mudança força outro). */
+    uint16_t frames_to_keyframe;                    /**< Frames delta restantes até o próximo keyframe. */
+    uint64_t valid_mask;                            /**< Zonas válidas na reconstrução. */
+    int16_t distance_mm[TOF_FRAME_MAX_ZONES];       /**< Última distância gravada por zona. */
+    uint8_t status[TOF_FRAME_MAX_ZONES];            /**< Último status gravado por zona. */
+} tof_bin_delta_sensor_t;
+
+/**
+ * @brief Contadores do modo delta.
+ */
+typedef struct {
+    uint32_t keyframes;                             /**< Keyframes gravados. */
+    uint32_t delta_frames;                          /**< Frames delta gravados. */
+    uint32_t zones_written;                         /**< Zonas gravadas em frames delta. */
+    uint32_t zones_skipped;                         /**< Zonas válidas omitidas por não terem mudado. */
+} tof_bin_delta_stats_t;
+
+/**
+ * @brief Estado do codificador delta de um arquivo.
+ */
+typedef struct {
+    tof_bin_delta_config_t config;                  /**< Parâmetros. */
+    tof_bin_delta_sensor_t sensors[TOF_BIN_DELTA_MAX_SENSORS]; /**< Estado de cada sensor, pelo sensor_id. */
+    tof_bin_delta_stats_t stats;                    /**< Contadores acumulados. */
+} tof_bin_delta_t;
+
+/** @brief Bytes por zona válida no payload (distância, sigma, sinal e status). */
+#define TOF_BIN_ZONE_SIZE (sizeof(int16_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t))
+
+/** @brief Tamanho máximo de um bloco codificado (cabeçalho + payload). */
+#define TOF_BIN_MAX_BLOCK_SIZE (sizeof(tof_bin_block_header_t) \
+    + TOF_BIN_MAX_FRAMES_PER_BLOCK * (sizeof(tof_bin_frame_header_t) + TOF_FRAME_MAX_ZONES * TOF_BIN_ZONE_SIZE) + 3)
+
+/**
+ * @brief Preenche o cabeçalho de arquivo da versão atual.
+ */
+void tof_bin_make_file_header(tof_bin_file_header_t *header);
+
+/**
+ * @brief Esvazia o bloco.
+ */
+void tof_bin_block_reset(tof_bin_block_t *block);
+
+/**
+ * @brief Acrescenta um frame ao bloco, mantendo apenas as zonas válidas.
+ * @return true se o frame foi acrescentado, false se o bloco já está cheio.
+ */
+bool tof_bin_block_add_frame(tof_bin_block_t *block, const tof_frame_t *frame);
+
+/**
+ * @brief Inicializa o codificador delta; o primeiro frame de cada sensor será um keyframe.
+ */
+void tof_bin_delta_init(tof_bin_delta_t *delta, const tof_bin_delta_config_t *config);
+
+/**
+ * @brief Acrescenta um frame ao bloco como keyframe ou frame delta, conforme o estado do sensor.
+ *
+ * Inicie cada arquivo com tof_bin_delta_init(): um frame delta só pode ser
+ * reconstruído a partir do keyframe anterior do mesmo arquivo.
+ * @return true se o frame foi acrescentado, false se o bloco já está cheio (o estado não muda).
+ */
+bool tof_bin_block_add_delta_frame(tof_bin_block_t *block, tof_bin_delta_t *delta, const tof_frame_t *frame);
+
+/**
+ * @brief Indica se o bloco atingiu TOF_BIN_MAX_FRAMES_PER_BLOCK.
+ */
+bool tof_bin_block_is_full(const tof_bin_block_t *block);
+
+/**
+ * @brief Tamanho do bloco codificado (cabeçalho + payload), em bytes.
+ */
+size_t tof_bin_block_encoded_size(const tof_bin_block_t *block);
+
+/**
+ * @brief Codifica o bloco (cabeçalho com CRC + payload).
+ * @param out Buffer de saída com ao menos tof_bin_block_encoded_size() bytes.
+ * @return Bytes escritos, ou 0 se o bloco estiver vazio ou o buffer for pequeno.
+ */
+size_t tof_bin_block_encode(const tof_bin_block_t *block, uint8_t *out, size_t capacity);
+
+#endif // TOF_BIN_H
@@ -0,0 +1,96 @@
+/**
+ * @file tof_cal.h
+ * @brief Registro do cache de calibração de xtalk e sua leitura e validação.
+ *
+ * O firmware guarda um registro por sensor e módulo na NVS. Os offsets vêm de
+ * fábrica na NVM do sensor e são relidos por vl53lmz_init a cada boot; o
+ * registro guarda o CRC deles como impressão digital do módulo, então trocar o
+ * sensor de um conector invalida o cache. A leitura do blob é feita por uma
+ * função do chamador com a semântica de nvs_get_blob(), o que permite testar
+ * o caminho de carga no PC com um armazenamento simulado.
+ */
+
+#ifndef TOF_CAL_H
+#define TOF_CAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TOF_CAL_MAGIC 0x4C414354u                   /**< "TCAL" em little-endian, início de um registro de calibração. */
+#define TOF_CAL_VERSION 1                           /**< Versão do layout de tof_cal_record_t. */
+#define TOF_CAL_XTALK_SIZE 776                      /**< Bytes do blob de xtalk (VL53LMZ_XTALK_BUFFER_SIZE do driver). */
+
+/**
+ * @brief Registro de calibração de um sensor. crc32 cobre todos os campos anteriores.
+ */
+typedef struct {
+    uint32_t magic;                                 /**< TOF_CAL_MAGIC. */
+    uint16_t version;                               /**< TOF_CAL_VERSION. */
+    uint8_t module_type;                            /**< Tipo do módulo lido pelo driver (VL53LMZ_MODULE_TYPE_*). */
+    uint8_t sensor_id;                              /**< Sensor calibrado. */
+    uint32_t offset_crc;                            /**< tof_crc32() dos offsets de fábrica (offset_data). */
+    uint8_t xtalk[TOF_CAL_XTALK_SIZE];              /**< Blob de xtalk (xtalk_data) após a calibração. */
+    uint32_t crc32;                                 /**< tof_crc32() do registro até xtalk. */
+} tof_cal_record_t;
+
+/**
+ * @brief Resultado da leitura de um blob pela função do chamador.
+ */
+typedef enum {
+    TOF_CAL_READ_OK = 0,                            /**< Blob lido; *len tem o tamanho gravado. */
+    TOF_CAL_READ_NOT_FOUND,                         /**< Não há blob com a chave. */
+    TOF_CAL_READ_FAILED,                            /**< Falha do armazenamento (inclui blob maior que a capacidade). */
+} tof_cal_read_status_t;
+
+/**
+ * @brief Lê um blob, com a semântica de nvs_get_blob().
+ * @param ctx Contexto do chamador.
+ * @param key Chave do blob.
+ * @param[out] out Destino do blob.
+ * @param[in,out] len Entra com a capacidade de out e sai com o tamanho do blob lido.
+ */
+typedef tof_cal_read_status_t (*tof_cal_read_fn)(void *ctx, const char *key, void *out, size_t *len);
+
+/**
+ * @brief Resultado de tof_cal_load().
+ */
+typedef enum {
+    TOF_CAL_LOADED = 0,                             /**< Registro válido para o módulo. */
+    TOF_CAL_MISSING,                                /**< Não há registro na chave. */
+    TOF_CAL_MISMATCH,                               /**< Registro de outro módulo, de outra versão ou corrompido. */
+    TOF_CAL_READ_ERROR,                             /**< O armazenamento falhou. */
+} tof_cal_load_result_t;
+
+/**
+ * @brief Monta um registro a partir do xtalk calibrado.
+ * @param[out] record Registro com o CRC já calculado.
+ * @param sensor_id Sensor calibrado.
+ * @param module_type Tipo do módulo.
+ * @param offset_crc CRC dos offsets de fábrica.
+ * @param xtalk Blob de xtalk com TOF_CAL_XTALK_SIZE bytes.
+ */
+void tof_cal_record_make(tof_cal_record_t *record, uint8_t sensor_id, uint8_t module_type,
+                         uint32_t offset_crc, const uint8_t *xtalk);
+
+/**
+ * @brief Indica se um registro lido é íntegro e pertence ao módulo instalado.
+ * @param record Registro lido.
+ * @param len Bytes lidos.
+ * @return true se o tamanho, a versão, o CRC e a identificação do módulo conferem.
+ */
+bool tof_cal_record_matches(const tof_cal_record_t *record, size_t len, uint8_t sensor_id,
+                            uint8_t module_type, uint32_t offset_crc);
+
+/**
+ * @brief Lê o registro de uma chave e o valida para o módulo instalado.
+ * @param read Leitura do blob.
+ * @param ctx Contexto repassado a read.
+ * @param key Chave do registro.
+ * @param[out] record Registro lido (vale com TOF_CAL_LOADED).
+ * @return Resultado da carga.
+ */
+tof_cal_load_result_t tof_cal_load(tof_cal_read_fn read, void *ctx, const char *key, tof_cal_record_t *record,
+                                   uint8_t sensor_id, uint8_t module_type, uint32_t offset_crc);
+
+#endif // TOF_CAL_H
@@ -0,0 +1,124 @@
+/**
+ * @file tof_cnh.h
+ * @brief Compressão dos histogramas CNH (Compressed Normalized Histograms) para gravação e streaming.
+ *
+ * Cada frame com o bloco CNH vira um pacote do mesmo canal de tof_stream.h
+ * (CRC16, COBS e delimitadores 0x00):
+ *
+ *     tof_cnh_header_t                              (16 bytes)
+ *     nb_aggregates x agregado:
+ *         varint zigzag(ambient)
+ *         varint zigzag(ambient_scaler)
+ *         nb_bins x varint zigzag(hist_scaler[b] - hist_scaler[b - 1])
+ *         nb_bins x varint zigzag(hist[b] - hist[b - 1])
+ *     uint16 crc16
+ *
+ * As diferenças partem de zero no primeiro bin de cada agregado e são
+ * calculadas módulo 2^32, então qualquer valor int32 volta exatamente. O
+ * varint é o LEB128 sem sinal (7 bits por byte, bit 7 = continua) e o
+ * zigzag leva 0, -1, 1, -2... a 0, 1, 2, 3...: bins vizinhos de um
+ * histograma diferem pouco e os scalers quase nunca mudam, então a maioria
+ * dos valores ocupa 1 ou 2 bytes em vez dos 4 + 1 do bloco do sensor.
+ *
+ * O valor de um bin é hist × 2^-hist_scaler (o scaler é o número de bits
+ * fracionários), e o mesmo vale para ambient com ambient_scaler.
+ */
+
+#ifndef TOF_CNH_H
+#define TOF_CNH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TOF_CNH_MAX_AGGREGATES 64                   /**< Agregados que um frame pode ter (VL53LMZ_CNH_AGG_MAX). */
+#define TOF_CNH_MAX_VALUES 1540                     /**< Bins somados de todos os agregados (cada bin ocupa ao menos uma das VL53LMZ_CNH_MAX_DATA_WORDS palavras). */
+#define TOF_CNH_VARINT_MAX 5                        /**< Bytes de um varint de 32 bits. */
+
+/**
+ * @brief Cabeçalho de um pacote CNH (16 bytes).
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t type;                                   /**< TOF_STREAM_MSG_CNH. */
+    uint8_t sensor_id;                              /**< Sensor de origem. */
+    uint8_t nb_aggregates;                          /**< Agregados que seguem. */
+    uint8_t nb_bins;                                /**< Bins por agregado. */
+    uint32_t sequence;                              /**< Contador de frames do firmware (o mesmo do pacote de frame). */
+    uint32_t timestamp_ms;                          /**< Instante da aquisição, em ms. */
+    uint32_t ref_residual;                          /**< Resíduo de referência do sensor (11 bits fracionários). */
+} tof_cnh_header_t;
+
+/** @brief Tamanho máximo do pacote de um frame antes do COBS, CRC incluído. */
+#define TOF_CNH_PACKET_BOUND(aggregates, bins) (sizeof(tof_cnh_header_t) \
+    + (size_t)(aggregates) * (2 * TOF_CNH_VARINT_MAX + (size_t)(bins) * 2 * TOF_CNH_VARINT_MAX) + 2)
+
+/** @brief Maior pacote que um decodificador pode receber, antes do COBS. */
+#define TOF_CNH_MAX_PACKET (sizeof(tof_cnh_header_t) \
+    + (TOF_CNH_MAX_AGGREGATES + TOF_CNH_MAX_VALUES) * 2 * TOF_CNH_VARINT_MAX + 2)
+
+/** @brief Tamanho máximo após COBS e os dois delimitadores, para um pacote de até packet bytes. */
+#define TOF_CNH_ENCODED_BOUND(packet) ((packet) + (packet) / 254 + 3)
+
+/**
+ * @brief Pacote CNH em montagem. Os campos são internos.
+ */
+typedef struct {
+    uint8_t *packet;                                /**< Buffer do pacote (antes do COBS). */
+    size_t capacity;                                /**< Tamanho do buffer. */
+    size_t len;                                     /**< Bytes já escritos. */
+    uint8_t nb_bins;                                /**< Bins por agregado, do cabeçalho. */
+    uint8_t remaining;                              /**< Agregados que ainda faltam. */
+    bool overflow;                                  /**< O buffer não comportou o pacote. */
+} tof_cnh_encoder_t;
+
+/**
+ * @brief Histogramas de um frame reconstruídos a partir de um pacote.
+ */
+typedef struct {
+    tof_cnh_header_t header;                        /**< Cabeçalho do pacote. */
+    int32_t ambient[TOF_CNH_MAX_AGGREGATES];        /**< Ambiente de cada agregado. */
+    int8_t ambient_scaler[TOF_CNH_MAX_AGGREGATES];  /**< Bits fracionários de ambient. */
+    int32_t hist[TOF_CNH_MAX_VALUES];               /**< Bin b do agregado a em hist[a * nb_bins + b]. */
+    int8_t hist_scaler[TOF_CNH_MAX_VALUES];         /**< Bits fracionários de cada bin, no mesmo arranjo. */
+} tof_cnh_frame_t;
+
+/**
+ * @brief Inicia um pacote.
+ * @param encoder Pacote a ser iniciado.
+ * @param packet Buffer com ao menos TOF_CNH_PACKET_BOUND(nb_aggregates, nb_bins) bytes.
+ * @param capacity Tamanho do buffer.
+ * @param header Cabeçalho (type é preenchido aqui).
+ */
+void tof_cnh_encoder_begin(tof_cnh_encoder_t *encoder, uint8_t *packet, size_t capacity,
+                           const tof_cnh_header_t *header);
+
+/**
+ * @brief Acrescenta o próximo agregado, na ordem dos agregados do sensor.
+ * @param encoder Pacote em montagem.
+ * @param hist nb_bins bins do agregado.
+ * @param hist_scaler Bits fracionários de cada bin.
+ * @param ambient Ambiente do agregado.
+ * @param ambient_scaler Bits fracionários do ambiente.
+ */
+void tof_cnh_encoder_add_aggregate(tof_cnh_encoder_t *encoder, const int32_t *hist, const int8_t *hist_scaler,
+                                   int32_t ambient, int8_t ambient_scaler);
+
+/**
+ * @brief Fecha o pacote: CRC, COBS e delimitadores.
+ * @param encoder Pacote com todos os agregados do cabeçalho.
+ * @param out Saída com ao menos TOF_CNH_ENCODED_BOUND() do pacote.
+ * @param capacity Tamanho da saída.
+ * @return Bytes prontos para envio, ou 0 se algum buffer for pequeno ou faltarem agregados.
+ */
+size_t tof_cnh_encoder_finish(tof_cnh_encoder_t *encoder, uint8_t *out, size_t capacity);
+
+/**
+ * @brief Decodifica um pacote CNH já sem COBS (ver tof_cobs_decode()).
+ * @param packet Pacote, CRC incluído.
+ * @param len Tamanho do pacote.
+ * @param frame Histogramas reconstruídos.
+ * @return true se o pacote é um pacote CNH válido (tamanho, limites e CRC corretos).
+ */
+bool tof_cnh_decode_packet(const uint8_t *packet, size_t len, tof_cnh_frame_t *frame);
+
+#endif // TOF_CNH_H
@@ -0,0 +1,29 @@
+/**
+ * @file tof_crc.h
+ * @brief CRCs usados nos formatos binários do projeto.
+ */
+
+#ifndef TOF_CRC_H
+#define TOF_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief CRC-32 IEEE 802.3 (polinômio refletido 0xEDB88320), idêntico a zlib.crc32().
+ * @param crc Valor parcial anterior (0 para iniciar).
+ * @param data Dados a acumular.
+ * @param len Tamanho dos dados em bytes.
+ * @return CRC atualizado.
+ */
+uint32_t tof_crc32(uint32_t crc, const void *data, size_t len);
+
+/**
+ * @brief CRC-16/CCITT-FALSE (polinômio 0x1021, valor inicial 0xFFFF), idêntico a binascii.crc_hqx(data, 0xFFFF).
+ * @param data Dados a acumular.
+ * @param len Tamanho dos dados em bytes.
+ * @return CRC calculado.
+ */
+uint16_t tof_crc16(const void *data, size_t len);
+
+#endif // TOF_CRC_H
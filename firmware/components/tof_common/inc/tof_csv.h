@@ -0,0 +1,30 @@
+/**
+ * @file tof_csv.h
+ * @brief Formatação dos frames no CSV `timestamp_ms,zone_id,distance_mm,status,range_sigma_mm,signal_per_spad,sensor_id,resolution`.
+ *
+ * zone_id é o índice da zona na resolução do frame (0 a 15 em 4x4, 0 a 63 em
+ * 8x8), e resolution é o número de zonas do frame.
+ */
+
+#ifndef TOF_CSV_H
+#define TOF_CSV_H
+
+#include <stddef.h>
+
+#include "tof_frame.h"
+
+#define TOF_CSV_HEADER "timestamp_ms,zone_id,distance_mm,status,range_sigma_mm,signal_per_spad,sensor_id,resolution\n" /**< Cabeçalho do arquivo CSV. */
+#define TOF_CSV_MAX_ROW_LEN 64                                        /**< Tamanho máximo de uma linha formatada. */
+#define TOF_CSV_MAX_FRAME_LEN (TOF_CSV_MAX_ROW_LEN * TOF_FRAME_MAX_TARGETS) /**< Pior caso de um frame inteiro. */
+
+/**
+ * @brief Formata os alvos válidos (ver tof_frame_target_is_valid()) de um frame, uma linha por alvo.
+ * Com mais de um alvo por zona, as linhas de uma mesma zona seguem a ordem dos alvos do sensor.
+ * @param out Buffer de saída (não é terminado em '\0').
+ * @param capacity Tamanho do buffer; TOF_CSV_MAX_FRAME_LEN sempre é suficiente.
+ * @param frame Frame a ser formatado. O timestamp é frame->timestamp_us / 1000.
+ * @return Número de bytes escritos, ou 0 se não houver zonas válidas ou o buffer for pequeno.
+ */
+size_t tof_csv_format_frame(char *out, size_t capacity, const tof_frame_t *frame);
+
+#endif // TOF_CSV_H
@@ -0,0 +1,127 @@
+/**
+ * @file tof_filter.h
+ * @brief Filtro temporal por zona das distâncias, entre a aquisição e a gravação.
+ *
+ * Atua sobre o primeiro alvo de cada zona válida (ver tof_frame_valid_mask());
+ * a validade, os status e os demais alvos não são alterados. Três modos:
+ *  - mediana das últimas N medidas (3, 5 ou 7), que elimina picos isolados;
+ *  - média móvel exponencial, com peso da nova medida em Q8;
+ *  - Kalman de posição constante por zona, com a variância da medida vinda de
+ *    range_sigma_mm e rejeição das medidas a mais de kalman_gate_sigma desvios
+ *    da estimativa (a zona mantém a estimativa e, após kalman_max_rejects
+ *    rejeições seguidas, é reiniciada na medida atual).
+ * Toda a aritmética é inteira (estimativas em Q4 mm, ganho em Q12) e o estado
+ * é pré-alocado em vetores por zona (SoA): o histórico da mediana é uma linha
+ * de 64 distâncias por frame, percorrida zona a zona em laços sem desvios.
+ */
+
+#ifndef TOF_FILTER_H
+#define TOF_FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+#define TOF_FILTER_MAX_WINDOW 7                     /**< Maior janela da mediana. */
+#define TOF_FILTER_CHANGE_MM 50                     /**< Variação entre frames consecutivos contada como mudança nas estatísticas. */
+#define TOF_FILTER_MAX_SIGMA_MM 1023                /**< Limite de range_sigma_mm no Kalman (variâncias abaixo de 2^20 mm²). */
+
+/**
+ * @brief Modo do filtro.
+ */
+typedef enum {
+    TOF_FILTER_NONE = 0,                            /**< Distâncias repassadas sem filtro. */
+    TOF_FILTER_MEDIAN,                              /**< Mediana das últimas median_window medidas. */
+    TOF_FILTER_EMA,                                 /**< Média móvel exponencial. */
+    TOF_FILTER_KALMAN,                              /**< Kalman com rejeição de medidas pelo sigma. */
+} tof_filter_mode_t;
+
+/**
+ * @brief Parâmetros do filtro.
+ */
+typedef struct {
+    tof_filter_mode_t mode;                         /**< Modo do filtro. */
+    uint8_t median_window;                          /**< Janela da mediana: 3, 5 ou 7 frames. */
+    uint16_t ema_alpha_q8;                          /**< Peso da nova medida na média exponencial, em Q8 (1 a 256). */
+    uint16_t kalman_process_noise_mm2;              /**< Variância somada à estimativa a cada frame (quanto o alvo pode se mover). */
+    uint8_t kalman_gate_sigma;                      /**< Medidas a mais destes desvios da estimativa são rejeitadas (1 a 7). */
+    uint8_t kalman_max_rejects;                     /**< Rejeições seguidas após as quais a zona é reiniciada na medida atual. */
+    uint16_t default_sigma_mm;                      /**< Sigma usado quando o frame não traz range_sigma_mm (logs de texto). */
+} tof_filter_config_t;
+
+/** @brief Parâmetros padrão de cada modo. */
+#define TOF_FILTER_CONFIG_DEFAULT(filter_mode) {    \
+    .mode = (filter_mode),                          \
+    .median_window = 3,                             \
+    .ema_alpha_q8 = 96,                             \
+    .kalman_process_noise_mm2 = 400,                \
+    .kalman_gate_sigma = 3,                         \
+    .kalman_max_rejects = 3,                        \
+    .default_sigma_mm = 20,                         \
+}
+
+/**
+ * @brief Contadores acumulados do filtro.
+ */
+typedef struct {
+    uint32_t frames;                                /**< Frames filtrados. */
+    uint32_t rejected;                              /**< Medidas rejeitadas pelo Kalman. */
+    uint32_t raw_changes;                           /**< Zonas válidas em dois frames seguidos cuja medida variou mais de TOF_FILTER_CHANGE_MM. */
+    uint32_t filtered_changes;                      /**< O mesmo, na saída do filtro. */
+} tof_filter_stats_t;
+
+/**
+ * @brief Estado do filtro de um sensor. Os campos são internos.
+ */
+typedef struct {
+    tof_filter_config_t config;                     /**< Parâmetros (com a janela e o gate já limitados). */
+    uint8_t resolution;                             /**< Resolução dos frames filtrados (uma mudança reinicia o filtro). */
+    uint8_t head;                                   /**< Próxima linha do histórico da mediana. */
+    uint64_t tracked;                               /**< Bit z ligado = zona com estado inicializado. */
+    uint64_t previous_valid;                        /**< Zonas válidas no frame anterior (estatísticas). */
+    int16_t history[TOF_FILTER_MAX_WINDOW][TOF_FRAME_MAX_ZONES]; /**< Últimas medidas de cada zona (a zona inválida repete a saída anterior). */
+    int32_t estimate_q4[TOF_FRAME_MAX_ZONES];       /**< Estimativa da média exponencial ou do Kalman, em Q4 mm. */
+    uint32_t variance_mm2[TOF_FRAME_MAX_ZONES];     /**< Variância da estimativa do Kalman. */
+    uint8_t rejects[TOF_FRAME_MAX_ZONES];           /**< Rejeições seguidas do Kalman. */
+    int16_t previous_raw[TOF_FRAME_MAX_ZONES];      /**< Medida anterior de cada zona (estatísticas). */
+    int16_t previous_out[TOF_FRAME_MAX_ZONES];      /**< Saída anterior de cada zona. */
+    tof_filter_stats_t stats;                       /**< Contadores acumulados. */
+} tof_filter_t;
+
+/**
+ * @brief Inicializa o filtro.
+ * @param filter Filtro a ser inicializado.
+ * @param config Parâmetros (NULL = TOF_FILTER_CONFIG_DEFAULT(TOF_FILTER_MEDIAN)).
+ */
+void tof_filter_init(tof_filter_t *filter, const tof_filter_config_t *config);
+
+/**
+ * @brief Descarta o histórico, por exemplo quando o ranging é reiniciado.
+ */
+void tof_filter_reset(tof_filter_t *filter);
+
+/**
+ * @brief Filtra as distâncias do primeiro alvo das zonas válidas do frame, no lugar.
+ * @param filter Filtro do sensor que produziu o frame.
+ * @param frame Frame recém-adquirido.
+ */
+void tof_filter_apply(tof_filter_t *filter, tof_frame_t *frame);
+
+/**
+ * @brief Retorna uma cópia dos contadores acumulados.
+ */
+tof_filter_stats_t tof_filter_get_stats(const tof_filter_t *filter);
+
+/**
+ * @brief Nome do modo ("none", "median", "ema" ou "kalman").
+ */
+const char *tof_filter_mode_name(tof_filter_mode_t mode);
+
+/**
+ * @brief Converte um nome de tof_filter_mode_name() no modo.
+ * @return true se o nome é conhecido.
+ */
+bool tof_filter_mode_from_name(const char *name, tof_filter_mode_t *mode);
+
+#endif // TOF_FILTER_H
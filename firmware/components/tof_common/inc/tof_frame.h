@@ -0,0 +1,74 @@
+/**
+ * @file tof_frame.h
+ * @brief Estrutura de um frame completo do sensor ToF, trocado entre as etapas do pipeline.
+ */
+
+#ifndef TOF_FRAME_H
+#define TOF_FRAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TOF_FRAME_MAX_ZONES 64                      /**< Número máximo de zonas por frame (8x8). */
+
+/**
+ * @brief Alvos por zona; deve ser igual a VL53LMZ_NB_TARGET_PER_ZONE do driver.
+ */
+#ifndef TOF_FRAME_TARGETS_PER_ZONE
+#define TOF_FRAME_TARGETS_PER_ZONE 1
+#endif
+
+#define TOF_FRAME_MAX_TARGETS (TOF_FRAME_MAX_ZONES * TOF_FRAME_TARGETS_PER_ZONE) /**< Posições de alvo por frame. */
+
+/** @brief Índice do alvo t da zona z nos vetores por alvo (mesma ordem do VL53LMZ_ResultsData). */
+#define TOF_FRAME_TARGET_IDX(z, t) ((z) * TOF_FRAME_TARGETS_PER_ZONE + (t))
+
+#define TOF_FRAME_MOTION_AGGREGATES 32              /**< Agregados do indicador de movimento (VL53LMZ_MI_INDICATOR_LENGTH). */
+
+#define TOF_FRAME_FLAG_MOTION 0x01                  /**< O frame traz o bloco do indicador de movimento. */
+#define TOF_FRAME_FLAG_MOTION_ONLY 0x02             /**< Sem movimento: os consumidores repassam só o indicador, não as distâncias (ver tof_motion.h). */
+
+/**
+ * @brief Indicador de movimento do sensor (motion_indicator do VL53LMZ_ResultsData).
+ */
+typedef struct {
+    uint32_t global_indicator_1;                    /**< Indicador global 1, no formato configurado no plugin. */
+    uint32_t global_indicator_2;                    /**< Indicador global 2. */
+    uint8_t status;                                 /**< Status do detector. */
+    uint8_t nb_detected_aggregates;                 /**< Agregados em que o sensor detectou movimento. */
+    uint8_t nb_aggregates;                          /**< Agregados configurados (16 em 4x4, 64 zonas em até 32 agregados em 8x8). */
+    uint32_t active_mask;                           /**< Bit i ligado = agregado i acima do limiar (preenchido por tof_motion_apply()). */
+    uint32_t aggregate[TOF_FRAME_MOTION_AGGREGATES]; /**< Intensidade do movimento por agregado. */
+} tof_frame_motion_t;
+
+/**
+ * @brief Frame de medição do sensor, com carimbo de tempo da aquisição.
+ *
+ * Os campos de resultado são cópias em largura total dos campos de mesmo nome
+ * do VL53LMZ_ResultsData do driver.
+ */
+typedef struct {
+    int64_t timestamp_us;                           /**< Instante da aquisição (relógio do sistema, em µs). */
+    uint32_t sequence;                              /**< Contador de frames adquiridos do sensor sensor_id. */
+    uint8_t sensor_id;                              /**< Sensor de origem do frame (0 com um único sensor). */
+    uint8_t streamcount;                            /**< Streamcount reportado pelo sensor. */
+    uint8_t resolution;                             /**< Número de zonas válidas no frame (16 ou 64). */
+    int8_t silicon_temp_degc;                       /**< Temperatura interna do sensor. */
+    uint8_t flags;                                  /**< TOF_FRAME_FLAG_*. */
+    uint8_t nb_target_detected[TOF_FRAME_MAX_ZONES]; /**< Alvos detectados por zona. */
+    int16_t distance_mm[TOF_FRAME_MAX_TARGETS];     /**< Distância por alvo, em mm. */
+    uint16_t range_sigma_mm[TOF_FRAME_MAX_TARGETS]; /**< Desvio padrão estimado da distância, em mm. */
+    uint32_t signal_per_spad[TOF_FRAME_MAX_TARGETS]; /**< Sinal de retorno por alvo, em kcps/SPAD. */
+    uint8_t target_status[TOF_FRAME_MAX_TARGETS];   /**< Status por alvo (5 ou 9 = medição válida). */
+    tof_frame_motion_t motion;                      /**< Indicador de movimento (válido com TOF_FRAME_FLAG_MOTION). */
+} tof_frame_t;
+
+/**
+ * @brief Indica se o alvo t da zona z é uma medição válida (detectado e com status 5 ou 9).
+ */
+static inline bool tof_frame_target_is_valid(const tof_frame_t *frame, int z, int t) {
+    uint8_t status = frame->target_status[TOF_FRAME_TARGET_IDX(z, t)];
+    return t < frame->nb_target_detected[z] && (status == 5 || status == 9);
+}
+
+#endif // TOF_FRAME_H
@@ -0,0 +1,79 @@
+/**
+ * @file tof_frame_pub.h
+ * @brief Último frame de um sensor publicado para vários leitores, sem cópia no leitor e sem mutex.
+ *
+ * O produtor copia cada frame para um slot livre e o torna o mais recente; o
+ * leitor recebe um ponteiro para o slot mais recente, com a contagem de
+ * referências do slot incrementada, e o lê diretamente até liberá-lo. Um slot
+ * referenciado nunca é reescrito, e o produtor nunca espera: com todos os
+ * slots fora do mais recente referenciados, o frame deixa de ser publicado e
+ * é contabilizado. Com capacidade para N leitores simultâneos são
+ * necessários N + 2 slots (o mais recente, um em escrita e um por leitor).
+ *
+ * O leitor também nunca espera: se o produtor trocar o slot mais recente
+ * entre a leitura do índice e o incremento da referência, ele tenta de novo
+ * com o novo índice. Um leitor que já viu o frame reconhece-o pela sequence.
+ */
+
+#ifndef TOF_FRAME_PUB_H
+#define TOF_FRAME_PUB_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+#define TOF_FRAME_PUB_MIN_SLOTS 3                   /**< Slots para um leitor por vez. */
+#define TOF_FRAME_PUB_MAX_SLOTS 8                   /**< Maior número de slots (até 6 leitores simultâneos). */
+#define TOF_FRAME_PUB_NONE UINT32_MAX               /**< Índice do slot mais recente antes da primeira publicação. */
+
+/**
+ * @brief Estado da publicação. Os campos são internos.
+ */
+typedef struct {
+    tof_frame_t *slots;                             /**< Vetor de slots pré-alocados pelo chamador. */
+    uint32_t count;                                 /**< Número de slots (0 = não inicializada). */
+    _Atomic uint32_t latest;                        /**< Slot mais recente (TOF_FRAME_PUB_NONE = nenhum frame). */
+    _Atomic uint32_t refs[TOF_FRAME_PUB_MAX_SLOTS]; /**< Leitores com referência a cada slot. */
+    _Atomic uint32_t published;                     /**< Frames publicados. */
+    _Atomic uint32_t dropped;                       /**< Frames não publicados por falta de slot livre. */
+} tof_frame_pub_t;
+
+/**
+ * @brief Inicializa a publicação sobre um vetor de slots fornecido pelo chamador.
+ * @param pub Publicação a ser inicializada (ainda sem leitores).
+ * @param slots Vetor de slots (deve permanecer válido durante o uso).
+ * @param count Número de slots, de TOF_FRAME_PUB_MIN_SLOTS a TOF_FRAME_PUB_MAX_SLOTS.
+ * @return true em caso de sucesso, false se o número de slots for inválido.
+ */
+bool tof_frame_pub_init(tof_frame_pub_t *pub, tof_frame_t *slots, uint32_t count);
+
+/**
+ * @brief (Produtor) Copia um frame para um slot livre e o torna o mais recente.
+ * @return true se o frame foi publicado, false se todos os outros slots estavam referenciados.
+ */
+bool tof_frame_pub_publish(tof_frame_pub_t *pub, const tof_frame_t *frame);
+
+/**
+ * @brief (Leitor) Referencia o frame mais recente.
+ * @return Ponteiro para o slot, válido até tof_frame_pub_release(), ou NULL se nenhum frame foi publicado.
+ */
+const tof_frame_t *tof_frame_pub_acquire(tof_frame_pub_t *pub);
+
+/**
+ * @brief (Leitor) Libera um slot retornado por tof_frame_pub_acquire().
+ */
+void tof_frame_pub_release(tof_frame_pub_t *pub, const tof_frame_t *frame);
+
+/**
+ * @brief Frames publicados desde a inicialização.
+ */
+uint32_t tof_frame_pub_published(tof_frame_pub_t *pub);
+
+/**
+ * @brief Frames não publicados por falta de slot livre desde a inicialização.
+ */
+uint32_t tof_frame_pub_dropped(tof_frame_pub_t *pub);
+
+#endif // TOF_FRAME_PUB_H
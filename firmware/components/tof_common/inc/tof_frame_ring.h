@@ -0,0 +1,63 @@
+/**
+ * @file tof_frame_ring.h
+ * @brief Fila circular lock-free SPSC (um produtor, um consumidor) de frames pré-alocados.
+ *
+ * O produtor copia o frame para o próximo slot livre e o publica; o consumidor
+ * lê o slot diretamente (sem cópia) e o libera ao terminar. Nenhuma operação
+ * bloqueia nem usa mutex: quando a fila está cheia o frame é descartado e
+ * contabilizado, de forma que um consumidor lento nunca atrasa o produtor.
+ */
+
+#ifndef TOF_FRAME_RING_H
+#define TOF_FRAME_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+/**
+ * @brief Estado da fila. Os índices crescem livremente e são mascarados no acesso.
+ */
+typedef struct {
+    tof_frame_t *slots;                             /**< Vetor de slots pré-alocados pelo chamador. */
+    uint32_t mask;                                  /**< Capacidade - 1 (a capacidade é potência de 2). */
+    _Atomic uint32_t head;                          /**< Próximo slot a ser escrito (apenas o produtor altera). */
+    _Atomic uint32_t tail;                          /**< Próximo slot a ser lido (apenas o consumidor altera). */
+    _Atomic uint32_t dropped;                       /**< Frames descartados por fila cheia. */
+    _Atomic uint32_t high_watermark;                /**< Maior ocupação observada pelo produtor. */
+} tof_frame_ring_t;
+
+/**
+ * @brief Inicializa a fila sobre um vetor de slots fornecido pelo chamador.
+ * @param ring Fila a ser inicializada.
+ * @param slots Vetor de slots (deve permanecer válido durante o uso da fila).
+ * @param capacity Número de slots; deve ser potência de 2.
+ * @return true em caso de sucesso, false se a capacidade for inválida.
+ */
+bool tof_frame_ring_init(tof_frame_ring_t *ring, tof_frame_t *slots, uint32_t capacity);
+
+/**
+ * @brief (Produtor) Copia um frame para a fila.
+ * @return true se o frame foi enfileirado, false se a fila estava cheia (frame descartado).
+ */
+bool tof_frame_ring_push(tof_frame_ring_t *ring, const tof_frame_t *frame);
+
+/**
+ * @brief (Consumidor) Retorna o frame mais antigo sem removê-lo da fila.
+ * @return Ponteiro para o slot, ou NULL se a fila estiver vazia.
+ */
+const tof_frame_t *tof_frame_ring_peek(tof_frame_ring_t *ring);
+
+/**
+ * @brief (Consumidor) Libera o slot retornado por tof_frame_ring_peek().
+ */
+void tof_frame_ring_release(tof_frame_ring_t *ring);
+
+/**
+ * @brief Número de frames atualmente na fila.
+ */
+uint32_t tof_frame_ring_count(tof_frame_ring_t *ring);
+
+#endif // TOF_FRAME_RING_H
@@ -0,0 +1,67 @@
+/**
+ * @file tof_frame_stats.h
+ * @brief Núcleo de processamento por frame: máscara de validade, compactação e estatísticas das distâncias.
+ *
+ * É a implementação única do critério de tof_frame_target_is_valid() para o
+ * frame inteiro, usada pelo firmware, pelo simulador e pelos formatos de log
+ * (CSV e .tofb). Nenhum laço tem desvio dependente dos dados:
+ *  - no x86 (simulador) a máscara, o mínimo, o máximo e a soma são calculados
+ *    com SSE2, 16 status ou 8 distâncias por instrução;
+ *  - nas outras arquiteturas, inclusive o ESP32 (Xtensa LX6, sem extensão
+ *    SIMD), a máscara é calculada 4 zonas por vez em palavras de 32 bits
+ *    (SWAR) e as estatísticas com seleções condicionais, que o compilador
+ *    traduz nas instruções MIN/MAX/MOVxx.
+ * Definir TOF_FRAME_STATS_NO_SIMD força o caminho portátil também no x86.
+ */
+
+#ifndef TOF_FRAME_STATS_H
+#define TOF_FRAME_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+#define TOF_FRAME_STATS_BIN_SHIFT 8                 /**< Largura de uma classe do histograma: 2^8 = 256 mm. */
+#define TOF_FRAME_STATS_BINS 16                     /**< Classes do histograma (0 a 4095 mm; as distâncias maiores entram na última e as negativas na primeira). */
+
+/**
+ * @brief Estatísticas das distâncias válidas de um alvo do frame.
+ */
+typedef struct {
+    uint64_t valid_mask;                            /**< Bit z ligado = alvo válido na zona z. */
+    uint8_t valid_count;                            /**< Zonas válidas (bits em valid_mask). */
+    int16_t min_mm;                                 /**< Menor distância válida (0 sem zonas válidas). */
+    int16_t max_mm;                                 /**< Maior distância válida (0 sem zonas válidas). */
+    int16_t mean_mm;                                /**< Média das distâncias válidas, arredondada (0 sem zonas válidas). */
+    int32_t sum_mm;                                 /**< Soma das distâncias válidas. */
+    uint8_t histogram[TOF_FRAME_STATS_BINS];        /**< Zonas válidas por classe de distância. */
+} tof_frame_stats_t;
+
+/**
+ * @brief Calcula a máscara de zonas cujo alvo target é válido (ver tof_frame_target_is_valid()).
+ * @param frame Frame de entrada; só as frame->resolution primeiras zonas são consideradas.
+ * @param target Índice do alvo (0 a TOF_FRAME_TARGETS_PER_ZONE - 1).
+ * @return Bit z ligado = alvo target da zona z detectado e com status 5 ou 9.
+ */
+uint64_t tof_frame_valid_mask(const tof_frame_t *frame, int target);
+
+/**
+ * @brief Copia em sequência as distâncias do alvo target das zonas marcadas em mask.
+ * @param frame Frame de entrada.
+ * @param mask Zonas a copiar, normalmente de tof_frame_valid_mask().
+ * @param target Índice do alvo.
+ * @param[out] out Destino com TOF_FRAME_MAX_ZONES posições (a cópia sem desvios escreve além das zonas copiadas).
+ * @return Número de distâncias copiadas (bits de mask nas zonas do frame).
+ */
+size_t tof_frame_compact_distances(const tof_frame_t *frame, uint64_t mask, int target, int16_t *out);
+
+/**
+ * @brief Calcula máscara, mínimo, máximo, média e histograma das distâncias válidas do alvo target.
+ * @param frame Frame de entrada.
+ * @param target Índice do alvo.
+ * @param[out] stats Estatísticas do frame.
+ */
+void tof_frame_compute_stats(const tof_frame_t *frame, int target, tof_frame_stats_t *stats);
+
+#endif // TOF_FRAME_STATS_H
@@ -0,0 +1,127 @@
+/**
+ * @file tof_latency.h
+ * @brief Histogramas de latência por etapa do caminho de um frame, sem travas, e o pacote de telemetria.
+ *
+ * Cada etapa tem um histograma de faixas fixas em ns: as 4 primeiras faixas
+ * são 0, 1, 2 e 3 ns, e cada oitava seguinte [2^k, 2^(k+1)) é dividida em 4
+ * faixas iguais, então o valor reportado (o limite superior da faixa) fica no
+ * máximo 25% acima do valor real. As amostras entram com um incremento
+ * atômico, de qualquer tarefa, e o leitor esvazia o histograma faixa a faixa
+ * com uma troca atômica: nenhuma amostra se perde e ninguém espera.
+ *
+ * O resumo das etapas pode seguir no streaming da UART em um pacote
+ *
+ *     tof_latency_telemetry_header_t                (12 bytes)
+ *     stage_count x tof_latency_summary_t           (16 bytes cada, na ordem de tof_latency_stage_t)
+ *     uint16 crc16
+ *
+ * do mesmo canal de tof_stream.h (CRC16, COBS e delimitadores 0x00).
+ */
+
+#ifndef TOF_LATENCY_H
+#define TOF_LATENCY_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TOF_LATENCY_BUCKETS 124                     /**< Faixas de um histograma (4 por oitava até 2^32 ns). */
+
+/**
+ * @brief Etapas instrumentadas, na ordem do caminho de um frame.
+ */
+typedef enum {
+    TOF_LATENCY_INT_TO_READ = 0,                    /**< Do pulso INT ao início da leitura dos resultados. */
+    TOF_LATENCY_SPI_READ,                           /**< Leitura dos resultados no barramento (RdMulti). */
+    TOF_LATENCY_PARSE,                              /**< Localização dos blocos no buffer lido. */
+    TOF_LATENCY_CONVERT,                            /**< Cópia e conversão dos blocos para o frame. */
+    TOF_LATENCY_FILTER,                             /**< Filtro temporal das distâncias. */
+    TOF_LATENCY_UART_EMIT,                          /**< Saída do frame na UART. */
+    TOF_LATENCY_SD_WRITE,                           /**< Gravação do frame no log do SD (bloco ou linha CSV). */
+    TOF_LATENCY_FRAME_TO_CAN,                       /**< Do carimbo do frame (sensor pronto, logo após o INT) ao fim do envio dos frames CAN de obstáculos. */
+    TOF_LATENCY_STAGE_COUNT                         /**< Número de etapas. */
+} tof_latency_stage_t;
+
+/**
+ * @brief Histograma de uma etapa. Zerado = vazio; os campos são internos.
+ */
+typedef struct {
+    _Atomic uint32_t bucket[TOF_LATENCY_BUCKETS];   /**< Amostras em cada faixa. */
+    _Atomic uint32_t max_ns;                        /**< Maior amostra desde o último esvaziamento. */
+} tof_latency_hist_t;
+
+/**
+ * @brief Resumo de um histograma no intervalo entre dois esvaziamentos (16 bytes, little-endian no pacote).
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t count;                                 /**< Amostras no intervalo. */
+    uint32_t p50_ns;                                /**< Mediana (limite superior da faixa). */
+    uint32_t p99_ns;                                /**< Percentil 99 (limite superior da faixa). */
+    uint32_t max_ns;                                /**< Maior amostra. */
+} tof_latency_summary_t;
+
+/**
+ * @brief Cabeçalho do pacote de telemetria (12 bytes).
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t type;                                   /**< TOF_STREAM_MSG_TELEMETRY. */
+    uint8_t stage_count;                            /**< Resumos que seguem. */
+    uint8_t reserved[2];                            /**< Zero. */
+    uint32_t uptime_ms;                             /**< Instante do esvaziamento, em ms desde o boot. */
+    uint32_t interval_ms;                           /**< Duração do intervalo resumido. */
+} tof_latency_telemetry_header_t;
+
+/** @brief Tamanho do pacote de telemetria antes do COBS, CRC incluído. */
+#define TOF_LATENCY_TELEMETRY_PACKET (sizeof(tof_latency_telemetry_header_t) \
+    + TOF_LATENCY_STAGE_COUNT * sizeof(tof_latency_summary_t) + 2)
+
+/** @brief Tamanho do pacote de telemetria após COBS e os dois delimitadores. */
+#define TOF_LATENCY_TELEMETRY_ENCODED (TOF_LATENCY_TELEMETRY_PACKET + TOF_LATENCY_TELEMETRY_PACKET / 254 + 3)
+
+/**
+ * @brief Registra uma amostra. Pode ser chamada de qualquer tarefa.
+ * @param hist Histograma da etapa.
+ * @param ns Duração, em ns.
+ */
+void tof_latency_record(tof_latency_hist_t *hist, uint32_t ns);
+
+/**
+ * @brief Esvazia o histograma e resume as amostras acumuladas desde o esvaziamento anterior.
+ * @param hist Histograma da etapa.
+ * @param summary Contagem, percentis e máximo do intervalo (tudo zero sem amostras).
+ */
+void tof_latency_take(tof_latency_hist_t *hist, tof_latency_summary_t *summary);
+
+/**
+ * @brief Nome curto de uma etapa, para o log.
+ * @param stage Etapa.
+ * @return Nome, ou "?" fora do intervalo.
+ */
+const char *tof_latency_stage_name(tof_latency_stage_t stage);
+
+/**
+ * @brief Monta o pacote de telemetria com o resumo de todas as etapas, com COBS e delimitadores.
+ * @param summaries TOF_LATENCY_STAGE_COUNT resumos, na ordem de tof_latency_stage_t.
+ * @param uptime_ms Instante do esvaziamento.
+ * @param interval_ms Duração do intervalo resumido.
+ * @param out Saída com ao menos TOF_LATENCY_TELEMETRY_ENCODED bytes.
+ * @param capacity Tamanho da saída.
+ * @return Bytes prontos para envio, ou 0 se a saída for pequena.
+ */
+size_t tof_latency_encode_telemetry(const tof_latency_summary_t *summaries, uint32_t uptime_ms,
+                                    uint32_t interval_ms, uint8_t *out, size_t capacity);
+
+/**
+ * @brief Decodifica um pacote de telemetria já sem COBS (ver tof_cobs_decode()).
+ * @param packet Pacote, CRC incluído.
+ * @param len Tamanho do pacote.
+ * @param header Cabeçalho do pacote.
+ * @param summaries Saída para TOF_LATENCY_STAGE_COUNT resumos; as etapas que o
+ * pacote não traz (firmware mais antigo) ficam zeradas.
+ * @return true se o pacote é um pacote de telemetria válido.
+ */
+bool tof_latency_decode_telemetry(const uint8_t *packet, size_t len, tof_latency_telemetry_header_t *header,
+                                  tof_latency_summary_t *summaries);
+
+#endif // TOF_LATENCY_H
@@ -0,0 +1,143 @@
+/**
+ * @file tof_log_index.h
+ * @brief Índice lateral de um arquivo de log: instante do frame -> deslocamento no arquivo.
+ *
+ * Layout do arquivo .idx (little-endian):
+ *
+ *     tof_log_index_header_t                        (uma vez, no início)
+ *     tof_log_index_entry_t                         (uma por fsync do log de dados)
+ *
+ * Depois de confirmar cada registro do log de dados (linha do CSV ou bloco
+ * .tofb), o chamador marca o instante do primeiro frame e o deslocamento do
+ * registro; um registro que não pôde ser reservado ou confirmado não é
+ * marcado. Só a primeira marca desde a última entrada é guardada. Depois de cada
+ * fsync do log de dados, tof_log_index_sync() grava uma entrada com essa
+ * marca (se o registro marcado já está no cartão) e com durable_end, o total
+ * de bytes do log de dados garantidos pelo fsync. Assim as entradas crescem
+ * em timestamp_us e offset, uma a cada SD_FSYNC_INTERVAL_MS, e um leitor
+ * encontra por busca binária o registro de onde começar a ler uma janela de
+ * tempo em vez de percorrer o arquivo inteiro.
+ *
+ * A última entrada com CRC válido diz até onde o log de dados é confiável:
+ * após uma queda de energia, tof_log_index_recover() trunca o arquivo em
+ * durable_end, descartando a cauda parcial e, num arquivo pré-alocado, a
+ * parte reservada que nunca foi escrita. Os deslocamentos são de 32 bits,
+ * o limite de tamanho de arquivo do FAT32.
+ */
+
+#ifndef TOF_LOG_INDEX_H
+#define TOF_LOG_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_log_writer.h"
+
+#define TOF_LOG_INDEX_MAGIC "TIDX"                  /**< Assinatura no início do arquivo. */
+#define TOF_LOG_INDEX_VERSION 1                     /**< Versão atual do formato. */
+#define TOF_LOG_INDEX_BUFFER_SIZE 512               /**< Buffer de escrita do índice (um setor; cada entrada é descarregada logo). */
+
+/**
+ * @brief Cabeçalho do arquivo (8 bytes).
+ */
+typedef struct __attribute__((packed)) {
+    char magic[4];                                  /**< TOF_LOG_INDEX_MAGIC. */
+    uint16_t version;                               /**< TOF_LOG_INDEX_VERSION. */
+    uint16_t entry_size;                            /**< sizeof(tof_log_index_entry_t). */
+} tof_log_index_header_t;
+
+/**
+ * @brief Entrada do índice (20 bytes).
+ */
+typedef struct __attribute__((packed)) {
+    int64_t timestamp_us;                           /**< Instante do primeiro frame do registro em offset. */
+    uint32_t offset;                                /**< Deslocamento do registro no log de dados. */
+    uint32_t durable_end;                           /**< Bytes do log de dados garantidos no cartão quando a entrada foi gravada. */
+    uint32_t crc32;                                 /**< CRC-32 dos 16 bytes anteriores. */
+} tof_log_index_entry_t;
+
+/**
+ * @brief Estatísticas acumuladas do índice.
+ */
+typedef struct {
+    uint32_t entries;                               /**< Entradas gravadas. */
+    uint32_t write_errors;                          /**< Entradas que não puderam ser gravadas. */
+} tof_log_index_stats_t;
+
+/**
+ * @brief Estado de um índice aberto. Os campos são internos.
+ */
+typedef struct {
+    tof_log_writer_t writer;                        /**< Escritor do arquivo .idx. */
+    uint8_t buffer[TOF_LOG_INDEX_BUFFER_SIZE] __attribute__((aligned(4))); /**< Buffer de escrita do escritor. */
+    bool pending;                                   /**< Há uma marca ainda sem entrada. */
+    int64_t pending_us;                             /**< Instante da marca pendente. */
+    uint32_t pending_offset;                        /**< Deslocamento da marca pendente. */
+    tof_log_index_entry_t last;                     /**< Última entrada gravada (offset e timestamp repetidos sem marca nova). */
+    tof_log_index_stats_t stats;                    /**< Estatísticas acumuladas. */
+} tof_log_index_t;
+
+/**
+ * @brief Cria (ou trunca) o arquivo de índice e grava o cabeçalho, já sincronizado no arquivo.
+ * @param index Índice a ser inicializado.
+ * @param path Caminho do arquivo .idx.
+ * @return true em caso de sucesso.
+ */
+bool tof_log_index_open(tof_log_index_t *index, const char *path);
+
+/**
+ * @brief Marca o início de um registro confirmado no log de dados.
+ * @param timestamp_us Instante do primeiro frame do registro.
+ * @param offset Deslocamento do registro (tof_log_writer_position() entre a reserva e a confirmação).
+ */
+void tof_log_index_mark(tof_log_index_t *index, int64_t timestamp_us, uint64_t offset);
+
+/**
+ * @brief Grava uma entrada se o último fsync do log de dados avançou desde a entrada anterior.
+ *
+ * Deve ser chamado depois de tof_log_writer_poll() do log de dados; a
+ * entrada é descarregada e sincronizada no próprio arquivo logo em seguida.
+ *
+ * @param data Escritor do log de dados indexado (pode já estar fechado).
+ * @return true se não havia nada a gravar ou a entrada foi gravada.
+ */
+bool tof_log_index_sync(tof_log_index_t *index, const tof_log_writer_t *data);
+
+/**
+ * @brief Grava a entrada final e fecha o índice (chamar depois de fechar o log de dados).
+ */
+bool tof_log_index_close(tof_log_index_t *index, const tof_log_writer_t *data);
+
+/**
+ * @brief Indica se o índice está aberto.
+ */
+bool tof_log_index_is_open(const tof_log_index_t *index);
+
+/**
+ * @brief Retorna uma cópia das estatísticas acumuladas.
+ */
+tof_log_index_stats_t tof_log_index_get_stats(const tof_log_index_t *index);
+
+/**
+ * @brief Lê a última entrada com CRC válido de um arquivo de índice.
+ * @param path Caminho do arquivo .idx.
+ * @param[out] entry Última entrada válida.
+ * @return true se o cabeçalho é válido e há ao menos uma entrada válida.
+ */
+bool tof_log_index_read_last(const char *path, tof_log_index_entry_t *entry);
+
+/**
+ * @brief Trunca um log de dados no fim confiável indicado pelo seu índice.
+ *
+ * Com o cabeçalho do índice válido mas nenhuma entrada, nada do log de dados
+ * chegou a ser garantido e ele é truncado em zero. Sem índice legível, o
+ * arquivo não é alterado.
+ *
+ * @param data_path Caminho do log de dados.
+ * @param index_path Caminho do seu arquivo .idx.
+ * @param[out] size Tamanho do log de dados depois da recuperação (pode ser NULL).
+ * @return true se o arquivo foi truncado (havia bytes além do fim confiável).
+ */
+bool tof_log_index_recover(const char *data_path, const char *index_path, uint64_t *size);
+
+#endif // TOF_LOG_INDEX_H
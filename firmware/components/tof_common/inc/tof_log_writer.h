@@ -0,0 +1,145 @@
+/**
+ * @file tof_log_writer.h
+ * @brief Escritor de log persistente e bufferizado para o cartão SD (ou disco, no simulador).
+ *
+ * O arquivo é aberto uma única vez e os registros são acumulados em um buffer
+ * de escrita fornecido pelo chamador. O buffer é descarregado no arquivo
+ * quando atinge um limite de bytes ou quando os dados pendentes ultrapassam
+ * um tempo máximo, e o fsync é feito em uma cadência própria. Descargas por
+ * tamanho escrevem apenas múltiplos de TOF_LOG_WRITER_SECTOR_SIZE, evitando
+ * leitura-modificação-escrita de setores parciais no FAT.
+ *
+ * Um arquivo pré-alocado (preallocated) já tem o tamanho reservado e
+ * clusters contíguos: o escritor grava desde o início, sem O_APPEND, para que
+ * as escritas não alterem a cadeia de clusters, e ao fechar trunca o arquivo
+ * na posição lógica. Se a energia cair antes, o tamanho do arquivo continua o
+ * reservado e o fim válido vem do índice lateral (tof_log_index.h).
+ */
+
+#ifndef TOF_LOG_WRITER_H
+#define TOF_LOG_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TOF_LOG_WRITER_SECTOR_SIZE 512              /**< Tamanho do setor do cartão SD, unidade das descargas por tamanho. */
+
+/**
+ * @brief Parâmetros de descarga do escritor.
+ */
+typedef struct {
+    size_t flush_threshold_bytes;                   /**< Descarrega quando o buffer acumula ao menos estes bytes. */
+    uint32_t flush_interval_ms;                     /**< Idade máxima dos dados pendentes no buffer (0 = sem limite). */
+    uint32_t fsync_interval_ms;                     /**< Intervalo mínimo entre fsyncs (0 = fsync em toda descarga). */
+    bool preallocated;                              /**< O arquivo já existe com o tamanho reservado: grava desde o início e trunca ao fechar. */
+} tof_log_writer_config_t;
+
+/**
+ * @brief Estatísticas acumuladas do escritor.
+ */
+typedef struct {
+    uint64_t bytes_written;                         /**< Total de bytes entregues ao sistema de arquivos. */
+    uint32_t flushes;                               /**< Número de descargas do buffer. */
+    uint32_t fsyncs;                                /**< Número de fsyncs executados. */
+    uint32_t write_errors;                          /**< Falhas de write()/fsync(). */
+    int64_t busy_time_us;                           /**< Tempo total gasto em write() e fsync(). */
+    uint32_t max_flush_us;                          /**< Pior latência de uma descarga (write + fsync, se houver). */
+    uint32_t max_fsync_us;                          /**< Pior latência de um fsync isolado. */
+} tof_log_writer_stats_t;
+
+/**
+ * @brief Estado de um escritor aberto. Os campos são internos.
+ */
+typedef struct {
+    int fd;                                         /**< Descritor do arquivo (-1 quando fechado). */
+    uint8_t *buffer;                                /**< Buffer de escrita fornecido pelo chamador. */
+    size_t capacity;                                /**< Tamanho do buffer. */
+    size_t used;                                    /**< Bytes pendentes no buffer. */
+    tof_log_writer_config_t config;                 /**< Parâmetros de descarga. */
+    int64_t pending_since_us;                       /**< Instante em que o primeiro byte pendente foi escrito. */
+    int64_t last_fsync_us;                          /**< Instante do último fsync. */
+    bool unsynced;                                  /**< Há dados escritos desde o último fsync. */
+    uint64_t file_bytes;                            /**< Bytes do arquivo até o fim da última escrita (posição lógica sem o buffer). */
+    uint64_t synced_bytes;                          /**< Valor de file_bytes no último fsync bem-sucedido. */
+    tof_log_writer_stats_t stats;                   /**< Estatísticas acumuladas. */
+} tof_log_writer_t;
+
+/**
+ * @brief Abre (ou cria) o arquivo de log em modo append.
+ * @param writer Escritor a ser inicializado.
+ * @param path Caminho do arquivo.
+ * @param truncate Se true, descarta o conteúdo anterior do arquivo (ignorado com config->preallocated).
+ * @param header Cabeçalho escrito apenas quando o arquivo está vazio ou é pré-alocado (NULL para nenhum).
+ * @param header_len Tamanho do cabeçalho em bytes.
+ * @param buffer Buffer de escrita; de preferência alinhado a 4 bytes e com tamanho múltiplo de TOF_LOG_WRITER_SECTOR_SIZE.
+ * @param capacity Tamanho do buffer em bytes.
+ * @param config Parâmetros de descarga (NULL para os padrões).
+ * @return true em caso de sucesso.
+ */
+bool tof_log_writer_open(tof_log_writer_t *writer, const char *path, bool truncate,
+                         const void *header, size_t header_len,
+                         uint8_t *buffer, size_t capacity,
+                         const tof_log_writer_config_t *config);
+
+/**
+ * @brief Reserva espaço contíguo no buffer para o chamador formatar um registro no lugar.
+ *
+ * Se não houver espaço, o buffer é descarregado antes. O registro deve ser
+ * confirmado com tof_log_writer_commit().
+ *
+ * @param len Número máximo de bytes que o chamador pode escrever.
+ * @return Ponteiro para o espaço reservado, ou NULL se len excede a capacidade ou a descarga falhou.
+ */
+uint8_t *tof_log_writer_reserve(tof_log_writer_t *writer, size_t len);
+
+/**
+ * @brief Confirma os bytes efetivamente escritos no espaço de tof_log_writer_reserve().
+ * @return true em caso de sucesso (inclui a descarga por tamanho, se disparada).
+ */
+bool tof_log_writer_commit(tof_log_writer_t *writer, size_t len);
+
+/**
+ * @brief Copia um bloco de bytes para o buffer (atalho para reserve + memcpy + commit).
+ */
+bool tof_log_writer_write(tof_log_writer_t *writer, const void *data, size_t len);
+
+/**
+ * @brief Aplica os limites de tempo: descarrega dados antigos e faz o fsync na cadência configurada.
+ *
+ * Deve ser chamado periodicamente, mesmo quando não chegam novos registros.
+ */
+bool tof_log_writer_poll(tof_log_writer_t *writer);
+
+/**
+ * @brief Indica se há dados no buffer ou escritos sem fsync, ou seja, se tof_log_writer_poll() ainda tem trabalho.
+ */
+bool tof_log_writer_has_pending(const tof_log_writer_t *writer);
+
+/**
+ * @brief Descarrega todo o buffer no arquivo.
+ * @param sync Se true, faz fsync logo em seguida.
+ */
+bool tof_log_writer_flush(tof_log_writer_t *writer, bool sync);
+
+/**
+ * @brief Descarrega o buffer, faz fsync e fecha o arquivo.
+ */
+bool tof_log_writer_close(tof_log_writer_t *writer);
+
+/**
+ * @brief Retorna uma cópia das estatísticas acumuladas.
+ */
+tof_log_writer_stats_t tof_log_writer_get_stats(const tof_log_writer_t *writer);
+
+/**
+ * @brief Deslocamento no arquivo do próximo byte confirmado (inclui o que ainda está no buffer).
+ */
+uint64_t tof_log_writer_position(const tof_log_writer_t *writer);
+
+/**
+ * @brief Bytes do início do arquivo garantidos no cartão pelo último fsync (mantido após o fechamento).
+ */
+uint64_t tof_log_writer_synced_bytes(const tof_log_writer_t *writer);
+
+#endif // TOF_LOG_WRITER_H
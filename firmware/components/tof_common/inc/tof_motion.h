@@ -0,0 +1,83 @@
+/**
+ * @file tof_motion.h
+ * @brief Modo de movimento: repassa o indicador de movimento e só envia as distâncias quando há movimento.
+ *
+ * A cada frame com o bloco do indicador (TOF_FRAME_FLAG_MOTION), os agregados
+ * com intensidade a partir de aggregate_threshold formam motion.active_mask.
+ * Com ao menos min_active_aggregates agregados ativos o frame tem movimento e
+ * segue completo; sem movimento por mais de hold_frames frames seguidos o
+ * frame recebe TOF_FRAME_FLAG_MOTION_ONLY, e os consumidores gravam ou enviam
+ * só os indicadores globais e os agregados ativos (ver tof_stream.h). Frames
+ * sem o bloco do indicador seguem completos.
+ */
+
+#ifndef TOF_MOTION_H
+#define TOF_MOTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+/**
+ * @brief Parâmetros do modo de movimento.
+ */
+typedef struct {
+    uint32_t aggregate_threshold;                   /**< Intensidade a partir da qual um agregado é ativo. */
+    uint8_t min_active_aggregates;                  /**< Agregados ativos para o frame ter movimento (mínimo 1). */
+    uint8_t hold_frames;                            /**< Frames completos enviados após o último com movimento. */
+} tof_motion_config_t;
+
+/** @brief Parâmetros padrão. */
+#define TOF_MOTION_CONFIG_DEFAULT {                 \
+    .aggregate_threshold = 100,                     \
+    .min_active_aggregates = 1,                     \
+    .hold_frames = 8,                               \
+}
+
+/**
+ * @brief Contadores acumulados do modo de movimento.
+ */
+typedef struct {
+    uint32_t frames;                                /**< Frames com o bloco do indicador. */
+    uint32_t motion_frames;                         /**< Frames com movimento. */
+    uint32_t suppressed_frames;                     /**< Frames marcados com TOF_FRAME_FLAG_MOTION_ONLY. */
+    uint32_t active_aggregates;                     /**< Soma dos agregados ativos (os enviados nos pacotes de movimento). */
+} tof_motion_stats_t;
+
+/**
+ * @brief Estado do modo de movimento de um sensor. Os campos são internos.
+ */
+typedef struct {
+    tof_motion_config_t config;                     /**< Parâmetros. */
+    uint8_t hold;                                   /**< Frames completos que ainda restam após o último movimento. */
+    tof_motion_stats_t stats;                       /**< Contadores acumulados. */
+} tof_motion_t;
+
+/**
+ * @brief Inicializa o estado.
+ * @param motion Estado a ser inicializado.
+ * @param config Parâmetros (NULL = TOF_MOTION_CONFIG_DEFAULT).
+ */
+void tof_motion_init(tof_motion_t *motion, const tof_motion_config_t *config);
+
+/**
+ * @brief Marca os agregados ativos do frame e decide se as distâncias seguem.
+ * @param motion Estado do sensor que produziu o frame.
+ * @param frame Frame recém-adquirido: recebe motion.active_mask e, sem
+ * movimento, TOF_FRAME_FLAG_MOTION_ONLY.
+ * @return true se o frame segue completo.
+ */
+bool tof_motion_apply(tof_motion_t *motion, tof_frame_t *frame);
+
+/**
+ * @brief Máscara dos agregados com intensidade a partir de threshold.
+ */
+uint32_t tof_motion_active_mask(const tof_frame_motion_t *indicator, uint32_t threshold);
+
+/**
+ * @brief Retorna uma cópia dos contadores acumulados.
+ */
+tof_motion_stats_t tof_motion_get_stats(const tof_motion_t *motion);
+
+#endif // TOF_MOTION_H
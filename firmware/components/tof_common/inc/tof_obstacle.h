@@ -0,0 +1,170 @@
+/**
+ * @file tof_obstacle.h
+ * @brief Distância mais próxima por setor, rastreio do alvo mais próximo e empacotamento em frames CAN.
+ *
+ * Cada coluna da grade do frame (8 em 8x8, 4 em 4x4, na ordem das zonas do
+ * driver) é um setor. A distância do setor é a menor entre as zonas da
+ * coluna com o primeiro alvo válido, sigma até max_sigma_mm e distância entre
+ * min_mm e max_mm; a confiança cai linearmente com o sigma dessa zona, de 255
+ * (sigma 0) a 0 (max_sigma_mm).
+ *
+ * O setor mais próximo alimenta o rastreio: um alvo a até gate_mm da
+ * distância rastreada continua o alvo, que tem a distância e a velocidade de
+ * aproximação suavizadas com peso smoothing_pct para a medição nova; um salto
+ * maior inicia um novo alvo. Sem nenhum setor com alvo por hold_ms, o alvo é
+ * perdido. O tempo vem de frame->timestamp_us, então o mesmo estágio roda no
+ * firmware e sobre um log no simulador.
+ *
+ * O resultado de um frame vai em frames CAN clássicos de 8 bytes,
+ * little-endian, nos identificadores can_base_id + sensor_id *
+ * TOF_OBSTACLE_CAN_IDS_PER_SENSOR + k:
+ *
+ *     k = 0, resumo:
+ *         uint16 nearest_mm     menor distância do frame (TOF_OBSTACLE_NO_TARGET_MM = nenhum alvo)
+ *         uint16 track_mm       distância suavizada do alvo rastreado (TOF_OBSTACLE_NO_TARGET_MM = sem alvo)
+ *         int16  closing_mm_s   velocidade de aproximação do alvo (> 0 = aproximando)
+ *         uint8  setor do alvo mais próximo (bits 0-3) e confiança / 16 (bits 4-7)
+ *         uint8  TOF_OBSTACLE_FLAG_* (bits 0-3) e sequence do frame módulo 16 (bits 4-7)
+ *     k = 1, 2, setores 4k-4 a 4k-1 (só os que existem na resolução):
+ *         uint16 por setor: distância (bits 0-11, TOF_OBSTACLE_SECTOR_NO_TARGET = nenhum alvo) e confiança / 16 (bits 12-15)
+ *
+ * Um frame 8x8 ocupa 3 frames CAN (24 bytes de dados) e um 4x4, 2, contra
+ * 3 bytes de distância e status por zona para transmitir as zonas cruas.
+ */
+
+#ifndef TOF_OBSTACLE_H
+#define TOF_OBSTACLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+#define TOF_OBSTACLE_MAX_SECTORS 8                  /**< Setores de um frame 8x8 (um por coluna). */
+#define TOF_OBSTACLE_SECTORS_PER_CAN_FRAME 4        /**< Setores em cada frame CAN de setores. */
+#define TOF_OBSTACLE_MAX_CAN_FRAMES (1 + TOF_OBSTACLE_MAX_SECTORS / TOF_OBSTACLE_SECTORS_PER_CAN_FRAME) /**< Frames CAN de um frame ToF 8x8. */
+#define TOF_OBSTACLE_CAN_IDS_PER_SENSOR 4           /**< Identificadores CAN reservados por sensor. */
+#define TOF_OBSTACLE_CAN_DLC 8                      /**< Bytes de dados de cada frame CAN. */
+#define TOF_OBSTACLE_NO_TARGET_MM 0xFFFF            /**< Distância do resumo sem alvo. */
+#define TOF_OBSTACLE_SECTOR_NO_TARGET 0xFFF         /**< Distância de um setor sem alvo (12 bits; alvos a partir de 4095 mm são limitados a 4094). */
+
+#define TOF_OBSTACLE_FLAG_TARGET 0x01               /**< Ao menos um setor tem alvo neste frame. */
+#define TOF_OBSTACLE_FLAG_TRACK 0x02                /**< Há um alvo rastreado (pode vir de frames anteriores, até hold_ms). */
+#define TOF_OBSTACLE_FLAG_NEW_TRACK 0x04            /**< O alvo rastreado começou neste frame (velocidade ainda zero). */
+
+/**
+ * @brief Parâmetros do estágio.
+ */
+typedef struct {
+    uint16_t max_sigma_mm;                          /**< Maior sigma aceito em uma zona (mínimo 1). */
+    int16_t min_mm;                                 /**< Menor distância de um alvo. */
+    int16_t max_mm;                                 /**< Maior distância de um alvo. */
+    uint16_t gate_mm;                               /**< Salto de distância a partir do qual o alvo mais próximo é um novo alvo. */
+    uint8_t smoothing_pct;                          /**< Peso da medição nova na distância e na velocidade rastreadas (1 a 100). */
+    uint16_t hold_ms;                               /**< Tempo sem alvo antes de perder o alvo rastreado. */
+    uint16_t can_base_id;                           /**< Identificador CAN (11 bits) do resumo do sensor 0. */
+} tof_obstacle_config_t;
+
+/** @brief Parâmetros padrão. */
+#define TOF_OBSTACLE_CONFIG_DEFAULT {               \
+    .max_sigma_mm = 50,                             \
+    .min_mm = 0,                                    \
+    .max_mm = 4000,                                 \
+    .gate_mm = 300,                                 \
+    .smoothing_pct = 50,                            \
+    .hold_ms = 500,                                 \
+    .can_base_id = 0x380,                           \
+}
+
+/**
+ * @brief Menor distância de um setor.
+ */
+typedef struct {
+    int16_t distance_mm;                            /**< Menor distância (vale com zones > 0). */
+    uint8_t confidence;                             /**< Confiança da zona mais próxima (0 a 255). */
+    uint8_t zones;                                  /**< Zonas do setor com alvo aceito. */
+} tof_obstacle_sector_t;
+
+/**
+ * @brief Resultado de um frame.
+ */
+typedef struct {
+    int64_t timestamp_us;                           /**< Instante do frame de origem. */
+    uint32_t sequence;                              /**< Sequência do frame de origem. */
+    uint8_t sensor_id;                              /**< Sensor de origem. */
+    uint8_t flags;                                  /**< TOF_OBSTACLE_FLAG_*. */
+    uint8_t sector_count;                           /**< Setores do frame (colunas da resolução). */
+    uint8_t nearest_sector;                         /**< Setor com a menor distância (vale com TOF_OBSTACLE_FLAG_TARGET). */
+    int16_t nearest_mm;                             /**< Menor distância do frame. */
+    uint8_t nearest_confidence;                     /**< Confiança da menor distância. */
+    int16_t track_mm;                               /**< Distância suavizada do alvo rastreado (vale com TOF_OBSTACLE_FLAG_TRACK). */
+    int16_t closing_mm_s;                           /**< Velocidade de aproximação suavizada (> 0 = aproximando). */
+    uint16_t track_frames;                          /**< Frames com alvo desde o início do alvo rastreado (satura). */
+    tof_obstacle_sector_t sectors[TOF_OBSTACLE_MAX_SECTORS]; /**< Setores, da coluna 0 à última. */
+} tof_obstacle_result_t;
+
+/**
+ * @brief Contadores acumulados do estágio.
+ */
+typedef struct {
+    uint32_t frames;                                /**< Frames avaliados. */
+    uint32_t target_frames;                         /**< Frames com alvo em algum setor. */
+    uint32_t tracks;                                /**< Alvos rastreados iniciados. */
+    uint32_t lost;                                  /**< Alvos perdidos após hold_ms sem alvo. */
+} tof_obstacle_stats_t;
+
+/**
+ * @brief Estado do estágio de um sensor. Os campos são internos.
+ */
+typedef struct {
+    tof_obstacle_config_t config;                   /**< Parâmetros (já limitados). */
+    bool tracking;                                  /**< Há um alvo rastreado. */
+    int32_t track_mm;                               /**< Distância rastreada. */
+    int32_t closing_mm_s;                           /**< Velocidade de aproximação rastreada. */
+    uint16_t track_frames;                          /**< Frames do alvo rastreado. */
+    int64_t last_seen_us;                           /**< Último frame com alvo. */
+    tof_obstacle_stats_t stats;                     /**< Contadores acumulados. */
+} tof_obstacle_t;
+
+/**
+ * @brief Frame CAN clássico.
+ */
+typedef struct {
+    uint32_t id;                                    /**< Identificador de 11 bits. */
+    uint8_t dlc;                                    /**< Bytes de dados (TOF_OBSTACLE_CAN_DLC). */
+    uint8_t data[8];                                /**< Dados. */
+} tof_can_frame_t;
+
+/**
+ * @brief Inicializa o estágio sem alvo rastreado.
+ * @param obstacle Estado a ser inicializado.
+ * @param config Parâmetros (NULL = TOF_OBSTACLE_CONFIG_DEFAULT).
+ */
+void tof_obstacle_init(tof_obstacle_t *obstacle, const tof_obstacle_config_t *config);
+
+/**
+ * @brief Calcula os setores de um frame e atualiza o alvo rastreado.
+ * @param obstacle Estado do sensor que produziu o frame.
+ * @param frame Frame já filtrado, em 4x4 ou 8x8.
+ * @param[out] result Resultado do frame.
+ */
+void tof_obstacle_update(tof_obstacle_t *obstacle, const tof_frame_t *frame, tof_obstacle_result_t *result);
+
+/**
+ * @brief Empacota um resultado nos frames CAN descritos no início do arquivo.
+ * @param config Parâmetros (can_base_id).
+ * @param result Resultado de tof_obstacle_update().
+ * @param[out] frames Saída com ao menos TOF_OBSTACLE_MAX_CAN_FRAMES frames.
+ * @param capacity Frames disponíveis na saída.
+ * @return Frames preenchidos, ou 0 se a saída for pequena.
+ */
+size_t tof_obstacle_pack_can(const tof_obstacle_config_t *config, const tof_obstacle_result_t *result,
+                             tof_can_frame_t *frames, size_t capacity);
+
+/**
+ * @brief Retorna uma cópia dos contadores acumulados.
+ */
+tof_obstacle_stats_t tof_obstacle_get_stats(const tof_obstacle_t *obstacle);
+
+#endif // TOF_OBSTACLE_H
@@ -0,0 +1,131 @@
+/**
+ * @file tof_rate.h
+ * @brief Controle adaptativo da frequência de ranging e do tempo de integração pela atividade da cena e pela carga das filas.
+ *
+ * A cada frame o controle compara as distâncias do primeiro alvo com as do
+ * frame anterior do mesmo sensor: o frame é ativo quando ao menos
+ * active_zones zonas mudaram change_mm ou mais (ou passaram a ser válidas ou
+ * inválidas), ou quando traz agregados de movimento ativos
+ * (TOF_FRAME_FLAG_MOTION, ver tof_motion.h). Um frame ativo leva a
+ * frequência direto ao teto; sem atividade, a frequência cai à metade a cada
+ * hold_ms, até min_hz. Parado em min_hz por mais hold_ms, o sensor passa a
+ * medir em rajadas: burst_frames frames e sleep_ms com o sensor em sleep,
+ * até que um frame da rajada seja ativo.
+ *
+ * O teto começa em max_hz e cai à metade quando a fila mais cheia dos
+ * consumidores chega a queue_high_pct, no máximo uma vez a cada hold_ms
+ * enquanto ela continuar cheia; com a fila até queue_low_pct por hold_ms o
+ * teto volta a dobrar, até max_hz.
+ *
+ * O tempo de integração (ranging autônomo) acompanha a frequência:
+ * integration_pct do período, entre TOF_RATE_MIN_INTEGRATION_MS e
+ * max_integration_ms. O tempo vem de frame->timestamp_us, então o mesmo
+ * controle roda no firmware e sobre um log no simulador.
+ */
+
+#ifndef TOF_RATE_H
+#define TOF_RATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+#define TOF_RATE_MIN_INTEGRATION_MS 2               /**< Menor tempo de integração aceito pelo sensor. */
+
+/**
+ * @brief Parâmetros do controle.
+ */
+typedef struct {
+    uint8_t min_hz;                                 /**< Frequência com a cena parada (mínimo 1). */
+    uint8_t max_hz;                                 /**< Frequência com atividade (limite do sensor na resolução, ver vl53lmz_api.h). */
+    uint16_t change_mm;                             /**< Variação de uma zona entre frames seguidos que conta como mudança. */
+    uint8_t active_zones;                           /**< Zonas mudadas para o frame ser ativo (mínimo 1). */
+    uint16_t hold_ms;                               /**< Tempo sem atividade antes de cada redução (e entre ajustes do teto). */
+    uint16_t sleep_ms;                              /**< Sono entre as rajadas em min_hz (0 = nunca dorme). */
+    uint8_t burst_frames;                           /**< Frames de cada rajada (mínimo 1). */
+    uint8_t queue_high_pct;                         /**< Ocupação da fila que reduz o teto. */
+    uint8_t queue_low_pct;                          /**< Ocupação até a qual o teto volta a subir. */
+    uint8_t integration_pct;                        /**< Tempo de integração, em % do período. */
+    uint16_t max_integration_ms;                    /**< Maior tempo de integração. */
+} tof_rate_config_t;
+
+/** @brief Parâmetros padrão (max_hz do sensor em 8x8). */
+#define TOF_RATE_CONFIG_DEFAULT {                   \
+    .min_hz = 2,                                    \
+    .max_hz = 15,                                   \
+    .change_mm = 50,                                \
+    .active_zones = 2,                              \
+    .hold_ms = 2000,                                \
+    .sleep_ms = 1000,                               \
+    .burst_frames = 2,                              \
+    .queue_high_pct = 75,                           \
+    .queue_low_pct = 25,                            \
+    .integration_pct = 40,                          \
+    .max_integration_ms = 30,                       \
+}
+
+/**
+ * @brief Configuração pedida ao sensor.
+ */
+typedef struct {
+    uint8_t frequency_hz;                           /**< Frequência de ranging. */
+    uint16_t integration_ms;                        /**< Tempo de integração por medição. */
+    uint16_t sleep_ms;                              /**< > 0: parar o ranging e deixar o sensor em sleep por este tempo antes da próxima rajada. */
+} tof_rate_decision_t;
+
+/**
+ * @brief Contadores acumulados do controle.
+ */
+typedef struct {
+    uint32_t frames;                                /**< Frames avaliados. */
+    uint32_t active_frames;                         /**< Frames ativos. */
+    uint32_t rate_changes;                          /**< Mudanças de frequência pedidas. */
+    uint32_t sleeps;                                /**< Sonos entre rajadas pedidos. */
+    uint32_t backoffs;                              /**< Reduções do teto pela carga das filas. */
+} tof_rate_stats_t;
+
+/**
+ * @brief Estado do controle de um sensor. Os campos são internos.
+ */
+typedef struct {
+    tof_rate_config_t config;                       /**< Parâmetros (já limitados). */
+    tof_rate_decision_t decision;                   /**< Última configuração pedida. */
+    uint8_t cap_hz;                                 /**< Teto atual, reduzido pela carga das filas. */
+    uint8_t resolution;                             /**< Resolução do frame anterior (uma mudança descarta a referência). */
+    uint8_t burst_left;                             /**< Frames que ainda restam na rajada atual. */
+    bool bursting;                                  /**< Medindo em rajadas. */
+    bool overloaded;                                /**< A fila chegou a queue_high_pct e ainda não voltou a queue_low_pct. */
+    bool synced;                                    /**< Já houve um frame de referência. */
+    int64_t last_active_us;                         /**< Último frame ativo (ou o início). */
+    int64_t last_step_us;                           /**< Última redução ou aumento da frequência. */
+    int64_t last_cap_us;                            /**< Último ajuste do teto. */
+    uint64_t previous_valid;                        /**< Zonas válidas do frame anterior. */
+    int16_t previous_mm[TOF_FRAME_MAX_ZONES];       /**< Distâncias do frame anterior. */
+    tof_rate_stats_t stats;                         /**< Contadores acumulados. */
+} tof_rate_t;
+
+/**
+ * @brief Inicializa o controle na frequência máxima.
+ * @param rate Estado a ser inicializado.
+ * @param config Parâmetros (NULL = TOF_RATE_CONFIG_DEFAULT).
+ * @param[out] decision Configuração inicial do sensor.
+ */
+void tof_rate_init(tof_rate_t *rate, const tof_rate_config_t *config, tof_rate_decision_t *decision);
+
+/**
+ * @brief Avalia um frame e a carga das filas e decide a configuração do sensor.
+ * @param rate Estado do sensor que produziu o frame.
+ * @param frame Frame recém-adquirido (já filtrado).
+ * @param queue_pct Ocupação da fila mais cheia dos consumidores, em %.
+ * @param[out] decision Configuração pedida.
+ * @return true se a frequência ou a integração mudaram ou se o sensor deve dormir (decision->sleep_ms).
+ */
+bool tof_rate_update(tof_rate_t *rate, const tof_frame_t *frame, uint8_t queue_pct, tof_rate_decision_t *decision);
+
+/**
+ * @brief Retorna uma cópia dos contadores acumulados.
+ */
+tof_rate_stats_t tof_rate_get_stats(const tof_rate_t *rate);
+
+#endif // TOF_RATE_H
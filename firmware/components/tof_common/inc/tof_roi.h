@@ -0,0 +1,115 @@
+/**
+ * @file tof_roi.h
+ * @brief Troca automática entre 4x4 e 8x8 pela presença de um alvo em uma região de interesse (ROI).
+ *
+ * O sensor observa a cena em 4x4, com frequência alta e frames pequenos, e só
+ * passa a 8x8 enquanto houver um alvo dentro da ROI: um retângulo de zonas na
+ * grade 8x8 e uma faixa de distâncias. Em 4x4 cada zona cobre 2x2 zonas da
+ * grade 8x8, e conta como dentro da ROI se cobrir alguma zona do retângulo.
+ * O frame tem alvo na ROI quando ao menos min_zones zonas da ROI têm o
+ * primeiro alvo válido dentro da faixa. Sem alvo na ROI por hold_ms, o
+ * sensor volta a 4x4.
+ *
+ * O controle só decide a resolução: quem programa o sensor (e a frequência
+ * de cada resolução) é o chamador. As zonas são numeradas linha a linha na
+ * resolução do frame, como no driver, e o tempo vem de frame->timestamp_us.
+ */
+
+#ifndef TOF_ROI_H
+#define TOF_ROI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+#define TOF_ROI_RESOLUTION_4X4 16                   /**< Zonas em 4x4 (igual a VL53LMZ_RESOLUTION_4X4). */
+#define TOF_ROI_RESOLUTION_8X8 64                   /**< Zonas em 8x8 (igual a VL53LMZ_RESOLUTION_8X8). */
+#define TOF_ROI_GRID_SIDE 8                         /**< Lado da grade em que a ROI é definida. */
+
+/**
+ * @brief Parâmetros do controle.
+ */
+typedef struct {
+    uint8_t col_min;                                /**< Primeira coluna da ROI na grade 8x8 (0 a 7). */
+    uint8_t col_max;                                /**< Última coluna da ROI (inclusive). */
+    uint8_t row_min;                                /**< Primeira linha da ROI. */
+    uint8_t row_max;                                /**< Última linha da ROI (inclusive). */
+    int16_t min_mm;                                 /**< Menor distância de um alvo na ROI. */
+    int16_t max_mm;                                 /**< Maior distância de um alvo na ROI. */
+    uint8_t min_zones;                              /**< Zonas da ROI com alvo para o frame contar (mínimo 1). */
+    uint16_t hold_ms;                               /**< Tempo sem alvo na ROI antes de voltar a 4x4. */
+} tof_roi_config_t;
+
+/** @brief Parâmetros padrão: as 4x4 zonas centrais da grade 8x8, até 1,5 m. */
+#define TOF_ROI_CONFIG_DEFAULT {                    \
+    .col_min = 2,                                   \
+    .col_max = 5,                                   \
+    .row_min = 2,                                   \
+    .row_max = 5,                                   \
+    .min_mm = 0,                                    \
+    .max_mm = 1500,                                 \
+    .min_zones = 1,                                 \
+    .hold_ms = 1000,                                \
+}
+
+/**
+ * @brief Contadores acumulados do controle.
+ */
+typedef struct {
+    uint32_t frames;                                /**< Frames avaliados. */
+    uint32_t roi_frames;                            /**< Frames com alvo na ROI. */
+    uint32_t frames_8x8;                            /**< Frames avaliados em 8x8. */
+    uint32_t switches_up;                           /**< Trocas pedidas de 4x4 para 8x8. */
+    uint32_t switches_down;                         /**< Trocas pedidas de 8x8 para 4x4. */
+} tof_roi_stats_t;
+
+/**
+ * @brief Estado do controle de um sensor. Os campos são internos.
+ */
+typedef struct {
+    tof_roi_config_t config;                        /**< Parâmetros (já limitados à grade). */
+    uint64_t mask_4x4;                              /**< Zonas da ROI em 4x4. */
+    uint64_t mask_8x8;                              /**< Zonas da ROI em 8x8. */
+    uint8_t resolution;                             /**< Última resolução pedida (TOF_ROI_RESOLUTION_*). */
+    int64_t last_seen_us;                           /**< Último frame com alvo na ROI. */
+    tof_roi_stats_t stats;                          /**< Contadores acumulados. */
+} tof_roi_t;
+
+/**
+ * @brief Inicializa o controle em 4x4.
+ * @param roi Estado a ser inicializado.
+ * @param config Parâmetros (NULL = TOF_ROI_CONFIG_DEFAULT).
+ */
+void tof_roi_init(tof_roi_t *roi, const tof_roi_config_t *config);
+
+/**
+ * @brief Zonas da ROI em uma resolução.
+ * @param config Parâmetros da ROI.
+ * @param resolution Número de zonas (TOF_ROI_RESOLUTION_*).
+ * @return Bit z ligado = zona z cobre parte do retângulo (0 para outra resolução).
+ */
+uint64_t tof_roi_zone_mask(const tof_roi_config_t *config, uint8_t resolution);
+
+/**
+ * @brief Avalia um frame e decide a resolução do sensor.
+ * @param roi Estado do sensor que produziu o frame.
+ * @param frame Frame recém-adquirido, em qualquer resolução.
+ * @param[out] resolution Resolução pedida (TOF_ROI_RESOLUTION_*).
+ * @return true se a resolução pedida mudou.
+ */
+bool tof_roi_update(tof_roi_t *roi, const tof_frame_t *frame, uint8_t *resolution);
+
+/**
+ * @brief Descarta as zonas fora da ROI de um frame 8x8 (zonas sem alvo); frames 4x4 não mudam.
+ * @param roi Estado com a ROI.
+ * @param frame Frame a ser recortado.
+ */
+void tof_roi_crop(const tof_roi_t *roi, tof_frame_t *frame);
+
+/**
+ * @brief Retorna uma cópia dos contadores acumulados.
+ */
+tof_roi_stats_t tof_roi_get_stats(const tof_roi_t *roi);
+
+#endif // TOF_ROI_H
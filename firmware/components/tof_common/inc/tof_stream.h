@@ -0,0 +1,160 @@
+/**
+ * @file tof_stream.h
+ * @brief Streaming binário de frames pela UART: pacotes com CRC16, enquadrados com COBS.
+ *
+ * Cada frame vira um pacote
+ *
+ *     tof_stream_frame_header_t                     (16 bytes)
+ *     resolution x uint8 nb_target_detected         (todas as zonas)
+ *     targets x int16 distance_mm                   (targets = resolution x targets_per_zone)
+ *     targets x uint16 range_sigma_mm
+ *     targets x uint32 signal_per_spad
+ *     targets x uint8 target_status
+ *     uint16 crc16                                  (CRC-16/CCITT-FALSE de tudo o que vem antes)
+ *
+ * Os vetores por alvo seguem a ordem de TOF_FRAME_TARGET_IDX(). No modo de
+ * movimento (ver tof_motion.h), cada frame com o indicador de movimento gera
+ * também um pacote
+ *
+ *     tof_stream_motion_header_t                    (28 bytes)
+ *     popcount(active_mask) x uint32 motion         (só os agregados ativos, do menor para o maior)
+ *     uint16 crc16
+ *
+ * e o pacote do frame só é enviado quando o frame tem movimento. Os
+ * histogramas CNH seguem em pacotes próprios, do tipo TOF_STREAM_MSG_CNH
+ * (ver tof_cnh.h), e o resumo periódico das latências por etapa em pacotes
+ * TOF_STREAM_MSG_TELEMETRY (ver tof_latency.h).
+ *
+ * Cada pacote é codificado com COBS (Consistent Overhead Byte Stuffing) e cercado por
+ * bytes 0x00. Como o pacote codificado nunca contém 0x00, o receptor
+ * ressincroniza no próximo delimitador após qualquer byte perdido; o
+ * delimitador inicial isola do pacote o texto de log que o precede no mesmo
+ * canal. Trechos inválidos entre delimitadores são descartados pelo CRC.
+ * Todos os campos são little-endian.
+ */
+
+#ifndef TOF_STREAM_H
+#define TOF_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+#define TOF_STREAM_MSG_FRAME 0x01                   /**< Tipo de pacote: frame de medição. */
+#define TOF_STREAM_MSG_MOTION 0x02                  /**< Tipo de pacote: indicador de movimento de um frame. */
+#define TOF_STREAM_MSG_CNH 0x03                     /**< Tipo de pacote: histogramas CNH comprimidos de um frame (ver tof_cnh.h). */
+#define TOF_STREAM_MSG_TELEMETRY 0x04               /**< Tipo de pacote: latências por etapa do último intervalo (ver tof_latency.h). */
+#define TOF_STREAM_MOTION_SUPPRESSED 0x01           /**< Bit de flags do pacote de movimento: o frame de distâncias não foi enviado. */
+
+/**
+ * @brief Cabeçalho de um pacote de frame (16 bytes).
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t type;                                   /**< TOF_STREAM_MSG_FRAME. */
+    uint8_t resolution;                             /**< Número de zonas que seguem (16 ou 64). */
+    uint8_t streamcount;                            /**< Streamcount reportado pelo sensor. */
+    uint8_t targets_per_zone;                       /**< TOF_FRAME_TARGETS_PER_ZONE do firmware. */
+    uint32_t sequence;                              /**< Contador de frames do firmware. */
+    uint32_t timestamp_ms;                          /**< Instante da aquisição, em ms. */
+    int8_t silicon_temp_degc;                       /**< Temperatura interna do sensor. */
+    uint8_t sensor_id;                              /**< Sensor de origem (frames de vários sensores intercalados no mesmo stream). */
+    uint8_t reserved[2];                            /**< Zero. */
+} tof_stream_frame_header_t;
+
+/**
+ * @brief Cabeçalho de um pacote de movimento (28 bytes).
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t type;                                   /**< TOF_STREAM_MSG_MOTION. */
+    uint8_t sensor_id;                              /**< Sensor de origem. */
+    uint8_t status;                                 /**< Status do detector de movimento. */
+    uint8_t nb_detected_aggregates;                 /**< Agregados em que o sensor detectou movimento. */
+    uint8_t nb_aggregates;                          /**< Agregados configurados. */
+    uint8_t flags;                                  /**< TOF_STREAM_MOTION_SUPPRESSED. */
+    uint8_t reserved[2];                            /**< Zero. */
+    uint32_t sequence;                              /**< Contador de frames do firmware (o mesmo do pacote de frame). */
+    uint32_t timestamp_ms;                          /**< Instante da aquisição, em ms. */
+    uint32_t global_indicator_1;                    /**< Indicador global 1. */
+    uint32_t global_indicator_2;                    /**< Indicador global 2. */
+    uint32_t active_mask;                           /**< Bit i ligado = intensidade do agregado i incluída no pacote. */
+} tof_stream_motion_header_t;
+
+/** @brief Bytes por alvo no pacote (distância, sigma, sinal e status). */
+#define TOF_STREAM_TARGET_SIZE (sizeof(int16_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t))
+
+/** @brief Tamanho máximo de um pacote antes do COBS. */
+#define TOF_STREAM_MAX_PACKET (sizeof(tof_stream_frame_header_t) + TOF_FRAME_MAX_ZONES \
+    + TOF_FRAME_MAX_TARGETS * TOF_STREAM_TARGET_SIZE + 2)
+
+/** @brief Tamanho máximo após COBS (1 byte extra a cada 254, mais 1) e os dois delimitadores. */
+#define TOF_STREAM_MAX_ENCODED (TOF_STREAM_MAX_PACKET + TOF_STREAM_MAX_PACKET / 254 + 3)
+
+/**
+ * @brief Codifica um buffer com COBS (sem o delimitador final).
+ * @param in Dados de entrada.
+ * @param len Tamanho da entrada.
+ * @param out Saída com ao menos len + len / 254 + 1 bytes.
+ * @return Bytes escritos.
+ */
+size_t tof_cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ * @brief Decodifica um bloco COBS (sem o delimitador final).
+ * @param in Dados codificados.
+ * @param len Tamanho dos dados codificados.
+ * @param out Saída com ao menos len bytes.
+ * @param capacity Tamanho do buffer de saída.
+ * @return Bytes decodificados, ou 0 se a codificação for inválida.
+ */
+size_t tof_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t capacity);
+
+/**
+ * @brief Acrescenta o CRC a um pacote montado, aplica COBS e o cerca com delimitadores 0x00.
+ * @param packet Pacote com len bytes e 2 bytes livres no fim para o CRC.
+ * @param len Tamanho do pacote sem o CRC.
+ * @param out Saída com ao menos len + 2 + (len + 2) / 254 + 3 bytes.
+ * @return Bytes prontos para envio.
+ */
+size_t tof_stream_finish_packet(uint8_t *packet, size_t len, uint8_t *out);
+
+/**
+ * @brief Monta o pacote de um frame, aplica COBS e o cerca com delimitadores 0x00.
+ * @param frame Frame a ser enviado.
+ * @param out Buffer de saída com ao menos TOF_STREAM_MAX_ENCODED bytes.
+ * @param capacity Tamanho do buffer de saída.
+ * @return Bytes prontos para envio, ou 0 se o buffer for pequeno.
+ */
+size_t tof_stream_encode_frame(const tof_frame_t *frame, uint8_t *out, size_t capacity);
+
+/**
+ * @brief Monta o pacote de movimento de um frame (TOF_FRAME_FLAG_MOTION), com COBS e delimitadores.
+ * @param frame Frame, com motion.active_mask já calculado (tof_motion_apply()).
+ * @param out Buffer de saída com ao menos TOF_STREAM_MAX_ENCODED bytes.
+ * @param capacity Tamanho do buffer de saída.
+ * @return Bytes prontos para envio, ou 0 se o buffer for pequeno.
+ */
+size_t tof_stream_encode_motion(const tof_frame_t *frame, uint8_t *out, size_t capacity);
+
+/**
+ * @brief Decodifica um pacote recebido (bytes entre dois delimitadores, sem o 0x00).
+ * @param in Bytes codificados.
+ * @param len Quantidade de bytes.
+ * @param frame Frame reconstruído.
+ * @return true se o pacote é um frame válido (COBS, tamanho e CRC corretos).
+ */
+bool tof_stream_decode_frame(const uint8_t *in, size_t len, tof_frame_t *frame);
+
+/**
+ * @brief Decodifica um pacote de movimento.
+ * @param in Bytes codificados.
+ * @param len Quantidade de bytes.
+ * @param frame Frame sem distâncias, com o indicador de movimento, sensor_id,
+ * sequência e timestamp; TOF_FRAME_FLAG_MOTION_ONLY indica que o frame de
+ * distâncias não foi enviado.
+ * @return true se o pacote é um pacote de movimento válido.
+ */
+bool tof_stream_decode_motion(const uint8_t *in, size_t len, tof_frame_t *frame);
+
+#endif // TOF_STREAM_H
@@ -0,0 +1,59 @@
+/**
+ * @file tof_time.h
+ * @brief Relógio monotônico em microssegundos e contador de ciclos, iguais no firmware e no simulador de PC.
+ *
+ * tof_time_cycles() é o relógio da instrumentação (ver tof_latency.h): no
+ * ESP32 lê o registrador CCOUNT do core (uma instrução, válido em ISR), no PC
+ * o relógio monotônico em ns. Os valores são de 32 bits e dão a volta (~17 s a
+ * 240 MHz); a diferença sem sinal entre duas leituras do mesmo core é válida
+ * para intervalos menores que isso.
+ */
+
+#ifndef TOF_TIME_H
+#define TOF_TIME_H
+
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+
+/** @brief Tempo monotônico desde o boot, em µs. */
+static inline int64_t tof_time_us(void) {
+    return esp_timer_get_time();
+}
+
+/** @brief Ciclos do core atual. */
+static inline uint32_t tof_time_cycles(void) {
+    return (uint32_t)esp_cpu_get_cycle_count();
+}
+
+/** @brief Converte uma diferença de ciclos em ns, na frequência atual do core. */
+static inline uint32_t tof_time_cycles_to_ns(uint32_t cycles) {
+    return (uint32_t)((uint64_t)cycles * 1000u / esp_rom_get_cpu_ticks_per_us());
+}
+#else
+#include <time.h>
+
+/** @brief Tempo monotônico do sistema, em µs. */
+static inline int64_t tof_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** @brief Relógio monotônico em ns, truncado em 32 bits (um "ciclo" = 1 ns). */
+static inline uint32_t tof_time_cycles(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+/** @brief Converte uma diferença de tof_time_cycles() em ns. */
+static inline uint32_t tof_time_cycles_to_ns(uint32_t cycles) {
+    return cycles;
+}
+#endif
+
+#endif // TOF_TIME_H
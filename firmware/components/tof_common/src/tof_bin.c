@@ -0,0 +1,208 @@
+/**
+ * @file tof_bin.c
+ * @brief Codificação dos blocos do formato .tofb.
+ */
+
+#include "tof_bin.h"
+
+#include <string.h>
+
+#include "tof_crc.h"
+#include "tof_frame_stats.h"
+
+_Static_assert(sizeof(tof_bin_file_header_t) == 16, "cabeçalho de arquivo deve ter 16 bytes");
+_Static_assert(sizeof(tof_bin_block_header_t) == 16, "cabeçalho de bloco deve ter 16 bytes");
+_Static_assert(sizeof(tof_bin_frame_header_t) == 16, "cabeçalho de frame deve ter 16 bytes");
+
+void tof_bin_make_file_header(tof_bin_file_header_t *header) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, TOF_BIN_MAGIC, sizeof(header->magic));
+    header->version = TOF_BIN_VERSION;
+    header->header_size = sizeof(tof_bin_file_header_t);
+    header->block_header_size = sizeof(tof_bin_block_header_t);
+    header->frame_header_size = sizeof(tof_bin_frame_header_t);
+    header->distance_size = sizeof(int16_t);
+    header->status_size = sizeof(uint8_t);
+    header->sigma_size = sizeof(uint16_t);
+    header->signal_size = sizeof(uint32_t);
+}
+
+void tof_bin_block_reset(tof_bin_block_t *block) {
+    block->frame_count = 0;
+    block->zone_count = 0;
+    block->first_frame_us = 0;
+}
+
+bool tof_bin_block_add_frame(tof_bin_block_t *block, const tof_frame_t *frame) {
+    if (tof_bin_block_is_full(block)) {
+        return false;
+    }
+    if (block->frame_count == 0) {
+        block->first_frame_us = frame->timestamp_us;
+    }
+
+    tof_bin_frame_header_t *hdr = &block->headers[block->frame_count];
+    int16_t *dist = &block->distances[block->zone_count];
+    uint16_t *sigma = &block->sigmas[block->zone_count];
+    uint32_t *signal = &block->signals[block->zone_count];
+    uint8_t *status = &block->statuses[block->zone_count];
+    uint64_t mask = tof_frame_valid_mask(frame, 0);
+    uint8_t count = (uint8_t)tof_frame_compact_distances(frame, mask, 0, dist);
+
+    // Percorre só as zonas válidas, da menor para a maior, como as distâncias
+    uint8_t n = 0;
+    for (uint64_t pending = mask; pending != 0; pending &= pending - 1) {
+        int idx = TOF_FRAME_TARGET_IDX(__builtin_ctzll(pending), 0);
+        sigma[n] = frame->range_sigma_mm[idx];
+        signal[n] = frame->signal_per_spad[idx];
+        status[n] = frame->target_status[idx];
+        n++;
+    }
+
+    hdr->timestamp_ms = (uint32_t)(frame->timestamp_us / 1000);
+    hdr->streamcount = frame->streamcount;
+    hdr->resolution = frame->resolution;
+    hdr->valid_count = count;
+    hdr->sensor_id = frame->sensor_id;
+    hdr->valid_mask = mask;
+
+    block->frame_count++;
+    block->zone_count += count;
+    return true;
+}
+
+void tof_bin_delta_init(tof_bin_delta_t *delta, const tof_bin_delta_config_t *config) {
+    memset(delta, 0, sizeof(*delta));
+    delta->config = *config;
+    if (delta->config.keyframe_interval == 0) {
+        delta->config.keyframe_interval = 1;
+    }
+}
+
+bool tof_bin_block_add_delta_frame(tof_bin_block_t *block, tof_bin_delta_t *delta, const tof_frame_t *frame) {
+    if (tof_bin_block_is_full(block)) {
+        return false;
+    }
+    tof_bin_delta_sensor_t *state = frame->sensor_id < TOF_BIN_DELTA_MAX_SENSORS ? &delta->sensors[frame->sensor_id] : NULL;
+    uint64_t valid = tof_frame_valid_mask(frame, 0);
+
+    if (state == NULL || !state->synced || state->frames_to_keyframe == 0 || frame->resolution != state->resolution) {
+        tof_bin_block_add_frame(block, frame);
+        delta->stats.keyframes++;
+        if (state != NULL) {
+            state->synced = true;
+            state->resolution = frame->resolution;
+            state->frames_to_keyframe = delta->config.keyframe_interval - 1;
+            state->valid_mask = valid;
+            for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+                int idx = TOF_FRAME_TARGET_IDX(z, 0);
+                state->distance_mm[z] = frame->distance_mm[idx];
+                state->status[z] = frame->target_status[idx];
+            }
+        }
+        return true;
+    }
+    state->frames_to_keyframe--;
+    if (block->frame_count == 0) {
+        block->first_frame_us = frame->timestamp_us;
+    }
+
+    // Zonas a gravar: mudança de validade ou, nas válidas, de status ou de
+    // distância além do limiar, sempre contra o último valor gravado (a
+    // reconstrução nunca se afasta mais que o limiar da medida)
+    const int threshold = delta->config.threshold_mm;
+    uint64_t changed = valid ^ state->valid_mask;
+    for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+        int idx = TOF_FRAME_TARGET_IDX(z, 0);
+        int diff = frame->distance_mm[idx] - state->distance_mm[z];
+        uint64_t moved = (uint64_t)((diff > threshold) | (diff < -threshold) |
+                                    (frame->target_status[idx] != state->status[z]));
+        changed |= (moved & ((valid >> z) & 1)) << z;
+    }
+
+    tof_bin_frame_header_t *hdr = &block->headers[block->frame_count];
+    uint16_t first = block->zone_count;
+    uint8_t n = 0;
+    for (uint64_t pending = changed; pending != 0; pending &= pending - 1) {
+        int z = __builtin_ctzll(pending);
+        int idx = TOF_FRAME_TARGET_IDX(z, 0);
+        uint8_t status = ((valid >> z) & 1) ? frame->target_status[idx] : TOF_BIN_STATUS_INVALIDATED;
+        block->distances[first + n] = frame->distance_mm[idx];
+        block->sigmas[first + n] = frame->range_sigma_mm[idx];
+        block->signals[first + n] = frame->signal_per_spad[idx];
+        block->statuses[first + n] = status;
+        state->distance_mm[z] = frame->distance_mm[idx];
+        state->status[z] = status;
+        n++;
+    }
+    state->valid_mask = valid;
+
+    hdr->timestamp_ms = (uint32_t)(frame->timestamp_us / 1000);
+    hdr->streamcount = frame->streamcount;
+    hdr->resolution = frame->resolution;
+    hdr->valid_count = (uint8_t)(n | TOF_BIN_FRAME_DELTA);
+    hdr->sensor_id = frame->sensor_id;
+    hdr->valid_mask = changed;
+
+    block->frame_count++;
+    block->zone_count += n;
+    delta->stats.delta_frames++;
+    delta->stats.zones_written += n;
+    delta->stats.zones_skipped += (uint32_t)__builtin_popcountll(valid & ~changed);
+    return true;
+}
+
+bool tof_bin_block_is_full(const tof_bin_block_t *block) {
+    return block->frame_count >= TOF_BIN_MAX_FRAMES_PER_BLOCK;
+}
+
+/**
+ * @brief Tamanho do payload do bloco, com preenchimento até múltiplo de 4.
+ */
+static size_t payload_size(const tof_bin_block_t *block) {
+    size_t size = (size_t)block->frame_count * sizeof(tof_bin_frame_header_t)
+                + (size_t)block->zone_count * TOF_BIN_ZONE_SIZE;
+    return (size + 3) & ~(size_t)3;
+}
+
+size_t tof_bin_block_encoded_size(const tof_bin_block_t *block) {
+    return sizeof(tof_bin_block_header_t) + payload_size(block);
+}
+
+size_t tof_bin_block_encode(const tof_bin_block_t *block, uint8_t *out, size_t capacity) {
+    size_t total = tof_bin_block_encoded_size(block);
+    if (block->frame_count == 0 || capacity < total) {
+        return 0;
+    }
+
+    uint8_t *payload = out + sizeof(tof_bin_block_header_t);
+    uint8_t *p = payload;
+    size_t n;
+
+    n = (size_t)block->frame_count * sizeof(tof_bin_frame_header_t);
+    memcpy(p, block->headers, n);
+    p += n;
+    n = (size_t)block->zone_count * sizeof(int16_t);
+    memcpy(p, block->distances, n);
+    p += n;
+    n = (size_t)block->zone_count * sizeof(uint16_t);
+    memcpy(p, block->sigmas, n);
+    p += n;
+    n = (size_t)block->zone_count * sizeof(uint32_t);
+    memcpy(p, block->signals, n);
+    p += n;
+    n = (size_t)block->zone_count * sizeof(uint8_t);
+    memcpy(p, block->statuses, n);
+    p += n;
+    memset(p, 0, (size_t)(out + total - p));
+
+    tof_bin_block_header_t hdr = {
+        .sync = TOF_BIN_BLOCK_SYNC,
+        .payload_size = (uint32_t)payload_size(block),
+        .frame_count = block->frame_count,
+        .zone_count = block->zone_count,
+        .crc32 = tof_crc32(0, payload, payload_size(block)),
+    };
+    memcpy(out, &hdr, sizeof(hdr));
+    return total;
+}
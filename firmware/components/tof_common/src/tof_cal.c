@@ -0,0 +1,49 @@
+/**
+ * @file tof_cal.c
+ * @brief Implementação do registro do cache de calibração.
+ */
+
+#include "tof_cal.h"
+
+#include <string.h>
+
+#include "tof_crc.h"
+
+void tof_cal_record_make(tof_cal_record_t *record, uint8_t sensor_id, uint8_t module_type,
+                         uint32_t offset_crc, const uint8_t *xtalk) {
+    memset(record, 0, sizeof(*record));
+    record->magic = TOF_CAL_MAGIC;
+    record->version = TOF_CAL_VERSION;
+    record->module_type = module_type;
+    record->sensor_id = sensor_id;
+    record->offset_crc = offset_crc;
+    memcpy(record->xtalk, xtalk, sizeof(record->xtalk));
+    record->crc32 = tof_crc32(0, record, offsetof(tof_cal_record_t, crc32));
+}
+
+bool tof_cal_record_matches(const tof_cal_record_t *record, size_t len, uint8_t sensor_id,
+                            uint8_t module_type, uint32_t offset_crc) {
+    return len == sizeof(*record) &&
+           record->magic == TOF_CAL_MAGIC &&
+           record->version == TOF_CAL_VERSION &&
+           record->crc32 == tof_crc32(0, record, offsetof(tof_cal_record_t, crc32)) &&
+           record->module_type == module_type &&
+           record->sensor_id == sensor_id &&
+           record->offset_crc == offset_crc;
+}
+
+tof_cal_load_result_t tof_cal_load(tof_cal_read_fn read, void *ctx, const char *key, tof_cal_record_t *record,
+                                   uint8_t sensor_id, uint8_t module_type, uint32_t offset_crc) {
+    // A capacidade é o registro inteiro: um blob menor (de outra versão) é lido e rejeitado pelo tamanho
+    size_t len = sizeof(*record);
+    switch (read(ctx, key, record, &len)) {
+        case TOF_CAL_READ_OK:
+            break;
+        case TOF_CAL_READ_NOT_FOUND:
+            return TOF_CAL_MISSING;
+        default:
+            return TOF_CAL_READ_ERROR;
+    }
+    return tof_cal_record_matches(record, len, sensor_id, module_type, offset_crc) ? TOF_CAL_LOADED
+                                                                                    : TOF_CAL_MISMATCH;
+}
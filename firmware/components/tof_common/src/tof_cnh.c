@@ -0,0 +1,144 @@
+/**
+ * @file tof_cnh.c
+ * @brief Codificação delta + varint dos histogramas CNH e decodificação dos pacotes.
+ */
+
+#include "tof_cnh.h"
+
+#include <string.h>
+
+#include "tof_crc.h"
+#include "tof_stream.h"
+
+_Static_assert(sizeof(tof_cnh_header_t) == 16, "cabeçalho CNH deve ter 16 bytes");
+
+/** @brief Escreve um valor com sinal em zigzag + varint; retorna a posição seguinte. */
+static uint8_t *put_varint(uint8_t *p, int32_t value);
+
+/** @brief Lê um varint zigzag; retorna a posição seguinte, ou NULL se ultrapassar end. */
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, int32_t *value);
+
+void tof_cnh_encoder_begin(tof_cnh_encoder_t *encoder, uint8_t *packet, size_t capacity,
+                           const tof_cnh_header_t *header) {
+    memset(encoder, 0, sizeof(*encoder));
+    encoder->packet = packet;
+    encoder->capacity = capacity;
+    encoder->nb_bins = header->nb_bins;
+    encoder->remaining = header->nb_aggregates;
+    if (capacity < sizeof(*header) + 2) {
+        encoder->overflow = true;
+        return;
+    }
+    tof_cnh_header_t hdr = *header;
+    hdr.type = TOF_STREAM_MSG_CNH;
+    memcpy(packet, &hdr, sizeof(hdr));
+    encoder->len = sizeof(hdr);
+}
+
+void tof_cnh_encoder_add_aggregate(tof_cnh_encoder_t *encoder, const int32_t *hist, const int8_t *hist_scaler,
+                                   int32_t ambient, int8_t ambient_scaler) {
+    // Pior caso de um agregado, com os 2 bytes do CRC reservados
+    size_t worst = (2 + 2 * (size_t)encoder->nb_bins) * TOF_CNH_VARINT_MAX;
+    if (encoder->overflow || encoder->remaining == 0 || encoder->capacity - 2 - encoder->len < worst) {
+        encoder->overflow = true;
+        return;
+    }
+
+    uint8_t *p = &encoder->packet[encoder->len];
+    p = put_varint(p, ambient);
+    p = put_varint(p, ambient_scaler);
+    int32_t prev = 0;
+    for (uint8_t b = 0; b < encoder->nb_bins; b++) {
+        p = put_varint(p, hist_scaler[b] - prev);
+        prev = hist_scaler[b];
+    }
+    uint32_t prev_hist = 0;
+    for (uint8_t b = 0; b < encoder->nb_bins; b++) {
+        p = put_varint(p, (int32_t)((uint32_t)hist[b] - prev_hist));
+        prev_hist = (uint32_t)hist[b];
+    }
+    encoder->len = (size_t)(p - encoder->packet);
+    encoder->remaining--;
+}
+
+size_t tof_cnh_encoder_finish(tof_cnh_encoder_t *encoder, uint8_t *out, size_t capacity) {
+    if (encoder->overflow || encoder->remaining != 0 ||
+        capacity < TOF_CNH_ENCODED_BOUND(encoder->len + 2)) {
+        return 0;
+    }
+    return tof_stream_finish_packet(encoder->packet, encoder->len, out);
+}
+
+bool tof_cnh_decode_packet(const uint8_t *packet, size_t len, tof_cnh_frame_t *frame) {
+    if (len < sizeof(tof_cnh_header_t) + 2) {
+        return false;
+    }
+    tof_cnh_header_t hdr;
+    memcpy(&hdr, packet, sizeof(hdr));
+    if (hdr.type != TOF_STREAM_MSG_CNH || hdr.nb_aggregates > TOF_CNH_MAX_AGGREGATES ||
+        (size_t)hdr.nb_aggregates * hdr.nb_bins > TOF_CNH_MAX_VALUES) {
+        return false;
+    }
+    uint16_t crc;
+    memcpy(&crc, &packet[len - 2], sizeof(crc));
+    if (crc != tof_crc16(packet, len - 2)) {
+        return false;
+    }
+
+    frame->header = hdr;
+    const uint8_t *p = &packet[sizeof(hdr)];
+    const uint8_t *end = &packet[len - 2];
+    for (uint8_t a = 0; a < hdr.nb_aggregates; a++) {
+        int32_t value;
+        if ((p = get_varint(p, end, &frame->ambient[a])) == NULL || (p = get_varint(p, end, &value)) == NULL) {
+            return false;
+        }
+        frame->ambient_scaler[a] = (int8_t)value;
+
+        int8_t *scaler = &frame->hist_scaler[(size_t)a * hdr.nb_bins];
+        uint32_t prev = 0;
+        for (uint8_t b = 0; b < hdr.nb_bins; b++) {
+            if ((p = get_varint(p, end, &value)) == NULL) {
+                return false;
+            }
+            prev += (uint32_t)value;
+            scaler[b] = (int8_t)prev;
+        }
+        int32_t *hist = &frame->hist[(size_t)a * hdr.nb_bins];
+        uint32_t prev_hist = 0;
+        for (uint8_t b = 0; b < hdr.nb_bins; b++) {
+            if ((p = get_varint(p, end, &value)) == NULL) {
+                return false;
+            }
+            prev_hist += (uint32_t)value;
+            hist[b] = (int32_t)prev_hist;
+        }
+    }
+    return p == end;
+}
+
+static uint8_t *put_varint(uint8_t *p, int32_t value) {
+    uint32_t zz = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    while (zz >= 0x80u) {
+        *p++ = (uint8_t)(zz | 0x80u);
+        zz >>= 7;
+    }
+    *p++ = (uint8_t)zz;
+    return p;
+}
+
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, int32_t *value) {
+    uint32_t zz = 0;
+    for (int shift = 0; shift < 7 * TOF_CNH_VARINT_MAX; shift += 7) {
+        if (p >= end) {
+            return NULL;
+        }
+        uint8_t byte = *p++;
+        zz |= (uint32_t)(byte & 0x7Fu) << shift;
+        if ((byte & 0x80u) == 0) {
+            *value = (int32_t)((zz >> 1) ^ (0u - (zz & 1u)));
+            return p;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file tof_crc.c
+ * @brief Implementação por tabela dos CRCs.
+ */
+
+#include "tof_crc.h"
+
+#include <stdbool.h>
+
+static uint32_t s_crc32_table[256];
+static bool s_crc32_table_ready = false;
+static uint16_t s_crc16_table[256];
+static bool s_crc16_table_ready = false;
+
+/**
+ * @brief Gera a tabela do CRC-32 (1 KB) no primeiro uso.
+ */
+static void build_crc32_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+        }
+        s_crc32_table[i] = c;
+    }
+    s_crc32_table_ready = true;
+}
+
+uint32_t tof_crc32(uint32_t crc, const void *data, size_t len) {
+    if (!s_crc32_table_ready) {
+        build_crc32_table();
+    }
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+    while (len--) {
+        crc = s_crc32_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Gera a tabela do CRC-16 (512 bytes) no primeiro uso.
+ */
+static void build_crc16_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint16_t c = (uint16_t)(i << 8);
+        for (int k = 0; k < 8; k++) {
+            c = (c & 0x8000) ? (uint16_t)((c << 1) ^ 0x1021) : (uint16_t)(c << 1);
+        }
+        s_crc16_table[i] = c;
+    }
+    s_crc16_table_ready = true;
+}
+
+// Por tabela, como o CRC-32: um pacote de frame 8x8 tem ~660 bytes e o CRC é calculado a cada frame na UART
+uint16_t tof_crc16(const void *data, size_t len) {
+    if (!s_crc16_table_ready) {
+        build_crc16_table();
+    }
+    const uint8_t *p = (const uint8_t *)data;
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc = (uint16_t)((crc << 8) ^ s_crc16_table[((crc >> 8) ^ *p++) & 0xFF]);
+    }
+    return crc;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file tof_csv.c
+ * @brief Formatação CSV sem printf: os campos são convertidos diretamente para o buffer de saída.
+ */
+
+#include "tof_csv.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "tof_frame_stats.h"
+
+/**
+ * @brief Converte um inteiro sem sinal em decimal no buffer.
+ * @return Número de caracteres escritos.
+ */
+static size_t append_uint(char *out, uint64_t value) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+/**
+ * @brief Converte um inteiro com sinal em decimal no buffer.
+ * @return Número de caracteres escritos.
+ */
+static size_t append_int(char *out, int32_t value) {
+    if (value >= 0) {
+        return append_uint(out, (uint64_t)value);
+    }
+    out[0] = '-';
+    return 1 + append_uint(out + 1, (uint64_t)(-(int64_t)value));
+}
+
+size_t tof_csv_format_frame(char *out, size_t capacity, const tof_frame_t *frame) {
+    // O timestamp é o mesmo em todas as linhas do frame: formata uma única vez
+    char ts[24];
+    int64_t timestamp_ms = frame->timestamp_us / 1000;
+    size_t ts_len = append_uint(ts, (uint64_t)(timestamp_ms < 0 ? 0 : timestamp_ms));
+    ts[ts_len++] = ',';
+
+    uint64_t masks[TOF_FRAME_TARGETS_PER_ZONE];
+    uint64_t zones = 0;
+    for (int t = 0; t < TOF_FRAME_TARGETS_PER_ZONE; t++) {
+        masks[t] = tof_frame_valid_mask(frame, t);
+        zones |= masks[t];
+    }
+
+    size_t len = 0;
+    for (; zones != 0; zones &= zones - 1) {
+        int z = __builtin_ctzll(zones);
+        for (int t = 0; t < TOF_FRAME_TARGETS_PER_ZONE; t++) {
+            if (((masks[t] >> z) & 1) == 0) {
+                continue;
+            }
+            if (capacity - len < TOF_CSV_MAX_ROW_LEN) {
+                return 0;
+            }
+            int idx = TOF_FRAME_TARGET_IDX(z, t);
+            memcpy(out + len, ts, ts_len);
+            len += ts_len;
+            len += append_uint(out + len, (uint64_t)z);
+            out[len++] = ',';
+            len += append_int(out + len, frame->distance_mm[idx]);
+            out[len++] = ',';
+            len += append_uint(out + len, frame->target_status[idx]);
+            out[len++] = ',';
+            len += append_uint(out + len, frame->range_sigma_mm[idx]);
+            out[len++] = ',';
+            len += append_uint(out + len, frame->signal_per_spad[idx]);
+            out[len++] = ',';
+            len += append_uint(out + len, frame->sensor_id);
+            out[len++] = ',';
+            len += append_uint(out + len, frame->resolution);
+            out[len++] = '\n';
+        }
+    }
+    return len;
+}
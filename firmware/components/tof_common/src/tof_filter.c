@@ -0,0 +1,235 @@
+/**
+ * @file tof_filter.c
+ * @brief Mediana, média exponencial e Kalman por zona em aritmética inteira.
+ */
+
+#include "tof_filter.h"
+
+#include <string.h>
+
+#include "tof_frame_stats.h"
+
+#define KALMAN_GAIN_SHIFT 12                        /**< Ganho do Kalman em Q12. */
+#define KALMAN_MAX_VARIANCE ((1u << 20) - 1)        /**< Limite da variância da estimativa: (P << 12) cabe em 32 bits. */
+
+/** @brief Bit z da máscara, como 0 ou 1. */
+static inline int zone_bit(uint64_t mask, int z) {
+    return (int)((mask >> z) & 1);
+}
+
+/** @brief Arredonda uma estimativa em Q4 mm para mm. */
+static inline int16_t round_q4(int32_t value_q4) {
+    return (int16_t)((value_q4 + 8) >> 4);
+}
+
+/** @brief Mediana da janela, com o histórico das zonas inválidas repetindo a saída anterior. */
+static void median_step(tof_filter_t *filter, const int16_t *raw, uint64_t valid, int16_t *out);
+
+/** @brief Média móvel exponencial em Q4 mm. */
+static void ema_step(tof_filter_t *filter, const int16_t *raw, uint64_t valid, int16_t *out);
+
+/** @brief Kalman de posição constante com rejeição pelo sigma da medida. */
+static void kalman_step(tof_filter_t *filter, const tof_frame_t *frame, const int16_t *raw, uint64_t valid, int16_t *out);
+
+void tof_filter_init(tof_filter_t *filter, const tof_filter_config_t *config) {
+    static const tof_filter_config_t defaults = TOF_FILTER_CONFIG_DEFAULT(TOF_FILTER_MEDIAN);
+    memset(filter, 0, sizeof(*filter));
+    filter->config = config ? *config : defaults;
+
+    tof_filter_config_t *c = &filter->config;
+    c->median_window = c->median_window < 3 ? 3 : c->median_window;
+    c->median_window = c->median_window > TOF_FILTER_MAX_WINDOW ? TOF_FILTER_MAX_WINDOW : c->median_window;
+    c->median_window |= 1;  // Janela ímpar: a mediana é um elemento da janela
+    c->ema_alpha_q8 = c->ema_alpha_q8 < 1 ? 1 : (c->ema_alpha_q8 > 256 ? 256 : c->ema_alpha_q8);
+    c->kalman_gate_sigma = c->kalman_gate_sigma < 1 ? 1 : (c->kalman_gate_sigma > 7 ? 7 : c->kalman_gate_sigma);
+    c->kalman_max_rejects = c->kalman_max_rejects < 1 ? 1 : c->kalman_max_rejects;
+    c->default_sigma_mm = c->default_sigma_mm < 1 ? 1 : c->default_sigma_mm;
+}
+
+void tof_filter_reset(tof_filter_t *filter) {
+    filter->resolution = 0;
+    filter->head = 0;
+    filter->tracked = 0;
+    filter->previous_valid = 0;
+}
+
+void tof_filter_apply(tof_filter_t *filter, tof_frame_t *frame) {
+    if (frame->resolution != filter->resolution) {
+        tof_filter_reset(filter);
+        filter->resolution = frame->resolution;
+    }
+    filter->stats.frames++;
+
+    uint64_t valid = tof_frame_valid_mask(frame, 0);
+    int16_t raw[TOF_FRAME_MAX_ZONES];
+    int16_t out[TOF_FRAME_MAX_ZONES];
+    for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+        raw[z] = frame->distance_mm[TOF_FRAME_TARGET_IDX(z, 0)];
+    }
+
+    switch (filter->config.mode) {
+    case TOF_FILTER_MEDIAN:
+        median_step(filter, raw, valid, out);
+        break;
+    case TOF_FILTER_EMA:
+        ema_step(filter, raw, valid, out);
+        break;
+    case TOF_FILTER_KALMAN:
+        kalman_step(filter, frame, raw, valid, out);
+        break;
+    default:
+        memcpy(out, raw, sizeof(out));
+        break;
+    }
+
+    // Grava a saída só nas zonas válidas e conta as mudanças entre frames
+    // seguidos, que medem quanto o filtro reduz a oscilação no log
+    uint64_t both = valid & filter->previous_valid;
+    uint32_t raw_changes = 0;
+    uint32_t filtered_changes = 0;
+    for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+        int v = zone_bit(valid, z);
+        int b = zone_bit(both, z);
+        int16_t d = v ? out[z] : raw[z];
+        int raw_delta = raw[z] - filter->previous_raw[z];
+        int out_delta = d - filter->previous_out[z];
+        raw_changes += (uint32_t)(b & ((raw_delta > TOF_FILTER_CHANGE_MM) | (raw_delta < -TOF_FILTER_CHANGE_MM)));
+        filtered_changes += (uint32_t)(b & ((out_delta > TOF_FILTER_CHANGE_MM) | (out_delta < -TOF_FILTER_CHANGE_MM)));
+        filter->previous_raw[z] = v ? raw[z] : filter->previous_raw[z];
+        filter->previous_out[z] = v ? d : filter->previous_out[z];
+        frame->distance_mm[TOF_FRAME_TARGET_IDX(z, 0)] = d;
+    }
+    filter->stats.raw_changes += raw_changes;
+    filter->stats.filtered_changes += filtered_changes;
+    filter->previous_valid = valid;
+}
+
+tof_filter_stats_t tof_filter_get_stats(const tof_filter_t *filter) {
+    return filter->stats;
+}
+
+const char *tof_filter_mode_name(tof_filter_mode_t mode) {
+    switch (mode) {
+    case TOF_FILTER_MEDIAN:
+        return "median";
+    case TOF_FILTER_EMA:
+        return "ema";
+    case TOF_FILTER_KALMAN:
+        return "kalman";
+    default:
+        return "none";
+    }
+}
+
+bool tof_filter_mode_from_name(const char *name, tof_filter_mode_t *mode) {
+    static const tof_filter_mode_t modes[] = { TOF_FILTER_NONE, TOF_FILTER_MEDIAN, TOF_FILTER_EMA, TOF_FILTER_KALMAN };
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcmp(name, tof_filter_mode_name(modes[i])) == 0) {
+            *mode = modes[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void median_step(tof_filter_t *filter, const int16_t *raw, uint64_t valid, int16_t *out) {
+    const int window = filter->config.median_window;
+    // Uma zona que fica válida pela primeira vez começa com a janela inteira
+    // na medida atual, para não vir a mediana de valores antigos
+    uint64_t fresh = valid & ~filter->tracked;
+    for (int r = 0; r < window; r++) {
+        int16_t *row = filter->history[r];
+        for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+            row[z] = zone_bit(fresh, z) ? raw[z] : row[z];
+        }
+    }
+    filter->tracked |= valid;
+    int16_t *row = filter->history[filter->head];
+    for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+        row[z] = zone_bit(valid, z) ? raw[z] : filter->previous_out[z];
+    }
+    filter->head = (uint8_t)((filter->head + 1) % window);
+
+    // Ordenação par-ímpar da janela, zona a zona: só mínimos e máximos
+    int16_t sorted[TOF_FILTER_MAX_WINDOW][TOF_FRAME_MAX_ZONES];
+    memcpy(sorted, filter->history, (size_t)window * sizeof(sorted[0]));
+    for (int pass = 0; pass < window; pass++) {
+        for (int i = pass & 1; i + 1 < window; i += 2) {
+            int16_t *a = sorted[i];
+            int16_t *b = sorted[i + 1];
+            for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+                int16_t lo = a[z] < b[z] ? a[z] : b[z];
+                int16_t hi = a[z] < b[z] ? b[z] : a[z];
+                a[z] = lo;
+                b[z] = hi;
+            }
+        }
+    }
+    memcpy(out, sorted[window / 2], sizeof(sorted[0]));
+}
+
+static void ema_step(tof_filter_t *filter, const int16_t *raw, uint64_t valid, int16_t *out) {
+    const int32_t alpha = filter->config.ema_alpha_q8;
+    uint64_t fresh = valid & ~filter->tracked;
+    for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+        int32_t measure_q4 = (int32_t)raw[z] * 16;
+        int32_t estimate = filter->estimate_q4[z];
+        int32_t updated = estimate + ((alpha * (measure_q4 - estimate)) >> 8);
+        updated = zone_bit(fresh, z) ? measure_q4 : updated;
+        filter->estimate_q4[z] = zone_bit(valid, z) ? updated : estimate;
+        out[z] = round_q4(filter->estimate_q4[z]);
+    }
+    filter->tracked |= valid;
+}
+
+static void kalman_step(tof_filter_t *filter, const tof_frame_t *frame, const int16_t *raw, uint64_t valid, int16_t *out) {
+    const tof_filter_config_t *c = &filter->config;
+    const uint32_t gate2 = (uint32_t)c->kalman_gate_sigma * c->kalman_gate_sigma;
+    memcpy(out, raw, TOF_FRAME_MAX_ZONES * sizeof(*out));
+
+    for (uint64_t pending = valid; pending != 0; pending &= pending - 1) {
+        int z = __builtin_ctzll(pending);
+        uint32_t sigma = frame->range_sigma_mm[TOF_FRAME_TARGET_IDX(z, 0)];
+        sigma = sigma == 0 ? c->default_sigma_mm : sigma;
+        sigma = sigma > TOF_FILTER_MAX_SIGMA_MM ? TOF_FILTER_MAX_SIGMA_MM : sigma;
+        uint32_t measure_var = sigma * sigma;
+        int32_t measure_q4 = (int32_t)raw[z] * 16;
+
+        if (!zone_bit(filter->tracked, z)) {
+            filter->estimate_q4[z] = measure_q4;
+            filter->variance_mm2[z] = measure_var;
+            filter->rejects[z] = 0;
+            filter->tracked |= (uint64_t)1 << z;
+            continue;
+        }
+
+        // Predição: o alvo pode ter se movido desde o último frame
+        uint32_t p = filter->variance_mm2[z] + c->kalman_process_noise_mm2;
+        p = p > KALMAN_MAX_VARIANCE ? KALMAN_MAX_VARIANCE : p;
+        uint32_t s = p + measure_var;
+        int32_t innovation_q4 = measure_q4 - filter->estimate_q4[z];
+        uint32_t miss_mm = (uint32_t)(innovation_q4 < 0 ? -innovation_q4 : innovation_q4) >> 4;
+        miss_mm = miss_mm > 0xFFFF ? 0xFFFF : miss_mm;
+
+        if (miss_mm * miss_mm > gate2 * s) {
+            // Medida incompatível com a estimativa: mantém a estimativa, a
+            // menos que a zona insista (o alvo mudou de fato)
+            if (++filter->rejects[z] < c->kalman_max_rejects) {
+                filter->variance_mm2[z] = p;
+                filter->stats.rejected++;
+                out[z] = round_q4(filter->estimate_q4[z]);
+                continue;
+            }
+            filter->estimate_q4[z] = measure_q4;
+            filter->variance_mm2[z] = measure_var;
+            filter->rejects[z] = 0;
+            continue;
+        }
+
+        filter->rejects[z] = 0;
+        uint32_t gain_q12 = (p << KALMAN_GAIN_SHIFT) / s;
+        filter->estimate_q4[z] += (int32_t)(((int64_t)gain_q12 * innovation_q4) >> KALMAN_GAIN_SHIFT);
+        filter->variance_mm2[z] = (((1u << KALMAN_GAIN_SHIFT) - gain_q12) * (p >> 4)) >> (KALMAN_GAIN_SHIFT - 4);
+        out[z] = round_q4(filter->estimate_q4[z]);
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * @file tof_frame_pub.c
+ * @brief Implementação da publicação do último frame com contagem de referências por slot.
+ *
+ * A troca do slot mais recente (produtor) e o incremento da referência
+ * (leitor) usam ordem sequencialmente consistente: depois de incrementar, o
+ * leitor relê o índice e, se o slot deixou de ser o mais recente, desiste
+ * dele. Assim, ou o produtor vê a referência e não escolhe o slot, ou o
+ * leitor vê a troca e não o lê.
+ */
+
+#include "tof_frame_pub.h"
+
+#include <stddef.h>
+#include <string.h>
+
+bool tof_frame_pub_init(tof_frame_pub_t *pub, tof_frame_t *slots, uint32_t count) {
+    if (pub == NULL || slots == NULL || count < TOF_FRAME_PUB_MIN_SLOTS || count > TOF_FRAME_PUB_MAX_SLOTS) {
+        return false;
+    }
+    pub->slots = slots;
+    pub->count = count;
+    atomic_init(&pub->latest, TOF_FRAME_PUB_NONE);
+    for (uint32_t i = 0; i < TOF_FRAME_PUB_MAX_SLOTS; i++) {
+        atomic_init(&pub->refs[i], 0);
+    }
+    atomic_init(&pub->published, 0);
+    atomic_init(&pub->dropped, 0);
+    return true;
+}
+
+bool tof_frame_pub_publish(tof_frame_pub_t *pub, const tof_frame_t *frame) {
+    uint32_t latest = atomic_load_explicit(&pub->latest, memory_order_relaxed);
+    uint32_t start = latest == TOF_FRAME_PUB_NONE ? 0 : latest + 1;
+
+    // Percorre os slots a partir do seguinte ao mais recente, que nunca é reescrito
+    for (uint32_t i = 0; i < pub->count; i++) {
+        uint32_t slot = (start + i) % pub->count;
+        if (slot == latest || atomic_load(&pub->refs[slot]) != 0) {
+            continue;
+        }
+        memcpy(&pub->slots[slot], frame, sizeof(*frame));
+        // Publica o slot somente depois que a cópia estiver completa
+        atomic_store(&pub->latest, slot);
+        atomic_fetch_add_explicit(&pub->published, 1, memory_order_relaxed);
+        return true;
+    }
+    atomic_fetch_add_explicit(&pub->dropped, 1, memory_order_relaxed);
+    return false;
+}
+
+const tof_frame_t *tof_frame_pub_acquire(tof_frame_pub_t *pub) {
+    if (pub->count == 0) {
+        return NULL;
+    }
+    uint32_t slot = atomic_load(&pub->latest);
+    while (slot != TOF_FRAME_PUB_NONE) {
+        atomic_fetch_add(&pub->refs[slot], 1);
+        uint32_t latest = atomic_load(&pub->latest);
+        if (latest == slot) {
+            return &pub->slots[slot];
+        }
+        // O produtor trocou o slot mais recente antes da referência: tenta o novo
+        atomic_fetch_sub_explicit(&pub->refs[slot], 1, memory_order_release);
+        slot = latest;
+    }
+    return NULL;
+}
+
+void tof_frame_pub_release(tof_frame_pub_t *pub, const tof_frame_t *frame) {
+    if (frame == NULL) {
+        return;
+    }
+    ptrdiff_t slot = frame - pub->slots;
+    if (slot < 0 || slot >= (ptrdiff_t)pub->count) {
+        return;
+    }
+    // Devolve o slot ao produtor somente depois que a leitura terminou
+    atomic_fetch_sub_explicit(&pub->refs[slot], 1, memory_order_release);
+}
+
+uint32_t tof_frame_pub_published(tof_frame_pub_t *pub) {
+    return atomic_load_explicit(&pub->published, memory_order_relaxed);
+}
+
+uint32_t tof_frame_pub_dropped(tof_frame_pub_t *pub) {
+    return atomic_load_explicit(&pub->dropped, memory_order_relaxed);
+}
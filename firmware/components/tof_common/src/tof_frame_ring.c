@@ -0,0 +1,62 @@
+/**
+ * @file tof_frame_ring.c
+ * @brief Implementação da fila circular SPSC de frames.
+ */
+
+#include "tof_frame_ring.h"
+
+#include <string.h>
+
+bool tof_frame_ring_init(tof_frame_ring_t *ring, tof_frame_t *slots, uint32_t capacity) {
+    if (ring == NULL || slots == NULL || capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    ring->slots = slots;
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->high_watermark, 0);
+    return true;
+}
+
+bool tof_frame_ring_push(tof_frame_ring_t *ring, const tof_frame_t *frame) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t used = head - tail;
+
+    if (used > ring->mask) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    memcpy(&ring->slots[head & ring->mask], frame, sizeof(*frame));
+    // Publica o slot somente depois que a cópia estiver completa
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    if (used + 1 > atomic_load_explicit(&ring->high_watermark, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->high_watermark, used + 1, memory_order_relaxed);
+    }
+    return true;
+}
+
+const tof_frame_t *tof_frame_ring_peek(tof_frame_ring_t *ring) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail) {
+        return NULL;
+    }
+    return &ring->slots[tail & ring->mask];
+}
+
+void tof_frame_ring_release(tof_frame_ring_t *ring) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    // Devolve o slot ao produtor somente depois que a leitura terminou
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+uint32_t tof_frame_ring_count(tof_frame_ring_t *ring) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
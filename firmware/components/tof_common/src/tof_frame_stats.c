@@ -0,0 +1,164 @@
+/**
+ * @file tof_frame_stats.c
+ * @brief Máscara de validade e estatísticas por frame sem desvios, com SSE2 no x86 e SWAR nas outras arquiteturas.
+ */
+
+#include "tof_frame_stats.h"
+
+#include <string.h>
+
+// Os caminhos vetorizados leem os status e as contagens de alvos das zonas
+// como vetores contíguos, o que só vale com um alvo por zona
+#if !defined(TOF_FRAME_STATS_NO_SIMD) && TOF_FRAME_TARGETS_PER_ZONE == 1 && defined(__SSE2__)
+#include <emmintrin.h>
+#define TOF_FRAME_STATS_SSE2 1
+#else
+#define TOF_FRAME_STATS_SSE2 0
+#endif
+
+#if !defined(TOF_FRAME_STATS_NO_SIMD) && TOF_FRAME_TARGETS_PER_ZONE == 1 && !TOF_FRAME_STATS_SSE2 && \
+    defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define TOF_FRAME_STATS_SWAR 1
+#else
+#define TOF_FRAME_STATS_SWAR 0
+#endif
+
+#define SWAR_LOW7 0x7F7F7F7Fu                       /**< Os 7 bits baixos de cada byte de uma palavra. */
+#define SWAR_HIGH 0x80808080u                       /**< O bit alto de cada byte de uma palavra. */
+#define SWAR_ONES 0x01010101u                       /**< Multiplicador que replica um byte nos quatro. */
+
+/** @brief Zonas do frame como máscara (bits 0 a resolution - 1). */
+static inline uint64_t zone_mask(const tof_frame_t *frame) {
+    return frame->resolution >= TOF_FRAME_MAX_ZONES ? UINT64_MAX : (((uint64_t)1 << frame->resolution) - 1);
+}
+
+#if TOF_FRAME_STATS_SSE2
+/** @brief Bytes 0xFF nas 16 zonas a partir de z cujo alvo target é válido. */
+static inline __m128i valid_bytes_sse2(const tof_frame_t *frame, int z, int target) {
+    const __m128i status = _mm_loadu_si128((const __m128i *)&frame->target_status[z]);
+    const __m128i detected = _mm_loadu_si128((const __m128i *)&frame->nb_target_detected[z]);
+    const __m128i ok = _mm_or_si128(_mm_cmpeq_epi8(status, _mm_set1_epi8(5)),
+                                    _mm_cmpeq_epi8(status, _mm_set1_epi8(9)));
+    // nb_target_detected > target, sem sinal: max(n, target + 1) == n
+    const __m128i enough = _mm_cmpeq_epi8(_mm_max_epu8(detected, _mm_set1_epi8((char)(target + 1))), detected);
+    return _mm_and_si128(ok, enough);
+}
+
+/** @brief Expande 8 bits de máscara em 8 palavras de 16 bits (0xFFFF = bit ligado). */
+static inline __m128i mask_lanes_sse2(uint32_t bits) {
+    const __m128i weights = _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16((short)bits), weights), weights);
+}
+#endif
+
+#if TOF_FRAME_STATS_SWAR
+/** @brief Bit alto ligado em cada byte nulo da palavra (sem falsos positivos). */
+static inline uint32_t swar_zero_bytes(uint32_t v) {
+    return ~(((v & SWAR_LOW7) + SWAR_LOW7) | v | SWAR_LOW7);
+}
+
+/** @brief Bits de validade das 4 zonas a partir de z, nos bits 0 a 3. */
+static inline uint32_t valid_nibble_swar(const tof_frame_t *frame, int z, int target) {
+    uint32_t status, detected;
+    memcpy(&status, &frame->target_status[z], sizeof(status));
+    memcpy(&detected, &frame->nb_target_detected[z], sizeof(detected));
+    uint32_t ok = swar_zero_bytes(status ^ (5 * SWAR_ONES)) | swar_zero_bytes(status ^ (9 * SWAR_ONES));
+    // (n & 0x7F) + 0x7F - target tem o bit alto ligado se n > target; n >= 128 também conta
+    uint32_t enough = (((detected & SWAR_LOW7) + (uint32_t)(0x7F - target) * SWAR_ONES) | detected) & SWAR_HIGH;
+    // Junta os bits altos dos 4 bytes nos 4 bits de cima e desce-os para 0..3
+    return (((ok & enough) >> 7) * 0x10204080u) >> 28;
+}
+#endif
+
+uint64_t tof_frame_valid_mask(const tof_frame_t *frame, int target) {
+    uint64_t mask = 0;
+#if TOF_FRAME_STATS_SSE2
+    (void)target;
+    for (int z = 0; z < TOF_FRAME_MAX_ZONES; z += 16) {
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(valid_bytes_sse2(frame, z, 0)) << z;
+    }
+#elif TOF_FRAME_STATS_SWAR
+    (void)target;
+    for (int z = 0; z < TOF_FRAME_MAX_ZONES; z += 4) {
+        mask |= (uint64_t)valid_nibble_swar(frame, z, 0) << z;
+    }
+#else
+    for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+        uint8_t status = frame->target_status[TOF_FRAME_TARGET_IDX(z, target)];
+        uint64_t valid = (frame->nb_target_detected[z] > target) & ((status == 5) | (status == 9));
+        mask |= valid << z;
+    }
+#endif
+    return mask & zone_mask(frame);
+}
+
+size_t tof_frame_compact_distances(const tof_frame_t *frame, uint64_t mask, int target, int16_t *out) {
+    mask &= zone_mask(frame);
+    size_t count = 0;
+    // Escreve sempre e só avança nas zonas marcadas: sem desvio por zona
+    for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+        out[count] = frame->distance_mm[TOF_FRAME_TARGET_IDX(z, target)];
+        count += (size_t)((mask >> z) & 1);
+    }
+    return count;
+}
+
+void tof_frame_compute_stats(const tof_frame_t *frame, int target, tof_frame_stats_t *stats) {
+    int16_t valid[TOF_FRAME_MAX_ZONES];
+    memset(stats, 0, sizeof(*stats));
+    stats->valid_mask = tof_frame_valid_mask(frame, target);
+    size_t count = tof_frame_compact_distances(frame, stats->valid_mask, target, valid);
+    stats->valid_count = (uint8_t)count;
+    if (count == 0) {
+        return;
+    }
+
+    int32_t sum = 0;
+    int16_t min_mm = INT16_MAX;
+    int16_t max_mm = INT16_MIN;
+#if TOF_FRAME_STATS_SSE2
+    // Mínimo, máximo e soma sobre as 64 zonas, com as inválidas neutralizadas
+    // pela máscara: mesmo custo para qualquer número de zonas válidas
+    __m128i vmin = _mm_set1_epi16(INT16_MAX);
+    __m128i vmax = _mm_set1_epi16(INT16_MIN);
+    __m128i vsum = _mm_setzero_si128();
+    for (int z = 0; z < TOF_FRAME_MAX_ZONES; z += 8) {
+        const __m128i lanes = mask_lanes_sse2((uint32_t)(stats->valid_mask >> z) & 0xFF);
+        const __m128i d = _mm_loadu_si128((const __m128i *)&frame->distance_mm[z]);
+        const __m128i kept = _mm_and_si128(lanes, d);
+        vmin = _mm_min_epi16(vmin, _mm_or_si128(kept, _mm_andnot_si128(lanes, _mm_set1_epi16(INT16_MAX))));
+        vmax = _mm_max_epi16(vmax, _mm_or_si128(kept, _mm_andnot_si128(lanes, _mm_set1_epi16(INT16_MIN))));
+        vsum = _mm_add_epi32(vsum, _mm_madd_epi16(kept, _mm_set1_epi16(1)));
+    }
+    int16_t lanes_min[8], lanes_max[8];
+    int32_t lanes_sum[4];
+    _mm_storeu_si128((__m128i *)lanes_min, vmin);
+    _mm_storeu_si128((__m128i *)lanes_max, vmax);
+    _mm_storeu_si128((__m128i *)lanes_sum, vsum);
+    for (int i = 0; i < 8; i++) {
+        min_mm = lanes_min[i] < min_mm ? lanes_min[i] : min_mm;
+        max_mm = lanes_max[i] > max_mm ? lanes_max[i] : max_mm;
+    }
+    sum = lanes_sum[0] + lanes_sum[1] + lanes_sum[2] + lanes_sum[3];
+#else
+    for (size_t i = 0; i < count; i++) {
+        int16_t d = valid[i];
+        min_mm = d < min_mm ? d : min_mm;
+        max_mm = d > max_mm ? d : max_mm;
+        sum += d;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++) {
+        int bin = valid[i] >> TOF_FRAME_STATS_BIN_SHIFT;
+        bin = bin < 0 ? 0 : bin;
+        bin = bin > TOF_FRAME_STATS_BINS - 1 ? TOF_FRAME_STATS_BINS - 1 : bin;
+        stats->histogram[bin]++;
+    }
+
+    int32_t half = (int32_t)count / 2;
+    stats->min_mm = min_mm;
+    stats->max_mm = max_mm;
+    stats->sum_mm = sum;
+    stats->mean_mm = (int16_t)((sum >= 0 ? sum + half : sum - half) / (int32_t)count);
+}
@@ -0,0 +1,125 @@
+/**
+ * @file tof_latency.c
+ * @brief Faixas logarítmicas dos histogramas de latência, resumo por percentis e pacote de telemetria.
+ */
+
+#include "tof_latency.h"
+
+#include <string.h>
+
+#include "tof_crc.h"
+#include "tof_stream.h"
+
+_Static_assert(sizeof(tof_latency_summary_t) == 16, "resumo de latência deve ter 16 bytes");
+_Static_assert(sizeof(tof_latency_telemetry_header_t) == 12, "cabeçalho de telemetria deve ter 12 bytes");
+
+/** @brief Nomes das etapas, na ordem de tof_latency_stage_t. */
+static const char *const s_stage_names[TOF_LATENCY_STAGE_COUNT] = {
+    "INT->leitura", "RdMulti", "blocos", "conversão", "filtro", "UART", "SD", "frame->CAN",
+};
+
+/** @brief Faixa de uma amostra. */
+static inline uint32_t bucket_of(uint32_t ns) {
+    if (ns < 4u) {
+        return ns;
+    }
+    uint32_t msb = 31u - (uint32_t)__builtin_clz(ns);
+    return ((msb - 1u) << 2) | ((ns >> (msb - 2u)) & 3u);
+}
+
+/** @brief Maior valor que cai na faixa. */
+static inline uint32_t bucket_upper_ns(uint32_t bucket) {
+    if (bucket < 4u) {
+        return bucket;
+    }
+    uint32_t shift = (bucket >> 2) - 1u;
+    uint32_t low = (4u | (bucket & 3u)) << shift;
+    return low + ((1u << shift) - 1u);
+}
+
+/** @brief Limite superior da faixa que contém a amostra de posição rank (1 = menor), limitado ao máximo. */
+static uint32_t percentile_ns(const uint32_t *counts, uint32_t rank, uint32_t max_ns);
+
+void tof_latency_record(tof_latency_hist_t *hist, uint32_t ns) {
+    atomic_fetch_add_explicit(&hist->bucket[bucket_of(ns)], 1, memory_order_relaxed);
+    uint32_t max = atomic_load_explicit(&hist->max_ns, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(&hist->max_ns, &max, ns, memory_order_relaxed,
+                                                              memory_order_relaxed)) {
+    }
+}
+
+void tof_latency_take(tof_latency_hist_t *hist, tof_latency_summary_t *summary) {
+    uint32_t counts[TOF_LATENCY_BUCKETS];
+    uint32_t count = 0;
+    for (int i = 0; i < TOF_LATENCY_BUCKETS; i++) {
+        counts[i] = atomic_exchange_explicit(&hist->bucket[i], 0, memory_order_relaxed);
+        count += counts[i];
+    }
+    uint32_t max_ns = atomic_exchange_explicit(&hist->max_ns, 0, memory_order_relaxed);
+
+    memset(summary, 0, sizeof(*summary));
+    if (count == 0) {
+        return;
+    }
+    summary->count = count;
+    summary->max_ns = max_ns;
+    summary->p50_ns = percentile_ns(counts, (uint32_t)(((uint64_t)count * 50 + 99) / 100), max_ns);
+    summary->p99_ns = percentile_ns(counts, (uint32_t)(((uint64_t)count * 99 + 99) / 100), max_ns);
+}
+
+const char *tof_latency_stage_name(tof_latency_stage_t stage) {
+    return (unsigned)stage < TOF_LATENCY_STAGE_COUNT ? s_stage_names[stage] : "?";
+}
+
+size_t tof_latency_encode_telemetry(const tof_latency_summary_t *summaries, uint32_t uptime_ms,
+                                    uint32_t interval_ms, uint8_t *out, size_t capacity) {
+    if (capacity < TOF_LATENCY_TELEMETRY_ENCODED) {
+        return 0;
+    }
+    uint8_t packet[TOF_LATENCY_TELEMETRY_PACKET];
+    tof_latency_telemetry_header_t hdr = {
+        .type = TOF_STREAM_MSG_TELEMETRY,
+        .stage_count = TOF_LATENCY_STAGE_COUNT,
+        .uptime_ms = uptime_ms,
+        .interval_ms = interval_ms,
+    };
+    memcpy(packet, &hdr, sizeof(hdr));
+    memcpy(&packet[sizeof(hdr)], summaries, TOF_LATENCY_STAGE_COUNT * sizeof(*summaries));
+    return tof_stream_finish_packet(packet, TOF_LATENCY_TELEMETRY_PACKET - 2, out);
+}
+
+bool tof_latency_decode_telemetry(const uint8_t *packet, size_t len, tof_latency_telemetry_header_t *header,
+                                  tof_latency_summary_t *summaries) {
+    if (len < sizeof(tof_latency_telemetry_header_t) + 2) {
+        return false;
+    }
+    tof_latency_telemetry_header_t hdr;
+    memcpy(&hdr, packet, sizeof(hdr));
+    if (hdr.type != TOF_STREAM_MSG_TELEMETRY ||
+        len != sizeof(hdr) + (size_t)hdr.stage_count * sizeof(tof_latency_summary_t) + 2) {
+        return false;
+    }
+    uint16_t crc;
+    memcpy(&crc, &packet[len - 2], sizeof(crc));
+    if (crc != tof_crc16(packet, len - 2)) {
+        return false;
+    }
+
+    *header = hdr;
+    size_t stages = hdr.stage_count < TOF_LATENCY_STAGE_COUNT ? hdr.stage_count : TOF_LATENCY_STAGE_COUNT;
+    memset(summaries, 0, TOF_LATENCY_STAGE_COUNT * sizeof(*summaries));
+    memcpy(summaries, &packet[sizeof(hdr)], stages * sizeof(*summaries));
+    return true;
+}
+
+static uint32_t percentile_ns(const uint32_t *counts, uint32_t rank, uint32_t max_ns) {
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < TOF_LATENCY_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint32_t upper = bucket_upper_ns(i);
+            return upper < max_ns ? upper : max_ns;
+        }
+    }
+    return max_ns;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file tof_log_index.c
+ * @brief Implementação do índice lateral de timestamp para deslocamento do log.
+ */
+
+#include "tof_log_index.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define read _read
+#define lseek _lseek
+#define close _close
+#define ftruncate _chsize
+#else
+#include <unistd.h>
+#endif
+
+#include "tof_crc.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/** @brief Lê a última entrada válida; header_ok indica se o arquivo tem um cabeçalho de índice válido. */
+static bool read_last_entry(const char *path, tof_log_index_entry_t *entry, bool *header_ok);
+
+/** @brief Grava uma entrada e a sincroniza no arquivo do índice. */
+static bool write_entry(tof_log_index_t *index, tof_log_index_entry_t *entry);
+
+bool tof_log_index_open(tof_log_index_t *index, const char *path) {
+    memset(index, 0, sizeof(*index));
+    // Cada entrada é descarregada e sincronizada logo ao ser gravada
+    const tof_log_writer_config_t config = {
+        .flush_threshold_bytes = sizeof(index->buffer),
+        .flush_interval_ms = 0,
+        .fsync_interval_ms = 0,
+    };
+    tof_log_index_header_t header;
+    memcpy(header.magic, TOF_LOG_INDEX_MAGIC, sizeof(header.magic));
+    header.version = TOF_LOG_INDEX_VERSION;
+    header.entry_size = sizeof(tof_log_index_entry_t);
+    if (!tof_log_writer_open(&index->writer, path, true, &header, sizeof(header),
+                             index->buffer, sizeof(index->buffer), &config)) {
+        return false;
+    }
+    // O cabeçalho vai logo para o cartão: sem ele, uma queda antes da primeira
+    // entrada deixaria o log de dados (e a reserva pré-alocada) sem recuperação
+    if (!tof_log_writer_flush(&index->writer, true)) {
+        tof_log_writer_close(&index->writer);
+        return false;
+    }
+    return true;
+}
+
+void tof_log_index_mark(tof_log_index_t *index, int64_t timestamp_us, uint64_t offset) {
+    if (index->pending || offset > UINT32_MAX) {
+        return;
+    }
+    index->pending = true;
+    index->pending_us = timestamp_us;
+    index->pending_offset = (uint32_t)offset;
+}
+
+bool tof_log_index_sync(tof_log_index_t *index, const tof_log_writer_t *data) {
+    if (!tof_log_index_is_open(index)) {
+        return false;
+    }
+    uint64_t synced = tof_log_writer_synced_bytes(data);
+    uint32_t durable_end = synced > UINT32_MAX ? UINT32_MAX : (uint32_t)synced;
+    if (durable_end <= index->last.durable_end) {
+        return true;
+    }
+
+    tof_log_index_entry_t entry = index->last;
+    // Só aponta para o registro marcado depois que ele também está no cartão
+    bool use_mark = index->pending && index->pending_offset < durable_end;
+    if (use_mark) {
+        entry.timestamp_us = index->pending_us;
+        entry.offset = index->pending_offset;
+    }
+    entry.durable_end = durable_end;
+    if (!write_entry(index, &entry)) {
+        return false;
+    }
+    index->pending = index->pending && !use_mark;
+    return true;
+}
+
+bool tof_log_index_close(tof_log_index_t *index, const tof_log_writer_t *data) {
+    if (!tof_log_index_is_open(index)) {
+        return false;
+    }
+    bool ok = tof_log_index_sync(index, data);
+    return tof_log_writer_close(&index->writer) && ok;
+}
+
+bool tof_log_index_is_open(const tof_log_index_t *index) {
+    return index->writer.fd >= 0;
+}
+
+tof_log_index_stats_t tof_log_index_get_stats(const tof_log_index_t *index) {
+    return index->stats;
+}
+
+bool tof_log_index_read_last(const char *path, tof_log_index_entry_t *entry) {
+    bool header_ok;
+    return read_last_entry(path, entry, &header_ok);
+}
+
+bool tof_log_index_recover(const char *data_path, const char *index_path, uint64_t *size) {
+    tof_log_index_entry_t entry;
+    bool header_ok;
+    uint64_t durable_end = read_last_entry(index_path, &entry, &header_ok) ? entry.durable_end : 0;
+
+    struct stat st;
+    if (stat(data_path, &st) != 0) {
+        return false;
+    }
+    if (size != NULL) {
+        *size = (uint64_t)st.st_size;
+    }
+    if (!header_ok || (uint64_t)st.st_size <= durable_end) {
+        return false;
+    }
+
+    int fd = open(data_path, O_WRONLY | O_BINARY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ftruncate(fd, (long)durable_end) == 0;
+    ok = close(fd) == 0 && ok;
+    if (ok && size != NULL) {
+        *size = durable_end;
+    }
+    return ok;
+}
+
+static bool read_last_entry(const char *path, tof_log_index_entry_t *entry, bool *header_ok) {
+    *header_ok = false;
+    int fd = open(path, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        return false;
+    }
+
+    tof_log_index_header_t header;
+    struct stat st;
+    if (read(fd, &header, sizeof(header)) != (int)sizeof(header) || fstat(fd, &st) != 0 ||
+        memcmp(header.magic, TOF_LOG_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TOF_LOG_INDEX_VERSION || header.entry_size != sizeof(*entry)) {
+        close(fd);
+        return false;
+    }
+    *header_ok = true;
+
+    // Percorre a partir do fim: uma entrada parcial ou com CRC inválido é da última gravação interrompida
+    bool found = false;
+    long count = (long)(((uint64_t)st.st_size - sizeof(header)) / sizeof(*entry));
+    for (long i = count - 1; i >= 0 && !found; i--) {
+        long offset = (long)sizeof(header) + i * (long)sizeof(*entry);
+        found = lseek(fd, offset, SEEK_SET) == offset &&
+                read(fd, entry, sizeof(*entry)) == (int)sizeof(*entry) &&
+                tof_crc32(0, entry, offsetof(tof_log_index_entry_t, crc32)) == entry->crc32;
+    }
+    close(fd);
+    return found;
+}
+
+static bool write_entry(tof_log_index_t *index, tof_log_index_entry_t *entry) {
+    entry->crc32 = tof_crc32(0, entry, offsetof(tof_log_index_entry_t, crc32));
+    if (!tof_log_writer_write(&index->writer, entry, sizeof(*entry)) ||
+        !tof_log_writer_flush(&index->writer, true)) {
+        index->stats.write_errors++;
+        return false;
+    }
+    index->last = *entry;
+    index->stats.entries++;
+    return true;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file tof_log_writer.c
+ * @brief Implementação do escritor de log bufferizado.
+ */
+
+#include "tof_log_writer.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define write _write
+#define close _close
+#define fsync _commit
+#define ftruncate _chsize
+#else
+#include <unistd.h>
+#endif
+
+#include "tof_time.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define TOF_LOG_WRITER_DEFAULT_FLUSH_MS 1000        /**< Idade máxima padrão dos dados pendentes. */
+#define TOF_LOG_WRITER_DEFAULT_FSYNC_MS 5000        /**< Cadência padrão de fsync. */
+
+static bool write_all(tof_log_writer_t *writer, const uint8_t *data, size_t len);
+static bool do_fsync(tof_log_writer_t *writer);
+static bool flush_bytes(tof_log_writer_t *writer, size_t len);
+
+bool tof_log_writer_open(tof_log_writer_t *writer, const char *path, bool truncate,
+                         const void *header, size_t header_len,
+                         uint8_t *buffer, size_t capacity,
+                         const tof_log_writer_config_t *config) {
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = -1;
+    if (buffer == NULL || capacity < TOF_LOG_WRITER_SECTOR_SIZE) {
+        return false;
+    }
+
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+    if (config != NULL) {
+        writer->config = *config;
+    } else {
+        writer->config.flush_threshold_bytes = capacity / 2;
+        writer->config.flush_interval_ms = TOF_LOG_WRITER_DEFAULT_FLUSH_MS;
+        writer->config.fsync_interval_ms = TOF_LOG_WRITER_DEFAULT_FSYNC_MS;
+    }
+    if (writer->config.flush_threshold_bytes == 0 || writer->config.flush_threshold_bytes > capacity) {
+        writer->config.flush_threshold_bytes = capacity;
+    }
+
+    // O arquivo pré-alocado é sobrescrito desde o início, sem mudar seu tamanho até o fechamento
+    int flags = writer->config.preallocated ? O_WRONLY | O_CREAT | O_BINARY
+                                            : O_WRONLY | O_CREAT | O_APPEND | O_BINARY | (truncate ? O_TRUNC : 0);
+    writer->fd = open(path, flags, 0644);
+    if (writer->fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (!writer->config.preallocated && fstat(writer->fd, &st) == 0) {
+        writer->file_bytes = (uint64_t)st.st_size;
+    }
+    writer->synced_bytes = writer->file_bytes;
+    if (header != NULL && header_len > 0 && writer->file_bytes == 0) {
+        if (!tof_log_writer_write(writer, header, header_len)) {
+            tof_log_writer_close(writer);
+            return false;
+        }
+    }
+    writer->last_fsync_us = tof_time_us();
+    return true;
+}
+
+uint8_t *tof_log_writer_reserve(tof_log_writer_t *writer, size_t len) {
+    if (writer->fd < 0 || len > writer->capacity) {
+        return NULL;
+    }
+    if (writer->capacity - writer->used < len && !tof_log_writer_flush(writer, false)) {
+        return NULL;
+    }
+    return writer->buffer + writer->used;
+}
+
+bool tof_log_writer_commit(tof_log_writer_t *writer, size_t len) {
+    if (len == 0) {
+        return true;
+    }
+    if (writer->used == 0) {
+        writer->pending_since_us = tof_time_us();
+    }
+    writer->used += len;
+
+    if (writer->used >= writer->config.flush_threshold_bytes) {
+        // Escreve apenas setores completos; o restante fica para a próxima descarga
+        size_t aligned = writer->used - (writer->used % TOF_LOG_WRITER_SECTOR_SIZE);
+        return flush_bytes(writer, aligned > 0 ? aligned : writer->used);
+    }
+    return true;
+}
+
+bool tof_log_writer_write(tof_log_writer_t *writer, const void *data, size_t len) {
+    uint8_t *dst = tof_log_writer_reserve(writer, len);
+    if (dst == NULL) {
+        return false;
+    }
+    memcpy(dst, data, len);
+    return tof_log_writer_commit(writer, len);
+}
+
+bool tof_log_writer_poll(tof_log_writer_t *writer) {
+    if (writer->fd < 0) {
+        return false;
+    }
+    int64_t now_us = tof_time_us();
+    bool ok = true;
+
+    if (writer->used > 0 && writer->config.flush_interval_ms > 0 &&
+        now_us - writer->pending_since_us >= (int64_t)writer->config.flush_interval_ms * 1000) {
+        ok = flush_bytes(writer, writer->used);
+    }
+    if (writer->unsynced &&
+        now_us - writer->last_fsync_us >= (int64_t)writer->config.fsync_interval_ms * 1000) {
+        ok = do_fsync(writer) && ok;
+    }
+    return ok;
+}
+
+bool tof_log_writer_has_pending(const tof_log_writer_t *writer) {
+    return writer->fd >= 0 && (writer->used > 0 || writer->unsynced);
+}
+
+bool tof_log_writer_flush(tof_log_writer_t *writer, bool sync) {
+    if (writer->fd < 0) {
+        return false;
+    }
+    bool ok = flush_bytes(writer, writer->used);
+    if (sync && writer->unsynced) {
+        ok = do_fsync(writer) && ok;
+    }
+    return ok;
+}
+
+bool tof_log_writer_close(tof_log_writer_t *writer) {
+    if (writer->fd < 0) {
+        return false;
+    }
+    bool ok = tof_log_writer_flush(writer, true);
+    if (writer->config.preallocated) {
+        // Descarta a parte reservada que não chegou a ser usada
+        ok = ftruncate(writer->fd, (long)writer->file_bytes) == 0 && ok;
+    }
+    ok = (close(writer->fd) == 0) && ok;
+    writer->fd = -1;
+    return ok;
+}
+
+tof_log_writer_stats_t tof_log_writer_get_stats(const tof_log_writer_t *writer) {
+    return writer->stats;
+}
+
+uint64_t tof_log_writer_position(const tof_log_writer_t *writer) {
+    return writer->file_bytes + writer->used;
+}
+
+uint64_t tof_log_writer_synced_bytes(const tof_log_writer_t *writer) {
+    return writer->synced_bytes;
+}
+
+/**
+ * @brief Escreve len bytes do início do buffer no arquivo e compacta o restante.
+ *
+ * Quando a cadência de fsync é zero, o fsync faz parte da própria descarga.
+ */
+static bool flush_bytes(tof_log_writer_t *writer, size_t len) {
+    if (len == 0) {
+        return true;
+    }
+    int64_t start_us = tof_time_us();
+    bool ok = write_all(writer, writer->buffer, len);
+
+    size_t remaining = writer->used - len;
+    if (remaining > 0) {
+        memmove(writer->buffer, writer->buffer + len, remaining);
+        writer->pending_since_us = tof_time_us();
+    }
+    writer->used = remaining;
+    writer->unsynced = true;
+
+    if (writer->config.fsync_interval_ms == 0) {
+        ok = do_fsync(writer) && ok;
+    }
+
+    uint32_t elapsed_us = (uint32_t)(tof_time_us() - start_us);
+    writer->stats.flushes++;
+    if (elapsed_us > writer->stats.max_flush_us) {
+        writer->stats.max_flush_us = elapsed_us;
+    }
+    return ok;
+}
+
+static bool write_all(tof_log_writer_t *writer, const uint8_t *data, size_t len) {
+    int64_t start_us = tof_time_us();
+    while (len > 0) {
+        int written = (int)write(writer->fd, data, len);
+        if (written <= 0) {
+            writer->stats.write_errors++;
+            writer->stats.busy_time_us += tof_time_us() - start_us;
+            return false;
+        }
+        data += written;
+        len -= (size_t)written;
+        writer->file_bytes += (uint64_t)written;
+        writer->stats.bytes_written += (uint64_t)written;
+    }
+    writer->stats.busy_time_us += tof_time_us() - start_us;
+    return true;
+}
+
+static bool do_fsync(tof_log_writer_t *writer) {
+    int64_t start_us = tof_time_us();
+    bool ok = fsync(writer->fd) == 0;
+    int64_t end_us = tof_time_us();
+
+    uint32_t elapsed_us = (uint32_t)(end_us - start_us);
+    writer->stats.busy_time_us += end_us - start_us;
+    writer->stats.fsyncs++;
+    if (elapsed_us > writer->stats.max_fsync_us) {
+        writer->stats.max_fsync_us = elapsed_us;
+    }
+    if (ok) {
+        writer->synced_bytes = writer->file_bytes;
+    } else {
+        writer->stats.write_errors++;
+    }
+    writer->last_fsync_us = end_us;
+    writer->unsynced = false;
+    return ok;
+}
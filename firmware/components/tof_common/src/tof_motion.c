@@ -0,0 +1,56 @@
+/**
+ * @file tof_motion.c
+ * @brief Seleção dos agregados ativos e supressão das distâncias sem movimento.
+ */
+
+#include "tof_motion.h"
+
+#include <string.h>
+
+void tof_motion_init(tof_motion_t *motion, const tof_motion_config_t *config) {
+    static const tof_motion_config_t defaults = TOF_MOTION_CONFIG_DEFAULT;
+    memset(motion, 0, sizeof(*motion));
+    motion->config = config ? *config : defaults;
+    if (motion->config.min_active_aggregates == 0) {
+        motion->config.min_active_aggregates = 1;
+    }
+}
+
+uint32_t tof_motion_active_mask(const tof_frame_motion_t *indicator, uint32_t threshold) {
+    uint8_t count = indicator->nb_aggregates < TOF_FRAME_MOTION_AGGREGATES ? indicator->nb_aggregates
+                                                                          : TOF_FRAME_MOTION_AGGREGATES;
+    uint32_t mask = 0;
+    for (int i = 0; i < TOF_FRAME_MOTION_AGGREGATES; i++) {
+        mask |= (uint32_t)((indicator->aggregate[i] >= threshold) & (i < count)) << i;
+    }
+    return mask;
+}
+
+bool tof_motion_apply(tof_motion_t *motion, tof_frame_t *frame) {
+    if ((frame->flags & TOF_FRAME_FLAG_MOTION) == 0) {
+        return true;
+    }
+    motion->stats.frames++;
+
+    uint32_t mask = tof_motion_active_mask(&frame->motion, motion->config.aggregate_threshold);
+    int active = __builtin_popcount(mask);
+    frame->motion.active_mask = mask;
+    motion->stats.active_aggregates += (uint32_t)active;
+
+    if (active >= motion->config.min_active_aggregates) {
+        motion->stats.motion_frames++;
+        motion->hold = motion->config.hold_frames;
+        return true;
+    }
+    if (motion->hold > 0) {
+        motion->hold--;
+        return true;
+    }
+    frame->flags |= TOF_FRAME_FLAG_MOTION_ONLY;
+    motion->stats.suppressed_frames++;
+    return false;
+}
+
+tof_motion_stats_t tof_motion_get_stats(const tof_motion_t *motion) {
+    return motion->stats;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file tof_obstacle.c
+ * @brief Setores, rastreio do alvo mais próximo e frames CAN do estágio de obstáculos.
+ */
+
+#include "tof_obstacle.h"
+
+#include <string.h>
+
+#include "tof_frame_stats.h"
+
+/** @brief Preenche os setores do resultado e o setor mais próximo. */
+static void compute_sectors(const tof_obstacle_t *obstacle, const tof_frame_t *frame, tof_obstacle_result_t *result);
+
+/** @brief Atualiza o alvo rastreado com o setor mais próximo do resultado. */
+static void update_track(tof_obstacle_t *obstacle, tof_obstacle_result_t *result);
+
+/** @brief Grava um uint16 little-endian. */
+static inline void put_u16(uint8_t *dst, uint16_t value) {
+    dst[0] = (uint8_t)value;
+    dst[1] = (uint8_t)(value >> 8);
+}
+
+/** @brief Limita um valor à faixa de int16. */
+static inline int16_t clamp_i16(int32_t value) {
+    return (int16_t)(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value);
+}
+
+void tof_obstacle_init(tof_obstacle_t *obstacle, const tof_obstacle_config_t *config) {
+    static const tof_obstacle_config_t defaults = TOF_OBSTACLE_CONFIG_DEFAULT;
+    memset(obstacle, 0, sizeof(*obstacle));
+    obstacle->config = config ? *config : defaults;
+
+    tof_obstacle_config_t *c = &obstacle->config;
+    c->max_sigma_mm = c->max_sigma_mm > 0 ? c->max_sigma_mm : 1;
+    c->max_mm = c->max_mm > c->min_mm ? c->max_mm : c->min_mm;
+    c->smoothing_pct = c->smoothing_pct < 1 ? 1 : c->smoothing_pct > 100 ? 100 : c->smoothing_pct;
+    c->can_base_id &= 0x7FF;
+}
+
+void tof_obstacle_update(tof_obstacle_t *obstacle, const tof_frame_t *frame, tof_obstacle_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    result->timestamp_us = frame->timestamp_us;
+    result->sequence = frame->sequence;
+    result->sensor_id = frame->sensor_id;
+
+    obstacle->stats.frames++;
+    compute_sectors(obstacle, frame, result);
+    update_track(obstacle, result);
+}
+
+size_t tof_obstacle_pack_can(const tof_obstacle_config_t *config, const tof_obstacle_result_t *result,
+                             tof_can_frame_t *frames, size_t capacity) {
+    size_t sector_frames = (result->sector_count + TOF_OBSTACLE_SECTORS_PER_CAN_FRAME - 1) / TOF_OBSTACLE_SECTORS_PER_CAN_FRAME;
+    size_t count = 1 + sector_frames;
+    if (capacity < count) {
+        return 0;
+    }
+    uint32_t base = (config->can_base_id + (uint32_t)result->sensor_id * TOF_OBSTACLE_CAN_IDS_PER_SENSOR) & 0x7FF;
+    memset(frames, 0, count * sizeof(*frames));
+
+    bool target = (result->flags & TOF_OBSTACLE_FLAG_TARGET) != 0;
+    bool track = (result->flags & TOF_OBSTACLE_FLAG_TRACK) != 0;
+    tof_can_frame_t *summary = &frames[0];
+    summary->id = base;
+    summary->dlc = TOF_OBSTACLE_CAN_DLC;
+    put_u16(&summary->data[0], target && result->nearest_mm >= 0 ? (uint16_t)result->nearest_mm : TOF_OBSTACLE_NO_TARGET_MM);
+    put_u16(&summary->data[2], track && result->track_mm >= 0 ? (uint16_t)result->track_mm : TOF_OBSTACLE_NO_TARGET_MM);
+    put_u16(&summary->data[4], (uint16_t)result->closing_mm_s);
+    summary->data[6] = (uint8_t)((result->nearest_sector & 0x0F) | (result->nearest_confidence & 0xF0));
+    summary->data[7] = (uint8_t)((result->flags & 0x0F) | ((result->sequence & 0x0F) << 4));
+
+    for (size_t f = 0; f < sector_frames; f++) {
+        tof_can_frame_t *can = &frames[1 + f];
+        can->id = base + 1 + (uint32_t)f;
+        can->dlc = TOF_OBSTACLE_CAN_DLC;
+        for (int i = 0; i < TOF_OBSTACLE_SECTORS_PER_CAN_FRAME; i++) {
+            size_t s = f * TOF_OBSTACLE_SECTORS_PER_CAN_FRAME + i;
+            uint16_t packed = TOF_OBSTACLE_SECTOR_NO_TARGET;
+            if (s < result->sector_count && result->sectors[s].zones > 0) {
+                int16_t mm = result->sectors[s].distance_mm;
+                uint16_t distance = mm < 0 ? 0 : mm >= TOF_OBSTACLE_SECTOR_NO_TARGET ? TOF_OBSTACLE_SECTOR_NO_TARGET - 1 : (uint16_t)mm;
+                packed = (uint16_t)(distance | (result->sectors[s].confidence >> 4) << 12);
+            }
+            put_u16(&can->data[2 * i], packed);
+        }
+    }
+    return count;
+}
+
+tof_obstacle_stats_t tof_obstacle_get_stats(const tof_obstacle_t *obstacle) {
+    return obstacle->stats;
+}
+
+static void compute_sectors(const tof_obstacle_t *obstacle, const tof_frame_t *frame, tof_obstacle_result_t *result) {
+    const tof_obstacle_config_t *c = &obstacle->config;
+    const int side = frame->resolution == 16 ? 4 : 8;
+    result->sector_count = (uint8_t)side;
+
+    for (uint64_t pending = tof_frame_valid_mask(frame, 0); pending != 0; pending &= pending - 1) {
+        int z = __builtin_ctzll(pending);
+        if (z >= side * side) {
+            break;
+        }
+        int idx = TOF_FRAME_TARGET_IDX(z, 0);
+        int16_t mm = frame->distance_mm[idx];
+        uint16_t sigma = frame->range_sigma_mm[idx];
+        if (mm < c->min_mm || mm > c->max_mm || sigma > c->max_sigma_mm) {
+            continue;
+        }
+        uint8_t confidence = (uint8_t)((uint32_t)(c->max_sigma_mm - sigma) * 255 / c->max_sigma_mm);
+        tof_obstacle_sector_t *sector = &result->sectors[z % side];
+        if (sector->zones++ == 0 || mm < sector->distance_mm ||
+            (mm == sector->distance_mm && confidence > sector->confidence)) {
+            sector->distance_mm = mm;
+            sector->confidence = confidence;
+        }
+    }
+
+    for (int s = 0; s < side; s++) {
+        const tof_obstacle_sector_t *sector = &result->sectors[s];
+        if (sector->zones == 0) {
+            continue;
+        }
+        if ((result->flags & TOF_OBSTACLE_FLAG_TARGET) == 0 || sector->distance_mm < result->nearest_mm) {
+            result->flags |= TOF_OBSTACLE_FLAG_TARGET;
+            result->nearest_sector = (uint8_t)s;
+            result->nearest_mm = sector->distance_mm;
+            result->nearest_confidence = sector->confidence;
+        }
+    }
+}
+
+static void update_track(tof_obstacle_t *obstacle, tof_obstacle_result_t *result) {
+    const tof_obstacle_config_t *c = &obstacle->config;
+    const int64_t now = result->timestamp_us;
+
+    if (result->flags & TOF_OBSTACLE_FLAG_TARGET) {
+        obstacle->stats.target_frames++;
+        int32_t mm = result->nearest_mm;
+        int32_t jump = mm - obstacle->track_mm;
+        if (obstacle->tracking && jump <= c->gate_mm && jump >= -(int32_t)c->gate_mm) {
+            int64_t dt_us = now - obstacle->last_seen_us;
+            if (dt_us > 0) {
+                int32_t closing = (int32_t)((int64_t)(obstacle->track_mm - mm) * 1000000 / dt_us);
+                obstacle->closing_mm_s += (closing - obstacle->closing_mm_s) * c->smoothing_pct / 100;
+            }
+            obstacle->track_mm += jump * c->smoothing_pct / 100;
+            obstacle->track_frames += obstacle->track_frames < UINT16_MAX;
+        } else {
+            obstacle->stats.tracks++;
+            obstacle->tracking = true;
+            obstacle->track_mm = mm;
+            obstacle->closing_mm_s = 0;
+            obstacle->track_frames = 1;
+            result->flags |= TOF_OBSTACLE_FLAG_NEW_TRACK;
+        }
+        obstacle->last_seen_us = now;
+    } else if (obstacle->tracking && now - obstacle->last_seen_us >= (int64_t)c->hold_ms * 1000) {
+        obstacle->stats.lost++;
+        obstacle->tracking = false;
+    }
+
+    if (obstacle->tracking) {
+        result->flags |= TOF_OBSTACLE_FLAG_TRACK;
+        result->track_mm = clamp_i16(obstacle->track_mm);
+        result->closing_mm_s = clamp_i16(obstacle->closing_mm_s);
+        result->track_frames = obstacle->track_frames;
+    }
+}
@@ -0,0 +1,143 @@
+/**
+ * @file tof_rate.c
+ * @brief Atividade da cena entre frames seguidos e escolha da frequência, do teto e das rajadas.
+ */
+
+#include "tof_rate.h"
+
+#include <string.h>
+
+#include "tof_frame_stats.h"
+
+/** @brief Tempo de integração para a frequência, dentro dos limites da configuração. */
+static uint16_t integration_for(const tof_rate_config_t *config, uint8_t hz);
+
+/** @brief Compara o frame com o anterior, que ele passa a substituir como referência. */
+static bool frame_is_active(tof_rate_t *rate, const tof_frame_t *frame);
+
+void tof_rate_init(tof_rate_t *rate, const tof_rate_config_t *config, tof_rate_decision_t *decision) {
+    static const tof_rate_config_t defaults = TOF_RATE_CONFIG_DEFAULT;
+    memset(rate, 0, sizeof(*rate));
+    rate->config = config ? *config : defaults;
+
+    tof_rate_config_t *c = &rate->config;
+    c->min_hz = c->min_hz > 0 ? c->min_hz : 1;
+    c->max_hz = c->max_hz > c->min_hz ? c->max_hz : c->min_hz;
+    c->active_zones = c->active_zones > 0 ? c->active_zones : 1;
+    c->burst_frames = c->burst_frames > 0 ? c->burst_frames : 1;
+    c->integration_pct = c->integration_pct > 0 && c->integration_pct <= 100 ? c->integration_pct : 50;
+    c->max_integration_ms = c->max_integration_ms > TOF_RATE_MIN_INTEGRATION_MS ? c->max_integration_ms
+                                                                                 : TOF_RATE_MIN_INTEGRATION_MS;
+    c->queue_low_pct = c->queue_low_pct < c->queue_high_pct ? c->queue_low_pct : c->queue_high_pct;
+
+    rate->cap_hz = c->max_hz;
+    rate->decision.frequency_hz = c->max_hz;
+    rate->decision.integration_ms = integration_for(c, c->max_hz);
+    if (decision != NULL) {
+        *decision = rate->decision;
+    }
+}
+
+bool tof_rate_update(tof_rate_t *rate, const tof_frame_t *frame, uint8_t queue_pct, tof_rate_decision_t *decision) {
+    const tof_rate_config_t *c = &rate->config;
+    const int64_t now = frame->timestamp_us;
+    const int64_t hold_us = (int64_t)c->hold_ms * 1000;
+
+    if (rate->stats.frames++ == 0) {
+        rate->last_active_us = now;
+        rate->last_step_us = now;
+        rate->last_cap_us = now;
+    }
+    bool active = frame_is_active(rate, frame);
+
+    // Teto: cai à metade ao encher a fila (e a cada hold_ms enquanto cheia), volta a dobrar com ela vazia
+    if (queue_pct >= c->queue_high_pct) {
+        if (rate->cap_hz > c->min_hz && (!rate->overloaded || now - rate->last_cap_us >= hold_us)) {
+            rate->cap_hz = rate->cap_hz / 2 > c->min_hz ? rate->cap_hz / 2 : c->min_hz;
+            rate->last_cap_us = now;
+            rate->stats.backoffs++;
+        }
+        rate->overloaded = true;
+    } else if (queue_pct <= c->queue_low_pct) {
+        rate->overloaded = false;
+        if (rate->cap_hz < c->max_hz && now - rate->last_cap_us >= hold_us) {
+            rate->cap_hz = rate->cap_hz * 2 < c->max_hz ? rate->cap_hz * 2 : c->max_hz;
+            rate->last_cap_us = now;
+        }
+    }
+
+    uint8_t hz = rate->decision.frequency_hz;
+    bool settled = now - rate->last_active_us >= hold_us && now - rate->last_step_us >= hold_us;
+    if (active) {
+        rate->stats.active_frames++;
+        rate->last_active_us = now;
+        rate->last_step_us = now;
+        rate->bursting = false;
+        hz = rate->cap_hz;
+    } else if (settled && hz > c->min_hz) {
+        hz = hz / 2 > c->min_hz ? hz / 2 : c->min_hz;
+        rate->last_step_us = now;
+        settled = false;
+    }
+    hz = hz < rate->cap_hz ? hz : rate->cap_hz;
+
+    // Rajadas: ao entrar, o frame atual fecha a primeira; depois, sono a cada burst_frames frames parados
+    uint16_t sleep_ms = 0;
+    if (!active && c->sleep_ms > 0 && hz == c->min_hz && (rate->bursting || settled)) {
+        if (!rate->bursting || --rate->burst_left == 0) {
+            rate->bursting = true;
+            rate->burst_left = c->burst_frames;
+            sleep_ms = c->sleep_ms;
+            rate->stats.sleeps++;
+        }
+    }
+
+    bool changed = hz != rate->decision.frequency_hz;
+    if (changed) {
+        rate->stats.rate_changes++;
+    }
+    rate->decision.frequency_hz = hz;
+    rate->decision.integration_ms = integration_for(c, hz);
+    rate->decision.sleep_ms = sleep_ms;
+    *decision = rate->decision;
+    return changed || sleep_ms > 0;
+}
+
+tof_rate_stats_t tof_rate_get_stats(const tof_rate_t *rate) {
+    return rate->stats;
+}
+
+static uint16_t integration_for(const tof_rate_config_t *config, uint8_t hz) {
+    uint32_t ms = 10u * config->integration_pct / hz;
+    if (ms < TOF_RATE_MIN_INTEGRATION_MS) {
+        return TOF_RATE_MIN_INTEGRATION_MS;
+    }
+    return ms < config->max_integration_ms ? (uint16_t)ms : config->max_integration_ms;
+}
+
+static bool frame_is_active(tof_rate_t *rate, const tof_frame_t *frame) {
+    uint64_t valid = tof_frame_valid_mask(frame, 0);
+    uint8_t zones = frame->resolution < TOF_FRAME_MAX_ZONES ? frame->resolution : TOF_FRAME_MAX_ZONES;
+    bool active = (frame->flags & TOF_FRAME_FLAG_MOTION) != 0 && frame->motion.active_mask != 0;
+
+    if (rate->synced && frame->resolution == rate->resolution) {
+        // Zonas que apareceram ou sumiram contam como mudança
+        int changed = __builtin_popcountll(valid ^ rate->previous_valid);
+        uint64_t both = valid & rate->previous_valid;
+        while (both != 0 && changed < rate->config.active_zones) {
+            int z = __builtin_ctzll(both);
+            both &= both - 1;
+            int diff = frame->distance_mm[TOF_FRAME_TARGET_IDX(z, 0)] - rate->previous_mm[z];
+            changed += (diff >= rate->config.change_mm || -diff >= rate->config.change_mm);
+        }
+        active = active || changed >= rate->config.active_zones;
+    }
+
+    rate->synced = true;
+    rate->resolution = frame->resolution;
+    rate->previous_valid = valid;
+    for (uint8_t z = 0; z < zones; z++) {
+        rate->previous_mm[z] = frame->distance_mm[TOF_FRAME_TARGET_IDX(z, 0)];
+    }
+    return active;
+}
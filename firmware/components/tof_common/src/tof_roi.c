@@ -0,0 +1,113 @@
+/**
+ * @file tof_roi.c
+ * @brief Máscaras da ROI em cada resolução e decisão da troca entre 4x4 e 8x8.
+ */
+
+#include "tof_roi.h"
+
+#include <string.h>
+
+#include "tof_frame_stats.h"
+
+/** @brief Zonas da ROI com o primeiro alvo válido dentro da faixa de distâncias. */
+static uint8_t count_roi_targets(const tof_roi_t *roi, const tof_frame_t *frame);
+
+void tof_roi_init(tof_roi_t *roi, const tof_roi_config_t *config) {
+    static const tof_roi_config_t defaults = TOF_ROI_CONFIG_DEFAULT;
+    memset(roi, 0, sizeof(*roi));
+    roi->config = config ? *config : defaults;
+
+    tof_roi_config_t *c = &roi->config;
+    const uint8_t last = TOF_ROI_GRID_SIDE - 1;
+    c->col_max = c->col_max < last ? c->col_max : last;
+    c->row_max = c->row_max < last ? c->row_max : last;
+    c->col_min = c->col_min < c->col_max ? c->col_min : c->col_max;
+    c->row_min = c->row_min < c->row_max ? c->row_min : c->row_max;
+    c->max_mm = c->max_mm > c->min_mm ? c->max_mm : c->min_mm;
+    c->min_zones = c->min_zones > 0 ? c->min_zones : 1;
+
+    roi->mask_4x4 = tof_roi_zone_mask(c, TOF_ROI_RESOLUTION_4X4);
+    roi->mask_8x8 = tof_roi_zone_mask(c, TOF_ROI_RESOLUTION_8X8);
+    roi->resolution = TOF_ROI_RESOLUTION_4X4;
+}
+
+uint64_t tof_roi_zone_mask(const tof_roi_config_t *config, uint8_t resolution) {
+    // Em 4x4 cada zona é um quadrado de 2x2 zonas da grade 8x8
+    int scale;
+    if (resolution == TOF_ROI_RESOLUTION_8X8) {
+        scale = 1;
+    } else if (resolution == TOF_ROI_RESOLUTION_4X4) {
+        scale = 2;
+    } else {
+        return 0;
+    }
+    const int side = TOF_ROI_GRID_SIDE / scale;
+    uint64_t mask = 0;
+    for (int row = config->row_min / scale; row <= config->row_max / scale; row++) {
+        for (int col = config->col_min / scale; col <= config->col_max / scale; col++) {
+            mask |= (uint64_t)1 << (row * side + col);
+        }
+    }
+    return mask;
+}
+
+bool tof_roi_update(tof_roi_t *roi, const tof_frame_t *frame, uint8_t *resolution) {
+    const int64_t now = frame->timestamp_us;
+    const uint8_t previous = roi->resolution;
+
+    if (roi->stats.frames++ == 0) {
+        roi->last_seen_us = now;
+    }
+    if (frame->resolution == TOF_ROI_RESOLUTION_8X8) {
+        roi->stats.frames_8x8++;
+    }
+    if (count_roi_targets(roi, frame) >= roi->config.min_zones) {
+        roi->stats.roi_frames++;
+        roi->last_seen_us = now;
+        roi->resolution = TOF_ROI_RESOLUTION_8X8;
+    } else if (now - roi->last_seen_us >= (int64_t)roi->config.hold_ms * 1000) {
+        roi->resolution = TOF_ROI_RESOLUTION_4X4;
+    }
+
+    if (roi->resolution != previous) {
+        if (roi->resolution == TOF_ROI_RESOLUTION_8X8) {
+            roi->stats.switches_up++;
+        } else {
+            roi->stats.switches_down++;
+        }
+    }
+    *resolution = roi->resolution;
+    return roi->resolution != previous;
+}
+
+void tof_roi_crop(const tof_roi_t *roi, tof_frame_t *frame) {
+    if (frame->resolution != TOF_ROI_RESOLUTION_8X8) {
+        return;
+    }
+    for (int z = 0; z < TOF_ROI_RESOLUTION_8X8; z++) {
+        if (((roi->mask_8x8 >> z) & 1) == 0) {
+            frame->nb_target_detected[z] = 0;
+        }
+    }
+}
+
+tof_roi_stats_t tof_roi_get_stats(const tof_roi_t *roi) {
+    return roi->stats;
+}
+
+static uint8_t count_roi_targets(const tof_roi_t *roi, const tof_frame_t *frame) {
+    uint64_t zones;
+    if (frame->resolution == TOF_ROI_RESOLUTION_8X8) {
+        zones = roi->mask_8x8;
+    } else if (frame->resolution == TOF_ROI_RESOLUTION_4X4) {
+        zones = roi->mask_4x4;
+    } else {
+        return 0;
+    }
+    uint8_t count = 0;
+    for (uint64_t pending = tof_frame_valid_mask(frame, 0) & zones; pending != 0; pending &= pending - 1) {
+        int16_t mm = frame->distance_mm[TOF_FRAME_TARGET_IDX(__builtin_ctzll(pending), 0)];
+        count += mm >= roi->config.min_mm && mm <= roi->config.max_mm;
+    }
+    return count;
+}
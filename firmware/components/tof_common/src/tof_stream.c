@@ -0,0 +1,226 @@
+/**
+ * @file tof_stream.c
+ * @brief Codificação e decodificação dos pacotes de streaming (COBS + CRC16).
+ */
+
+#include "tof_stream.h"
+
+#include <string.h>
+
+#include "tof_crc.h"
+
+_Static_assert(sizeof(tof_stream_frame_header_t) == 16, "cabeçalho de pacote deve ter 16 bytes");
+_Static_assert(sizeof(tof_stream_motion_header_t) == 28, "cabeçalho de movimento deve ter 28 bytes");
+_Static_assert(sizeof(tof_stream_motion_header_t) + TOF_FRAME_MOTION_AGGREGATES * sizeof(uint32_t) + 2 <= TOF_STREAM_MAX_PACKET,
+               "pacote de movimento deve caber no buffer de um pacote");
+
+size_t tof_cobs_encode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t code_pos = 0;
+    size_t out_pos = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = out_pos++;
+            code = 1;
+            continue;
+        }
+        out[out_pos++] = in[i];
+        if (++code == 0xFF) {
+            out[code_pos] = code;
+            code_pos = out_pos++;
+            code = 1;
+        }
+    }
+    out[code_pos] = code;
+    return out_pos;
+}
+
+size_t tof_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t capacity) {
+    size_t in_pos = 0;
+    size_t out_pos = 0;
+
+    while (in_pos < len) {
+        uint8_t code = in[in_pos++];
+        if (code == 0 || in_pos + code - 1 > len) {
+            return 0;
+        }
+        for (uint8_t k = 1; k < code; k++) {
+            if (out_pos >= capacity || in[in_pos] == 0) {
+                return 0;
+            }
+            out[out_pos++] = in[in_pos++];
+        }
+        // Um código < 0xFF representa um zero implícito, exceto no fim do bloco
+        if (code != 0xFF && in_pos < len) {
+            if (out_pos >= capacity) {
+                return 0;
+            }
+            out[out_pos++] = 0;
+        }
+    }
+    return out_pos;
+}
+
+size_t tof_stream_encode_frame(const tof_frame_t *frame, uint8_t *out, size_t capacity) {
+    if (capacity < TOF_STREAM_MAX_ENCODED) {
+        return 0;
+    }
+
+    uint8_t packet[TOF_STREAM_MAX_PACKET];
+    uint8_t zones = frame->resolution < TOF_FRAME_MAX_ZONES ? frame->resolution : TOF_FRAME_MAX_ZONES;
+    size_t targets = (size_t)zones * TOF_FRAME_TARGETS_PER_ZONE;
+    tof_stream_frame_header_t hdr = {
+        .type = TOF_STREAM_MSG_FRAME,
+        .resolution = zones,
+        .streamcount = frame->streamcount,
+        .targets_per_zone = TOF_FRAME_TARGETS_PER_ZONE,
+        .sequence = frame->sequence,
+        .timestamp_ms = (uint32_t)(frame->timestamp_us / 1000),
+        .silicon_temp_degc = frame->silicon_temp_degc,
+        .sensor_id = frame->sensor_id,
+    };
+
+    // Campos já em little-endian na memória: cada vetor é copiado inteiro
+    uint8_t *p = packet;
+    memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+    memcpy(p, frame->nb_target_detected, zones);
+    p += zones;
+    memcpy(p, frame->distance_mm, targets * sizeof(int16_t));
+    p += targets * sizeof(int16_t);
+    memcpy(p, frame->range_sigma_mm, targets * sizeof(uint16_t));
+    p += targets * sizeof(uint16_t);
+    memcpy(p, frame->signal_per_spad, targets * sizeof(uint32_t));
+    p += targets * sizeof(uint32_t);
+    memcpy(p, frame->target_status, targets);
+    p += targets;
+
+    return tof_stream_finish_packet(packet, (size_t)(p - packet), out);
+}
+
+bool tof_stream_decode_frame(const uint8_t *in, size_t len, tof_frame_t *frame) {
+    uint8_t packet[TOF_STREAM_MAX_PACKET];
+    size_t n = tof_cobs_decode(in, len, packet, sizeof(packet));
+    if (n < sizeof(tof_stream_frame_header_t) + 2) {
+        return false;
+    }
+
+    tof_stream_frame_header_t hdr;
+    memcpy(&hdr, packet, sizeof(hdr));
+    size_t targets = (size_t)hdr.resolution * TOF_FRAME_TARGETS_PER_ZONE;
+    if (hdr.type != TOF_STREAM_MSG_FRAME || hdr.resolution > TOF_FRAME_MAX_ZONES ||
+        hdr.targets_per_zone != TOF_FRAME_TARGETS_PER_ZONE ||
+        n != sizeof(hdr) + hdr.resolution + targets * TOF_STREAM_TARGET_SIZE + 2) {
+        return false;
+    }
+
+    uint16_t crc;
+    memcpy(&crc, &packet[n - 2], sizeof(crc));
+    if (crc != tof_crc16(packet, n - 2)) {
+        return false;
+    }
+
+    memset(frame, 0, sizeof(*frame));
+    frame->timestamp_us = (int64_t)hdr.timestamp_ms * 1000;
+    frame->sequence = hdr.sequence;
+    frame->streamcount = hdr.streamcount;
+    frame->resolution = hdr.resolution;
+    frame->silicon_temp_degc = hdr.silicon_temp_degc;
+    frame->sensor_id = hdr.sensor_id;
+
+    const uint8_t *p = &packet[sizeof(hdr)];
+    memcpy(frame->nb_target_detected, p, hdr.resolution);
+    p += hdr.resolution;
+    memcpy(frame->distance_mm, p, targets * sizeof(int16_t));
+    p += targets * sizeof(int16_t);
+    memcpy(frame->range_sigma_mm, p, targets * sizeof(uint16_t));
+    p += targets * sizeof(uint16_t);
+    memcpy(frame->signal_per_spad, p, targets * sizeof(uint32_t));
+    p += targets * sizeof(uint32_t);
+    memcpy(frame->target_status, p, targets);
+    return true;
+}
+
+size_t tof_stream_finish_packet(uint8_t *packet, size_t len, uint8_t *out) {
+    uint16_t crc = tof_crc16(packet, len);
+    memcpy(&packet[len], &crc, sizeof(crc));
+    len += sizeof(crc);
+
+    out[0] = 0x00;
+    size_t encoded = 1 + tof_cobs_encode(packet, len, &out[1]);
+    out[encoded++] = 0x00;
+    return encoded;
+}
+
+size_t tof_stream_encode_motion(const tof_frame_t *frame, uint8_t *out, size_t capacity) {
+    if (capacity < TOF_STREAM_MAX_ENCODED) {
+        return 0;
+    }
+
+    uint8_t packet[TOF_STREAM_MAX_PACKET];
+    const tof_frame_motion_t *motion = &frame->motion;
+    tof_stream_motion_header_t hdr = {
+        .type = TOF_STREAM_MSG_MOTION,
+        .sensor_id = frame->sensor_id,
+        .status = motion->status,
+        .nb_detected_aggregates = motion->nb_detected_aggregates,
+        .nb_aggregates = motion->nb_aggregates,
+        .flags = (frame->flags & TOF_FRAME_FLAG_MOTION_ONLY) ? TOF_STREAM_MOTION_SUPPRESSED : 0,
+        .sequence = frame->sequence,
+        .timestamp_ms = (uint32_t)(frame->timestamp_us / 1000),
+        .global_indicator_1 = motion->global_indicator_1,
+        .global_indicator_2 = motion->global_indicator_2,
+        .active_mask = motion->active_mask,
+    };
+    memcpy(packet, &hdr, sizeof(hdr));
+    uint8_t *p = &packet[sizeof(hdr)];
+    for (uint32_t pending = motion->active_mask; pending != 0; pending &= pending - 1) {
+        memcpy(p, &motion->aggregate[__builtin_ctz(pending)], sizeof(uint32_t));
+        p += sizeof(uint32_t);
+    }
+    return tof_stream_finish_packet(packet, (size_t)(p - packet), out);
+}
+
+bool tof_stream_decode_motion(const uint8_t *in, size_t len, tof_frame_t *frame) {
+    uint8_t packet[TOF_STREAM_MAX_PACKET];
+    size_t n = tof_cobs_decode(in, len, packet, sizeof(packet));
+    if (n < sizeof(tof_stream_motion_header_t) + 2) {
+        return false;
+    }
+
+    tof_stream_motion_header_t hdr;
+    memcpy(&hdr, packet, sizeof(hdr));
+    size_t active = (size_t)__builtin_popcount(hdr.active_mask);
+    if (hdr.type != TOF_STREAM_MSG_MOTION || n != sizeof(hdr) + active * sizeof(uint32_t) + 2) {
+        return false;
+    }
+
+    uint16_t crc;
+    memcpy(&crc, &packet[n - 2], sizeof(crc));
+    if (crc != tof_crc16(packet, n - 2)) {
+        return false;
+    }
+
+    memset(frame, 0, sizeof(*frame));
+    frame->timestamp_us = (int64_t)hdr.timestamp_ms * 1000;
+    frame->sequence = hdr.sequence;
+    frame->sensor_id = hdr.sensor_id;
+    frame->flags = TOF_FRAME_FLAG_MOTION;
+    frame->flags |= (hdr.flags & TOF_STREAM_MOTION_SUPPRESSED) ? TOF_FRAME_FLAG_MOTION_ONLY : 0;
+
+    tof_frame_motion_t *motion = &frame->motion;
+    motion->global_indicator_1 = hdr.global_indicator_1;
+    motion->global_indicator_2 = hdr.global_indicator_2;
+    motion->status = hdr.status;
+    motion->nb_detected_aggregates = hdr.nb_detected_aggregates;
+    motion->nb_aggregates = hdr.nb_aggregates;
+    motion->active_mask = hdr.active_mask;
+    const uint8_t *p = &packet[sizeof(hdr)];
+    for (uint32_t pending = hdr.active_mask; pending != 0; pending &= pending - 1) {
+        memcpy(&motion->aggregate[__builtin_ctz(pending)], p, sizeof(uint32_t));
+        p += sizeof(uint32_t);
+    }
+    return true;
+}
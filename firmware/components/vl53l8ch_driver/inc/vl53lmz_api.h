@@ -262,8 +262,11 @@
 #define LMZ_MOT_SIZE	0U
 #endif
 
-/* maximum size of (CNH_DATA + MI_OP_DEV) */
+/* maximum size of (CNH_DATA + MI_OP_DEV); the platform may reduce it when
+ * those blocks are never added to the output */
+#ifndef VL53LMZ_ADDITIONAL_RESULTS_DATA
 #define VL53LMZ_ADDITIONAL_RESULTS_DATA (6160U+268U)
+#endif
 
 
 /**
@@ -312,8 +315,15 @@ typedef struct
 	uint8_t				offset_data[VL53LMZ_OFFSET_BUFFER_SIZE];
 	/* Xtalk buffer */
 	uint8_t				xtalk_data[VL53LMZ_XTALK_BUFFER_SIZE];
-	/* Temporary buffer used for internal driver processing */
+	/* Temporary buffer used for internal driver processing. With
+	 * VL53LMZ_EXTERNAL_TEMP_BUFFER it is supplied by the platform before the
+	 * first driver call (VL53LMZ_TEMPORARY_BUFFER_SIZE bytes), and may be
+	 * shared by devices that are never accessed concurrently */
+#ifdef VL53LMZ_EXTERNAL_TEMP_BUFFER
+	uint8_t				*temp_buffer;
+#else
 	 uint8_t			temp_buffer[VL53LMZ_TEMPORARY_BUFFER_SIZE];
+#endif
 	/* Auto-stop flag for stopping the sensor */
 	uint8_t				is_auto_stop_enabled;
     /* Device and revision information read back from sensor */
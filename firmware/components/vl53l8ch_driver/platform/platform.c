@@ -0,0 +1,257 @@
+/**
+ * @file platform.c
+ * @brief Implementação da camada de plataforma do VL53LMZ sobre o driver spi_master do ESP-IDF.
+ */
+
+#include "platform.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+
+#define SPI_WRITE_FLAG 0x8000                       /**< Bit 15 do endereço indica escrita. */
+
+/**
+ * @brief Instantes de uma transação; início e fim são gravados pelos callbacks do driver SPI.
+ */
+typedef struct {
+    int64_t queued_us;                              /**< Entrada na fila do driver. */
+    volatile int64_t start_us;                      /**< CS baixo (barramento concedido ao sensor). */
+    volatile int64_t end_us;                        /**< CS alto (barramento liberado). */
+} chunk_timing_t;
+
+/** @brief Callback do driver SPI no início de cada transação (contexto de ISR). */
+static void IRAM_ATTR on_trans_start(spi_transaction_t *t);
+
+/** @brief Callback do driver SPI no fim de cada transação (contexto de ISR). */
+static void IRAM_ATTR on_trans_end(spi_transaction_t *t);
+
+/** @brief Acessos curtos (registradores): uma transação por polling, com os dados dentro da própria transação. */
+static uint8_t transfer_polling(VL53LMZ_Platform *p_platform, uint16_t address, uint8_t *data,
+                                uint32_t size, bool write);
+
+/**
+ * @brief Acessos longos: blocos de VL53LMZ_Platform::chunk_size enfileirados por DMA.
+ * Cada bloco é uma transação própria com o endereço já avançado, porque o CS
+ * sobe entre as transações e o sensor reinicia o auto-incremento.
+ */
+static uint8_t transfer_queued(VL53LMZ_Platform *p_platform, uint16_t address, uint8_t *data,
+                               uint32_t size, bool write);
+
+/** @brief Escolhe o caminho do acesso e contabiliza sua duração. */
+static uint8_t transfer(VL53LMZ_Platform *p_platform, uint16_t address, uint8_t *data,
+                        uint32_t size, bool write);
+
+/** @brief Contabiliza uma transação concluída; prev_end_us é o fim da transação anterior do mesmo acesso. */
+static void account_chunk(VL53LMZ_Platform *p_platform, const chunk_timing_t *timing, int64_t prev_end_us);
+
+esp_err_t VL53LMZ_PlatformInit(VL53LMZ_Platform *p_platform, const VL53LMZ_PlatformSpiConfig *config) {
+    memset(&p_platform->stats, 0, sizeof(p_platform->stats));
+    p_platform->bulk_buffer = NULL;
+    p_platform->chunk_size = VL53LMZ_PLATFORM_CHUNK_SIZE;
+    spi_device_interface_config_t dev_cfg = {
+        .address_bits = 16,
+        .mode = VL53LMZ_PLATFORM_SPI_MODE,
+        .clock_speed_hz = config->clock_hz,
+        .input_delay_ns = config->input_delay_ns,
+        .spics_io_num = config->cs_gpio,
+        .flags = SPI_DEVICE_HALFDUPLEX,
+        .queue_size = VL53LMZ_PLATFORM_QUEUE_DEPTH,
+        .pre_cb = on_trans_start,
+        .post_cb = on_trans_end,
+    };
+    return spi_bus_add_device(config->host, &dev_cfg, &p_platform->spi);
+}
+
+esp_err_t VL53LMZ_PlatformBeginBulk(VL53LMZ_Platform *p_platform) {
+    if (p_platform->bulk_buffer == NULL) {
+        p_platform->bulk_buffer = heap_caps_malloc(VL53LMZ_PLATFORM_QUEUE_DEPTH * VL53LMZ_PLATFORM_BULK_CHUNK_SIZE,
+                                                   MALLOC_CAP_DMA);
+        if (p_platform->bulk_buffer == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    p_platform->chunk_size = VL53LMZ_PLATFORM_BULK_CHUNK_SIZE;
+    return ESP_OK;
+}
+
+void VL53LMZ_PlatformEndBulk(VL53LMZ_Platform *p_platform) {
+    heap_caps_free(p_platform->bulk_buffer);
+    p_platform->bulk_buffer = NULL;
+    p_platform->chunk_size = VL53LMZ_PLATFORM_CHUNK_SIZE;
+}
+
+void VL53LMZ_PlatformTakeStats(VL53LMZ_Platform *p_platform, VL53LMZ_PlatformStats *stats) {
+    *stats = p_platform->stats;
+    memset(&p_platform->stats, 0, sizeof(p_platform->stats));
+}
+
+uint8_t RdByte(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_value) {
+    return RdMulti(p_platform, RegisterAdress, p_value, 1);
+}
+
+uint8_t WrByte(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t value) {
+    return WrMulti(p_platform, RegisterAdress, &value, 1);
+}
+
+uint8_t RdMulti(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_values, uint32_t size) {
+    return transfer(p_platform, RegisterAdress, p_values, size, false);
+}
+
+uint8_t WrMulti(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_values, uint32_t size) {
+    return transfer(p_platform, RegisterAdress, p_values, size, true);
+}
+
+static void IRAM_ATTR on_trans_start(spi_transaction_t *t) {
+    ((chunk_timing_t *)t->user)->start_us = esp_timer_get_time();
+}
+
+static void IRAM_ATTR on_trans_end(spi_transaction_t *t) {
+    ((chunk_timing_t *)t->user)->end_us = esp_timer_get_time();
+}
+
+static uint8_t transfer(VL53LMZ_Platform *p_platform, uint16_t address, uint8_t *data,
+                        uint32_t size, bool write) {
+    int64_t start_us = esp_timer_get_time();
+    uint8_t status = size <= VL53LMZ_PLATFORM_POLLING_MAX
+                   ? transfer_polling(p_platform, address, data, size, write)
+                   : transfer_queued(p_platform, address, data, size, write);
+
+    VL53LMZ_PlatformStats *stats = &p_platform->stats;
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+    stats->transfers++;
+    stats->bytes += size;
+    if (elapsed_us > stats->max_transfer_us) {
+        stats->max_transfer_us = elapsed_us;
+    }
+    return status;
+}
+
+static uint8_t transfer_polling(VL53LMZ_Platform *p_platform, uint16_t address, uint8_t *data,
+                                uint32_t size, bool write) {
+    chunk_timing_t timing = { .queued_us = esp_timer_get_time() };
+    spi_transaction_t t = {
+        .flags = write ? SPI_TRANS_USE_TXDATA : SPI_TRANS_USE_RXDATA,
+        .addr = write ? (address | SPI_WRITE_FLAG) : (address & ~SPI_WRITE_FLAG),
+        .length = write ? size * 8 : 0,
+        .rxlength = write ? 0 : size * 8,
+        .user = &timing,
+    };
+    if (write) {
+        memcpy(t.tx_data, data, size);
+    }
+    if (spi_device_polling_transmit(p_platform->spi, &t) != ESP_OK) {
+        p_platform->stats.errors++;
+        return 1;
+    }
+    if (!write) {
+        memcpy(data, t.rx_data, size);
+    }
+    account_chunk(p_platform, &timing, 0);
+    return 0;
+}
+
+static uint8_t transfer_queued(VL53LMZ_Platform *p_platform, uint16_t address, uint8_t *data,
+                               uint32_t size, bool write) {
+    spi_transaction_t trans[VL53LMZ_PLATFORM_QUEUE_DEPTH];
+    chunk_timing_t timing[VL53LMZ_PLATFORM_QUEUE_DEPTH];
+    uint32_t chunk_size = p_platform->chunk_size;
+    uint32_t n_chunks = (size + chunk_size - 1) / chunk_size;
+    uint32_t queued = 0;
+    uint32_t done = 0;
+    int64_t prev_end_us = 0;
+    uint8_t status = 0;
+
+    while (done < n_chunks) {
+        // Mantém até VL53LMZ_PLATFORM_QUEUE_DEPTH blocos na fila do driver
+        while (status == 0 && queued < n_chunks && queued - done < VL53LMZ_PLATFORM_QUEUE_DEPTH) {
+            uint32_t slot = queued % VL53LMZ_PLATFORM_QUEUE_DEPTH;
+            uint32_t offset = queued * chunk_size;
+            uint32_t len = size - offset < chunk_size ? size - offset : chunk_size;
+            uint16_t reg = (uint16_t)(address + offset);
+            uint8_t *bounce = p_platform->bulk_buffer != NULL
+                            ? &p_platform->bulk_buffer[slot * chunk_size]
+                            : p_platform->tx_bounce[slot];
+
+            if (write) {
+                memcpy(bounce, &data[offset], len);
+            }
+            trans[slot] = (spi_transaction_t){
+                .addr = write ? (reg | SPI_WRITE_FLAG) : (reg & ~SPI_WRITE_FLAG),
+                .length = write ? len * 8 : 0,
+                .rxlength = write ? 0 : len * 8,
+                .tx_buffer = write ? bounce : NULL,
+                .rx_buffer = write ? NULL : &data[offset],
+                .user = &timing[slot],
+            };
+            timing[slot].queued_us = esp_timer_get_time();
+            if (spi_device_queue_trans(p_platform->spi, &trans[slot], portMAX_DELAY) != ESP_OK) {
+                status = 1;
+                break;
+            }
+            queued++;
+        }
+        if (done == queued) {
+            break;  // Falha ao enfileirar e nada mais em voo
+        }
+
+        spi_transaction_t *result;
+        if (spi_device_get_trans_result(p_platform->spi, &result, portMAX_DELAY) != ESP_OK) {
+            status = 1;
+            break;
+        }
+        const chunk_timing_t *t = (const chunk_timing_t *)result->user;
+        account_chunk(p_platform, t, prev_end_us);
+        prev_end_us = t->end_us;
+        done++;
+    }
+
+    if (status != 0) {
+        p_platform->stats.errors++;
+    }
+    return status;
+}
+
+static void account_chunk(VL53LMZ_Platform *p_platform, const chunk_timing_t *timing, int64_t prev_end_us) {
+    VL53LMZ_PlatformStats *stats = &p_platform->stats;
+    uint32_t busy_us = (uint32_t)(timing->end_us - timing->start_us);
+    // A espera só conta a partir do fim do bloco anterior do próprio sensor
+    int64_t ready_us = timing->queued_us > prev_end_us ? timing->queued_us : prev_end_us;
+    uint32_t wait_us = timing->start_us > ready_us ? (uint32_t)(timing->start_us - ready_us) : 0;
+
+    stats->chunks++;
+    stats->busy_us += busy_us;
+    if (busy_us > stats->max_chunk_us) {
+        stats->max_chunk_us = busy_us;
+    }
+    if (wait_us > stats->max_bus_wait_us) {
+        stats->max_bus_wait_us = wait_us;
+    }
+}
+
+void SwapBuffer(uint8_t *buffer, uint16_t size) {
+    for (uint16_t i = 0; i + 4 <= size; i += 4) {
+        uint32_t word;
+        memcpy(&word, &buffer[i], sizeof(word));
+        word = __builtin_bswap32(word);
+        memcpy(&buffer[i], &word, sizeof(word));
+    }
+}
+
+uint8_t WaitMs(VL53LMZ_Platform *p_platform, uint32_t TimeMs) {
+    (void)p_platform;
+    TickType_t ticks = pdMS_TO_TICKS(TimeMs);
+    if (ticks == 0) {
+        // Acomodação menor que um tick (10 ms a 100 Hz), que vTaskDelay arredondaria para zero; as consultas
+        // do driver usam VL53LMZ_POLL_INTERVAL_MS, de um tick, e nunca caem aqui
+        esp_rom_delay_us(TimeMs * 1000);
+    } else {
+        vTaskDelay(ticks);
+    }
+    return 0;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file platform.h
+ * @brief Camada de plataforma do driver ULD VL53LMZ para o ESP-IDF (barramento SPI).
+ *
+ * O driver da ST não acessa o hardware diretamente: ele chama as funções
+ * RdByte/WrByte/RdMulti/WrMulti/WaitMs/SwapBuffer declaradas aqui e espera
+ * encontrar neste cabeçalho a estrutura VL53LMZ_Platform e a configuração de
+ * compilação (número de alvos por zona e os VL53LMZ_DISABLE_* dos blocos de
+ * saída que não forem usados).
+ *
+ * No SPI do VL53L8 cada transação começa pelo endereço de 16 bits do
+ * registrador, com o bit 15 em 1 para escrita e em 0 para leitura, seguido
+ * dos dados; o endereço é incrementado automaticamente enquanto o CS fica baixo.
+ *
+ * O barramento é compartilhado com os controladores CAN. Acessos longos (o
+ * download do firmware e a leitura dos resultados, de alguns KB) são
+ * divididos em transações DMA de até VL53LMZ_PLATFORM_CHUNK_SIZE bytes,
+ * enfileiradas com spi_device_queue_trans(): o barramento só fica com o
+ * sensor durante uma transação, e as transações dos outros dispositivos são
+ * atendidas entre elas. O tamanho do bloco limita, portanto, a latência que
+ * o sensor impõe ao CAN (VL53LMZ_PlatformStats::max_chunk_us).
+ *
+ * Durante a inicialização, VL53LMZ_PlatformBeginBulk() troca os blocos por
+ * transações de VL53LMZ_PLATFORM_BULK_CHUNK_SIZE bytes para baixar os ~84 KB
+ * de firmware com o mínimo de transações; VL53LMZ_PlatformEndBulk() volta ao
+ * tamanho normal antes do início do ranging.
+ */
+
+#ifndef VL53LMZ_PLATFORM_H_
+#define VL53LMZ_PLATFORM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>     // Os plugins do ULD usam memcpy/memset contando com este include
+
+#include "driver/spi_master.h"
+#include "sdkconfig.h"
+
+/**
+ * @brief Número de alvos reportados por zona (1 a 4). Deve ser o mesmo em
+ * todo o projeto, pois muda o tamanho de VL53LMZ_ResultsData.
+ */
+#ifndef VL53LMZ_NB_TARGET_PER_ZONE
+#define VL53LMZ_NB_TARGET_PER_ZONE 1U
+#endif
+
+/*
+ * Perfil de saída (menuconfig, "Sensor ToF VL53L8CH"): os blocos desabilitados
+ * aqui não entram na configuração de saída enviada ao sensor
+ * (vl53lmz_create_output_config()) nem em VL53LMZ_ResultsData.
+ */
+#if defined(CONFIG_VL53LMZ_PROFILE_DISTANCE)
+#define VL53LMZ_PROFILE_NAME "distância"
+#define VL53LMZ_DISABLE_AMBIENT_PER_SPAD
+#define VL53LMZ_DISABLE_NB_SPADS_ENABLED
+#define VL53LMZ_DISABLE_NB_TARGET_DETECTED
+#define VL53LMZ_DISABLE_SIGNAL_PER_SPAD
+#define VL53LMZ_DISABLE_RANGE_SIGMA_MM
+#define VL53LMZ_DISABLE_REFLECTANCE_PERCENT
+#define VL53LMZ_DISABLE_MOTION_INDICATOR
+#elif defined(CONFIG_VL53LMZ_PROFILE_MOTION)
+#define VL53LMZ_PROFILE_NAME "movimento"
+#define VL53LMZ_DISABLE_AMBIENT_PER_SPAD
+#define VL53LMZ_DISABLE_NB_SPADS_ENABLED
+#define VL53LMZ_DISABLE_SIGNAL_PER_SPAD
+#define VL53LMZ_DISABLE_RANGE_SIGMA_MM
+#define VL53LMZ_DISABLE_REFLECTANCE_PERCENT
+#elif defined(CONFIG_VL53LMZ_PROFILE_FULL)
+#define VL53LMZ_PROFILE_NAME "completo"
+#else
+#define VL53LMZ_PROFILE_NAME "ranging"             /**< Perfil usado na compilação, para o log. */
+#define VL53LMZ_DISABLE_AMBIENT_PER_SPAD
+#define VL53LMZ_DISABLE_NB_SPADS_ENABLED
+#define VL53LMZ_DISABLE_REFLECTANCE_PERCENT
+#define VL53LMZ_DISABLE_MOTION_INDICATOR
+#endif
+
+#ifndef CONFIG_VL53LMZ_EXTRA_RESULTS_BUFFER
+#define VL53LMZ_ADDITIONAL_RESULTS_DATA 0U          /**< Sem blocos CNH: o buffer temporário cobre só o perfil. */
+#endif
+
+/*
+ * Buffer temporário fora do VL53LMZ_Configuration: a aplicação aponta
+ * temp_buffer para um buffer de VL53LMZ_TEMPORARY_BUFFER_SIZE bytes em RAM
+ * interna com DMA (alinhado a 4 bytes, para o driver SPI ler os resultados
+ * direto nele) antes da primeira chamada ao driver.
+ */
+#ifdef CONFIG_VL53LMZ_EXTERNAL_TEMP_BUFFER
+#define VL53LMZ_EXTERNAL_TEMP_BUFFER
+#endif
+
+#define VL53LMZ_PLATFORM_SPI_MODE 3                 /**< CPOL = 1, CPHA = 1, exigido pelo VL53L8. */
+#ifndef VL53LMZ_PLATFORM_CHUNK_SIZE
+#define VL53LMZ_PLATFORM_CHUNK_SIZE 512             /**< Bytes por transação (múltiplo de 4; ~1,4 ms de barramento a 3 MHz). */
+#endif
+#ifndef VL53LMZ_PLATFORM_BULK_CHUNK_SIZE
+#define VL53LMZ_PLATFORM_BULK_CHUNK_SIZE 4092       /**< Bytes por transação no modo de inicialização (máximo de um descritor DMA, ~11 ms a 3 MHz). */
+#endif
+#define VL53LMZ_PLATFORM_QUEUE_DEPTH 2              /**< Transações em voo: a próxima é preparada enquanto a atual está no barramento. */
+#define VL53LMZ_PLATFORM_POLLING_MAX 4              /**< Acessos de até este tamanho usam uma transação por polling, sem DMA. */
+
+#ifndef VL53LMZ_POLL_INTERVAL_MS
+// Um tick do FreeRTOS, arredondado para cima: a consulta cede a CPU com vTaskDelay em vez de girar em WaitMs
+#define VL53LMZ_POLL_INTERVAL_MS ((1000U + CONFIG_FREERTOS_HZ - 1U) / CONFIG_FREERTOS_HZ) /**< Intervalo entre as consultas do driver ao aguardar o sensor (padrão da ST: 10 ms). */
+#endif
+#ifndef VL53LMZ_BOOT_SETTLE_MS
+#define VL53LMZ_BOOT_SETTLE_MS 10U                  /**< Espera fixa após o reboot do sensor; o restante é coberto pela consulta de boot (padrão da ST: 100 ms). */
+#endif
+
+/**
+ * @brief Estatísticas de transferência de um sensor, acumuladas desde a última leitura.
+ */
+typedef struct {
+    uint32_t transfers;                             /**< Chamadas a RdMulti/WrMulti. */
+    uint32_t chunks;                                /**< Transações SPI executadas. */
+    uint32_t errors;                                /**< Transações que falharam. */
+    uint64_t bytes;                                 /**< Bytes de dados transferidos. */
+    uint64_t busy_us;                               /**< Tempo total com o barramento ocupado pelo sensor. */
+    uint32_t max_transfer_us;                       /**< Maior duração de uma chamada (inclui as esperas entre blocos). */
+    uint32_t max_chunk_us;                          /**< Maior tempo contínuo com o barramento ocupado pelo sensor. */
+    uint32_t max_bus_wait_us;                       /**< Maior espera de um bloco na fila (barramento com outro dispositivo). */
+} VL53LMZ_PlatformStats;
+
+/**
+ * @brief Contexto de comunicação com um sensor, acessado pelo driver via p_dev->platform.
+ */
+typedef struct {
+    uint16_t address;                               /**< Endereço I2C exigido pela API; não é usado no SPI. */
+    spi_device_handle_t spi;                        /**< Dispositivo do sensor no barramento SPI. */
+    VL53LMZ_PlatformStats stats;                    /**< Estatísticas de transferência (ver VL53LMZ_PlatformTakeStats()). */
+    uint8_t tx_bounce[VL53LMZ_PLATFORM_QUEUE_DEPTH][VL53LMZ_PLATFORM_CHUNK_SIZE] __attribute__((aligned(4)));
+                                                    /**< Cópias em RAM dos blocos escritos (o firmware do sensor está na flash, inacessível ao DMA). */
+    uint8_t *bulk_buffer;                           /**< Buffers DMA do modo de inicialização (NULL fora dele). */
+    uint32_t chunk_size;                            /**< Tamanho de bloco em uso. */
+} VL53LMZ_Platform;
+
+/**
+ * @brief Parâmetros de conexão do sensor a um barramento SPI já inicializado.
+ */
+typedef struct {
+    spi_host_device_t host;                         /**< Barramento (SPI2_HOST ou SPI3_HOST). */
+    int cs_gpio;                                    /**< Pino de chip select do sensor. */
+    int clock_hz;                                   /**< Clock SPI do sensor, independente do clock dos outros dispositivos do barramento. */
+    int input_delay_ns;                             /**< Atraso de MISO do sensor e do roteamento (0 = padrão; necessário em clocks altos). */
+} VL53LMZ_PlatformSpiConfig;
+
+/**
+ * @brief Registra o sensor como dispositivo no barramento SPI.
+ * @param p_platform Contexto a ser preenchido.
+ * @param config Barramento, pino de CS e clock.
+ * @return ESP_OK em caso de sucesso, ou o erro de spi_bus_add_device().
+ */
+esp_err_t VL53LMZ_PlatformInit(VL53LMZ_Platform *p_platform, const VL53LMZ_PlatformSpiConfig *config);
+
+/**
+ * @brief Entra no modo de inicialização: transações de VL53LMZ_PLATFORM_BULK_CHUNK_SIZE bytes.
+ * Os buffers DMA são alocados do heap e devolvidos em VL53LMZ_PlatformEndBulk().
+ * O barramento deve ter sido inicializado com max_transfer_sz de pelo menos
+ * VL53LMZ_PLATFORM_BULK_CHUNK_SIZE, e os outros dispositivos do barramento
+ * passam a esperar até um bloco grande enquanto o modo estiver ativo.
+ * @param p_platform Contexto do sensor.
+ * @return ESP_OK, ou ESP_ERR_NO_MEM (o sensor continua no tamanho normal).
+ */
+esp_err_t VL53LMZ_PlatformBeginBulk(VL53LMZ_Platform *p_platform);
+
+/**
+ * @brief Sai do modo de inicialização e libera seus buffers. Pode ser chamada fora do modo.
+ * @param p_platform Contexto do sensor.
+ */
+void VL53LMZ_PlatformEndBulk(VL53LMZ_Platform *p_platform);
+
+/**
+ * @brief Copia e zera as estatísticas de transferência do sensor.
+ * Deve ser chamada pela mesma tarefa que usa o driver.
+ * @param p_platform Contexto do sensor.
+ * @param stats Estatísticas acumuladas desde a chamada anterior.
+ */
+void VL53LMZ_PlatformTakeStats(VL53LMZ_Platform *p_platform, VL53LMZ_PlatformStats *stats);
+
+/**
+ * @brief Lê um byte de um registrador.
+ * @param p_platform Contexto do sensor.
+ * @param RegisterAdress Endereço do registrador.
+ * @param p_value Valor lido.
+ * @return 0 em caso de sucesso.
+ */
+uint8_t RdByte(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_value);
+
+/**
+ * @brief Escreve um byte em um registrador.
+ * @param p_platform Contexto do sensor.
+ * @param RegisterAdress Endereço do registrador.
+ * @param value Valor a escrever.
+ * @return 0 em caso de sucesso.
+ */
+uint8_t WrByte(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t value);
+
+/**
+ * @brief Lê uma sequência de bytes a partir de um registrador.
+ * @param p_platform Contexto do sensor.
+ * @param RegisterAdress Endereço inicial.
+ * @param p_values Buffer de destino.
+ * @param size Quantidade de bytes.
+ * @return 0 em caso de sucesso.
+ */
+uint8_t RdMulti(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_values, uint32_t size);
+
+/**
+ * @brief Escreve uma sequência de bytes a partir de um registrador.
+ * @param p_platform Contexto do sensor.
+ * @param RegisterAdress Endereço inicial.
+ * @param p_values Dados a escrever (podem estar na flash).
+ * @param size Quantidade de bytes.
+ * @return 0 em caso de sucesso.
+ */
+uint8_t WrMulti(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_values, uint32_t size);
+
+/**
+ * @brief Inverte a ordem dos bytes de cada palavra de 32 bits (o sensor é big-endian).
+ * @param buffer Buffer a converter no próprio lugar.
+ * @param size Tamanho em bytes (múltiplo de 4).
+ */
+void SwapBuffer(uint8_t *buffer, uint16_t size);
+
+/**
+ * @brief Aguarda o tempo pedido pelo driver.
+ *
+ * Esperas de um tick ou mais bloqueiam a tarefa (vTaskDelay); só as esperas
+ * de acomodação menores que um tick (1 e 5 ms da sequência de reset, a 100 Hz)
+ * são feitas em espera ativa.
+ *
+ * @param p_platform Contexto do sensor.
+ * @param TimeMs Tempo em milissegundos.
+ * @return 0 sempre.
+ */
+uint8_t WaitMs(VL53LMZ_Platform *p_platform, uint32_t TimeMs);
+
+#endif // VL53LMZ_PLATFORM_H_
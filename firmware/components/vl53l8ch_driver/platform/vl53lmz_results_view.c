@@ -0,0 +1,212 @@
+/**
+ * @file vl53lmz_results_view.c
+ * @brief Implementação da leitura de resultados sem cópia (ver vl53lmz_results_view.h).
+ */
+
+#include "vl53lmz_results_view.h"
+#include "vl53lmz_plugin_cnh.h"
+
+/** @brief Associa o índice de um bloco de saída do sensor à entrada da visão; -1 se não é mapeado. */
+static int view_block_of(uint16_t idx);
+
+/** @brief Tamanho do elemento de um bloco da visão, em bytes (0 para blocos sem elementos). */
+static uint16_t element_size(VL53LMZ_ViewBlock block);
+
+/** @brief Elementos que podem ser convertidos de um bloco, limitados a count. */
+static uint16_t available(const VL53LMZ_ResultsView *p_view, VL53LMZ_ViewBlock block, uint16_t count);
+
+
+uint8_t vl53lmz_get_ranging_view(VL53LMZ_Configuration *p_dev, uint32_t blocks,
+                                 VL53LMZ_ResultsView *p_view) {
+    uint8_t status = vl53lmz_read_ranging_results(p_dev);
+    return status | vl53lmz_parse_ranging_view(p_dev, blocks, p_view);
+}
+
+uint8_t vl53lmz_read_ranging_results(VL53LMZ_Configuration *p_dev) {
+    return RdMulti(&(p_dev->platform), 0x0, p_dev->temp_buffer, p_dev->data_read_size);
+}
+
+uint8_t vl53lmz_parse_ranging_view(VL53LMZ_Configuration *p_dev, uint32_t blocks,
+                                   VL53LMZ_ResultsView *p_view) {
+    uint8_t *buf = p_dev->temp_buffer;
+    uint32_t size = p_dev->data_read_size;
+    uint8_t status = VL53LMZ_STATUS_OK;
+
+    memset(p_view, 0, sizeof(*p_view));
+    p_dev->streamcount = buf[0];
+    p_view->streamcount = buf[0];
+
+    // Identificadores de cabeçalho e rodapé lidos antes de qualquer troca de bytes
+    uint16_t header_id = (uint16_t)(((uint16_t)buf[0xB] << 8) | buf[0xA]);
+    uint16_t footer_id = (uint16_t)(((uint16_t)buf[size - 1U] << 8) | buf[size - 2U]);
+
+    // Mesmo percurso de vl53lmz_get_ranging_data(), a partir da posição 16
+    for (uint32_t i = 16U; i + 4U <= size; i += 4U) {
+        uint32_t word = vl53lmz_view_be32(&buf[i], 0);
+        uint32_t type = word & 0xFU;
+        uint32_t bh_size = (word >> 4) & 0xFFFU;
+        uint16_t idx = (uint16_t)(word >> 16);
+        uint32_t msize = (type > 0x1U && type < 0xDU) ? type * bh_size : bh_size;
+        if (i + 4U + msize > size) {
+            break;
+        }
+
+        uint8_t *data = &buf[i + 4U];
+        if (idx == VL53LMZ_METADATA_IDX) {
+            p_view->silicon_temp_degc = (int8_t)VL53LMZ_VIEW_BYTE(data, 8U);
+        } else {
+            int block = view_block_of(idx);
+            if (block >= 0 && (blocks & VL53LMZ_VIEW_MASK(block)) != 0U) {
+                p_view->block[block].data = data;
+                p_view->block[block].size = (uint16_t)msize;
+            }
+        }
+        i += msize;
+    }
+
+    if (header_id != footer_id) {
+        status |= VL53LMZ_STATUS_CORRUPTED_FRAME;
+    }
+    return status;
+}
+
+uint16_t vl53lmz_view_copy_distance_mm(const VL53LMZ_ResultsView *p_view, int16_t *out, uint16_t count) {
+    // Ponteiro local: out pode ter o mesmo tipo que a visão, e o compilador recarregaria o bloco a cada elemento
+    const uint8_t *src = p_view->block[VL53LMZ_VIEW_DISTANCE_MM].data;
+    count = available(p_view, VL53LMZ_VIEW_DISTANCE_MM, count);
+    uint16_t i = 0;
+    for (; i + 2U <= count; i += 2U) {
+        uint32_t word = vl53lmz_view_be32(src, i / 2U);
+        out[i] = vl53lmz_convert_distance_mm((int16_t)word);
+        out[i + 1U] = vl53lmz_convert_distance_mm((int16_t)(word >> 16));
+    }
+    if (i < count) {
+        out[i] = vl53lmz_convert_distance_mm((int16_t)vl53lmz_view_u16(src, i));
+    }
+    return count;
+}
+
+uint16_t vl53lmz_view_copy_range_sigma_mm(const VL53LMZ_ResultsView *p_view, uint16_t *out, uint16_t count) {
+    const uint8_t *src = p_view->block[VL53LMZ_VIEW_RANGE_SIGMA_MM].data;
+    count = available(p_view, VL53LMZ_VIEW_RANGE_SIGMA_MM, count);
+    uint16_t i = 0;
+    for (; i + 2U <= count; i += 2U) {
+        uint32_t word = vl53lmz_view_be32(src, i / 2U);
+        out[i] = vl53lmz_convert_range_sigma_mm((uint16_t)word);
+        out[i + 1U] = vl53lmz_convert_range_sigma_mm((uint16_t)(word >> 16));
+    }
+    if (i < count) {
+        out[i] = vl53lmz_convert_range_sigma_mm(vl53lmz_view_u16(src, i));
+    }
+    return count;
+}
+
+uint16_t vl53lmz_view_copy_signal_per_spad(const VL53LMZ_ResultsView *p_view, uint32_t *out, uint16_t count) {
+    const uint8_t *src = p_view->block[VL53LMZ_VIEW_SIGNAL_PER_SPAD].data;
+    count = available(p_view, VL53LMZ_VIEW_SIGNAL_PER_SPAD, count);
+    for (uint16_t i = 0; i < count; i++) {
+        out[i] = vl53lmz_convert_per_spad(vl53lmz_view_be32(src, i));
+    }
+    return count;
+}
+
+uint16_t vl53lmz_view_copy_target_status(const VL53LMZ_ResultsView *p_view, uint8_t *out, uint16_t count) {
+    const uint8_t *src = p_view->block[VL53LMZ_VIEW_TARGET_STATUS].data;
+    const uint8_t *nb = p_view->block[VL53LMZ_VIEW_NB_TARGET_DETECTED].data;
+    count = available(p_view, VL53LMZ_VIEW_TARGET_STATUS, count);
+    for (uint16_t i = 0; i < count; i++) {
+        out[i] = VL53LMZ_VIEW_BYTE(src, i);
+    }
+#ifndef VL53LMZ_USE_RAW_FORMAT
+    if (nb != NULL) {
+        for (uint16_t i = 0; i < count; i++) {
+            if (VL53LMZ_VIEW_BYTE(nb, i / VL53LMZ_NB_TARGET_PER_ZONE) == 0U) {
+                out[i] = 255U;
+            }
+        }
+    }
+#endif
+    return count;
+}
+
+uint16_t vl53lmz_view_copy_nb_target_detected(const VL53LMZ_ResultsView *p_view, uint8_t *out, uint16_t count) {
+    const uint8_t *src = p_view->block[VL53LMZ_VIEW_NB_TARGET_DETECTED].data;
+    count = available(p_view, VL53LMZ_VIEW_NB_TARGET_DETECTED, count);
+    for (uint16_t i = 0; i < count; i++) {
+        out[i] = VL53LMZ_VIEW_BYTE(src, i);
+    }
+    return count;
+}
+
+uint16_t vl53lmz_view_copy_motion_indicator(const VL53LMZ_ResultsView *p_view, VL53LMZ_ViewMotionIndicator *out) {
+    // Duas palavras de indicadores globais, uma de status e contadores e os agregados
+    const VL53LMZ_ViewSpan *span = &p_view->block[VL53LMZ_VIEW_MOTION_INDICATOR];
+    if (span->data == NULL || span->size < 12U) {
+        return 0U;
+    }
+    const uint8_t *src = span->data;
+    uint16_t count = (uint16_t)(span->size / 4U - 3U);
+    count = count < VL53LMZ_MI_INDICATOR_LENGTH ? count : VL53LMZ_MI_INDICATOR_LENGTH;
+
+    out->global_indicator_1 = vl53lmz_view_be32(src, 0);
+    out->global_indicator_2 = vl53lmz_view_be32(src, 1);
+    out->status = VL53LMZ_VIEW_BYTE(src, 8U);
+    out->nb_of_detected_aggregates = VL53LMZ_VIEW_BYTE(src, 9U);
+    out->nb_of_aggregates = VL53LMZ_VIEW_BYTE(src, 10U);
+    for (uint16_t i = 0; i < count; i++) {
+        out->motion[i] = vl53lmz_convert_motion(vl53lmz_view_be32(src, 3U + i));
+    }
+    for (uint16_t i = count; i < VL53LMZ_MI_INDICATOR_LENGTH; i++) {
+        out->motion[i] = 0;
+    }
+    return count;
+}
+
+uint16_t vl53lmz_view_copy_cnh_data(const VL53LMZ_ResultsView *p_view, uint32_t *out, uint16_t words) {
+    const uint8_t *src = p_view->block[VL53LMZ_VIEW_CNH_DATA].data;
+    words = available(p_view, VL53LMZ_VIEW_CNH_DATA, words);
+    for (uint16_t i = 0; i < words; i++) {
+        out[i] = vl53lmz_view_be32(src, i);
+    }
+    return words;
+}
+
+static int view_block_of(uint16_t idx) {
+    switch (idx) {
+        case VL53LMZ_AMBIENT_RATE_IDX:       return VL53LMZ_VIEW_AMBIENT_PER_SPAD;
+        case VL53LMZ_SPAD_COUNT_IDX:         return VL53LMZ_VIEW_NB_SPADS_ENABLED;
+        case VL53LMZ_NB_TARGET_DETECTED_IDX: return VL53LMZ_VIEW_NB_TARGET_DETECTED;
+        case VL53LMZ_SIGNAL_RATE_IDX:        return VL53LMZ_VIEW_SIGNAL_PER_SPAD;
+        case VL53LMZ_RANGE_SIGMA_MM_IDX:     return VL53LMZ_VIEW_RANGE_SIGMA_MM;
+        case VL53LMZ_DISTANCE_IDX:           return VL53LMZ_VIEW_DISTANCE_MM;
+        case VL53LMZ_REFLECTANCE_EST_PC_IDX: return VL53LMZ_VIEW_REFLECTANCE;
+        case VL53LMZ_TARGET_STATUS_IDX:      return VL53LMZ_VIEW_TARGET_STATUS;
+        case VL53LMZ_MOTION_DETEC_IDX:       return VL53LMZ_VIEW_MOTION_INDICATOR;
+        case VL53LMZ_CNH_DATA_IDX:           return VL53LMZ_VIEW_CNH_DATA;
+        default:                             return -1;
+    }
+}
+
+static uint16_t element_size(VL53LMZ_ViewBlock block) {
+    switch (block) {
+        case VL53LMZ_VIEW_AMBIENT_PER_SPAD:
+        case VL53LMZ_VIEW_NB_SPADS_ENABLED:
+        case VL53LMZ_VIEW_SIGNAL_PER_SPAD:
+        case VL53LMZ_VIEW_CNH_DATA:          return 4U;
+        case VL53LMZ_VIEW_RANGE_SIGMA_MM:
+        case VL53LMZ_VIEW_DISTANCE_MM:       return 2U;
+        case VL53LMZ_VIEW_NB_TARGET_DETECTED:
+        case VL53LMZ_VIEW_REFLECTANCE:
+        case VL53LMZ_VIEW_TARGET_STATUS:     return 1U;
+        default:                             return 0U;
+    }
+}
+
+static uint16_t available(const VL53LMZ_ResultsView *p_view, VL53LMZ_ViewBlock block, uint16_t count) {
+    const VL53LMZ_ViewSpan *span = &p_view->block[block];
+    if (span->data == NULL) {
+        return 0U;
+    }
+    uint16_t in_block = (uint16_t)(span->size / element_size(block));
+    return count < in_block ? count : in_block;
+}
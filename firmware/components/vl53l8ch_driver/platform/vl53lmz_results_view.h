@@ -0,0 +1,256 @@
+/**
+ * @file vl53lmz_results_view.h
+ * @brief Leitura dos resultados do VL53LMZ sem cópia: visão tipada sobre o temp_buffer do driver.
+ *
+ * vl53lmz_get_ranging_data() troca a ordem de bytes de todo o buffer lido,
+ * copia cada bloco para a VL53LMZ_ResultsData (~1,5 KB por sensor) e faz depois
+ * várias passagens para converter as unidades. Aqui a leitura só localiza os
+ * blocos pedidos no temp_buffer, sem trocar a ordem de bytes: cada elemento
+ * é lido direto das palavras de 32 bits big-endian do sensor e convertido
+ * (as mesmas divisões e regras do driver) no acesso, ou em uma única passagem
+ * pelas funções vl53lmz_view_copy_*(), direto para o destino do chamador.
+ *
+ * Os elementos seguem o mesmo arranjo da VL53LMZ_ResultsData: o alvo t da
+ * zona z está no índice z * VL53LMZ_NB_TARGET_PER_ZONE + t.
+ *
+ * @warning A visão aponta para p_dev->temp_buffer e só é válida até a próxima
+ * chamada ao driver para o mesmo sensor. Como o buffer fica na ordem de bytes
+ * do sensor, vl53lmz_results_extract_block() não deve ser usada após a visão.
+ */
+
+#ifndef VL53LMZ_RESULTS_VIEW_H_
+#define VL53LMZ_RESULTS_VIEW_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "vl53lmz_api.h"
+#include "vl53lmz_plugin_motion_indicator.h"
+
+/**
+ * @brief Blocos de saída que podem ser pedidos à visão.
+ */
+typedef enum {
+    VL53LMZ_VIEW_AMBIENT_PER_SPAD = 0,              /**< uint32 por zona, kcps/SPAD × 2048. */
+    VL53LMZ_VIEW_NB_SPADS_ENABLED,                  /**< uint32 por zona. */
+    VL53LMZ_VIEW_NB_TARGET_DETECTED,                /**< uint8 por zona. */
+    VL53LMZ_VIEW_SIGNAL_PER_SPAD,                   /**< uint32 por alvo, kcps/SPAD × 2048. */
+    VL53LMZ_VIEW_RANGE_SIGMA_MM,                    /**< uint16 por alvo, mm × 128. */
+    VL53LMZ_VIEW_DISTANCE_MM,                       /**< int16 por alvo, mm × 4. */
+    VL53LMZ_VIEW_REFLECTANCE,                       /**< uint8 por alvo, % × 2. */
+    VL53LMZ_VIEW_TARGET_STATUS,                     /**< uint8 por alvo. */
+    VL53LMZ_VIEW_MOTION_INDICATOR,                  /**< Bloco do detector de movimento, sem conversão. */
+    VL53LMZ_VIEW_CNH_DATA,                          /**< Bloco CNH (cnh_data_buffer_t), palavras de 32 bits; só com o bloco acrescentado à saída. */
+    VL53LMZ_VIEW_BLOCK_COUNT
+} VL53LMZ_ViewBlock;
+
+#define VL53LMZ_VIEW_MASK(block) (1UL << (block))   /**< Bit de um bloco na máscara de vl53lmz_get_ranging_view(). */
+
+/*
+ * O sensor envia palavras de 32 bits big-endian, e os elementos menores estão
+ * empacotados na ordem da palavra já trocada: o byte i do bloco trocado está
+ * na posição i ^ 3 do bloco recebido, e o elemento de 16 bits i é a metade
+ * baixa (i par) ou alta (i ímpar) da palavra i / 2 lida em big-endian.
+ */
+#define VL53LMZ_VIEW_BYTE(data, i) ((data)[(i) ^ 3U]) /**< Byte i de um bloco de elementos de 8 bits. */
+
+/** @brief Lê a palavra 'word' de um bloco, em big-endian. */
+static inline uint32_t vl53lmz_view_be32(const uint8_t *data, uint32_t word) {
+    const uint8_t *p = &data[word * 4U];
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/** @brief Lê o elemento de 16 bits i de um bloco. */
+static inline uint16_t vl53lmz_view_u16(const uint8_t *data, uint32_t i) {
+    return (uint16_t)(vl53lmz_view_be32(data, i / 2U) >> ((i & 1U) * 16U));
+}
+
+/**
+ * @brief Trecho do temp_buffer ocupado por um bloco, na ordem de bytes do sensor.
+ */
+typedef struct {
+    const uint8_t *data;                            /**< Primeiro elemento do bloco (NULL se ausente no frame ou não pedido). */
+    uint16_t size;                                  /**< Tamanho do bloco em bytes. */
+} VL53LMZ_ViewSpan;
+
+/**
+ * @brief Bloco do indicador de movimento convertido (mesmos campos de motion_indicator na VL53LMZ_ResultsData).
+ */
+typedef struct {
+    uint32_t global_indicator_1;                    /**< Indicador global 1. */
+    uint32_t global_indicator_2;                    /**< Indicador global 2. */
+    uint8_t status;                                 /**< Status do detector. */
+    uint8_t nb_of_detected_aggregates;              /**< Agregados com movimento detectado. */
+    uint8_t nb_of_aggregates;                       /**< Agregados configurados. */
+    uint32_t motion[VL53LMZ_MI_INDICATOR_LENGTH];   /**< Intensidade do movimento por agregado. */
+} VL53LMZ_ViewMotionIndicator;
+
+/**
+ * @brief Resultados de um frame como ponteiros para o temp_buffer.
+ */
+typedef struct {
+    uint8_t streamcount;                            /**< Contador de frames do sensor. */
+    int8_t silicon_temp_degc;                       /**< Temperatura interna do sensor. */
+    VL53LMZ_ViewSpan block[VL53LMZ_VIEW_BLOCK_COUNT]; /**< Blocos pedidos, indexados por VL53LMZ_ViewBlock. */
+} VL53LMZ_ResultsView;
+
+/**
+ * @brief Lê um frame do sensor e localiza os blocos pedidos, sem copiá-los.
+ * @param p_dev Sensor, com o ranging iniciado.
+ * @param blocks Máscara de VL53LMZ_VIEW_MASK() com os blocos de interesse.
+ * @param p_view Visão a ser preenchida.
+ * @return VL53LMZ_STATUS_OK, VL53LMZ_STATUS_CORRUPTED_FRAME ou erro de comunicação.
+ */
+uint8_t vl53lmz_get_ranging_view(VL53LMZ_Configuration *p_dev, uint32_t blocks,
+                                 VL53LMZ_ResultsView *p_view);
+
+/**
+ * @brief Primeira metade de vl53lmz_get_ranging_view(): lê os resultados do sensor para o temp_buffer.
+ * Separada para a instrumentação medir o barramento e a localização dos blocos à parte.
+ * @param p_dev Sensor, com o ranging iniciado.
+ * @return VL53LMZ_STATUS_OK ou erro de comunicação.
+ */
+uint8_t vl53lmz_read_ranging_results(VL53LMZ_Configuration *p_dev);
+
+/**
+ * @brief Segunda metade de vl53lmz_get_ranging_view(): localiza os blocos no temp_buffer já lido.
+ * @param p_dev Sensor cujos resultados estão no temp_buffer (vl53lmz_read_ranging_results()).
+ * @param blocks Máscara de VL53LMZ_VIEW_MASK() com os blocos de interesse.
+ * @param p_view Visão a ser preenchida.
+ * @return VL53LMZ_STATUS_OK ou VL53LMZ_STATUS_CORRUPTED_FRAME.
+ */
+uint8_t vl53lmz_parse_ranging_view(VL53LMZ_Configuration *p_dev, uint32_t blocks,
+                                   VL53LMZ_ResultsView *p_view);
+
+/** @brief Converte uma distância bruta (mm × 4) para mm; negativas saturam em 0, como no driver. */
+static inline int16_t vl53lmz_convert_distance_mm(int16_t raw) {
+#ifndef VL53LMZ_USE_RAW_FORMAT
+    raw = (int16_t)(raw / 4);
+    return raw < 0 ? 0 : raw;
+#else
+    return raw;
+#endif
+}
+
+/** @brief Converte um sigma bruto (mm × 128) para mm. */
+static inline uint16_t vl53lmz_convert_range_sigma_mm(uint16_t raw) {
+#ifndef VL53LMZ_USE_RAW_FORMAT
+    return (uint16_t)(raw / 128U);
+#else
+    return raw;
+#endif
+}
+
+/** @brief Converte um sinal ou ambiente bruto (kcps/SPAD × 2048) para kcps/SPAD. */
+static inline uint32_t vl53lmz_convert_per_spad(uint32_t raw) {
+#ifndef VL53LMZ_USE_RAW_FORMAT
+    return raw / 2048U;
+#else
+    return raw;
+#endif
+}
+
+/** @brief Converte a intensidade bruta de um agregado do indicador de movimento, como o driver. */
+static inline uint32_t vl53lmz_convert_motion(uint32_t raw) {
+#ifndef VL53LMZ_USE_RAW_FORMAT
+    return raw / 65535U;
+#else
+    return raw;
+#endif
+}
+
+/**
+ * @brief Distância de um alvo em mm (negativas saturam em 0, como no driver).
+ * @param p_view Visão com VL53LMZ_VIEW_DISTANCE_MM.
+ * @param idx Índice do alvo.
+ */
+static inline int16_t vl53lmz_view_distance_mm(const VL53LMZ_ResultsView *p_view, uint16_t idx) {
+    return vl53lmz_convert_distance_mm((int16_t)vl53lmz_view_u16(p_view->block[VL53LMZ_VIEW_DISTANCE_MM].data, idx));
+}
+
+/**
+ * @brief Sigma da distância de um alvo em mm.
+ * @param p_view Visão com VL53LMZ_VIEW_RANGE_SIGMA_MM.
+ * @param idx Índice do alvo.
+ */
+static inline uint16_t vl53lmz_view_range_sigma_mm(const VL53LMZ_ResultsView *p_view, uint16_t idx) {
+    return vl53lmz_convert_range_sigma_mm(vl53lmz_view_u16(p_view->block[VL53LMZ_VIEW_RANGE_SIGMA_MM].data, idx));
+}
+
+/**
+ * @brief Sinal de um alvo em kcps/SPAD.
+ * @param p_view Visão com VL53LMZ_VIEW_SIGNAL_PER_SPAD.
+ * @param idx Índice do alvo.
+ */
+static inline uint32_t vl53lmz_view_signal_per_spad(const VL53LMZ_ResultsView *p_view, uint16_t idx) {
+    return vl53lmz_convert_per_spad(vl53lmz_view_be32(p_view->block[VL53LMZ_VIEW_SIGNAL_PER_SPAD].data, idx));
+}
+
+/**
+ * @brief Número de alvos detectados em uma zona.
+ * @param p_view Visão com VL53LMZ_VIEW_NB_TARGET_DETECTED.
+ * @param zone Índice da zona.
+ */
+static inline uint8_t vl53lmz_view_nb_target_detected(const VL53LMZ_ResultsView *p_view, uint16_t zone) {
+    return VL53LMZ_VIEW_BYTE(p_view->block[VL53LMZ_VIEW_NB_TARGET_DETECTED].data, zone);
+}
+
+/**
+ * @brief Status de um alvo; 255 quando a zona não tem alvo detectado (se o bloco de alvos foi pedido).
+ * @param p_view Visão com VL53LMZ_VIEW_TARGET_STATUS.
+ * @param idx Índice do alvo.
+ */
+static inline uint8_t vl53lmz_view_target_status(const VL53LMZ_ResultsView *p_view, uint16_t idx) {
+#ifndef VL53LMZ_USE_RAW_FORMAT
+    const uint8_t *nb = p_view->block[VL53LMZ_VIEW_NB_TARGET_DETECTED].data;
+    if (nb != NULL && VL53LMZ_VIEW_BYTE(nb, idx / VL53LMZ_NB_TARGET_PER_ZONE) == 0U) {
+        return 255U;
+    }
+#endif
+    return VL53LMZ_VIEW_BYTE(p_view->block[VL53LMZ_VIEW_TARGET_STATUS].data, idx);
+}
+
+/**
+ * @brief Converte as distâncias em uma única passagem para o destino.
+ * @param p_view Visão lida.
+ * @param out Destino, com espaço para count elementos.
+ * @param count Número de alvos a converter.
+ * @return Elementos convertidos: count, limitado ao tamanho do bloco (em 4x4
+ * há só 16 zonas), ou 0 se o bloco não está na visão.
+ */
+uint16_t vl53lmz_view_copy_distance_mm(const VL53LMZ_ResultsView *p_view, int16_t *out, uint16_t count);
+
+/** @brief Como vl53lmz_view_copy_distance_mm(), para os sigmas. */
+uint16_t vl53lmz_view_copy_range_sigma_mm(const VL53LMZ_ResultsView *p_view, uint16_t *out, uint16_t count);
+
+/** @brief Como vl53lmz_view_copy_distance_mm(), para os sinais por SPAD. */
+uint16_t vl53lmz_view_copy_signal_per_spad(const VL53LMZ_ResultsView *p_view, uint32_t *out, uint16_t count);
+
+/** @brief Como vl53lmz_view_copy_distance_mm(), para os status (255 nas zonas sem alvo). */
+uint16_t vl53lmz_view_copy_target_status(const VL53LMZ_ResultsView *p_view, uint8_t *out, uint16_t count);
+
+/** @brief Como vl53lmz_view_copy_distance_mm(), para o número de alvos; count é em zonas. */
+uint16_t vl53lmz_view_copy_nb_target_detected(const VL53LMZ_ResultsView *p_view, uint8_t *out, uint16_t count);
+
+/**
+ * @brief Converte o bloco do indicador de movimento.
+ * @param p_view Visão com VL53LMZ_VIEW_MOTION_INDICATOR.
+ * @param out Destino.
+ * @return Agregados convertidos em out->motion, ou 0 se o bloco não está na
+ * visão (out fica inalterado).
+ */
+uint16_t vl53lmz_view_copy_motion_indicator(const VL53LMZ_ResultsView *p_view, VL53LMZ_ViewMotionIndicator *out);
+
+/**
+ * @brief Copia o bloco CNH na ordem de bytes do host, o mesmo conteúdo que
+ * vl53lmz_results_extract_block() entrega após vl53lmz_get_ranging_data().
+ * @param p_view Visão com VL53LMZ_VIEW_CNH_DATA.
+ * @param out Destino, com espaço para words palavras, lido depois com
+ * vl53lmz_cnh_get_block_addresses().
+ * @param words Palavras a copiar (o tamanho programado, ver
+ * vl53lmz_cnh_calc_required_memory()).
+ * @return Palavras copiadas, limitadas ao tamanho do bloco, ou 0 se o bloco não está na visão.
+ */
+uint16_t vl53lmz_view_copy_cnh_data(const VL53LMZ_ResultsView *p_view, uint32_t *out, uint16_t words);
+
+#endif /* VL53LMZ_RESULTS_VIEW_H_ */
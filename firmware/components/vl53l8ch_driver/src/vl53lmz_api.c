@@ -21,12 +21,47 @@
 
 static uint32_t g_output_config[NUM_OUTPUT_CONFIG_WORDS];
 
+/* Polling interval and post-reboot settle time; the platform may shorten
+ * them (platform.h) to reduce the boot time. */
+#ifndef VL53LMZ_POLL_INTERVAL_MS
+#define VL53LMZ_POLL_INTERVAL_MS	10U
+#endif
+#ifndef VL53LMZ_BOOT_SETTLE_MS
+#define VL53LMZ_BOOT_SETTLE_MS		100U
+#endif
+
 
 static uint32_t g_output_bh_enable[NUM_OUTPUT_ENABLE_WORDS] = {
 		0x00000007U,
 		0x00000000U,
 		0x00000000U,
 		0xC0000000U };
+/**
+ * @brief Inner function, not available outside this file. This function is used
+ * to copy a results block out of temp_buffer, swapping each 32-bit word from
+ * the sensor byte order on the way (single read and write per word).
+ */
+
+static void _vl53lmz_swap_copy(
+		uint8_t					*p_dst,
+		const uint8_t			*p_src,
+		uint32_t				size)
+{
+	uint32_t i, word;
+
+	for (i = 0; (i + (uint32_t)4) <= size; i += (uint32_t)4)
+	{
+		(void)memcpy(&word, &p_src[i], 4);
+#if defined(__GNUC__)
+		word = __builtin_bswap32(word);
+#else
+		word = (word >> 24) | ((word >> 8) & 0x0000FF00U)
+			| ((word << 8) & 0x00FF0000U) | (word << 24);
+#endif
+		(void)memcpy(&p_dst[i], &word, 4);
+	}
+}
+
 /**
  * @brief Inner function, not available outside this file. This function is used
  * to wait for an answer from VL53L5CX sensor.
@@ -41,25 +76,30 @@ static uint8_t _vl53lmz_poll_for_answer(
 		uint8_t					expected_value)
 {
 	uint8_t status = VL53LMZ_STATUS_OK;
-	uint8_t timeout = 0;
+	uint16_t timeout = 0;
 
 	do {
 		status |= RdMulti(&(p_dev->platform), address,
 				p_dev->temp_buffer, size);
-		status |= WaitMs(&(p_dev->platform), 10);
 
-		if(timeout >= (uint8_t)200)	/* 2s timeout */
-		{
-			status |= (uint8_t)VL53LMZ_STATUS_TIMEOUT_ERROR;
-			break;
-		}else if((size >= (uint8_t)4)	
+		if((size >= (uint8_t)4)
 				&& (p_dev->temp_buffer[2] >= (uint8_t)0x7f))
 		{
 			status |= VL53LMZ_MCU_ERROR;
 			break;
 		}
+		else if((p_dev->temp_buffer[pos] & mask) == expected_value)
+		{
+			break;	/* No wait once the answer is there */
+		}
+		else if(timeout >= (uint16_t)(2000U / VL53LMZ_POLL_INTERVAL_MS))	/* 2s timeout */
+		{
+			status |= (uint8_t)VL53LMZ_STATUS_TIMEOUT_ERROR;
+			break;
+		}
 		else
 		{
+			status |= WaitMs(&(p_dev->platform), VL53LMZ_POLL_INTERVAL_MS);
 			timeout++;
 		}
 	}while ((p_dev->temp_buffer[pos] & mask) != expected_value);
@@ -296,7 +336,7 @@ uint8_t vl53lmz_init(
 
 	status |= WrByte(&(p_dev->platform), 0x000F, 0x40);
 	status |= WrByte(&(p_dev->platform), 0x000A, 0x01);
-	status |= WaitMs(&(p_dev->platform), 100);
+	status |= WaitMs(&(p_dev->platform), VL53LMZ_BOOT_SETTLE_MS);
 
 	/* Wait for sensor booted (several ms required to get sensor ready ) */
 	status |= WrByte(&(p_dev->platform), 0x7fff, 0x00);
@@ -655,14 +695,27 @@ uint8_t vl53lmz_get_ranging_data(
 	union Block_header *bh_ptr;
 	uint16_t header_id, footer_id;
 	uint32_t i, msize;
+	uint8_t *p_dst;
 	status |= RdMulti(&(p_dev->platform), 0x0,
 			p_dev->temp_buffer, p_dev->data_read_size);
 	p_dev->streamcount = p_dev->temp_buffer[0];
-	SwapBuffer(p_dev->temp_buffer, (uint16_t)p_dev->data_read_size);
 
-	/* Start conversion at position 16 to avoid headers */
-	for (i = (uint32_t)16; i < (uint32_t)p_dev->data_read_size; i+=(uint32_t)4)
+	/* Header and footer ids, read in sensor byte order before the walk */
+	header_id = ((uint16_t)(p_dev->temp_buffer[0xB])<<8) & 0xFF00U;
+	header_id |= ((uint16_t)(p_dev->temp_buffer[0xA])) & 0x00FFU;
+
+	footer_id = ((uint16_t)(p_dev->temp_buffer[p_dev->data_read_size
+		- (uint32_t)1]) << 8) & 0xFF00U;
+	footer_id |= ((uint16_t)(p_dev->temp_buffer[p_dev->data_read_size
+		- (uint32_t)2])) & 0xFFU;
+
+	/* Single pass, starting at position 16 to avoid headers: each block
+	 * header is swapped in place, decoded blocks are swapped while being
+	 * copied into p_results, and the remaining blocks are swapped in place
+	 * so that vl53lmz_results_extract_block() can still read them. */
+	for (i = (uint32_t)16; (i + (uint32_t)4) <= (uint32_t)p_dev->data_read_size; i+=(uint32_t)4)
 	{
+		SwapBuffer(&(p_dev->temp_buffer[i]), 4);
 		bh_ptr = (union Block_header *)&(p_dev->temp_buffer[i]);
 		if ((bh_ptr->type > (uint32_t)0x1) 
 					&& (bh_ptr->type < (uint32_t)0xd))
@@ -673,70 +726,75 @@ uint8_t vl53lmz_get_ranging_data(
 		{
 			msize = bh_ptr->size;
 		}
+		if ((i + (uint32_t)4 + msize) > (uint32_t)p_dev->data_read_size)
+		{
+			break;
+		}
 
 		switch(bh_ptr->idx){
-			case VL53LMZ_METADATA_IDX:
-				p_results->silicon_temp_degc =
-						(int8_t)p_dev->temp_buffer[i + (uint32_t)12];
-				break;
-
 #ifndef VL53LMZ_DISABLE_AMBIENT_PER_SPAD
 			case VL53LMZ_AMBIENT_RATE_IDX:
-				(void)memcpy(p_results->ambient_per_spad,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				p_dst = (uint8_t *)p_results->ambient_per_spad;
 				break;
 #endif
 #ifndef VL53LMZ_DISABLE_NB_SPADS_ENABLED
 			case VL53LMZ_SPAD_COUNT_IDX:
-				(void)memcpy(p_results->nb_spads_enabled,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				p_dst = (uint8_t *)p_results->nb_spads_enabled;
 				break;
 #endif
 #ifndef VL53LMZ_DISABLE_NB_TARGET_DETECTED
 			case VL53LMZ_NB_TARGET_DETECTED_IDX:
-				(void)memcpy(p_results->nb_target_detected,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				p_dst = (uint8_t *)p_results->nb_target_detected;
 				break;
 #endif
 #ifndef VL53LMZ_DISABLE_SIGNAL_PER_SPAD
 			case VL53LMZ_SIGNAL_RATE_IDX:
-				(void)memcpy(p_results->signal_per_spad,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				p_dst = (uint8_t *)p_results->signal_per_spad;
 				break;
 #endif
 #ifndef VL53LMZ_DISABLE_RANGE_SIGMA_MM
 			case VL53LMZ_RANGE_SIGMA_MM_IDX:
-				(void)memcpy(p_results->range_sigma_mm,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				p_dst = (uint8_t *)p_results->range_sigma_mm;
 				break;
 #endif
 #ifndef VL53LMZ_DISABLE_DISTANCE_MM
 			case VL53LMZ_DISTANCE_IDX:
-				(void)memcpy(p_results->distance_mm,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				p_dst = (uint8_t *)p_results->distance_mm;
 				break;
 #endif
 #ifndef VL53LMZ_DISABLE_REFLECTANCE_PERCENT
 			case VL53LMZ_REFLECTANCE_EST_PC_IDX:
-				(void)memcpy(p_results->reflectance,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				p_dst = (uint8_t *)p_results->reflectance;
 				break;
 #endif
 #ifndef VL53LMZ_DISABLE_TARGET_STATUS
 			case VL53LMZ_TARGET_STATUS_IDX:
-				(void)memcpy(p_results->target_status,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				p_dst = (uint8_t *)p_results->target_status;
 				break;
 #endif
 #ifndef VL53LMZ_DISABLE_MOTION_INDICATOR
 			case VL53LMZ_MOTION_DETEC_IDX:
-				(void)memcpy(&p_results->motion_indicator,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				p_dst = (uint8_t *)&p_results->motion_indicator;
 				break;
 #endif
 			default:
+				p_dst = NULL;
 				break;
 		}
+
+		if (p_dst != NULL)
+		{
+			_vl53lmz_swap_copy(p_dst, &(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+		}
+		else
+		{
+			SwapBuffer(&(p_dev->temp_buffer[i + (uint32_t)4]), (uint16_t)msize);
+			if (bh_ptr->idx == VL53LMZ_METADATA_IDX)
+			{
+				p_results->silicon_temp_degc =
+						(int8_t)p_dev->temp_buffer[i + (uint32_t)12];
+			}
+		}
 		i += msize;
 	}
 
@@ -800,14 +858,6 @@ uint8_t vl53lmz_get_ranging_data(
 
 	/* Check if footer id and header id are matching. This allows to detect
 	 * corrupted frames */
-	header_id = ((uint16_t)(p_dev->temp_buffer[0x8])<<8) & 0xFF00U;
-	header_id |= ((uint16_t)(p_dev->temp_buffer[0x9])) & 0x00FFU;
-
-	footer_id = ((uint16_t)(p_dev->temp_buffer[p_dev->data_read_size
-		- (uint32_t)4]) << 8) & 0xFF00U;
-	footer_id |= ((uint16_t)(p_dev->temp_buffer[p_dev->data_read_size
-		- (uint32_t)3])) & 0xFFU;
-
 	if(header_id != footer_id)
 	{
 		status |= VL53LMZ_STATUS_CORRUPTED_FRAME;
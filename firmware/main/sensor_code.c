@@ -12,8 +12,13 @@
 #include "sensor_code.h"
 
 // Bibliotecas padrão de C
+#include <stdatomic.h>
+#include <dirent.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
 
@@ -27,166 +32,3081 @@
 #include "driver/sdmmc_host.h"   // Driver do host SDMMC
 #include "sdmmc_cmd.h"           // Comandos e utilitários SDMMC
 #include "driver/gpio.h"         // Driver de GPIO para configuração de pinos
+#include "driver/spi_master.h"   // Barramento SPI compartilhado (ToF + CAN)
 #include "esp_timer.h"           // Acesso ao timer de alta resolução do sistema
+#include "esp_rom_sys.h"         // Espera ativa curta (pulso de sincronismo)
+#include "esp_attr.h"            // DMA_ATTR
+#include "esp_heap_caps.h"       // Memória livre por capacidade (relatório de RAM)
+#include "driver/uart.h"         // Driver da UART (buffer de transmissão por interrupção)
+#include "driver/uart_vfs.h"     // Redireciona o console para o driver da UART
+#include "esp_pm.h"              // Light sleep automático no modo de eventos
+#include "esp_sleep.h"           // Despertar do light sleep pelo pino INT
+#include "nvs_flash.h"           // Partição NVS do cache de calibração
+#include "nvs.h"                 // Leitura e gravação do registro de calibração
+
+// Componentes comuns ao firmware e ao simulador
+#include "vl53lmz_api.h"         // Driver ULD da ST
+#include "vl53lmz_results_view.h" // Leitura dos resultados sem cópia
+#include "vl53lmz_plugin_detection_thresholds.h" // Limiares de detecção do modo de eventos
+#include "vl53lmz_plugin_motion_indicator.h" // Indicador de movimento do modo de movimento
+#include "vl53lmz_plugin_cnh.h"  // Histogramas CNH do modo CNH
+#include "vl53lmz_plugin_xtalk.h" // Calibração de crosstalk
+
+#include "tof_frame.h"
+#include "tof_frame_ring.h"
+#include "tof_frame_pub.h"
+#include "tof_log_writer.h"
+#include "tof_log_index.h"
+#include "tof_csv.h"
+#include "tof_bin.h"
+#include "tof_stream.h"
+#include "tof_crc.h"
+#include "tof_cal.h"
+#include "tof_frame_stats.h"
+#include "tof_filter.h"
+#include "tof_motion.h"
+#include "tof_cnh.h"
+#include "tof_latency.h"
+#include "tof_rate.h"
+#include "tof_roi.h"
+#include "tof_obstacle.h"
+#include "tof_time.h"
 
 //Variaveis Globais
 
 static const char *TAG = "TOF_TASK";                /**< Tag utilizada para as mensagens de log deste módulo. */
 #define SD_CARD_MOUNT_POINT "/sdcard"               /**< Ponto de montagem no VFS (Virtual File System) para o cartão SD. */
+#define SD_CARD_BUS_WIDTH 1                         /**< Linhas de dados do slot SDMMC 1 (1 = só D0; no modo 4 bits D1 seria o GPIO 4, o INT do sensor 0). */
+#define SD_CARD_MAX_FILES 4                         /**< Arquivos abertos ao mesmo tempo no FAT (log, índice, CNH e a recuperação no boot). */
 #define SENSOR_POLLING_RATE_MS 200                  /**< Frequência de leitura do sensor em milissegundos (200ms = 5 Hz). */
-#define SENSOR_DATA_BUFFER_SIZE 64                  /**< Tamanho do buffer para os dados do sensor (8x8 zonas). */
+#define SENSOR_RESOLUTION (SENSOR_ROI_MODE ? VL53LMZ_RESOLUTION_4X4 : VL53LMZ_RESOLUTION_8X8) /**< Resolução programada no sensor na partida (8x8 zonas; 4x4 no modo de ROI). */
+#define SENSOR_SPI_HOST SPI3_HOST                   /**< Barramento SPI do sensor, compartilhado com os controladores CAN. */
+#define SENSOR_SPI_MOSI_GPIO 23                     /**< Pino MOSI do barramento. */
+#define SENSOR_SPI_MISO_GPIO 19                     /**< Pino MISO do barramento. */
+#define SENSOR_SPI_SCLK_GPIO 18                     /**< Pino SCLK do barramento. */
+#define SENSOR_SPI_CLOCK_HZ (3 * 1000 * 1000)       /**< Clock SPI do sensor (máx. 3 MHz no VL53L8), próprio do dispositivo e independente do clock dos CAN. */
+#define SENSOR_SPI_INPUT_DELAY_NS 50                /**< Atraso do MISO do sensor até o ESP32 (datasheet + trilhas), usado pelo driver para amostrar no clock máximo. */
+
+#define SENSOR_ACQ_MODE_POLLING 0                   /**< Aquisição por polling periódico (SENSOR_POLLING_RATE_MS). */
+#define SENSOR_ACQ_MODE_INTERRUPT 1                 /**< Aquisição bloqueada na interrupção do pino INT do sensor. */
+#define SENSOR_ACQ_MODE SENSOR_ACQ_MODE_INTERRUPT   /**< Modo de aquisição selecionado. */
+#define SENSOR_COUNT 1                              /**< Sensores VL53L8CH no barramento, cada um com CS e INT próprios (ver s_sensor_pins). */
+#define SENSOR_SYNC_GPIO -1                         /**< Pino ligado ao SYNC de todos os sensores; -1 = sem sincronismo por hardware (partidas escalonadas). */
+#define SENSOR_SYNC_PULSE_US 10                     /**< Largura do pulso de sincronismo (nível alto). */
+#define SENSOR_INT_TIMEOUT_MS 1000                  /**< Tempo máximo de espera por uma interrupção antes de avisar no log. */
+#define SENSOR_RANGING_FREQUENCY_HZ (SENSOR_EVENT_MODE ? SENSOR_EVENT_RANGING_FREQUENCY_HZ : \
+    SENSOR_ROI_MODE ? SENSOR_ROI_WATCH_HZ : (SENSOR_RATE_MODE ? SENSOR_RATE_MAX_HZ : 15)) /**< Frequência de ranging programada no sensor na partida (máx. 15 Hz em 8x8, 60 Hz em 4x4). */
+#define SENSOR_STATS_INTERVAL_MS 5000               /**< Intervalo entre os relatórios de taxa de aquisição no log. */
+#define SENSOR_SD_RING_CAPACITY (SENSOR_COUNT > 1 ? 64 : 32) /**< Frames na fila do SD (potência de 2; ~2 s a 15 Hz por sensor, com até 2 sensores, de folga para picos de latência FAT). */
+#define SENSOR_UART_RING_CAPACITY (SENSOR_COUNT > 1 ? 16 : 8) /**< Frames na fila da UART (potência de 2). */
+#define SENSOR_PUB_MAX_READERS 2                    /**< Leitores simultâneos do último frame de cada sensor (tof_sensor_acquire_latest()). */
+#define SENSOR_PUB_SLOTS (SENSOR_PUB_MAX_READERS + 2) /**< Slots da publicação de cada sensor (ver tof_frame_pub.h). */
+#define SENSOR_PUB_MAX_SUBSCRIBERS 4                /**< Tarefas registradas por tof_sensor_subscribe(). */
+#define SD_LOG_FORMAT_CSV 0                         /**< Log em CSV: uma linha por zona válida. */
+#define SD_LOG_FORMAT_TOFB 1                        /**< Log no formato binário compacto .tofb (ver tof_bin.h). */
+#define SD_LOG_FORMAT SD_LOG_FORMAT_CSV             /**< Formato do log gravado no cartão SD. */
+#define SD_LOG_DELTA_KEYFRAME_INTERVAL 32           /**< No .tofb, frames de cada sensor entre keyframes do modo delta (~2 s a 15 Hz; 0 = todos os frames completos). */
+#define SD_LOG_DELTA_THRESHOLD_MM 20                /**< No modo delta, variação de distância a partir da qual uma zona é regravada. */
+#define SD_WRITE_BUFFER_SIZE (16 * 1024)            /**< Buffer de escrita do SD (múltiplo do setor de 512 bytes). */
+#define SD_FLUSH_THRESHOLD_BYTES (8 * 1024)         /**< Descarrega o buffer no arquivo ao atingir este tamanho. */
+#define SD_FLUSH_INTERVAL_MS 1000                   /**< Idade máxima dos dados no buffer antes da descarga. */
+#define SD_FSYNC_INTERVAL_MS 5000                   /**< Cadência de fsync (atualização da FAT e do diretório). */
+#define SD_WRITER_POLL_MS 100                       /**< Período máximo de espera da tarefa do SD entre verificações dos limites de tempo. */
+#define SD_REOPEN_INTERVAL_MS 5000                  /**< Intervalo entre tentativas de reabrir o arquivo após uma falha. */
+#define SD_LOG_ROTATE_BYTES (64u * 1024 * 1024)     /**< Tamanho a partir do qual o log passa para o próximo arquivo numerado (0 = sem limite). */
+#define SD_LOG_ROTATE_INTERVAL_S 3600               /**< Duração máxima de um arquivo de log antes da rotação (0 = sem limite). */
+#define SD_LOG_PREALLOCATE 1                        /**< Reserva SD_LOG_ROTATE_BYTES em clusters contíguos ao criar cada arquivo. */
+#define SD_LOG_PREFIX "tof_"                        /**< Prefixo dos arquivos numerados (tof_NNNN.csv/.tofb e tof_NNNN.idx). */
+#define SD_LOG_MAX_NUMBER 9999                      /**< Maior número de arquivo; depois dele a numeração volta a 1 e reescreve os mais antigos. */
+#define SD_LOG_PATH_LEN 32                          /**< Tamanho do caminho de um arquivo numerado. */
+#define UART_STREAM_PORT UART_NUM_0                 /**< UART usada na saída dos frames (a mesma do console). */
+#define UART_STREAM_TX_BUFFER_SIZE 4096             /**< Buffer de transmissão do driver (~19 pacotes de 8x8). */
+#define UART_STREAM_RX_BUFFER_SIZE 256              /**< Buffer de recepção dos comandos de troca de modo. */
+#define UART_OUTPUT_DEFAULT_MODE TOF_UART_OUTPUT_STREAM /**< Modo de saída da UART na partida. */
+#define UART_CMD_STREAM 'b'                         /**< Byte recebido na UART que seleciona o streaming binário. */
+#define UART_CMD_HEX 'h'                            /**< Byte recebido na UART que seleciona o dump hexadecimal. */
+#define SENSOR_FRAME_LATE_MS 250                    /**< Idade máxima de um frame ao ser consumido antes de contar como atrasado. */
+#define SENSOR_LATENCY_STATS 1                      /**< 1 = mede cada etapa do caminho de um frame em ciclos e reporta p50/p99/máx a cada SENSOR_STATS_INTERVAL_MS (ver tof_latency.h). */
+#define SENSOR_FILTER_MODE TOF_FILTER_MEDIAN        /**< Filtro temporal das distâncias entre a aquisição e os consumidores (TOF_FILTER_NONE desliga; ver tof_filter.h). */
+#define SENSOR_RATE_MODE 0                          /**< 1 = ajusta a frequência e a integração de cada sensor pela atividade da cena e pela ocupação das filas, com o sensor em sleep entre rajadas na cena parada (ver tof_rate.h). */
+#define SENSOR_RATE_MIN_HZ 2                        /**< Frequência do controle adaptativo com a cena parada. */
+#define SENSOR_RATE_MAX_HZ (SENSOR_RESOLUTION == VL53LMZ_RESOLUTION_8X8 ? 15 : 30) /**< Frequência do controle adaptativo com atividade (máx. 15 Hz em 8x8, 60 Hz em 4x4). */
+#define SENSOR_RATE_SLEEP_MS 1000                   /**< Sono do sensor entre as rajadas na cena parada (0 = nunca dorme). */
+#define SENSOR_ROI_MODE 0                           /**< 1 = observa a cena em 4x4 e passa a 8x8 enquanto houver um alvo na ROI de TOF_ROI_CONFIG_DEFAULT (ver tof_roi.h). */
+#define SENSOR_ROI_WATCH_HZ 60                      /**< Frequência em 4x4 no modo de ROI (máx. 60 Hz). */
+#define SENSOR_ROI_DETAIL_HZ 15                     /**< Frequência em 8x8 no modo de ROI (máx. 15 Hz). */
+#define SENSOR_ROI_CROP 0                           /**< 1 = em 8x8 só as zonas da ROI seguem para o SD e a UART. */
+#define SENSOR_OBSTACLE_MODE 0                      /**< 1 = calcula a distância mais próxima por setor e o alvo mais próximo de cada frame e os envia no CAN (ver tof_obstacle.h e tof_set_can_transmit()). */
+#define SENSOR_OBSTACLE_DEADLINE_MS 20              /**< Latência máxima do carimbo do frame ao fim do envio no CAN antes de contar como atrasado. */
+#define SENSOR_OBSTACLE_NOTIFY_BIT (1u << 0)        /**< Bit da notificação da tarefa do CAN a cada frame publicado. */
+#define SENSOR_EVENT_MODE 0                         /**< 1 = o sensor só gera INT quando uma zona dispara os limiares de s_event_windows, e o ESP32 dorme entre os eventos. */
+#define SENSOR_EVENT_RANGING_FREQUENCY_HZ 5         /**< Frequência de ranging no modo de eventos (modo autônomo; substitui SENSOR_RANGING_FREQUENCY_HZ). */
+#define SENSOR_EVENT_INTEGRATION_MS 10              /**< Tempo de integração por medição no modo de eventos (o sensor fica ocioso no resto do período). */
+#define SENSOR_EVENT_POLL_MS SENSOR_STATS_INTERVAL_MS /**< Espera máxima por um evento antes de consultar os sensores (recupera um pulso de INT perdido). */
+#define SENSOR_EVENT_ALL_ZONES (-1)                 /**< Zona de uma regra de s_event_windows que vale para todas as zonas. */
+#define SENSOR_MOTION_MODE 0                        /**< 1 = configura o indicador de movimento e só repassa as distâncias dos frames com movimento (ver tof_motion.h). */
+#define SENSOR_MOTION_DISTANCE_MIN_MM 400           /**< Início da faixa de distâncias observada pelo indicador de movimento (mínimo 400 mm). */
+#define SENSOR_MOTION_DISTANCE_MAX_MM 1500          /**< Fim da faixa (até 4000 mm e no máximo 1500 mm além do início). */
+
+#define SENSOR_CNH_MODE 0                           /**< 1 = lê os histogramas CNH de cada frame e os grava ou envia comprimidos (ver tof_cnh.h). */
+#define SENSOR_CNH_START_BIN 0                      /**< Primeiro bin do histograma do sensor coberto pelo CNH. */
+#define SENSOR_CNH_NUM_BINS 24                      /**< Bins CNH por agregado. */
+#define SENSOR_CNH_SUB_SAMPLE 4                     /**< Bins do histograma do sensor somados em cada bin CNH. */
+#define SENSOR_CNH_AGG_MERGE 2                      /**< Zonas por lado de cada agregado (2 = 16 agregados de 2x2 zonas em 8x8). */
+#define SENSOR_CNH_AGG_SIDE ((SENSOR_RESOLUTION == VL53LMZ_RESOLUTION_8X8 ? 8 : 4) / SENSOR_CNH_AGG_MERGE) /**< Agregados por lado do mapa. */
+#define SENSOR_CNH_AGGREGATES (SENSOR_CNH_AGG_SIDE * SENSOR_CNH_AGG_SIDE) /**< Agregados por frame. */
+#define SENSOR_CNH_OUTPUT_SD 0                      /**< Pacotes CNH gravados em SD_CNH_LOG_PATH pela tarefa do SD. */
+#define SENSOR_CNH_OUTPUT_UART 1                    /**< Pacotes CNH enviados no streaming da UART, intercalados com os frames. */
+#define SENSOR_CNH_OUTPUT SENSOR_CNH_OUTPUT_SD      /**< Destino dos pacotes CNH. */
+#define SENSOR_CNH_PACKET_SIZE TOF_CNH_PACKET_BOUND(SENSOR_CNH_AGGREGATES, SENSOR_CNH_NUM_BINS) /**< Pior caso de um pacote CNH antes do COBS. */
+#define SD_CNH_LOG_PATH SD_CARD_MOUNT_POINT "/tof_cnh.tofs" /**< Arquivo dos pacotes CNH (mesmo enquadramento do streaming da UART). */
+#define SD_CNH_WRITE_BUFFER_SIZE (16 * 1024)        /**< Buffer de escrita do arquivo CNH (~10 frames de 16 agregados x 24 bins). */
+
+#define SENSOR_CAL_CACHE 1                          /**< 1 = carrega o xtalk de cada sensor da NVS no boot em vez do xtalk padrão do driver. */
+#define SENSOR_CAL_RECALIBRATE 0                    /**< 1 = calibra o xtalk quando o cache falta ou é de outro módulo (exige o alvo de referência diante do sensor). */
+#define SENSOR_CAL_XTALK_REFLECTANCE_PCT 3          /**< Refletância do alvo de referência da calibração, em % (1 a 99). */
+#define SENSOR_CAL_XTALK_SAMPLES 4                  /**< Medições somadas na calibração (1 a 16). */
+#define SENSOR_CAL_XTALK_DISTANCE_MM 600            /**< Distância do alvo de referência (600 a 3000 mm). */
+#define SENSOR_CAL_NVS_NAMESPACE "tof_cal"          /**< Namespace NVS dos registros de calibração. */
+
+#if SENSOR_MOTION_MODE && defined(VL53LMZ_DISABLE_MOTION_INDICATOR)
+#error "SENSOR_MOTION_MODE exige o perfil de saída Movimento ou Completo (menuconfig)"
+#endif
+#if SENSOR_CNH_MODE && !defined(CONFIG_VL53LMZ_EXTRA_RESULTS_BUFFER)
+#error "SENSOR_CNH_MODE exige VL53LMZ_EXTRA_RESULTS_BUFFER (menuconfig): o bloco CNH precisa caber no buffer temporário"
+#endif
+#if SENSOR_CNH_MODE && SENSOR_MOTION_MODE
+#error "SENSOR_CNH_MODE e SENSOR_MOTION_MODE programam a mesma configuração do indicador de movimento"
+#endif
+#if SENSOR_RATE_MODE && SENSOR_EVENT_MODE
+#error "SENSOR_RATE_MODE depende de um frame por período, e o modo de eventos só gera INT nos disparos"
+#endif
+#if SENSOR_RATE_MODE && SENSOR_SYNC_GPIO >= 0
+#error "SENSOR_RATE_MODE muda a frequência de cada sensor; com SENSOR_SYNC_GPIO ela é a do timer de sincronismo"
+#endif
+#if SENSOR_ROI_MODE && (SENSOR_EVENT_MODE || SENSOR_MOTION_MODE || SENSOR_CNH_MODE)
+#error "SENSOR_ROI_MODE troca a resolução, e os limiares de eventos e os agregados de movimento e CNH são programados para uma só"
+#endif
+#if SENSOR_ROI_MODE && (SENSOR_RATE_MODE || SENSOR_SYNC_GPIO >= 0)
+#error "SENSOR_ROI_MODE escolhe a frequência de cada resolução, o que não combina com SENSOR_RATE_MODE nem com SENSOR_SYNC_GPIO"
+#endif
+
+/**
+ * @brief Consumidor do pipeline: uma fila SPSC dedicada e a tarefa que a esvazia.
+ */
+typedef struct {
+    const char* name;                               /**< Nome do consumidor, usado no log. */
+    tof_frame_ring_t ring;                          /**< Fila alimentada pela tarefa de aquisição. */
+    TaskHandle_t task;                              /**< Tarefa consumidora, notificada a cada frame publicado. */
+    _Atomic uint32_t late;                          /**< Frames consumidos após SENSOR_FRAME_LATE_MS. */
+} tof_consumer_t;
+
+/**
+ * @brief Tarefa registrada por tof_sensor_subscribe(), notificada a cada frame publicado.
+ */
+typedef struct {
+    _Atomic(TaskHandle_t) task;                     /**< Tarefa notificada (NULL = entrada livre). */
+    uint32_t notify_bits;                           /**< Bits ligados na notificação da tarefa (eSetBits). */
+} tof_subscriber_t;
+
+/**
+ * @brief Pinos próprios de um sensor; o barramento (SENSOR_SPI_*_GPIO) é comum a todos.
+ */
+typedef struct {
+    int cs_gpio;                                    /**< Chip select do sensor. */
+    gpio_num_t int_gpio;                            /**< Saída INT do sensor (ativa em nível baixo). */
+} tof_sensor_pins_t;
+
+/**
+ * @brief Um sensor do conjunto: estado do driver e contadores da aquisição.
+ */
+typedef struct {
+    uint8_t id;                                     /**< sensor_id dos frames deste sensor (índice em s_sensors). */
+    const tof_sensor_pins_t* pins;                  /**< Pinos do sensor (s_sensor_pins[id]). */
+    VL53LMZ_Configuration dev;                      /**< Estado do driver ULD (inclui o buffer temporário de leitura). */
+    uint32_t sequence;                              /**< Frames publicados por este sensor. */
+    uint32_t frames_read;                           /**< Frames lidos desde o último relatório. */
+    uint32_t empty_wakeups;                         /**< Despertares sem frame pendente desde o último relatório. */
+    tof_frame_stats_t last_stats;                   /**< Estatísticas do primeiro alvo do último frame lido. */
+    tof_filter_t filter;                            /**< Filtro temporal das distâncias deste sensor. */
+    uint32_t filter_max_us;                         /**< Maior tempo do filtro em um frame desde o último relatório. */
+    tof_motion_t motion;                            /**< Estado do modo de movimento deste sensor. */
+    uint8_t frequency_hz;                           /**< Frequência de ranging programada. */
+    uint8_t resolution;                             /**< Resolução programada (VL53LMZ_RESOLUTION_*, igual ao número de zonas). */
+#if SENSOR_ROI_MODE
+    tof_roi_t roi;                                  /**< Troca de resolução pela ROI deste sensor. */
+#endif
+#if SENSOR_RATE_MODE
+    tof_rate_t rate;                                /**< Controle adaptativo da frequência deste sensor. */
+    int64_t wake_at_us;                             /**< Fim do sono entre rajadas (vale com o bit do sensor em s_rate_sleeping). */
+#endif
+} tof_sensor_t;
+
+/**
+ * @brief Bloco CNH de um frame, copiado do buffer temporário do driver para o consumidor.
+ *
+ * Os dois slots formam um ping-pong entre a tarefa de aquisição, que preenche
+ * o slot livre logo após a leitura SPI, e o consumidor do destino CNH, que o
+ * comprime e o devolve: a leitura do frame seguinte nunca espera pela
+ * compressão nem pela escrita.
+ */
+typedef struct {
+    cnh_data_buffer_t words;                        /**< Bloco CNH na ordem de bytes do ESP32 (só as s_cnh_words primeiras palavras). */
+    int64_t timestamp_us;                           /**< Instante da leitura. */
+    uint32_t sequence;                              /**< Sequência do frame do mesmo sensor. */
+    uint8_t sensor_id;                              /**< Sensor de origem. */
+    _Atomic bool ready;                             /**< true = preenchido pela aquisição e ainda não comprimido. */
+} sensor_cnh_slot_t;
+
+/**
+ * @brief Contadores do consumidor CNH desde o último relatório.
+ */
+typedef struct {
+    uint32_t frames;                                /**< Pacotes entregues ao destino. */
+    uint32_t output_errors;                         /**< Pacotes perdidos no destino (escritor sem espaço ou fechado). */
+    uint64_t raw_bytes;                             /**< Bytes dos blocos CNH comprimidos. */
+    uint64_t packet_bytes;                          /**< Bytes dos pacotes entregues (após COBS). */
+    uint32_t max_encode_us;                         /**< Maior tempo de compressão de um frame. */
+} sensor_cnh_stats_t;
+
+/**
+ * @brief Contadores da tarefa de obstáculos no CAN desde o último relatório.
+ */
+typedef struct {
+    uint32_t frames;                                /**< Frames ToF processados. */
+    uint32_t skipped;                               /**< Frames publicados que a tarefa não chegou a ler (só o mais recente interessa). */
+    uint32_t can_frames;                            /**< Frames CAN aceitos pela função de envio. */
+    uint32_t tx_errors;                             /**< Frames CAN recusados pela função de envio. */
+    uint32_t unsent;                                /**< Frames CAN descartados sem função de envio registrada. */
+    uint64_t raw_bytes;                             /**< Bytes que as zonas cruas dos mesmos frames ocupariam (distância e status). */
+    uint32_t late;                                  /**< Frames ToF entregues ao CAN após SENSOR_OBSTACLE_DEADLINE_MS. */
+    uint32_t max_latency_us;                        /**< Maior latência do carimbo do frame ao fim do envio. */
+} sensor_can_stats_t;
+
+/**
+ * @brief Contexto de read_cal_blob(): namespace de calibração aberto e último erro da NVS.
+ */
+typedef struct {
+    nvs_handle_t handle;                            /**< Namespace SENSOR_CAL_NVS_NAMESPACE aberto. */
+    esp_err_t err;                                  /**< Resultado da última nvs_get_blob(), para o log. */
+} nvs_cal_read_t;
+
+/**
+ * @brief Regra de disparo do modo de eventos, expandida para um limiar por zona do driver.
+ *
+ * As regras de uma mesma zona são combinadas na ordem da tabela: a primeira
+ * é sempre OU, as seguintes usam operation. O driver aceita no máximo
+ * VL53LMZ_NB_THRESHOLDS limiares: em 8x8 cabe uma regra por zona.
+ */
+typedef struct {
+    int8_t zone;                                    /**< Zona (0 a 63) ou SENSOR_EVENT_ALL_ZONES. */
+    uint8_t measurement;                            /**< Grandeza comparada (VL53LMZ_DISTANCE_MM, VL53LMZ_SIGNAL_PER_SPAD_KCPS, ...). */
+    uint8_t type;                                   /**< Janela (VL53LMZ_IN_WINDOW, VL53LMZ_OUT_OF_WINDOW, ...). */
+    uint8_t operation;                              /**< VL53LMZ_OPERATION_OR ou VL53LMZ_OPERATION_AND com a regra anterior da zona. */
+    int32_t low;                                    /**< Limite inferior, na unidade da grandeza (mm, kcps/SPAD...). */
+    int32_t high;                                   /**< Limite superior. */
+} sensor_event_window_t;
+
+/**
+ * @brief Etapas da inicialização dos sensores, na ordem em que a máquina de estados as executa.
+ *
+ * Cada etapa é aplicada a todos os sensores antes de passar para a próxima.
+ */
+typedef enum {
+    SENSOR_BOOT_BUS = 0,                            /**< Barramento SPI e registro do sensor. */
+    SENSOR_BOOT_DETECT,                             /**< Detecção do sensor (vl53lmz_is_alive). */
+    SENSOR_BOOT_FIRMWARE,                           /**< Download do firmware, offsets, xtalk e configuração padrão (vl53lmz_init). */
+    SENSOR_BOOT_CALIBRATION,                        /**< Xtalk do cache na NVS ou recalibração; enviado ao sensor junto com a configuração. */
+    SENSOR_BOOT_CONFIGURE,                          /**< Resolução e frequência de ranging. */
+    SENSOR_BOOT_INT_GPIO,                           /**< Pino INT e ISR. */
+    SENSOR_BOOT_START,                              /**< Início do ranging. */
+    SENSOR_BOOT_FIRST_FRAME,                        /**< Espera do primeiro frame com ao menos um alvo válido. */
+    SENSOR_BOOT_DONE,                               /**< Sensor em operação; os tempos de boot já foram reportados. */
+} sensor_boot_state_t;
+
+/** @brief Nome de cada etapa da inicialização, usado no log. */
+static const char* const s_boot_state_names[SENSOR_BOOT_DONE] = {
+    "barramento", "detecção", "firmware", "calibração", "configuração", "INT", "ranging", "primeiro frame válido",
+};
+
+/**
+ * @brief Pinos de cada sensor, na ordem do sensor_id.
+ * @warning Ajustar conforme o hardware. O host SPI do ESP32 tem 3 linhas de CS
+ * por hardware, divididas com os controladores CAN do mesmo barramento.
+ */
+static const tof_sensor_pins_t s_sensor_pins[] = {
+    { .cs_gpio = 5, .int_gpio = GPIO_NUM_4 },
+    { .cs_gpio = 21, .int_gpio = GPIO_NUM_22 },
+    { .cs_gpio = 26, .int_gpio = GPIO_NUM_27 },
+};
+
+_Static_assert(SENSOR_COUNT >= 1 && SENSOR_COUNT <= sizeof(s_sensor_pins) / sizeof(s_sensor_pins[0]),
+               "SENSOR_COUNT precisa de uma entrada em s_sensor_pins para cada sensor");
+
+/**
+ * @brief Regras de disparo do modo de eventos (SENSOR_EVENT_MODE).
+ * @warning Ajustar conforme a instalação. O padrão dispara quando um alvo
+ * entra a menos de 1 m em qualquer zona.
+ */
+static const sensor_event_window_t s_event_windows[] = {
+    { .zone = SENSOR_EVENT_ALL_ZONES, .measurement = VL53LMZ_DISTANCE_MM, .type = VL53LMZ_IN_WINDOW,
+      .operation = VL53LMZ_OPERATION_OR, .low = 0, .high = 1000 },
+};
+
+#define SENSOR_ALL_MASK ((1u << SENSOR_COUNT) - 1u)  /**< Bits de notificação de todos os sensores (bit i = sensor i). */
+
+static TaskHandle_t s_tof_task_handle = NULL;       /**< Handle da tarefa do sensor, notificada pela ISR do pino INT. */
+static tof_sensor_t s_sensors[SENSOR_COUNT];        /**< Sensores do conjunto, indexados pelo sensor_id. */
+static bool s_sensor_bus_owned = false;             /**< Barramento SPI inicializado por este módulo (max_transfer_sz conhecido). */
+#if SENSOR_SYNC_GPIO >= 0
+static esp_timer_handle_t s_sync_timer;             /**< Timer periódico que gera o pulso de sincronismo. */
+#endif
+#ifdef VL53LMZ_EXTERNAL_TEMP_BUFFER
+/**
+ * @brief Buffer temporário do driver, único para todos os sensores.
+ * Só a tarefa de aquisição chama o driver, e cada leitura (incluindo a visão
+ * dos resultados) é convertida para o frame antes da consulta ao próximo sensor.
+ */
+static DMA_ATTR uint8_t s_sensor_scratch[VL53LMZ_TEMPORARY_BUFFER_SIZE];
+#endif
+
+_Static_assert(!SENSOR_EVENT_MODE || SENSOR_ACQ_MODE == SENSOR_ACQ_MODE_INTERRUPT,
+               "o modo de eventos depende do pino INT (SENSOR_ACQ_MODE_INTERRUPT)");
+_Static_assert(!SENSOR_RATE_MODE || 1000 / SENSOR_RATE_MIN_HZ < SENSOR_INT_TIMEOUT_MS,
+               "na menor frequência do controle adaptativo o período deve caber em SENSOR_INT_TIMEOUT_MS");
+
+_Static_assert(TOF_FRAME_TARGETS_PER_ZONE == VL53LMZ_NB_TARGET_PER_ZONE,
+               "tof_frame_t e o driver devem usar o mesmo número de alvos por zona");
+_Static_assert(TOF_FRAME_MOTION_AGGREGATES == VL53LMZ_MI_INDICATOR_LENGTH,
+               "tof_frame_t e o driver devem usar o mesmo número de agregados de movimento");
+_Static_assert(TOF_CAL_XTALK_SIZE == VL53LMZ_XTALK_BUFFER_SIZE,
+               "tof_cal_record_t e o driver devem usar o mesmo tamanho de blob de xtalk");
+
+static tof_frame_t s_sd_slots[SENSOR_SD_RING_CAPACITY];     /**< Slots pré-alocados da fila do SD. */
+static tof_frame_t s_uart_slots[SENSOR_UART_RING_CAPACITY]; /**< Slots pré-alocados da fila da UART. */
+static tof_consumer_t s_sd_consumer = { .name = "SD" };     /**< Consumidor que persiste os frames no cartão SD. */
+static tof_consumer_t s_uart_consumer = { .name = "UART" }; /**< Consumidor que imprime os frames na UART. */
+static tof_frame_t s_pub_slots[SENSOR_COUNT][SENSOR_PUB_SLOTS]; /**< Slots pré-alocados da publicação de cada sensor. */
+static tof_frame_pub_t s_frame_pubs[SENSOR_COUNT];          /**< Último frame de cada sensor, lido sem cópia por outras tarefas. */
+static tof_subscriber_t s_subscribers[SENSOR_PUB_MAX_SUBSCRIBERS]; /**< Tarefas notificadas a cada frame publicado. */
+static _Atomic uint32_t s_subscriber_count = 0;             /**< Entradas de s_subscribers já reservadas. */
+static _Atomic(tof_can_transmit_fn) s_can_transmit = NULL;  /**< Envio de um frame CAN, registrado por tof_set_can_transmit(). */
+static void* _Atomic s_can_transmit_ctx = NULL;             /**< Contexto repassado a s_can_transmit. */
+#if SENSOR_OBSTACLE_MODE
+static tof_obstacle_t s_obstacles[SENSOR_COUNT];            /**< Estágio de obstáculos de cada sensor (só a tarefa do CAN acessa). */
+#endif
+
+static uint8_t s_sd_write_buffer[SD_WRITE_BUFFER_SIZE] __attribute__((aligned(4))); /**< Buffer de escrita do SD (alinhado para DMA). */
+static tof_log_writer_t s_sd_writer = { .fd = -1 };         /**< Escritor persistente do arquivo de log no cartão SD. */
+static tof_log_index_t s_sd_index = { .writer = { .fd = -1 } }; /**< Índice lateral (timestamp -> deslocamento) do arquivo de log aberto. */
+static sdmmc_card_t* s_sd_card = NULL;                      /**< Cartão montado em SD_CARD_MOUNT_POINT (NULL = não montado). */
+static uint32_t s_sd_log_number = 0;                        /**< Número do arquivo de log aberto (0 = nenhum ainda). */
+static int64_t s_sd_log_opened_us = 0;                      /**< Instante em que o arquivo de log aberto foi criado. */
+static uint32_t s_sd_rotations = 0;                         /**< Rotações de arquivo desde a partida. */
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_TOFB
+static tof_bin_block_t s_sd_block;                          /**< Bloco .tofb em formação. */
+#if SD_LOG_DELTA_KEYFRAME_INTERVAL > 0
+static tof_bin_delta_t s_sd_delta;                          /**< Último valor gravado de cada zona, base dos frames delta. */
+#endif
+#endif
+static _Atomic int s_uart_output_mode = UART_OUTPUT_DEFAULT_MODE; /**< Modo de saída atual (tof_uart_output_mode_t). */
+static bool s_uart_driver_ready = false;                    /**< Driver da UART instalado com sucesso. */
+#if SENSOR_CNH_MODE
+static VL53LMZ_Motion_Configuration s_cnh_config;           /**< Configuração CNH comum a todos os sensores (lida pelo consumidor para localizar os agregados). */
+static uint32_t s_cnh_words;                                /**< Palavras do bloco CNH programado (vl53lmz_cnh_calc_required_memory()). */
+static sensor_cnh_slot_t s_cnh_slots[2];                    /**< Ping-pong entre a aquisição e o consumidor CNH. */
+static uint32_t s_cnh_head;                                 /**< Próximo slot preenchido pela aquisição. */
+static _Atomic uint32_t s_cnh_dropped;                      /**< Blocos descartados com os dois slots ocupados. */
+#if SENSOR_CNH_OUTPUT == SENSOR_CNH_OUTPUT_SD
+static uint8_t s_cnh_write_buffer[SD_CNH_WRITE_BUFFER_SIZE] __attribute__((aligned(4))); /**< Buffer de escrita do arquivo CNH. */
+static tof_log_writer_t s_cnh_writer = { .fd = -1 };        /**< Escritor do arquivo CNH. */
+#endif
+#endif
+#if SENSOR_EVENT_MODE
+static uint32_t s_event_wakeups = 0;                        /**< Despertares da tarefa de aquisição desde o último relatório. */
+static uint32_t s_event_frames = 0;                         /**< Frames de evento lidos desde o último relatório. */
+#endif
+static int64_t s_boot_start_us;                             /**< Início da tarefa de aquisição (esp_timer, desde o reset). */
+static int64_t s_boot_end_us[SENSOR_BOOT_DONE];             /**< Fim de cada etapa da inicialização do sensor. */
+static _Atomic uint32_t s_sd_ready_ms = 0;                  /**< Instante em que o log do SD ficou pronto (ms desde o reset; 0 = ainda não). */
+#if SENSOR_RATE_MODE
+static uint32_t s_rate_sleeping = 0;                        /**< Bit i ligado = sensor i em sleep entre rajadas. */
+#endif
+#if SENSOR_LATENCY_STATS
+static tof_latency_hist_t s_latency[TOF_LATENCY_STAGE_COUNT]; /**< Histograma de cada etapa, comum a todos os sensores. */
+static uint32_t s_int_cycles[SENSOR_COUNT];                 /**< Ciclos no último pulso INT de cada sensor (gravado pela ISR). */
+static _Atomic uint32_t s_int_stamped;                      /**< Bit i ligado = s_int_cycles[i] ainda não consumido pela leitura. */
+#endif
+#if SENSOR_CAL_CACHE
+static bool s_cal_nvs_ready = false;                        /**< Partição NVS inicializada. */
+static tof_cal_record_t s_cal_record;                       /**< Registro lido ou gravado na etapa de calibração (fora da pilha da tarefa). */
+#endif
+
+
+/** @brief Executa as etapas de inicialização dos sensores até o início do ranging. */
+static bool run_sensor_boot(void);
+
+/** @brief Aplica uma etapa da inicialização a todos os sensores, parando no primeiro que falhar. */
+static bool for_each_sensor(bool (*step)(tof_sensor_t* sensor));
+
+/** @brief Reporta no log a duração de cada etapa, no primeiro frame com alvo válido. */
+static void log_boot_times(void);
+
+/** @brief Indica se o frame tem ao menos um alvo válido. */
+static bool frame_has_valid_target(const tof_frame_t* frame);
+
+/** @brief Inicializa o barramento SPI compartilhado pelos sensores. */
+static bool setup_spi_bus(void);
+
+/** @brief Registra um sensor no barramento SPI. */
+static bool vl53l8ch_setup_bus(tof_sensor_t* sensor);
+
+/** @brief Verifica se o sensor responde no barramento. */
+static bool vl53l8ch_detect(tof_sensor_t* sensor);
+
+/** @brief Baixa o firmware no sensor com transações grandes (vl53lmz_init). */
+static bool vl53l8ch_load_firmware(tof_sensor_t* sensor);
 
+#if SENSOR_CAL_CACHE
+/** @brief Carrega o xtalk do sensor do cache na NVS, recalibrando se o cache faltar ou for de outro módulo. */
+static bool vl53l8ch_load_calibration(tof_sensor_t* sensor);
 
-/** @brief Simula a inicialização do hardware e firmware do sensor VL53L8CH. */
-static bool vl53l8ch_init(void);
+/** @brief Inicializa a partição NVS (na primeira chamada) e abre o namespace de calibração. */
+static bool open_cal_nvs(nvs_handle_t* handle);
 
-/** @brief Simula o comando para iniciar a aquisição contínua de dados. */
-static void vl53l8ch_start_ranging(void);
+/** @brief Lê um blob do namespace de calibração para tof_cal_load(). */
+static tof_cal_read_status_t read_cal_blob(void* ctx, const char* key, void* out, size_t* len);
+#endif
 
-/** @brief Simula a leitura dos buffers de distância e status do sensor. */
-static bool vl53l8ch_get_data(uint8_t* dist_buf, uint8_t* status_buf);
+/** @brief Aplica a resolução, a frequência de ranging e o modo de sincronismo. */
+static bool vl53l8ch_configure(tof_sensor_t* sensor);
+
+#if SENSOR_MOTION_MODE
+/** @brief Configura o indicador de movimento na resolução e na faixa de distâncias do modo de movimento. */
+static bool vl53l8ch_configure_motion_mode(tof_sensor_t* sensor);
+
+/** @brief Reporta no log os frames com movimento e os suprimidos de um sensor. */
+static void log_motion_stats(tof_sensor_t* sensor);
+#endif
+
+#if SENSOR_CNH_MODE
+/** @brief Programa os agregados e os bins CNH e calcula o tamanho do bloco. */
+static bool vl53l8ch_configure_cnh_mode(tof_sensor_t* sensor);
+
+/** @brief Copia o bloco CNH da visão para o slot livre do ping-pong. */
+static void capture_cnh_block(const tof_sensor_t* sensor, const VL53LMZ_ResultsView* view);
+
+/** @brief Comprime os slots CNH preenchidos e os entrega ao destino. */
+static void drain_cnh_slots(void);
+
+/** @brief Entrega um pacote CNH fechado ao destino configurado; retorna os bytes entregues. */
+static size_t output_cnh_packet(tof_cnh_encoder_t* encoder);
+
+/** @brief Reporta no log a vazão e a compressão dos histogramas CNH e zera os contadores. */
+static void log_cnh_stats(sensor_cnh_stats_t* stats, uint32_t elapsed_ms);
+
+#if SENSOR_CNH_OUTPUT == SENSOR_CNH_OUTPUT_SD
+/** @brief Abre o arquivo dos pacotes CNH no cartão SD. */
+static bool open_cnh_log(void);
+#endif
+#endif
+
+/** @brief Inicia a aquisição contínua de dados. */
+static bool vl53l8ch_start_ranging(tof_sensor_t* sensor);
+
+/** @brief Inicia o ranging de todos os sensores, escalonado ou sob o pulso de sincronismo. */
+static bool start_all_sensors(void);
+
+#if SENSOR_SYNC_GPIO >= 0
+/** @brief Configura o pino de sincronismo e o timer que gera os pulsos. */
+static bool setup_sync_output(void);
+#endif
+
+/** @brief Consulta o sensor para saber se há um novo frame disponível. */
+static bool vl53l8ch_check_data_ready(tof_sensor_t* sensor, bool* is_ready);
+
+/** @brief Configura o pino INT do sensor e registra a ISR que notifica a tarefa. */
+static bool setup_sensor_int_gpio(tof_sensor_t* sensor);
+
+/** @brief Bloqueia a tarefa até o próximo frame (interrupção ou polling, conforme SENSOR_ACQ_MODE). */
+static uint32_t wait_for_sensor_frames(void);
+
+#if SENSOR_EVENT_MODE
+/** @brief Programa no sensor os limiares de s_event_windows e o modo autônomo. */
+static bool vl53l8ch_configure_event_mode(tof_sensor_t* sensor);
+
+/** @brief Habilita o light sleep automático e o despertar pelos pinos INT. */
+static void setup_event_sleep(void);
+
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE && CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+/** @brief Antes do light sleep: arma o despertar por nível baixo nos pinos INT. */
+static esp_err_t event_sleep_enter_cb(int64_t sleep_time_us, void* arg);
+
+/** @brief Depois do light sleep: desarma o despertar e devolve a borda de descida à ISR. */
+static esp_err_t event_sleep_exit_cb(int64_t sleep_time_us, void* arg);
+#endif
+#endif
+
+#if SENSOR_ROI_MODE
+/** @brief Inicia a troca de resolução pela ROI. */
+static bool vl53l8ch_configure_roi_mode(tof_sensor_t* sensor);
+
+/** @brief Passa um frame publicado à troca de resolução e reprograma o sensor quando ela pede. */
+static void update_sensor_roi(tof_sensor_t* sensor, const tof_frame_t* frame);
+
+/** @brief Para o ranging, programa a resolução e a frequência dela e reinicia o sensor. */
+static void vl53l8ch_apply_resolution(tof_sensor_t* sensor, uint8_t resolution);
+
+/** @brief Reporta no log a resolução atual e os contadores da troca de resolução de um sensor. */
+static void log_roi_stats(tof_sensor_t* sensor);
+#endif
+
+#if SENSOR_RATE_MODE
+/** @brief Inicia o controle adaptativo e programa o ranging autônomo na frequência inicial. */
+static bool vl53l8ch_configure_rate_mode(tof_sensor_t* sensor);
+
+/** @brief Passa um frame publicado ao controle adaptativo e reprograma o sensor quando ele pede. */
+static void update_sensor_rate(tof_sensor_t* sensor, const tof_frame_t* frame);
+
+/** @brief Para o ranging, programa a nova frequência e reinicia o sensor ou o põe em sleep. */
+static void vl53l8ch_apply_rate(tof_sensor_t* sensor, const tof_rate_decision_t* decision);
+
+/** @brief Acorda e reinicia os sensores cujo sono entre rajadas terminou. */
+static void wake_sleeping_sensors(void);
+
+/** @brief Tempo até o próximo fim de sono, limitado a limit_ms. */
+static uint32_t next_wake_ms(uint32_t limit_ms);
+
+/** @brief Reporta no log a frequência atual e os contadores do controle adaptativo de um sensor. */
+static void log_rate_stats(tof_sensor_t* sensor);
+#endif
+
+/** @brief Lê o frame pendente de um sensor, se houver, e o publica nas filas. */
+static bool acquire_sensor_frame(tof_sensor_t* sensor, tof_frame_t* frame);
+
+/** @brief Lê os resultados do sensor e os copia em largura total para um frame do pipeline. */
+static bool vl53l8ch_get_data(tof_sensor_t* sensor, tof_frame_t* frame);
 
 /** @brief Formata e imprime um buffer de dados como string hexadecimal na UART. */
-static void print_raw_data_as_hex(const char* prefix, uint8_t* buffer, size_t len);
+static void print_raw_data_as_hex(const char* prefix, const uint8_t* buffer, size_t len);
 
 /** @brief Inicializa os pinos e monta o sistema de arquivos FAT do cartão SD. */
-static void setup_sd_card(void);
+static bool setup_sd_card(void);
+
+/** @brief Abre o próximo arquivo de log numerado do cartão SD, com seu índice. */
+static bool open_sd_log(void);
+
+/** @brief Descarrega e fecha o arquivo de log e o índice abertos. */
+static void close_sd_log(void);
 
-/** @brief Filtra e salva os     dados válidos de distância e status em um arquivo CSV no cartão SD. */
-static void save_data_to_sd(uint8_t* dist_buf, uint8_t* status_buf);
+/** @brief Indica se o arquivo de log aberto atingiu o limite de tamanho ou de duração. */
+static bool sd_log_should_rotate(int64_t now_us);
 
-/** @brief Função principal da tarefa RTOS que orquestra o ciclo de vida do sensor. */
+/** @brief Retorna o maior número de arquivo de log presente no cartão (0 = nenhum). */
+static uint32_t find_last_sd_log(void);
+
+/** @brief Monta o caminho de um arquivo de log numerado com a extensão dada. */
+static void make_sd_log_path(char* path, uint32_t number, const char* extension);
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_TOFB
+/** @brief Fecha o bloco .tofb em formação e o entrega ao escritor. */
+static void flush_sd_block(void);
+
+/** @brief Descarta o estado do modo delta: o próximo frame de cada sensor será um keyframe. */
+static void reset_sd_delta(void);
+#endif
+
+/** @brief Tarefa produtora: aquisição dos frames do sensor e publicação nas filas. */
 static void tof_sensor_task(void *pvParameters);
 
+/** @brief Tarefa consumidora que persiste os frames no cartão SD. */
+static void tof_sd_task(void *pvParameters);
+
+/** @brief Tarefa consumidora que imprime os frames na UART. */
+static void tof_uart_task(void *pvParameters);
+
+#if SENSOR_OBSTACLE_MODE
+/** @brief Tarefa consumidora: setores e alvo mais próximo de cada frame novo, enviados no CAN. */
+static void tof_can_task(void *pvParameters);
+
+/** @brief Entrega os frames CAN de um resultado à função de envio registrada. */
+static void transmit_can_frames(const tof_can_frame_t* frames, size_t count, sensor_can_stats_t* stats);
+
+/** @brief Imprime no log o último resultado de cada sensor e os contadores da tarefa do CAN. */
+static void log_obstacle_stats(const tof_obstacle_result_t* last, sensor_can_stats_t* stats, uint32_t elapsed_ms);
+#endif
+
+/** @brief Enfileira um frame para um consumidor sem bloquear a aquisição. */
+static void publish_frame(tof_consumer_t* consumer, const tof_frame_t* frame);
+
+/** @brief Torna um frame o mais recente do seu sensor e notifica as tarefas inscritas, sem nunca bloquear. */
+static void publish_latest_frame(const tof_frame_t* frame);
+
+/** @brief Processa todos os frames pendentes na fila de um consumidor, medindo cada um na etapa stage. */
+static void drain_consumer_ring(tof_consumer_t* consumer, void (*handler)(const tof_frame_t*),
+                                tof_latency_stage_t stage);
+
+/** @brief Mede o tempo desde start_cycles, em ns, e o registra na etapa stage (só com SENSOR_LATENCY_STATS). */
+static inline uint32_t record_latency(tof_latency_stage_t stage, uint32_t start_cycles);
+
+#if SENSOR_LATENCY_STATS
+/** @brief Reporta no log as latências de cada etapa e, no streaming binário, envia o pacote de telemetria. */
+static void report_latency_stats(uint32_t elapsed_ms);
+#endif
+
+/** @brief Filtra e salva os dados válidos de distância e status de um frame no log do cartão SD. */
+static void save_frame_to_sd(const tof_frame_t* frame);
+
+/** @brief Imprime um frame do pipeline na UART em hexadecimal. */
+static void print_frame_as_hex(const tof_frame_t* frame);
+
+/** @brief Envia um frame do pipeline pela UART como pacote binário COBS. */
+static void stream_frame_binary(const tof_frame_t* frame);
+
+/** @brief Encaminha um frame para a saída da UART selecionada. */
+static void output_frame_to_uart(const tof_frame_t* frame);
+
+/** @brief Instala o driver da UART de saída e redireciona o console para ele. */
+static bool setup_uart_stream(void);
+
+/** @brief Trata os comandos de troca de modo recebidos na UART. */
+static void poll_uart_commands(void);
+
+/** @brief Imprime no log a ocupação e os contadores de uma fila do pipeline. */
+static void log_pipeline_stats(tof_consumer_t* consumer);
+
+/** @brief Imprime no log o custo de RAM dos sensores e a memória interna livre. */
+static void log_sensor_ram_usage(void);
+
+/** @brief Imprime no log a ocupação do barramento SPI por um sensor e zera os contadores. */
+static void log_spi_stats(tof_sensor_t* sensor, uint32_t elapsed_ms);
+
+/** @brief Reporta no log as mudanças removidas pelo filtro temporal de um sensor e zera o tempo máximo. */
+static void log_filter_stats(tof_sensor_t* sensor);
+
+/** @brief Imprime no log os contadores da publicação do último frame de um sensor. */
+static void log_pub_stats(tof_sensor_t* sensor);
+
+/**
+ * @brief Rotina de interrupção do pino INT de um sensor.
+ *
+ * O VL53L8CH gera um pulso em nível baixo a cada novo frame. A ISR apenas
+ * liga o bit do sensor na notificação da tarefa de aquisição; toda a
+ * comunicação com o sensor é feita fora do contexto de interrupção.
+ *
+ * @param arg Sensor que gerou a interrupção (tof_sensor_t).
+ */
+static void IRAM_ATTR sensor_int_isr_handler(void* arg) {
+    const tof_sensor_t* sensor = (const tof_sensor_t*)arg;
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    if (s_tof_task_handle != NULL) {
+#if SENSOR_LATENCY_STATS
+        // A ISR roda no core da tarefa de aquisição (serviço instalado por ela): mesmo CCOUNT
+        s_int_cycles[sensor->id] = tof_time_cycles();
+        atomic_fetch_or_explicit(&s_int_stamped, 1u << sensor->id, memory_order_release);
+#endif
+        xTaskNotifyFromISR(s_tof_task_handle, 1u << sensor->id, eSetBits, &higher_priority_task_woken);
+    }
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+#if SENSOR_SYNC_GPIO >= 0
 /**
- * @brief Tarefa principal para manipulação do sensor ToF.
+ * @brief Gera um pulso no pino de sincronismo, iniciando a próxima medição de todos os sensores.
+ * @param arg Não utilizado.
+ */
+static void sensor_sync_timer_cb(void* arg) {
+    gpio_set_level(SENSOR_SYNC_GPIO, 1);
+    esp_rom_delay_us(SENSOR_SYNC_PULSE_US);
+    gpio_set_level(SENSOR_SYNC_GPIO, 0);
+}
+#endif
+
+/**
+ * @brief Tarefa produtora: aquisição dos frames dos sensores ToF.
  *
- * Esta tarefa opera em um loop infinito, realizando a leitura periódica dos dados
- * do sensor, enviando os dados brutos para o log de depuração e persistindo
- * as medições válidas no cartão SD.
+ * Esta tarefa opera em um loop infinito, aguardando cada novo frame dos
+ * sensores (pela interrupção do pino INT de cada um ou por polling, conforme
+ * SENSOR_ACQ_MODE) e publicando-o, com o sensor_id de origem, nas filas dos
+ * consumidores: os frames de todos os sensores formam um único stream
+ * intercalado. Ela nunca espera pelos consumidores: se uma fila estiver
+ * cheia, o frame é descartado apenas para aquele consumidor e contabilizado.
  *
  * @param pvParameters Ponteiro para parâmetros da tarefa.
  */
 static void tof_sensor_task(void *pvParameters) {
-    ESP_LOGI(TAG, "Tarefa do sensor ToF iniciada.");
+    ESP_LOGI(TAG, "Tarefa do sensor ToF iniciada no core %d.", (int)xPortGetCoreID());
+
+    s_tof_task_handle = xTaskGetCurrentTaskHandle();
+
+    if (!run_sensor_boot()) {
+        ESP_LOGE(TAG, "Falha na inicialização do sensor. A tarefa será encerrada.");
+        vTaskDelete(NULL);
+        return;
+    }
+    sensor_boot_state_t boot_state = SENSOR_BOOT_FIRST_FRAME;
+#if SENSOR_EVENT_MODE
+    setup_event_sleep();
+#endif
 
-    setup_sd_card();
+    static tof_frame_t frame;   // Estático para não ocupar a pilha da tarefa
+    int64_t stats_start_us = esp_timer_get_time();
+
+    while (1) {
+        int64_t now_us = esp_timer_get_time();
+        if (now_us - stats_start_us >= (int64_t)SENSOR_STATS_INTERVAL_MS * 1000) {
+            uint32_t elapsed_ms = (uint32_t)((now_us - stats_start_us) / 1000);
+            for (int i = 0; i < SENSOR_COUNT; i++) {
+                tof_sensor_t* sensor = &s_sensors[i];
+                ESP_LOGI(TAG, "Sensor %u: %lu medições/s (alvo: %u Hz), %lu despertares sem dados",
+                         sensor->id, (unsigned long)(sensor->frames_read * 1000 / elapsed_ms),
+                         sensor->frequency_hz, (unsigned long)sensor->empty_wakeups);
+                const tof_frame_stats_t* stats = &sensor->last_stats;
+                ESP_LOGI(TAG, "Sensor %u: último frame com %u zonas válidas, %d / %d / %d mm (mín / média / máx)",
+                         sensor->id, stats->valid_count, stats->min_mm, stats->mean_mm, stats->max_mm);
+                log_filter_stats(sensor);
+                log_pub_stats(sensor);
+#if SENSOR_MOTION_MODE
+                log_motion_stats(sensor);
+#endif
+#if SENSOR_RATE_MODE
+                log_rate_stats(sensor);
+#endif
+#if SENSOR_ROI_MODE
+                log_roi_stats(sensor);
+#endif
+                log_spi_stats(sensor, elapsed_ms);
+                sensor->frames_read = 0;
+                sensor->empty_wakeups = 0;
+            }
+            log_pipeline_stats(&s_sd_consumer);
+            log_pipeline_stats(&s_uart_consumer);
+#if SENSOR_EVENT_MODE
+            ESP_LOGI(TAG, "Eventos: %lu despertares/h, %lu frames de evento/h",
+                     (unsigned long)((uint64_t)s_event_wakeups * 3600000 / elapsed_ms),
+                     (unsigned long)((uint64_t)s_event_frames * 3600000 / elapsed_ms));
+            s_event_wakeups = 0;
+            s_event_frames = 0;
+#endif
+            stats_start_us = now_us;
+        }
 
-    // Garante que o arquivo de log tenha um cabeçalho CSV
-    struct stat st;
-    if (stat(SD_CARD_MOUNT_POINT "/tof_log.csv", &st) != 0) {
-        FILE* f = fopen(SD_CARD_MOUNT_POINT "/tof_log.csv", "w");
-        if (f) {
-            fprintf(f, "timestamp_ms,zone_id,distance_mm,status\n");
-            fclose(f);
+#if SENSOR_RATE_MODE
+        wake_sleeping_sensors();
+#endif
+        // Com as partidas escalonadas, normalmente só um bit está ligado por
+        // despertar: a leitura de um sensor acontece enquanto os outros integram
+        uint32_t pending = wait_for_sensor_frames();
+#if SENSOR_RATE_MODE
+        pending &= ~s_rate_sleeping;
+#endif
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            if ((pending & (1u << i)) == 0 || !acquire_sensor_frame(&s_sensors[i], &frame)) {
+                continue;
+            }
+            if (boot_state == SENSOR_BOOT_FIRST_FRAME && frame_has_valid_target(&frame)) {
+                s_boot_end_us[SENSOR_BOOT_FIRST_FRAME] = frame.timestamp_us;
+                boot_state = SENSOR_BOOT_DONE;
+                log_boot_times();
+            }
+            publish_frame(&s_sd_consumer, &frame);
+            publish_frame(&s_uart_consumer, &frame);
+            publish_latest_frame(&frame);
+#if SENSOR_RATE_MODE
+            // Depois da publicação: reprogramar o sensor não atrasa a entrega do frame
+            update_sensor_rate(&s_sensors[i], &frame);
+#endif
+#if SENSOR_ROI_MODE
+            update_sensor_roi(&s_sensors[i], &frame);
+#endif
         }
     }
+}
 
-    if (!vl53l8ch_init()) {
-        ESP_LOGE(TAG, "Falha na inicialização do sensor. A tarefa será encerrada.");
-        vTaskDelete(NULL);
+/**
+ * @brief Lê o frame pendente de um sensor e o identifica com o sensor_id e a sequência do sensor.
+ * @param sensor Sensor notificado.
+ * @param[out] frame Frame a ser preenchido.
+ * @return true se um frame foi lido; false se o sensor não tinha frame pendente ou a leitura falhou.
+ */
+static bool acquire_sensor_frame(tof_sensor_t* sensor, tof_frame_t* frame) {
+    // Só lê os resultados quando o sensor confirma que há um frame pendente
+    bool is_ready = false;
+    if (!vl53l8ch_check_data_ready(sensor, &is_ready)) {
+        ESP_LOGW(TAG, "Sensor %u: falha ao consultar o estado do sensor.", sensor->id);
+        return false;
+    }
+    if (!is_ready) {
+        sensor->empty_wakeups++;
+        return false;
+    }
+    // Carimbo antes da leitura SPI: o mais próximo do fim da medição que o relógio do sistema alcança
+    int64_t ready_us = esp_timer_get_time();
+#if SENSOR_LATENCY_STATS
+    uint32_t bit = 1u << sensor->id;
+    if (atomic_fetch_and_explicit(&s_int_stamped, ~bit, memory_order_acquire) & bit) {
+        record_latency(TOF_LATENCY_INT_TO_READ, s_int_cycles[sensor->id]);
+    }
+#endif
+    if (!vl53l8ch_get_data(sensor, frame)) {
+        ESP_LOGW(TAG, "Sensor %u: falha ao obter novos dados do sensor.", sensor->id);
+        return false;
+    }
+    sensor->frames_read++;
+#if SENSOR_EVENT_MODE
+    s_event_frames++;
+#endif
+    frame->timestamp_us = ready_us;
+    frame->sequence = sensor->sequence++;
+    frame->sensor_id = sensor->id;
+#if SENSOR_ROI_MODE && SENSOR_ROI_CROP
+    tof_roi_crop(&sensor->roi, frame);
+#endif
+    uint32_t filter_start = tof_time_cycles();
+    tof_filter_apply(&sensor->filter, frame);
+    uint32_t filter_us = record_latency(TOF_LATENCY_FILTER, filter_start) / 1000;
+    sensor->filter_max_us = filter_us > sensor->filter_max_us ? filter_us : sensor->filter_max_us;
+    tof_frame_compute_stats(frame, 0, &sensor->last_stats);
+#if SENSOR_MOTION_MODE
+    tof_motion_apply(&sensor->motion, frame);
+#endif
+    ESP_LOGD(TAG, "Dados recebidos do sensor %u.", sensor->id);
+    return true;
+}
+
+/**
+ * @brief Enfileira um frame para um consumidor e o acorda, sem nunca bloquear.
+ * @param consumer Consumidor de destino.
+ * @param frame Frame recém-adquirido.
+ */
+static void publish_frame(tof_consumer_t* consumer, const tof_frame_t* frame) {
+    if (!tof_frame_ring_push(&consumer->ring, frame)) {
+        ESP_LOGD(TAG, "Fila do consumidor %s cheia, frame %lu descartado.",
+                 consumer->name, (unsigned long)frame->sequence);
+    }
+    if (consumer->task != NULL) {
+        xTaskNotifyGive(consumer->task);
+    }
+}
+
+/**
+ * @brief Publica um frame como o mais recente do seu sensor e notifica as tarefas inscritas.
+ *
+ * Um leitor que segura todos os slots livres só faz o frame deixar de ser
+ * publicado (contabilizado em log_pub_stats()); a aquisição nunca espera.
+ *
+ * @param frame Frame recém-adquirido.
+ */
+static void publish_latest_frame(const tof_frame_t* frame) {
+    if (!tof_frame_pub_publish(&s_frame_pubs[frame->sensor_id], frame)) {
+        ESP_LOGD(TAG, "Sensor %u: todos os slots da publicação referenciados, frame %lu não publicado.",
+                 frame->sensor_id, (unsigned long)frame->sequence);
         return;
     }
+    for (int i = 0; i < SENSOR_PUB_MAX_SUBSCRIBERS; i++) {
+        TaskHandle_t task = atomic_load_explicit(&s_subscribers[i].task, memory_order_acquire);
+        if (task != NULL) {
+            xTaskNotify(task, s_subscribers[i].notify_bits, eSetBits);
+        }
+    }
+}
+
+/**
+ * @brief Retira e processa todos os frames pendentes na fila de um consumidor.
+ *
+ * Frames processados mais de SENSOR_FRAME_LATE_MS após a aquisição são
+ * contabilizados como atrasados.
+ *
+ * @param consumer Consumidor cuja fila será esvaziada.
+ * @param handler Função de processamento de cada frame.
+ * @param stage Etapa em que o tempo de handler é registrado.
+ */
+static void drain_consumer_ring(tof_consumer_t* consumer, void (*handler)(const tof_frame_t*),
+                                tof_latency_stage_t stage) {
+    const tof_frame_t* frame;
+    while ((frame = tof_frame_ring_peek(&consumer->ring)) != NULL) {
+        if (esp_timer_get_time() - frame->timestamp_us > (int64_t)SENSOR_FRAME_LATE_MS * 1000) {
+            atomic_fetch_add_explicit(&consumer->late, 1, memory_order_relaxed);
+        }
+        uint32_t start = tof_time_cycles();
+        handler(frame);
+        record_latency(stage, start);
+        tof_frame_ring_release(&consumer->ring);
+    }
+}
+
+/**
+ * @brief Tarefa consumidora: persistência dos frames no cartão SD.
+ *
+ * A montagem do cartão e as escritas FAT acontecem exclusivamente nesta
+ * tarefa, de forma que uma escrita lenta apenas acumula frames na fila em
+ * vez de atrasar a próxima leitura do sensor.
+ *
+ * @param pvParameters Ponteiro para o consumidor (tof_consumer_t).
+ */
+static void tof_sd_task(void *pvParameters) {
+    tof_consumer_t* consumer = (tof_consumer_t*)pvParameters;
 
-    vl53l8ch_start_ranging();
+    // Sem cartão montado a tarefa só esvazia a fila: a falha é reportada uma vez por setup_sd_card()
+    bool mounted = setup_sd_card();
+    if (mounted && open_sd_log()) {
+        atomic_store(&s_sd_ready_ms, (uint32_t)(esp_timer_get_time() / 1000));
+    }
+#if SENSOR_CNH_MODE && SENSOR_CNH_OUTPUT == SENSOR_CNH_OUTPUT_SD
+    if (mounted) {
+        open_cnh_log();
+    }
+#endif
 
-    uint8_t distance_data[SENSOR_DATA_BUFFER_SIZE];
-    uint8_t status_data[SENSOR_DATA_BUFFER_SIZE];
+    uint64_t stats_bytes = 0;
+    int64_t stats_start_us = esp_timer_get_time();
+    int64_t last_open_attempt_us = stats_start_us;
 
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(SENSOR_POLLING_RATE_MS));
+        // O timeout garante que os limites de tempo do escritor sejam aplicados mesmo sem frames
+        TickType_t wait = pdMS_TO_TICKS(SD_WRITER_POLL_MS);
+#if SENSOR_EVENT_MODE
+        // Sem nada a descarregar, só o próximo evento acorda a tarefa: o light
+        // sleep não é interrompido a cada SD_WRITER_POLL_MS
+        bool idle = s_sd_writer.fd >= 0 && !tof_log_writer_has_pending(&s_sd_writer);
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_TOFB
+        idle = idle && s_sd_block.frame_count == 0;
+#endif
+#if SENSOR_CNH_MODE && SENSOR_CNH_OUTPUT == SENSOR_CNH_OUTPUT_SD
+        idle = idle && !tof_log_writer_has_pending(&s_cnh_writer);
+#endif
+        wait = idle ? portMAX_DELAY : wait;
+#endif
+        ulTaskNotifyTake(pdTRUE, wait);
+        drain_consumer_ring(consumer, save_frame_to_sd, TOF_LATENCY_SD_WRITE);
 
-        if (vl53l8ch_get_data(distance_data, status_data)) {
-            ESP_LOGD(TAG, "Dados recebidos do sensor.");
+        int64_t now_us = esp_timer_get_time();
+#if SENSOR_CNH_MODE && SENSOR_CNH_OUTPUT == SENSOR_CNH_OUTPUT_SD
+        drain_cnh_slots();
+        if (s_cnh_writer.fd < 0 && s_sd_writer.fd >= 0 &&
+            now_us - last_open_attempt_us >= (int64_t)SD_REOPEN_INTERVAL_MS * 1000) {
+            last_open_attempt_us = now_us;
+            open_cnh_log();
+        }
+        tof_log_writer_poll(&s_cnh_writer);
+#endif
+        if (s_sd_writer.fd < 0) {
+            if (mounted && now_us - last_open_attempt_us >= (int64_t)SD_REOPEN_INTERVAL_MS * 1000) {
+                last_open_attempt_us = now_us;
+                open_sd_log();
+            }
+            continue;
+        }
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_TOFB
+        if (s_sd_block.frame_count > 0 &&
+            now_us - s_sd_block.first_frame_us >= (int64_t)SD_FLUSH_INTERVAL_MS * 1000) {
+            flush_sd_block();
+        }
+#endif
+        tof_log_writer_poll(&s_sd_writer);
+        tof_log_index_sync(&s_sd_index, &s_sd_writer);
+        if (sd_log_should_rotate(now_us)) {
+            // As estatísticas do escritor recomeçam no arquivo novo: a base da
+            // taxa passa a descontar os bytes do arquivo fechado (aritmética modular)
+            close_sd_log();
+            s_sd_rotations++;
+            stats_bytes -= tof_log_writer_get_stats(&s_sd_writer).bytes_written;
+            if (!open_sd_log()) {
+                last_open_attempt_us = now_us;
+                continue;
+            }
+        }
 
-            // Saída de depuração com dados brutos
-            print_raw_data_as_hex("TOF: HEX DATA", distance_data, sizeof(distance_data));
-            print_raw_data_as_hex("TOF: TARGET STATUS", status_data, sizeof(status_data));
+        if (now_us - stats_start_us >= (int64_t)SENSOR_STATS_INTERVAL_MS * 1000) {
+            tof_log_writer_stats_t stats = tof_log_writer_get_stats(&s_sd_writer);
+            uint32_t elapsed_ms = (uint32_t)((now_us - stats_start_us) / 1000);
+            ESP_LOGI(TAG, "SD: %lu B/s, %lu descargas, %lu fsyncs, pior descarga %lu us, pior fsync %lu us, %lu erros",
+                     (unsigned long)((stats.bytes_written - stats_bytes) * 1000 / elapsed_ms),
+                     (unsigned long)stats.flushes, (unsigned long)stats.fsyncs,
+                     (unsigned long)stats.max_flush_us, (unsigned long)stats.max_fsync_us,
+                     (unsigned long)stats.write_errors);
+            tof_log_index_stats_t index = tof_log_index_get_stats(&s_sd_index);
+            ESP_LOGI(TAG, "SD: arquivo %04lu com %lu KB, %lu entradas de índice (%lu erros), %lu rotações",
+                     (unsigned long)s_sd_log_number, (unsigned long)(tof_log_writer_position(&s_sd_writer) / 1024),
+                     (unsigned long)index.entries, (unsigned long)index.write_errors,
+                     (unsigned long)s_sd_rotations);
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_TOFB && SD_LOG_DELTA_KEYFRAME_INTERVAL > 0
+            const tof_bin_delta_stats_t* delta = &s_sd_delta.stats;
+            ESP_LOGI(TAG, "SD delta: %lu keyframes, %lu frames delta, %lu zonas gravadas e %lu omitidas",
+                     (unsigned long)delta->keyframes, (unsigned long)delta->delta_frames,
+                     (unsigned long)delta->zones_written, (unsigned long)delta->zones_skipped);
+#endif
+            stats_bytes = stats.bytes_written;
+            stats_start_us = now_us;
+        }
+    }
+}
 
-            // Persistência dos dados no cartão SD
-            save_data_to_sd(distance_data, status_data);
-        } else {
-            ESP_LOGW(TAG, "Falha ao obter novos dados do sensor.");
+/**
+ * @brief Abre o próximo arquivo de log numerado do cartão SD, com seu índice.
+ *
+ * Cada arquivo (SD_LOG_PREFIX + número de 4 dígitos, nome 8.3) permanece
+ * aberto até a rotação por tamanho ou por duração e recebe o cabeçalho (linha
+ * do CSV ou cabeçalho de arquivo .tofb) no início. Com SD_LOG_PREALLOCATE, o
+ * arquivo é criado com SD_LOG_ROTATE_BYTES em clusters contíguos antes da
+ * abertura, para que as escritas não percorram nem estendam a cadeia de
+ * clusters da FAT; se a reserva falhar (cartão cheio ou fragmentado), o
+ * arquivo cresce normalmente.
+ *
+ * Na primeira abertura após a partida, o maior número presente no cartão é
+ * o arquivo em uso quando o firmware parou: ele é truncado no fim confiável
+ * registrado no seu índice (tof_log_index_recover()) e o log continua no
+ * número seguinte.
+ *
+ * @return true se o arquivo foi aberto.
+ */
+static bool open_sd_log(void) {
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_TOFB
+    const char* extension = "tofb";
+#else
+    const char* extension = "csv";
+#endif
+    char path[SD_LOG_PATH_LEN];
+    char index_path[SD_LOG_PATH_LEN];
+    if (s_sd_log_number == 0) {
+        s_sd_log_number = find_last_sd_log();
+        if (s_sd_log_number > 0) {
+            make_sd_log_path(path, s_sd_log_number, extension);
+            make_sd_log_path(index_path, s_sd_log_number, "idx");
+            uint64_t size = 0;
+            if (tof_log_index_recover(path, index_path, &size)) {
+                ESP_LOGW(TAG, "Log %s truncado em %llu bytes, o fim confiável do índice.", path, (unsigned long long)size);
+            }
         }
     }
+    s_sd_log_number = s_sd_log_number >= SD_LOG_MAX_NUMBER ? 1 : s_sd_log_number + 1;
+    make_sd_log_path(path, s_sd_log_number, extension);
+    make_sd_log_path(index_path, s_sd_log_number, "idx");
+
+    tof_log_writer_config_t config = {
+        .flush_threshold_bytes = SD_FLUSH_THRESHOLD_BYTES,
+        .flush_interval_ms = SD_FLUSH_INTERVAL_MS,
+        .fsync_interval_ms = SD_FSYNC_INTERVAL_MS,
+    };
+#if SD_LOG_PREALLOCATE && SD_LOG_ROTATE_BYTES > 0
+    // Depois de uma volta da numeração, o arquivo antigo é substituído
+    unlink(path);
+    esp_err_t err = esp_vfs_fat_create_contiguous_file(SD_CARD_MOUNT_POINT, path, SD_LOG_ROTATE_BYTES, true);
+    config.preallocated = err == ESP_OK;
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Sem %lu bytes contíguos para %s (%s); o arquivo cresce sob demanda.",
+                 (unsigned long)SD_LOG_ROTATE_BYTES, path, esp_err_to_name(err));
+    }
+#endif
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_TOFB
+    tof_bin_file_header_t file_header;
+    tof_bin_make_file_header(&file_header);
+    tof_bin_block_reset(&s_sd_block);
+    reset_sd_delta();
+    const void* header = &file_header;
+    size_t header_len = sizeof(file_header);
+#else
+    const void* header = TOF_CSV_HEADER;
+    size_t header_len = strlen(TOF_CSV_HEADER);
+#endif
+    if (!tof_log_writer_open(&s_sd_writer, path, true, header, header_len,
+                             s_sd_write_buffer, sizeof(s_sd_write_buffer), &config)) {
+        ESP_LOGE(TAG, "Falha ao abrir o arquivo de log %s no cartão SD.", path);
+        return false;
+    }
+    if (!tof_log_index_open(&s_sd_index, index_path)) {
+        // O log continua sem índice: as leituras percorrem o arquivo inteiro
+        ESP_LOGW(TAG, "Falha ao criar o índice %s; log sem índice.", index_path);
+    }
+    s_sd_log_opened_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Log do SD em %s%s.", path, config.preallocated ? " (pré-alocado)" : "");
+    return true;
 }
 
 /**
- * @brief Cria e inicia a tarefa do sensor ToF.
+ * @brief Descarrega e fecha o arquivo de log e o índice abertos.
+ *
+ * O bloco .tofb em formação é gravado no arquivo que está sendo fechado. O
+ * fechamento do escritor trunca um arquivo pré-alocado no tamanho usado, e a
+ * entrada final do índice, gravada depois, marca o arquivo inteiro como
+ * confiável.
  */
-void start_tof_sensor_task(void) {
-    xTaskCreate(
-        tof_sensor_task,
-        "tof_sensor_task",  // Nome da tarefa para depuração
-        4096,               // Tamanho da pilha em words (4 bytes por word)
-        NULL,               // Parâmetros da tarefa
-        5,                  // Prioridade da tarefa (0 é a mais baixa)
-        NULL                // Handle da tarefa (opcional)
-    );
+static void close_sd_log(void) {
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_TOFB
+    if (s_sd_block.frame_count > 0) {
+        flush_sd_block();
+    }
+#endif
+    tof_log_writer_close(&s_sd_writer);
+    tof_log_index_close(&s_sd_index, &s_sd_writer);
 }
 
+/**
+ * @brief Indica se o arquivo de log aberto atingiu o limite de tamanho ou de duração.
+ *
+ * A verificação é feita a cada drenagem da fila, então o arquivo pode passar
+ * do limite (e da reserva) pelos frames de uma drenagem; o excedente é
+ * alocado normalmente pela FAT.
+ *
+ * @param now_us Instante atual (esp_timer).
+ * @return true se é hora de passar para o próximo arquivo.
+ */
+static bool sd_log_should_rotate(int64_t now_us) {
+    if (s_sd_writer.fd < 0) {
+        return false;
+    }
+    if (SD_LOG_ROTATE_BYTES > 0 && tof_log_writer_position(&s_sd_writer) >= SD_LOG_ROTATE_BYTES) {
+        return true;
+    }
+    return SD_LOG_ROTATE_INTERVAL_S > 0 && now_us - s_sd_log_opened_us >= (int64_t)SD_LOG_ROTATE_INTERVAL_S * 1000000;
+}
 
 /**
- * @brief Formata e imprime um buffer para o console.
- * @param prefix String de texto para preceder a saída hexadecimal.
- * @param buffer Ponteiro para o buffer de dados a ser impresso.
- * @param len Número de bytes a serem impressos do buffer.
+ * @brief Retorna o maior número de arquivo de log presente no cartão.
+ *
+ * Sem nomes longos na FAT, o diretório devolve os nomes 8.3 em maiúsculas,
+ * por isso a comparação do prefixo ignora a caixa.
+ *
+ * @return Maior número encontrado (de qualquer extensão), ou 0 se não há arquivos numerados.
  */
-static void print_raw_data_as_hex(const char* prefix, uint8_t* buffer, size_t len) {
-    printf("%s: \t", prefix);
-    for (size_t i = 0; i < len; i++) {
-        printf("%02X", buffer[i]);
+static uint32_t find_last_sd_log(void) {
+    DIR* dir = opendir(SD_CARD_MOUNT_POINT);
+    if (dir == NULL) {
+        return 0;
     }
-    printf("\n");
+    uint32_t last = 0;
+    const size_t prefix_len = strlen(SD_LOG_PREFIX);
+    for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+        if (strncasecmp(entry->d_name, SD_LOG_PREFIX, prefix_len) != 0) {
+            continue;
+        }
+        char* end;
+        unsigned long number = strtoul(entry->d_name + prefix_len, &end, 10);
+        if (*end == '.' && number > last && number <= SD_LOG_MAX_NUMBER) {
+            last = (uint32_t)number;
+        }
+    }
+    closedir(dir);
+    return last;
 }
 
 /**
- * @brief Configura e monta o cartão SD.
- * @warning Os pinos de GPIO (clk, cmd, d0) devem ser ajustados conforme o hardware específico.
+ * @brief Monta o caminho de um arquivo de log numerado.
+ * @param[out] path Saída com SD_LOG_PATH_LEN bytes.
+ * @param number Número do arquivo (1 a SD_LOG_MAX_NUMBER).
+ * @param extension Extensão sem o ponto.
  */
-static void setup_sd_card(void) {
-    // Implementação da função...
+static void make_sd_log_path(char* path, uint32_t number, const char* extension) {
+    snprintf(path, SD_LOG_PATH_LEN, SD_CARD_MOUNT_POINT "/" SD_LOG_PREFIX "%04lu.%s",
+             (unsigned long)number, extension);
 }
 
+#if SENSOR_CNH_MODE && SENSOR_CNH_OUTPUT == SENSOR_CNH_OUTPUT_SD
 /**
- * @brief Salva os dados de uma medição no cartão SD.
- * Itera sobre as 64 zonas e salva uma nova linha no arquivo CSV para cada
- * medição com status considerado válido (status 5 ou 9).
- * @param dist_buf Buffer de 64 bytes com dados de distância.
- * @param status_buf Buffer de 64 bytes com dados de status.
+ * @brief Abre o arquivo dos pacotes CNH com um escritor próprio.
+ *
+ * O arquivo não tem cabeçalho: é a mesma sequência de pacotes COBS do
+ * streaming da UART, lida como uma captura .tofs.
+ *
+ * @return true se o arquivo foi aberto.
  */
-static void save_data_to_sd(uint8_t* dist_buf, uint8_t* status_buf) {
-    // Implementação da função...
+static bool open_cnh_log(void) {
+    const tof_log_writer_config_t config = {
+        .flush_threshold_bytes = SD_FLUSH_THRESHOLD_BYTES,
+        .flush_interval_ms = SD_FLUSH_INTERVAL_MS,
+        .fsync_interval_ms = SD_FSYNC_INTERVAL_MS,
+    };
+    if (!tof_log_writer_open(&s_cnh_writer, SD_CNH_LOG_PATH, false, NULL, 0,
+                             s_cnh_write_buffer, sizeof(s_cnh_write_buffer), &config)) {
+        ESP_LOGE(TAG, "Falha ao abrir o arquivo CNH %s no cartão SD.", SD_CNH_LOG_PATH);
+        return false;
+    }
+    return true;
 }
+#endif
 
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_TOFB
+/**
+ * @brief Codifica o bloco .tofb em formação diretamente no buffer do escritor.
+ */
+static void flush_sd_block(void) {
+    size_t size = tof_bin_block_encoded_size(&s_sd_block);
+    uint8_t* dst = tof_log_writer_reserve(&s_sd_writer, size);
+    if (dst != NULL) {
+        // A marca só vale para um bloco confirmado: uma marca pendente de um bloco
+        // perdido indexaria o bloco seguinte com o instante errado
+        uint64_t offset = tof_log_writer_position(&s_sd_writer);
+        if (tof_log_writer_commit(&s_sd_writer, tof_bin_block_encode(&s_sd_block, dst, size))) {
+            tof_log_index_mark(&s_sd_index, s_sd_block.first_frame_us, offset);
+        }
+    } else {
+        // Os frames delta seguintes dependeriam do bloco perdido
+        reset_sd_delta();
+    }
+    tof_bin_block_reset(&s_sd_block);
+}
 
+/**
+ * @brief Reinicia o codificador delta a cada arquivo aberto e após um bloco perdido.
+ */
+static void reset_sd_delta(void) {
+#if SD_LOG_DELTA_KEYFRAME_INTERVAL > 0
+    static const tof_bin_delta_config_t config = {
+        .keyframe_interval = SD_LOG_DELTA_KEYFRAME_INTERVAL,
+        .threshold_mm = SD_LOG_DELTA_THRESHOLD_MM,
+    };
+    tof_bin_delta_init(&s_sd_delta, &config);
+#endif
+}
+#endif
 
 /**
- * @brief Placeholder para inicialização do sensor.
- * @note Esta é uma função de simulação. Deve ser substituída pela implementação real do driver do sensor.
- * @return true sempre, para simulação.
+ * @brief Tarefa consumidora: saída dos frames na UART.
+ *
+ * No modo de streaming cada frame vira um pacote COBS com CRC16 entregue ao
+ * buffer de transmissão do driver, que o envia por interrupção sem ocupar a
+ * tarefa; o dump hexadecimal via printf fica como alternativa de depuração.
+ * O modo pode ser trocado a qualquer momento por tof_set_uart_output_mode()
+ * ou enviando UART_CMD_STREAM / UART_CMD_HEX pela própria UART.
+ * @param pvParameters Ponteiro para o consumidor (tof_consumer_t).
  */
-static bool vl53l8ch_init(void) {
-    ESP_LOGI(TAG, "Simulando inicialização do sensor... OK.");
-    return true;
+static void tof_uart_task(void *pvParameters) {
+    tof_consumer_t* consumer = (tof_consumer_t*)pvParameters;
+
+    s_uart_driver_ready = setup_uart_stream();
+    if (!s_uart_driver_ready) {
+        ESP_LOGW(TAG, "Driver da UART indisponível, usando apenas o dump hexadecimal.");
+    }
+
+#if SENSOR_LATENCY_STATS
+    int64_t stats_start_us = esp_timer_get_time();
+#endif
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SENSOR_EVENT_MODE ? SENSOR_EVENT_POLL_MS : SENSOR_INT_TIMEOUT_MS));
+        drain_consumer_ring(consumer, output_frame_to_uart, TOF_LATENCY_UART_EMIT);
+#if SENSOR_CNH_MODE && SENSOR_CNH_OUTPUT == SENSOR_CNH_OUTPUT_UART
+        drain_cnh_slots();
+#endif
+        poll_uart_commands();
+#if SENSOR_LATENCY_STATS
+        int64_t now_us = esp_timer_get_time();
+        if (now_us - stats_start_us >= (int64_t)SENSOR_STATS_INTERVAL_MS * 1000) {
+            report_latency_stats((uint32_t)((now_us - stats_start_us) / 1000));
+            stats_start_us = now_us;
+        }
+#endif
+    }
 }
 
 /**
- * @brief Placeholder para iniciar as medições.
- * @note Esta é uma função de simulação. Deve ser substituída pela implementação real do driver do sensor.
+ * @brief Seleciona em tempo de execução o formato de saída dos frames na UART.
+ * @param mode Novo modo de saída.
  */
-static void vl53l8ch_start_ranging(void) {
-    ESP_LOGI(TAG, "Simulando início do ranging...");
+void tof_set_uart_output_mode(tof_uart_output_mode_t mode) {
+    atomic_store(&s_uart_output_mode, (int)mode);
+    ESP_LOGI(TAG, "Saída da UART: %s", mode == TOF_UART_OUTPUT_STREAM ? "streaming COBS" : "dump hexadecimal");
 }
 
 /**
- * @brief Placeholder que fornece dados de exemplo para a simulação.
- * @note Esta é uma função de simulação. Deve ser substituída pela implementação real do driver do sensor.
- * @param[out] dist_buf Ponteiro para o buffer onde os dados de distância serão escritos.
- * @param[out] status_buf Ponteiro para o buffer onde os dados de status serão escritos.
- * @return true sempre, para simulação.
+ * @brief Referencia o último frame publicado de um sensor, sem cópia e sem bloquear.
+ * @param sensor_id Sensor de origem.
+ * @return Frame válido até tof_sensor_release(), ou NULL se o sensor não existe ou ainda não publicou.
  */
-static bool vl53l8ch_get_data(uint8_t* dist_buf, uint8_t* status_buf) {
-    // Implementação da função de simulação
-    return true;
-}
\ No newline at end of file
+const tof_frame_t* tof_sensor_acquire_latest(uint8_t sensor_id) {
+    if (sensor_id >= SENSOR_COUNT) {
+        return NULL;
+    }
+    return tof_frame_pub_acquire(&s_frame_pubs[sensor_id]);
+}
+
+/**
+ * @brief Libera um frame retornado por tof_sensor_acquire_latest().
+ * @param frame Frame a ser liberado (NULL é ignorado).
+ */
+void tof_sensor_release(const tof_frame_t* frame) {
+    if (frame != NULL && frame->sensor_id < SENSOR_COUNT) {
+        tof_frame_pub_release(&s_frame_pubs[frame->sensor_id], frame);
+    }
+}
+
+/**
+ * @brief Registra uma tarefa para ser notificada a cada frame publicado, de qualquer sensor.
+ * @param task Tarefa a ser notificada.
+ * @param notify_bits Bits ligados na notificação da tarefa.
+ * @return true se a tarefa foi registrada, false sem entradas livres.
+ */
+bool tof_sensor_subscribe(TaskHandle_t task, uint32_t notify_bits) {
+    if (task == NULL) {
+        return false;
+    }
+    // Reserva uma entrada; a tarefa só é vista pela aquisição depois dos bits
+    uint32_t index = atomic_load(&s_subscriber_count);
+    do {
+        if (index >= SENSOR_PUB_MAX_SUBSCRIBERS) {
+            ESP_LOGW(TAG, "Sem entradas para inscrever mais tarefas (máx. %d).", SENSOR_PUB_MAX_SUBSCRIBERS);
+            return false;
+        }
+    } while (!atomic_compare_exchange_weak(&s_subscriber_count, &index, index + 1));
+    s_subscribers[index].notify_bits = notify_bits;
+    atomic_store_explicit(&s_subscribers[index].task, task, memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Registra a função que envia os frames CAN do estágio de obstáculos.
+ * @param transmit Função de envio (NULL = descartar os frames).
+ * @param ctx Contexto repassado à função.
+ */
+void tof_set_can_transmit(tof_can_transmit_fn transmit, void* ctx) {
+    atomic_store_explicit(&s_can_transmit_ctx, ctx, memory_order_relaxed);
+    atomic_store_explicit(&s_can_transmit, transmit, memory_order_release);
+}
+
+/**
+ * @brief Número de sensores do conjunto (sensor_id de 0 a tof_sensor_count() - 1).
+ */
+uint8_t tof_sensor_count(void) {
+    return SENSOR_COUNT;
+}
+
+/**
+ * @brief Instante atual no relógio de frame->timestamp_us.
+ * @return esp_timer_get_time(), em µs desde o reset.
+ */
+int64_t tof_sensor_time_us(void) {
+    return esp_timer_get_time();
+}
+
+/**
+ * @brief Salva um frame no cartão SD.
+ * No formato CSV, formata uma linha para cada zona com status considerado
+ * válido (status 5 ou 9) diretamente no buffer do escritor. No formato .tofb,
+ * acumula as zonas válidas no bloco em formação (no modo delta, só as que
+ * mudaram desde o último keyframe), que é codificado no buffer quando enche
+ * ou envelhece. A escrita no arquivo só acontece quando o
+ * escritor atinge seus limites de tamanho ou de tempo. No modo de movimento,
+ * os frames sem movimento não são gravados.
+ * @param frame Frame a ser persistido.
+ */
+static void save_frame_to_sd(const tof_frame_t* frame) {
+    if (frame->flags & TOF_FRAME_FLAG_MOTION_ONLY) {
+        return;
+    }
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_TOFB
+#if SD_LOG_DELTA_KEYFRAME_INTERVAL > 0
+    tof_bin_block_add_delta_frame(&s_sd_block, &s_sd_delta, frame);
+#else
+    tof_bin_block_add_frame(&s_sd_block, frame);
+#endif
+    if (tof_bin_block_is_full(&s_sd_block)) {
+        flush_sd_block();
+    }
+#else
+    char* row = (char*)tof_log_writer_reserve(&s_sd_writer, TOF_CSV_MAX_FRAME_LEN);
+    if (row == NULL) {
+        return;
+    }
+    uint64_t offset = tof_log_writer_position(&s_sd_writer);
+    if (tof_log_writer_commit(&s_sd_writer, tof_csv_format_frame(row, TOF_CSV_MAX_FRAME_LEN, frame))) {
+        tof_log_index_mark(&s_sd_index, frame->timestamp_us, offset);
+    }
+#endif
+}
+
+/**
+ * @brief Adaptador de print_raw_data_as_hex() para o formato de frame do pipeline.
+ * @param frame Frame a ser impresso.
+ */
+static void print_frame_as_hex(const tof_frame_t* frame) {
+    size_t targets = (size_t)frame->resolution * TOF_FRAME_TARGETS_PER_ZONE;
+
+    // Distâncias com 4 dígitos por alvo (int16 em complemento de dois), sem truncar em 255 mm
+    printf("TOF: HEX DATA: \t");
+    for (size_t i = 0; i < targets; i++) {
+        printf("%04X", (uint16_t)frame->distance_mm[i]);
+    }
+    printf("\n");
+    print_raw_data_as_hex("TOF: TARGET STATUS", frame->target_status, targets);
+}
+
+/**
+ * @brief Envia um frame como pacote binário (ver tof_stream.h).
+ * uart_write_bytes() apenas copia o pacote para o buffer de transmissão e
+ * serializa as escritas, então um pacote nunca é intercalado com o texto do log.
+ * @param frame Frame a ser enviado.
+ */
+static void stream_frame_binary(const tof_frame_t* frame) {
+    uint8_t packet[TOF_STREAM_MAX_ENCODED];
+    size_t len = tof_stream_encode_frame(frame, packet, sizeof(packet));
+    if (len > 0) {
+        uart_write_bytes(UART_STREAM_PORT, packet, len);
+    }
+}
+
+/**
+ * @brief Encaminha um frame para a saída da UART selecionada.
+ * @param frame Frame a ser enviado.
+ */
+static void output_frame_to_uart(const tof_frame_t* frame) {
+    bool stream = s_uart_driver_ready && atomic_load(&s_uart_output_mode) == TOF_UART_OUTPUT_STREAM;
+#if SENSOR_MOTION_MODE
+    if (frame->flags & TOF_FRAME_FLAG_MOTION) {
+        if (stream) {
+            uint8_t packet[TOF_STREAM_MAX_ENCODED];
+            size_t len = tof_stream_encode_motion(frame, packet, sizeof(packet));
+            if (len > 0) {
+                uart_write_bytes(UART_STREAM_PORT, packet, len);
+            }
+        } else {
+            printf("TOF: MOTION: %lu %lu %08lX\n", (unsigned long)frame->motion.global_indicator_1,
+                   (unsigned long)frame->motion.global_indicator_2, (unsigned long)frame->motion.active_mask);
+        }
+    }
+    if (frame->flags & TOF_FRAME_FLAG_MOTION_ONLY) {
+        return;
+    }
+#endif
+    if (stream) {
+        stream_frame_binary(frame);
+    } else {
+        print_frame_as_hex(frame);
+    }
+}
+
+/**
+ * @brief Lê sem bloquear os bytes recebidos na UART e troca o modo de saída.
+ */
+static void poll_uart_commands(void) {
+    if (!s_uart_driver_ready) {
+        return;
+    }
+    uint8_t cmd;
+    while (uart_read_bytes(UART_STREAM_PORT, &cmd, 1, 0) == 1) {
+        if (cmd == UART_CMD_STREAM) {
+            tof_set_uart_output_mode(TOF_UART_OUTPUT_STREAM);
+        } else if (cmd == UART_CMD_HEX) {
+            tof_set_uart_output_mode(TOF_UART_OUTPUT_HEX);
+        }
+    }
+}
+
+#if SENSOR_CNH_MODE
+/**
+ * @brief Comprime os blocos CNH pendentes no ping-pong e os entrega ao destino.
+ *
+ * Chamada só pela tarefa do destino configurado (SD ou UART), depois da fila
+ * de frames: a compressão e a escrita ficam fora da tarefa de aquisição,
+ * e cada slot é devolvido assim que os agregados são codificados, antes da
+ * escrita do pacote.
+ */
+static void drain_cnh_slots(void) {
+    static uint32_t tail = 0;
+    static uint8_t packet[SENSOR_CNH_PACKET_SIZE];  // Estático para não ocupar a pilha da tarefa
+    static sensor_cnh_stats_t stats;
+    static int64_t stats_start_us = 0;
+
+    sensor_cnh_slot_t* slot;
+    while (atomic_load_explicit(&(slot = &s_cnh_slots[tail & 1u])->ready, memory_order_acquire)) {
+        int64_t start_us = esp_timer_get_time();
+        const tof_cnh_header_t header = {
+            .sensor_id = slot->sensor_id,
+            .nb_aggregates = s_cnh_config.nb_of_aggregates,
+            .nb_bins = s_cnh_config.feature_length,
+            .sequence = slot->sequence,
+            .timestamp_ms = (uint32_t)(slot->timestamp_us / 1000),
+            .ref_residual = vl53lmz_cnh_get_ref_residual(slot->words),
+        };
+        tof_cnh_encoder_t encoder;
+        tof_cnh_encoder_begin(&encoder, packet, sizeof(packet), &header);
+        for (int32_t agg = 0; agg < header.nb_aggregates; agg++) {
+            int32_t* hist;
+            int8_t* hist_scaler;
+            int32_t* ambient;
+            int8_t* ambient_scaler;
+            vl53lmz_cnh_get_block_addresses(&s_cnh_config, agg, slot->words, &hist, &hist_scaler,
+                                            &ambient, &ambient_scaler);
+            tof_cnh_encoder_add_aggregate(&encoder, hist, hist_scaler, *ambient, *ambient_scaler);
+        }
+        atomic_store_explicit(&slot->ready, false, memory_order_release);
+        tail++;
+
+        size_t sent = output_cnh_packet(&encoder);
+        uint32_t encode_us = (uint32_t)(esp_timer_get_time() - start_us);
+        stats.max_encode_us = encode_us > stats.max_encode_us ? encode_us : stats.max_encode_us;
+        stats.raw_bytes += s_cnh_words * sizeof(uint32_t);
+        stats.packet_bytes += sent;
+        if (sent > 0) {
+            stats.frames++;
+        } else {
+            stats.output_errors++;
+        }
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    if (stats_start_us == 0) {
+        stats_start_us = now_us;
+    } else if (now_us - stats_start_us >= (int64_t)SENSOR_STATS_INTERVAL_MS * 1000) {
+        log_cnh_stats(&stats, (uint32_t)((now_us - stats_start_us) / 1000));
+        stats_start_us = now_us;
+    }
+}
+
+/**
+ * @brief Fecha um pacote CNH direto no destino: no buffer do escritor do SD
+ * ou, no streaming da UART, no buffer de transmissão do driver.
+ * @param encoder Pacote com todos os agregados.
+ * @return Bytes entregues, ou 0 se o pacote foi perdido (o dump hexadecimal não envia pacotes CNH).
+ */
+static size_t output_cnh_packet(tof_cnh_encoder_t* encoder) {
+    const size_t bound = TOF_CNH_ENCODED_BOUND(SENSOR_CNH_PACKET_SIZE);
+#if SENSOR_CNH_OUTPUT == SENSOR_CNH_OUTPUT_SD
+    uint8_t* dst = tof_log_writer_reserve(&s_cnh_writer, bound);
+    if (dst == NULL) {
+        return 0;
+    }
+    size_t len = tof_cnh_encoder_finish(encoder, dst, bound);
+    // Uma descarga que falhou conta como pacote perdido, não como vazão gravada
+    return tof_log_writer_commit(&s_cnh_writer, len) ? len : 0;
+#else
+    static uint8_t out[TOF_CNH_ENCODED_BOUND(SENSOR_CNH_PACKET_SIZE)];
+    if (!s_uart_driver_ready || atomic_load(&s_uart_output_mode) != TOF_UART_OUTPUT_STREAM) {
+        return 0;
+    }
+    size_t len = tof_cnh_encoder_finish(encoder, out, bound);
+    if (len > 0) {
+        uart_write_bytes(UART_STREAM_PORT, out, len);
+    }
+    return len;
+#endif
+}
+
+/**
+ * @brief Imprime no log a vazão sustentada do modo CNH e a taxa de compressão.
+ *
+ * Os descartes são blocos lidos com os dois slots do ping-pong ocupados, ou
+ * seja, quando o destino não acompanha a frequência de ranging.
+ * @param stats Contadores do consumidor, zerados após o relatório.
+ * @param elapsed_ms Duração do intervalo.
+ */
+static void log_cnh_stats(sensor_cnh_stats_t* stats, uint32_t elapsed_ms) {
+    uint32_t compressed = stats->frames + stats->output_errors;
+    ESP_LOGI(TAG, "CNH: %lu.%lu frames/s (%u agregados x %u bins), %lu descartados, %lu perdidos no destino, "
+             "%lu -> %lu B por frame, pior compressão %lu us",
+             (unsigned long)(stats->frames * 1000 / elapsed_ms),
+             (unsigned long)(stats->frames * 10000 / elapsed_ms % 10),
+             (unsigned)s_cnh_config.nb_of_aggregates, (unsigned)s_cnh_config.feature_length,
+             (unsigned long)atomic_exchange(&s_cnh_dropped, 0), (unsigned long)stats->output_errors,
+             (unsigned long)(compressed ? stats->raw_bytes / compressed : 0),
+             (unsigned long)(stats->frames ? stats->packet_bytes / stats->frames : 0),
+             (unsigned long)stats->max_encode_us);
+    memset(stats, 0, sizeof(*stats));
+}
+#endif
+
+/**
+ * @brief Imprime no log os contadores de uma fila do pipeline.
+ * @param consumer Consumidor a ser reportado.
+ */
+static void log_pipeline_stats(tof_consumer_t* consumer) {
+    ESP_LOGI(TAG, "Fila %s: %lu/%lu ocupados (pico %lu), %lu descartados, %lu atrasados",
+             consumer->name,
+             (unsigned long)tof_frame_ring_count(&consumer->ring),
+             (unsigned long)(consumer->ring.mask + 1),
+             (unsigned long)atomic_load(&consumer->ring.high_watermark),
+             (unsigned long)atomic_load(&consumer->ring.dropped),
+             (unsigned long)atomic_load(&consumer->late));
+}
+
+/**
+ * @brief Imprime no log os contadores da publicação do último frame de um sensor.
+ * @param sensor Sensor a ser reportado.
+ */
+static void log_pub_stats(tof_sensor_t* sensor) {
+    tof_frame_pub_t* pub = &s_frame_pubs[sensor->id];
+    uint32_t dropped = tof_frame_pub_dropped(pub);
+    if (dropped > 0) {
+        ESP_LOGW(TAG, "Publicação %u: %lu frames publicados, %lu não publicados (leitores nos %d slots reutilizáveis)",
+                 sensor->id, (unsigned long)tof_frame_pub_published(pub), (unsigned long)dropped,
+                 SENSOR_PUB_SLOTS - 1);
+    }
+}
+
+/**
+ * @brief Imprime no log a RAM estática de cada sensor e a memória interna que sobra para os outros componentes.
+ *
+ * Chamada após o boot, quando os buffers de download do firmware já foram
+ * liberados. O firmware e a configuração padrão do sensor ficam na flash
+ * (const em vl53lmz_buffers.h) e passam apenas pelos buffers de bounce da
+ * plataforma, então não entram na conta.
+ */
+static void log_sensor_ram_usage(void) {
+#ifdef VL53LMZ_EXTERNAL_TEMP_BUFFER
+    const char* scratch_mode = "compartilhado";
+    size_t scratch_size = sizeof(s_sensor_scratch);
+#else
+    const char* scratch_mode = "por sensor";
+    size_t scratch_size = sizeof(s_sensors[0].dev.temp_buffer);
+#endif
+    size_t per_sensor = sizeof(tof_sensor_t);
+    size_t queues = sizeof(s_sd_slots) + sizeof(s_uart_slots) + sizeof(s_pub_slots);
+    size_t total = SENSOR_COUNT * per_sensor + queues;
+#ifdef VL53LMZ_EXTERNAL_TEMP_BUFFER
+    total += scratch_size;
+#endif
+#if SENSOR_LATENCY_STATS
+    total += sizeof(s_latency);
+#endif
+#if SENSOR_CNH_MODE
+    total += sizeof(s_cnh_slots);
+#if SENSOR_CNH_OUTPUT == SENSOR_CNH_OUTPUT_SD
+    total += sizeof(s_cnh_write_buffer);
+#endif
+#endif
+    ESP_LOGI(TAG, "RAM: %u B por sensor (calibração %u B, bounce SPI %u B), buffer temporário %s de %u B, "
+             "filas %u B; total %u B para %d sensor(es).",
+             (unsigned)per_sensor, (unsigned)(VL53LMZ_OFFSET_BUFFER_SIZE + VL53LMZ_XTALK_BUFFER_SIZE),
+             (unsigned)sizeof(s_sensors[0].dev.platform.tx_bounce), scratch_mode, (unsigned)scratch_size,
+             (unsigned)queues, (unsigned)total, SENSOR_COUNT);
+    ESP_LOGI(TAG, "Heap interno livre %u B (mínimo %u B, maior bloco %u B), com DMA %u B.",
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL),
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_DMA));
+}
+
+/**
+ * @brief Imprime no log as estatísticas de SPI de um sensor desde o último relatório.
+ *
+ * O "bloco mais longo" é o maior tempo contínuo em que o sensor segurou o
+ * barramento, ou seja, o atraso máximo imposto a uma transação dos
+ * controladores CAN; a "espera" é o tempo que o sensor aguardou o barramento.
+ * Deve ser chamada pela tarefa de aquisição, a única que acessa o sensor.
+ * @param sensor Sensor a ser reportado.
+ * @param elapsed_ms Duração do intervalo, para o cálculo da vazão e da ocupação.
+ */
+static void log_spi_stats(tof_sensor_t* sensor, uint32_t elapsed_ms) {
+    VL53LMZ_PlatformStats stats;
+    VL53LMZ_PlatformTakeStats(&sensor->dev.platform, &stats);
+    ESP_LOGI(TAG, "SPI %u: %lu acessos em %lu blocos, %lu KB/s, ocupação %lu.%lu%%, "
+             "pior acesso %lu us, bloco mais longo %lu us, pior espera %lu us, %lu erros",
+             sensor->id, (unsigned long)stats.transfers, (unsigned long)stats.chunks,
+             (unsigned long)(stats.bytes / elapsed_ms),
+             (unsigned long)(stats.busy_us / (elapsed_ms * 10ULL)),
+             (unsigned long)(stats.busy_us / elapsed_ms % 10),
+             (unsigned long)stats.max_transfer_us, (unsigned long)stats.max_chunk_us,
+             (unsigned long)stats.max_bus_wait_us, (unsigned long)stats.errors);
+}
+
+/**
+ * @brief Imprime no log os contadores acumulados do filtro temporal de um sensor.
+ *
+ * As mudanças são variações de mais de TOF_FILTER_CHANGE_MM entre frames
+ * seguidos numa zona válida nos dois, antes e depois do filtro: a diferença é
+ * a oscilação que deixa de chegar ao log.
+ * @param sensor Sensor a ser reportado.
+ */
+static void log_filter_stats(tof_sensor_t* sensor) {
+    tof_filter_stats_t stats = tof_filter_get_stats(&sensor->filter);
+    ESP_LOGI(TAG, "Filtro %u (%s): %lu frames, mudanças > %d mm %lu -> %lu, %lu medidas rejeitadas, pior frame %lu us",
+             sensor->id, tof_filter_mode_name(sensor->filter.config.mode), (unsigned long)stats.frames,
+             TOF_FILTER_CHANGE_MM, (unsigned long)stats.raw_changes, (unsigned long)stats.filtered_changes,
+             (unsigned long)stats.rejected, (unsigned long)sensor->filter_max_us);
+    sensor->filter_max_us = 0;
+}
+
+/**
+ * @brief Mede uma etapa do caminho de um frame.
+ * @param stage Etapa medida.
+ * @param start_cycles tof_time_cycles() no início da etapa, no mesmo core.
+ * @return Duração da etapa, em ns.
+ */
+static inline uint32_t record_latency(tof_latency_stage_t stage, uint32_t start_cycles) {
+    uint32_t ns = tof_time_cycles_to_ns(tof_time_cycles() - start_cycles);
+#if SENSOR_LATENCY_STATS
+    tof_latency_record(&s_latency[stage], ns);
+#else
+    (void)stage;
+#endif
+    return ns;
+}
+
+#if SENSOR_LATENCY_STATS
+/**
+ * @brief Esvazia os histogramas de latência e reporta o intervalo.
+ *
+ * Chamada pela tarefa da UART: o pacote de telemetria entra no streaming
+ * entre dois frames, pela mesma tarefa que envia os frames. As etapas sem
+ * amostras no intervalo (INT no polling, SD sem cartão...) são omitidas do log.
+ *
+ * @param elapsed_ms Duração do intervalo.
+ */
+static void report_latency_stats(uint32_t elapsed_ms) {
+    tof_latency_summary_t summaries[TOF_LATENCY_STAGE_COUNT];
+    for (int stage = 0; stage < TOF_LATENCY_STAGE_COUNT; stage++) {
+        tof_latency_take(&s_latency[stage], &summaries[stage]);
+        const tof_latency_summary_t* summary = &summaries[stage];
+        if (summary->count == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "Latência %-12s %5lu amostras, p50 %lu.%lu us, p99 %lu.%lu us, máx %lu.%lu us",
+                 tof_latency_stage_name((tof_latency_stage_t)stage), (unsigned long)summary->count,
+                 (unsigned long)(summary->p50_ns / 1000), (unsigned long)(summary->p50_ns / 100 % 10),
+                 (unsigned long)(summary->p99_ns / 1000), (unsigned long)(summary->p99_ns / 100 % 10),
+                 (unsigned long)(summary->max_ns / 1000), (unsigned long)(summary->max_ns / 100 % 10));
+    }
+    if (s_uart_driver_ready && atomic_load(&s_uart_output_mode) == TOF_UART_OUTPUT_STREAM) {
+        uint8_t packet[TOF_LATENCY_TELEMETRY_ENCODED];
+        size_t len = tof_latency_encode_telemetry(summaries, (uint32_t)(esp_timer_get_time() / 1000), elapsed_ms,
+                                                  packet, sizeof(packet));
+        if (len > 0) {
+            uart_write_bytes(UART_STREAM_PORT, packet, len);
+        }
+    }
+}
+#endif
+
+#if SENSOR_MOTION_MODE
+/**
+ * @brief Imprime no log os contadores acumulados do modo de movimento de um sensor.
+ * @param sensor Sensor a ser reportado.
+ */
+static void log_motion_stats(tof_sensor_t* sensor) {
+    tof_motion_stats_t stats = tof_motion_get_stats(&sensor->motion);
+    ESP_LOGI(TAG, "Movimento %u: %lu de %lu frames com movimento, %lu frames de distância suprimidos, %lu agregados ativos",
+             sensor->id, (unsigned long)stats.motion_frames, (unsigned long)stats.frames,
+             (unsigned long)stats.suppressed_frames, (unsigned long)stats.active_aggregates);
+}
+#endif
+
+#if SENSOR_ROI_MODE
+/**
+ * @brief Inicia a troca de resolução pela ROI.
+ *
+ * O sensor já foi programado em 4x4 a SENSOR_ROI_WATCH_HZ por
+ * vl53l8ch_configure(); a ROI e os limiares são os de TOF_ROI_CONFIG_DEFAULT.
+ *
+ * @param sensor Sensor já com a resolução programada.
+ * @return true (a configuração é só local).
+ */
+static bool vl53l8ch_configure_roi_mode(tof_sensor_t* sensor) {
+    tof_roi_init(&sensor->roi, NULL);
+    const tof_roi_config_t* config = &sensor->roi.config;
+    ESP_LOGI(TAG, "Sensor %u: 4x4 a %d Hz, 8x8 a %d Hz com alvo entre %d e %d mm nas colunas %u-%u e linhas %u-%u%s.",
+             sensor->id, SENSOR_ROI_WATCH_HZ, SENSOR_ROI_DETAIL_HZ, config->min_mm, config->max_mm,
+             config->col_min, config->col_max, config->row_min, config->row_max,
+             SENSOR_ROI_CROP ? " (só as zonas da ROI em 8x8)" : "");
+    return true;
+}
+
+/**
+ * @brief Passa um frame publicado à troca de resolução e reprograma o sensor quando ela pede.
+ * @param sensor Sensor que produziu o frame.
+ * @param frame Frame publicado.
+ */
+static void update_sensor_roi(tof_sensor_t* sensor, const tof_frame_t* frame) {
+    uint8_t resolution;
+    if (tof_roi_update(&sensor->roi, frame, &resolution)) {
+        vl53l8ch_apply_resolution(sensor, resolution);
+    }
+}
+
+/**
+ * @brief Para o ranging, programa a resolução e a frequência dela e reinicia o sensor.
+ *
+ * vl53lmz_set_resolution() só vale com o ranging parado e reprograma o
+ * tamanho da leitura (dev.data_read_size); a frequência é reprogramada em
+ * seguida porque o limite dela depende da resolução. O filtro temporal
+ * recomeça sozinho no primeiro frame da nova resolução.
+ *
+ * @param sensor Sensor a ser reprogramado.
+ * @param resolution VL53LMZ_RESOLUTION_4X4 ou VL53LMZ_RESOLUTION_8X8.
+ */
+static void vl53l8ch_apply_resolution(tof_sensor_t* sensor, uint8_t resolution) {
+    const uint8_t frequency_hz = resolution == VL53LMZ_RESOLUTION_8X8 ? SENSOR_ROI_DETAIL_HZ : SENSOR_ROI_WATCH_HZ;
+    uint8_t status = vl53lmz_stop_ranging(&sensor->dev);
+    status |= vl53lmz_set_resolution(&sensor->dev, resolution);
+    status |= vl53lmz_set_ranging_frequency_hz(&sensor->dev, frequency_hz);
+    if (status != VL53LMZ_STATUS_OK) {
+        ESP_LOGE(TAG, "Sensor %u: falha ao trocar para %u zonas (status %u).", sensor->id, resolution, status);
+    } else {
+        sensor->resolution = resolution;
+        sensor->frequency_hz = frequency_hz;
+        ESP_LOGD(TAG, "Sensor %u: %u zonas a %u Hz.", sensor->id, resolution, frequency_hz);
+    }
+    vl53l8ch_start_ranging(sensor);
+}
+
+/**
+ * @brief Imprime no log a resolução atual e os contadores da troca de resolução de um sensor.
+ * @param sensor Sensor a ser reportado.
+ */
+static void log_roi_stats(tof_sensor_t* sensor) {
+    tof_roi_stats_t stats = tof_roi_get_stats(&sensor->roi);
+    ESP_LOGI(TAG, "ROI %u: %u zonas, %lu de %lu frames com alvo na ROI, %lu em 8x8, %lu trocas para 8x8, %lu para 4x4",
+             sensor->id, sensor->resolution, (unsigned long)stats.roi_frames, (unsigned long)stats.frames,
+             (unsigned long)stats.frames_8x8, (unsigned long)stats.switches_up, (unsigned long)stats.switches_down);
+}
+#endif
+
+#if SENSOR_OBSTACLE_MODE
+/**
+ * @brief Tarefa consumidora: setores e alvo mais próximo de cada frame novo, enviados no CAN.
+ *
+ * Inscrita na publicação do último frame (tof_sensor_subscribe()), a tarefa
+ * lê cada frame novo sem cópia, calcula o resultado de tof_obstacle.h, libera
+ * o frame antes do envio e entrega os frames CAN à função registrada em
+ * tof_set_can_transmit(). A latência do carimbo do frame ao fim do envio é
+ * medida (no relógio do esp_timer, comum aos dois cores) e os frames acima de
+ * SENSOR_OBSTACLE_DEADLINE_MS são contabilizados. Se a tarefa atrasar mais de
+ * um período, os frames intermediários são pulados: só o mais recente
+ * interessa ao CAN.
+ *
+ * @param pvParameters Não utilizado.
+ */
+static void tof_can_task(void *pvParameters) {
+    ESP_LOGI(TAG, "Tarefa de obstáculos no CAN iniciada no core %d.", (int)xPortGetCoreID());
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        tof_obstacle_init(&s_obstacles[i], NULL);
+    }
+    if (!tof_sensor_subscribe(xTaskGetCurrentTaskHandle(), SENSOR_OBSTACLE_NOTIFY_BIT)) {
+        ESP_LOGE(TAG, "Falha ao inscrever a tarefa do CAN. A tarefa será encerrada.");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    static tof_obstacle_result_t last[SENSOR_COUNT];    // Estático para não ocupar a pilha da tarefa
+    tof_can_frame_t can_frames[TOF_OBSTACLE_MAX_CAN_FRAMES];
+    uint32_t last_sequence[SENSOR_COUNT] = { 0 };
+    bool started[SENSOR_COUNT] = { false };
+    sensor_can_stats_t stats = { 0 };
+    int64_t stats_start_us = esp_timer_get_time();
+
+    while (1) {
+        xTaskNotifyWait(0, SENSOR_OBSTACLE_NOTIFY_BIT, NULL, pdMS_TO_TICKS(SENSOR_STATS_INTERVAL_MS));
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            const tof_frame_t* frame = tof_sensor_acquire_latest((uint8_t)i);
+            if (frame == NULL) {
+                continue;
+            }
+            if (started[i] && frame->sequence == last_sequence[i]) {
+                // Já enviado: a notificação vale para um frame novo de qualquer sensor
+                tof_sensor_release(frame);
+                continue;
+            }
+            stats.skipped += started[i] ? frame->sequence - last_sequence[i] - 1 : 0;
+            started[i] = true;
+            last_sequence[i] = frame->sequence;
+            tof_obstacle_update(&s_obstacles[i], frame, &last[i]);
+            tof_sensor_release(frame);
+
+            size_t count = tof_obstacle_pack_can(&s_obstacles[i].config, &last[i], can_frames,
+                                                 TOF_OBSTACLE_MAX_CAN_FRAMES);
+            transmit_can_frames(can_frames, count, &stats);
+            stats.frames++;
+            stats.raw_bytes += (uint64_t)last[i].sector_count * last[i].sector_count * 3;
+
+            int64_t latency_us = esp_timer_get_time() - last[i].timestamp_us;
+            uint32_t clamped_us = latency_us > (int64_t)(UINT32_MAX / 1000) ? UINT32_MAX / 1000 : (uint32_t)latency_us;
+            stats.max_latency_us = clamped_us > stats.max_latency_us ? clamped_us : stats.max_latency_us;
+            stats.late += latency_us > (int64_t)SENSOR_OBSTACLE_DEADLINE_MS * 1000;
+#if SENSOR_LATENCY_STATS
+            tof_latency_record(&s_latency[TOF_LATENCY_FRAME_TO_CAN], clamped_us * 1000);
+#endif
+        }
+
+        int64_t now_us = esp_timer_get_time();
+        if (now_us - stats_start_us >= (int64_t)SENSOR_STATS_INTERVAL_MS * 1000) {
+            log_obstacle_stats(last, &stats, (uint32_t)((now_us - stats_start_us) / 1000));
+            stats_start_us = now_us;
+        }
+    }
+}
+
+/**
+ * @brief Entrega os frames CAN de um resultado à função de envio registrada.
+ *
+ * A função de envio roda nesta tarefa e não deve bloquear (por exemplo,
+ * enfileirar no driver do controlador sem espera); um frame recusado só é
+ * contabilizado, porque o resultado seguinte o substitui.
+ *
+ * @param frames Frames a enviar.
+ * @param count Número de frames.
+ * @param stats Contadores da tarefa.
+ */
+static void transmit_can_frames(const tof_can_frame_t* frames, size_t count, sensor_can_stats_t* stats) {
+    tof_can_transmit_fn transmit = atomic_load_explicit(&s_can_transmit, memory_order_acquire);
+    void* ctx = atomic_load_explicit(&s_can_transmit_ctx, memory_order_relaxed);
+    for (size_t k = 0; k < count; k++) {
+        if (transmit == NULL) {
+            stats->unsent++;
+        } else if (transmit(&frames[k], ctx)) {
+            stats->can_frames++;
+        } else {
+            stats->tx_errors++;
+        }
+    }
+}
+
+/**
+ * @brief Imprime no log o último resultado de cada sensor e os contadores da tarefa do CAN, e zera os contadores.
+ * @param last Último resultado de cada sensor.
+ * @param stats Contadores do intervalo.
+ * @param elapsed_ms Duração do intervalo, para as vazões.
+ */
+static void log_obstacle_stats(const tof_obstacle_result_t* last, sensor_can_stats_t* stats, uint32_t elapsed_ms) {
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        const tof_obstacle_result_t* result = &last[i];
+        tof_obstacle_stats_t obstacle = tof_obstacle_get_stats(&s_obstacles[i]);
+        ESP_LOGI(TAG, "Obstáculos %u: mais próximo %d mm no setor %u, alvo rastreado %d mm a %d mm/s, "
+                 "%lu de %lu frames com alvo, %lu alvos, %lu perdidos",
+                 i, (result->flags & TOF_OBSTACLE_FLAG_TARGET) ? result->nearest_mm : -1, result->nearest_sector,
+                 (result->flags & TOF_OBSTACLE_FLAG_TRACK) ? result->track_mm : -1, result->closing_mm_s,
+                 (unsigned long)obstacle.target_frames, (unsigned long)obstacle.frames,
+                 (unsigned long)obstacle.tracks, (unsigned long)obstacle.lost);
+    }
+    uint32_t sent = stats->can_frames + stats->tx_errors + stats->unsent;
+    ESP_LOGI(TAG, "CAN: %lu frames ToF em %lu frames CAN (%lu B/s de dados; as zonas cruas exigiriam %lu B/s), "
+             "%lu erros de envio, %lu sem função de envio, %lu frames pulados, %lu acima de %d ms (pior %lu us)",
+             (unsigned long)stats->frames, (unsigned long)sent,
+             (unsigned long)((uint64_t)sent * TOF_OBSTACLE_CAN_DLC * 1000 / elapsed_ms),
+             (unsigned long)(stats->raw_bytes * 1000 / elapsed_ms),
+             (unsigned long)stats->tx_errors, (unsigned long)stats->unsent, (unsigned long)stats->skipped,
+             (unsigned long)stats->late, SENSOR_OBSTACLE_DEADLINE_MS, (unsigned long)stats->max_latency_us);
+    memset(stats, 0, sizeof(*stats));
+}
+#endif
+
+#if SENSOR_RATE_MODE
+/**
+ * @brief Inicia o controle adaptativo e programa o ranging autônomo na frequência inicial.
+ *
+ * O tempo de integração só vale no ranging autônomo, por isso o modo troca o
+ * ranging contínuo pelo autônomo. O sensor começa em SENSOR_RATE_MAX_HZ.
+ *
+ * @param sensor Sensor já com a resolução programada.
+ * @return true se o sensor aceitou a configuração.
+ */
+static bool vl53l8ch_configure_rate_mode(tof_sensor_t* sensor) {
+    tof_rate_config_t config = TOF_RATE_CONFIG_DEFAULT;
+    config.min_hz = SENSOR_RATE_MIN_HZ;
+    config.max_hz = SENSOR_RATE_MAX_HZ;
+    config.sleep_ms = SENSOR_RATE_SLEEP_MS;
+    tof_rate_decision_t decision;
+    tof_rate_init(&sensor->rate, &config, &decision);
+
+    uint8_t status = vl53lmz_set_ranging_mode(&sensor->dev, VL53LMZ_RANGING_MODE_AUTONOMOUS);
+    status |= vl53lmz_set_ranging_frequency_hz(&sensor->dev, decision.frequency_hz);
+    status |= vl53lmz_set_integration_time_ms(&sensor->dev, decision.integration_ms);
+    if (status != VL53LMZ_STATUS_OK) {
+        ESP_LOGE(TAG, "Sensor %u: falha ao programar a frequência adaptativa (status %u).", sensor->id, status);
+        return false;
+    }
+    sensor->frequency_hz = decision.frequency_hz;
+    ESP_LOGI(TAG, "Sensor %u: frequência adaptativa entre %d e %d Hz (%u ms de integração, sono de %d ms entre rajadas).",
+             sensor->id, SENSOR_RATE_MIN_HZ, SENSOR_RATE_MAX_HZ, decision.integration_ms, SENSOR_RATE_SLEEP_MS);
+    return true;
+}
+
+/**
+ * @brief Passa um frame publicado ao controle adaptativo e reprograma o sensor quando ele pede.
+ *
+ * A carga considerada é a da fila mais cheia entre SD e UART, já com o frame
+ * recém-publicado.
+ *
+ * @param sensor Sensor que produziu o frame.
+ * @param frame Frame publicado.
+ */
+static void update_sensor_rate(tof_sensor_t* sensor, const tof_frame_t* frame) {
+    tof_consumer_t* consumers[] = { &s_sd_consumer, &s_uart_consumer };
+    uint32_t queue_pct = 0;
+    for (size_t i = 0; i < sizeof(consumers) / sizeof(consumers[0]); i++) {
+        tof_frame_ring_t* ring = &consumers[i]->ring;
+        uint32_t pct = (uint32_t)tof_frame_ring_count(ring) * 100u / (ring->mask + 1u);
+        if (pct > queue_pct) {
+            queue_pct = pct;
+        }
+    }
+
+    tof_rate_decision_t decision;
+    if (tof_rate_update(&sensor->rate, frame, (uint8_t)queue_pct, &decision)) {
+        vl53l8ch_apply_rate(sensor, &decision);
+    }
+}
+
+/**
+ * @brief Para o ranging, programa a nova frequência e reinicia o sensor ou o põe em sleep.
+ *
+ * A frequência e o tempo de integração só podem mudar com o ranging parado.
+ * Com decision->sleep_ms o sensor fica em VL53LMZ_POWER_MODE_SLEEP (firmware
+ * e configuração preservados) até wake_sleeping_sensors().
+ *
+ * @param sensor Sensor a ser reprogramado.
+ * @param decision Configuração pedida pelo controle.
+ */
+static void vl53l8ch_apply_rate(tof_sensor_t* sensor, const tof_rate_decision_t* decision) {
+    uint8_t status = vl53lmz_stop_ranging(&sensor->dev);
+    if (decision->frequency_hz != sensor->frequency_hz) {
+        status |= vl53lmz_set_ranging_frequency_hz(&sensor->dev, decision->frequency_hz);
+        status |= vl53lmz_set_integration_time_ms(&sensor->dev, decision->integration_ms);
+        sensor->frequency_hz = decision->frequency_hz;
+    }
+    if (status != VL53LMZ_STATUS_OK) {
+        ESP_LOGE(TAG, "Sensor %u: falha ao mudar a frequência para %u Hz (status %u).",
+                 sensor->id, decision->frequency_hz, status);
+    }
+
+    if (decision->sleep_ms > 0) {
+        status = vl53lmz_set_power_mode(&sensor->dev, VL53LMZ_POWER_MODE_SLEEP);
+        if (status == VL53LMZ_STATUS_OK) {
+            sensor->wake_at_us = esp_timer_get_time() + (int64_t)decision->sleep_ms * 1000;
+            s_rate_sleeping |= 1u << sensor->id;
+            return;
+        }
+        ESP_LOGE(TAG, "Sensor %u: falha ao entrar em sleep (status %u).", sensor->id, status);
+    }
+    vl53l8ch_start_ranging(sensor);
+}
+
+/**
+ * @brief Acorda e reinicia os sensores cujo sono entre rajadas terminou.
+ */
+static void wake_sleeping_sensors(void) {
+    if (s_rate_sleeping == 0) {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        tof_sensor_t* sensor = &s_sensors[i];
+        if (!(s_rate_sleeping & (1u << i)) || now_us < sensor->wake_at_us) {
+            continue;
+        }
+        uint8_t status = vl53lmz_set_power_mode(&sensor->dev, VL53LMZ_POWER_MODE_WAKEUP);
+        if (status != VL53LMZ_STATUS_OK) {
+            ESP_LOGE(TAG, "Sensor %u: falha ao acordar do sleep (status %u).", sensor->id, status);
+        }
+        vl53l8ch_start_ranging(sensor);
+        s_rate_sleeping &= ~(1u << i);
+    }
+}
+
+/**
+ * @brief Tempo até o próximo fim de sono entre rajadas.
+ * @param limit_ms Maior espera aceita (a espera normal, sem sensores em sleep).
+ * @return Milissegundos até o sensor que acorda primeiro, no máximo limit_ms.
+ */
+static uint32_t next_wake_ms(uint32_t limit_ms) {
+    if (s_rate_sleeping == 0) {
+        return limit_ms;
+    }
+    int64_t now_us = esp_timer_get_time();
+    uint32_t wait_ms = limit_ms;
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        if (!(s_rate_sleeping & (1u << i))) {
+            continue;
+        }
+        int64_t left_us = s_sensors[i].wake_at_us - now_us;
+        uint32_t left_ms = left_us <= 0 ? 0 : (uint32_t)((left_us + 999) / 1000);
+        if (left_ms < wait_ms) {
+            wait_ms = left_ms;
+        }
+    }
+    return wait_ms;
+}
+
+/**
+ * @brief Imprime no log a frequência atual e os contadores do controle adaptativo de um sensor.
+ * @param sensor Sensor a ser reportado.
+ */
+static void log_rate_stats(tof_sensor_t* sensor) {
+    tof_rate_stats_t stats = tof_rate_get_stats(&sensor->rate);
+    ESP_LOGI(TAG, "Frequência %u: %u Hz (%u ms de integração, teto %u Hz), %lu de %lu frames ativos, "
+             "%lu mudanças, %lu sonos, %lu reduções pela carga das filas",
+             sensor->id, sensor->rate.decision.frequency_hz, sensor->rate.decision.integration_ms,
+             sensor->rate.cap_hz, (unsigned long)stats.active_frames, (unsigned long)stats.frames,
+             (unsigned long)stats.rate_changes, (unsigned long)stats.sleeps, (unsigned long)stats.backoffs);
+}
+#endif
+
+/**
+ * @brief Cria e inicia as tarefas do pipeline do sensor ToF.
+ *
+ * A tarefa de aquisição roda fixa no core de aplicação (APP_CPU), com
+ * prioridade maior; as tarefas de SD e UART rodam no core de protocolo
+ * (PRO_CPU), cada uma alimentada por sua própria fila SPSC.
+ */
+void start_tof_sensor_task(void) {
+    tof_frame_ring_init(&s_sd_consumer.ring, s_sd_slots, SENSOR_SD_RING_CAPACITY);
+    tof_frame_ring_init(&s_uart_consumer.ring, s_uart_slots, SENSOR_UART_RING_CAPACITY);
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        tof_frame_pub_init(&s_frame_pubs[i], s_pub_slots[i], SENSOR_PUB_SLOTS);
+    }
+
+    // A aquisição é criada primeiro para o download do firmware começar o quanto
+    // antes; a montagem do SD e a UART sobem em paralelo no outro core, bem antes
+    // do primeiro frame (publish_frame() tolera consumidores ainda sem tarefa)
+    xTaskCreatePinnedToCore(
+        tof_sensor_task,
+        "tof_sensor_task",
+        4096,
+        NULL,
+        10,
+        NULL,
+        APP_CPU_NUM
+    );
+    xTaskCreatePinnedToCore(
+        tof_sd_task,
+        "tof_sd_task",      // Nome da tarefa para depuração
+        4096,               // Tamanho da pilha em words (4 bytes por word)
+        &s_sd_consumer,     // Parâmetros da tarefa
+        4,                  // Prioridade da tarefa (0 é a mais baixa)
+        &s_sd_consumer.task,
+        PRO_CPU_NUM
+    );
+    xTaskCreatePinnedToCore(
+        tof_uart_task,
+        "tof_uart_task",
+        3072,
+        &s_uart_consumer,
+        3,
+        &s_uart_consumer.task,
+        PRO_CPU_NUM
+    );
+#if SENSOR_OBSTACLE_MODE
+    // Acima do SD e da UART: a latência até o CAN não depende da escrita no cartão
+    xTaskCreatePinnedToCore(
+        tof_can_task,
+        "tof_can_task",
+        3072,
+        NULL,
+        5,
+        NULL,
+        PRO_CPU_NUM
+    );
+#endif
+}
+
+
+/**
+ * @brief Configura o pino INT do sensor como entrada com interrupção na borda de descida.
+ * @param sensor Sensor cujo pino INT será configurado.
+ * @return true se o pino e a ISR foram configurados com sucesso.
+ */
+static bool setup_sensor_int_gpio(tof_sensor_t* sensor) {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << sensor->pins->int_gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    if (gpio_config(&io_conf) != ESP_OK) {
+        return false;
+    }
+
+    // O serviço de ISR pode já ter sido instalado por outro componente
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return false;
+    }
+    return gpio_isr_handler_add(sensor->pins->int_gpio, sensor_int_isr_handler, sensor) == ESP_OK;
+}
+
+/**
+ * @brief Aguarda o próximo frame dos sensores.
+ *
+ * No modo de interrupção a tarefa fica bloqueada (sem consumir CPU) até a ISR
+ * do pino INT de algum sensor notificá-la; as interrupções que chegam durante
+ * as leituras se acumulam nos bits da notificação. No modo de polling a tarefa
+ * apenas dorme SENSOR_POLLING_RATE_MS e consulta todos os sensores.
+ *
+ * No modo de eventos a falta de interrupções é o normal: após
+ * SENSOR_EVENT_POLL_MS sem evento todos os sensores são consultados, o que
+ * recupera um pulso de INT perdido durante o despertar do light sleep.
+ *
+ * Com o controle adaptativo (SENSOR_RATE_MODE) e algum sensor em sleep entre
+ * rajadas, a espera termina no fim do sono mais próximo, para que a tarefa o
+ * acorde no horário.
+ *
+ * @return Bits dos sensores a consultar (bit i = sensor i), ou 0 em caso de timeout.
+ */
+static uint32_t wait_for_sensor_frames(void) {
+#if SENSOR_ACQ_MODE == SENSOR_ACQ_MODE_INTERRUPT && SENSOR_EVENT_MODE
+    uint32_t pending = 0;
+    if (xTaskNotifyWait(0, SENSOR_ALL_MASK, &pending, pdMS_TO_TICKS(SENSOR_EVENT_POLL_MS)) != pdTRUE) {
+        return SENSOR_ALL_MASK;
+    }
+    s_event_wakeups++;
+    return pending & SENSOR_ALL_MASK;
+#elif SENSOR_ACQ_MODE == SENSOR_ACQ_MODE_INTERRUPT
+    uint32_t pending = 0;
+#if SENSOR_RATE_MODE
+    // Com um sensor em sleep a espera termina no fim do sono, e a falta de INT é esperada
+    uint32_t timeout_ms = next_wake_ms(SENSOR_INT_TIMEOUT_MS);
+    bool sleeping = s_rate_sleeping != 0;
+#else
+    uint32_t timeout_ms = SENSOR_INT_TIMEOUT_MS;
+    bool sleeping = false;
+#endif
+    if (xTaskNotifyWait(0, SENSOR_ALL_MASK, &pending, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        if (!sleeping) {
+            ESP_LOGW(TAG, "Nenhuma interrupção dos sensores em %d ms.", SENSOR_INT_TIMEOUT_MS);
+        }
+        return 0;
+    }
+    return pending & SENSOR_ALL_MASK;
+#else
+    vTaskDelay(pdMS_TO_TICKS(SENSOR_POLLING_RATE_MS));
+    return SENSOR_ALL_MASK;
+#endif
+}
+
+/**
+ * @brief Formata e imprime um buffer para o console.
+ * @param prefix String de texto para preceder a saída hexadecimal.
+ * @param buffer Ponteiro para o buffer de dados a ser impresso.
+ * @param len Número de bytes a serem impressos do buffer.
+ */
+static void print_raw_data_as_hex(const char* prefix, const uint8_t* buffer, size_t len) {
+    printf("%s: \t", prefix);
+    for (size_t i = 0; i < len; i++) {
+        printf("%02X", buffer[i]);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Instala o driver da UART de saída.
+ * A UART já foi configurada pelo bootloader para o console (baud rate e
+ * pinos), então basta instalar o driver com um buffer de transmissão; com o
+ * console redirecionado para o driver, printf e ESP_LOG passam pelo mesmo
+ * buffer e mantêm a ordem com os pacotes binários.
+ * @return true se o driver foi instalado.
+ */
+static bool setup_uart_stream(void) {
+    esp_err_t ret = uart_driver_install(UART_STREAM_PORT, UART_STREAM_RX_BUFFER_SIZE,
+                                        UART_STREAM_TX_BUFFER_SIZE, 0, NULL, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Falha ao instalar o driver da UART (%s).", esp_err_to_name(ret));
+        return false;
+    }
+    uart_vfs_dev_use_driver(UART_STREAM_PORT);
+    return true;
+}
+
+/**
+ * @brief Configura e monta o cartão SD.
+ *
+ * O cartão fica no slot 1 do host SDMMC, cujos pinos no ESP32 são fixos pelo
+ * IO MUX (CLK = GPIO 14, CMD = GPIO 15, D0 = GPIO 2) e não disputam o
+ * barramento SPI dos sensores e dos CAN. Um cartão que não monta não é
+ * formatado: o log do SD fica desativado até o próximo reset, com um único
+ * erro no log.
+ *
+ * @warning Conferir a ligação com o hardware específico: CMD e D0 precisam de pull-up externo
+ * de 10 kΩ (o pull-up interno só serve para protótipos).
+ * @return true se o FAT foi montado em SD_CARD_MOUNT_POINT.
+ */
+static bool setup_sd_card(void) {
+    const esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+        .format_if_mount_failed = false,
+        .max_files = SD_CARD_MAX_FILES,
+        .allocation_unit_size = 0,
+    };
+    sdmmc_host_t host = SDMMC_HOST_DEFAULT();
+    sdmmc_slot_config_t slot_config = SDMMC_SLOT_CONFIG_DEFAULT();
+    slot_config.width = SD_CARD_BUS_WIDTH;
+    slot_config.flags |= SDMMC_SLOT_FLAG_INTERNAL_PULLUP;
+
+    esp_err_t ret = esp_vfs_fat_sdmmc_mount(SD_CARD_MOUNT_POINT, &host, &slot_config, &mount_config, &s_sd_card);
+    if (ret != ESP_OK) {
+        s_sd_card = NULL;
+        ESP_LOGE(TAG, "Falha ao montar o cartão SD em %s (%s); os frames não serão gravados até o próximo reset.",
+                 SD_CARD_MOUNT_POINT, esp_err_to_name(ret));
+        return false;
+    }
+    ESP_LOGI(TAG, "Cartão SD %s montado em %s (%llu MB).", s_sd_card->cid.name, SD_CARD_MOUNT_POINT,
+             (unsigned long long)s_sd_card->csd.capacity * s_sd_card->csd.sector_size / (1024 * 1024));
+    return true;
+}
+
+/**
+ * @brief Máquina de estados da inicialização dos sensores.
+ *
+ * Executa as etapas de sensor_boot_state_t até o início do ranging, cada uma
+ * em todos os sensores, marcando o fim de cada etapa em s_boot_end_us. As
+ * esperas do driver liberam o core, e a montagem do SD e a instalação da UART
+ * correm em paralelo nas tarefas consumidoras; a etapa
+ * SENSOR_BOOT_FIRST_FRAME é concluída pelo loop de aquisição, que então
+ * reporta os tempos com log_boot_times().
+ *
+ * @return true se o ranging foi iniciado; false indica a etapa que falhou no log.
+ */
+static bool run_sensor_boot(void) {
+    s_boot_start_us = esp_timer_get_time();
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        s_sensors[i].id = (uint8_t)i;
+        s_sensors[i].pins = &s_sensor_pins[i];
+    }
+    for (sensor_boot_state_t state = SENSOR_BOOT_BUS; state < SENSOR_BOOT_FIRST_FRAME; state++) {
+        bool ok;
+        switch (state) {
+            case SENSOR_BOOT_BUS:       ok = setup_spi_bus() && for_each_sensor(vl53l8ch_setup_bus); break;
+            case SENSOR_BOOT_DETECT:    ok = for_each_sensor(vl53l8ch_detect); break;
+            case SENSOR_BOOT_FIRMWARE:  ok = for_each_sensor(vl53l8ch_load_firmware); break;
+#if SENSOR_CAL_CACHE
+            case SENSOR_BOOT_CALIBRATION: ok = for_each_sensor(vl53l8ch_load_calibration); break;
+#else
+            case SENSOR_BOOT_CALIBRATION: ok = true; break;
+#endif
+            case SENSOR_BOOT_CONFIGURE: ok = for_each_sensor(vl53l8ch_configure); break;
+#if SENSOR_ACQ_MODE == SENSOR_ACQ_MODE_INTERRUPT
+            case SENSOR_BOOT_INT_GPIO:  ok = for_each_sensor(setup_sensor_int_gpio); break;
+#else
+            case SENSOR_BOOT_INT_GPIO:  ok = true; break;
+#endif
+            case SENSOR_BOOT_START:     ok = start_all_sensors(); break;
+            default:                    ok = false; break;
+        }
+        if (!ok) {
+            ESP_LOGE(TAG, "Inicialização interrompida na etapa \"%s\".", s_boot_state_names[state]);
+            return false;
+        }
+        s_boot_end_us[state] = esp_timer_get_time();
+    }
+    log_sensor_ram_usage();
+    return true;
+}
+
+/**
+ * @brief Aplica uma etapa da inicialização a cada sensor, em ordem de sensor_id.
+ * @param step Etapa a aplicar.
+ * @return true se a etapa teve sucesso em todos os sensores.
+ */
+static bool for_each_sensor(bool (*step)(tof_sensor_t* sensor)) {
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        if (!step(&s_sensors[i])) {
+            ESP_LOGE(TAG, "Sensor %d falhou na inicialização.", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Imprime no log a duração de cada etapa da inicialização e o tempo até o primeiro frame válido.
+ *
+ * O total é contado desde o reset do chip (esp_timer), incluindo o bootloader
+ * e a inicialização do ESP-IDF antes da tarefa de aquisição.
+ */
+static void log_boot_times(void) {
+    char breakdown[256];
+    size_t len = 0;
+    int64_t prev_us = s_boot_start_us;
+    for (int state = SENSOR_BOOT_BUS; state < SENSOR_BOOT_DONE && len < sizeof(breakdown); state++) {
+        len += (size_t)snprintf(&breakdown[len], sizeof(breakdown) - len, "%s%s %lu ms",
+                                state == SENSOR_BOOT_BUS ? "" : ", ", s_boot_state_names[state],
+                                (unsigned long)((s_boot_end_us[state] - prev_us) / 1000));
+        prev_us = s_boot_end_us[state];
+    }
+    uint32_t sd_ready_ms = atomic_load(&s_sd_ready_ms);
+    ESP_LOGI(TAG, "Boot: %s", breakdown);
+    ESP_LOGI(TAG, "Primeiro frame válido %lu ms após o reset (tarefa iniciada em %lu ms); SD %s %lu ms.",
+             (unsigned long)(s_boot_end_us[SENSOR_BOOT_FIRST_FRAME] / 1000),
+             (unsigned long)(s_boot_start_us / 1000),
+             sd_ready_ms != 0 ? "pronto em" : "ainda não pronto após",
+             (unsigned long)(sd_ready_ms != 0 ? sd_ready_ms : esp_timer_get_time() / 1000));
+}
+
+/**
+ * @brief Indica se o frame tem ao menos um alvo válido (critério de tof_frame_target_is_valid()).
+ * @param frame Frame recém-adquirido.
+ * @return true se alguma zona tem um alvo válido.
+ */
+static bool frame_has_valid_target(const tof_frame_t* frame) {
+    uint64_t any = 0;
+    for (int target = 0; target < TOF_FRAME_TARGETS_PER_ZONE; target++) {
+        any |= tof_frame_valid_mask(frame, target);
+    }
+    return any != 0;
+}
+
+/**
+ * @brief Inicializa o barramento SPI compartilhado pelos sensores e pelos controladores CAN.
+ * O barramento pode já ter sido inicializado por outro componente; nesse caso
+ * o tamanho máximo de transação é desconhecido e o download do firmware usa os
+ * blocos normais.
+ * @warning Os pinos do barramento (SENSOR_SPI_*_GPIO) devem ser ajustados conforme o hardware específico.
+ * @return true se o barramento está disponível.
+ */
+static bool setup_spi_bus(void) {
+    spi_bus_config_t bus_cfg = {
+        .mosi_io_num = SENSOR_SPI_MOSI_GPIO,
+        .miso_io_num = SENSOR_SPI_MISO_GPIO,
+        .sclk_io_num = SENSOR_SPI_SCLK_GPIO,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = VL53LMZ_PLATFORM_BULK_CHUNK_SIZE,
+    };
+    esp_err_t err = spi_bus_initialize(SENSOR_SPI_HOST, &bus_cfg, SPI_DMA_CH_AUTO);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Falha ao inicializar o barramento SPI (%s).", esp_err_to_name(err));
+        return false;
+    }
+    s_sensor_bus_owned = err == ESP_OK;
+    return true;
+}
+
+/**
+ * @brief Registra um sensor no barramento SPI, com o seu próprio chip select.
+ * No SPI cada sensor é selecionado pelo CS, então todos mantêm o endereço
+ * padrão (vl53lmz_set_i2c_address só é necessário no I2C).
+ * @param sensor Sensor a ser registrado.
+ * @return true se o sensor foi registrado no barramento.
+ */
+static bool vl53l8ch_setup_bus(tof_sensor_t* sensor) {
+    const VL53LMZ_PlatformSpiConfig spi_cfg = {
+        .host = SENSOR_SPI_HOST,
+        .cs_gpio = sensor->pins->cs_gpio,
+        .clock_hz = SENSOR_SPI_CLOCK_HZ,
+        .input_delay_ns = SENSOR_SPI_INPUT_DELAY_NS,
+    };
+#ifdef VL53LMZ_EXTERNAL_TEMP_BUFFER
+    sensor->dev.temp_buffer = s_sensor_scratch;
+#endif
+    sensor->dev.platform.address = VL53LMZ_DEFAULT_I2C_ADDRESS;
+    esp_err_t err = VL53LMZ_PlatformInit(&sensor->dev.platform, &spi_cfg);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Sensor %u: falha ao registrar no barramento SPI (%s).", sensor->id, esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Verifica se o sensor responde no barramento.
+ * @param sensor Sensor a ser verificado.
+ * @return true se um módulo VL53L5/L7/L8 foi identificado.
+ */
+static bool vl53l8ch_detect(tof_sensor_t* sensor) {
+    uint8_t is_alive = 0;
+    if (vl53lmz_is_alive(&sensor->dev, &is_alive) != VL53LMZ_STATUS_OK || !is_alive) {
+        ESP_LOGE(TAG, "Sensor %u: VL53L8CH não respondeu no barramento SPI.", sensor->id);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Baixa o firmware do VL53L8CH e aplica a calibração e a configuração padrão (vl53lmz_init).
+ *
+ * Quando o barramento foi inicializado por este módulo, o download usa o modo
+ * de inicialização da plataforma (transações de VL53LMZ_PLATFORM_BULK_CHUNK_SIZE
+ * bytes); ele é desfeito antes do ranging, quando o CAN volta a precisar de
+ * latência baixa.
+ *
+ * @param sensor Sensor que recebe o firmware.
+ * @return true se o firmware foi carregado.
+ */
+static bool vl53l8ch_load_firmware(tof_sensor_t* sensor) {
+    if (s_sensor_bus_owned && VL53LMZ_PlatformBeginBulk(&sensor->dev.platform) != ESP_OK) {
+        ESP_LOGW(TAG, "Sensor %u: sem memória DMA para o download rápido; usando blocos de %d bytes.",
+                 sensor->id, VL53LMZ_PLATFORM_CHUNK_SIZE);
+    }
+    uint8_t status = vl53lmz_init(&sensor->dev);
+    VL53LMZ_PlatformEndBulk(&sensor->dev.platform);
+    if (status != VL53LMZ_STATUS_OK) {
+        ESP_LOGE(TAG, "Sensor %u: vl53lmz_init falhou (status %u).", sensor->id, status);
+        return false;
+    }
+    return true;
+}
+
+#if SENSOR_CAL_CACHE
+/**
+ * @brief Etapa SENSOR_BOOT_CALIBRATION: xtalk do cache na NVS ou recalibração.
+ *
+ * vl53lmz_init deixa em dev.xtalk_data o xtalk padrão do driver. Com um
+ * registro válido para o módulo, o blob salvo substitui o padrão só na RAM:
+ * vl53lmz_set_resolution, chamado na etapa de configuração, já reenvia os
+ * offsets e o xtalk ao sensor, então o cache não custa nenhuma transferência
+ * a mais. Sem cache válido o sensor é recalibrado (SENSOR_CAL_RECALIBRATE)
+ * ou segue com o xtalk padrão: a NVS só é gravada depois de uma recalibração.
+ *
+ * @param sensor Sensor com o firmware já carregado.
+ * @return false apenas se a calibração pedida falhar no sensor.
+ */
+static bool vl53l8ch_load_calibration(tof_sensor_t* sensor) {
+    uint32_t offset_crc = tof_crc32(0, sensor->dev.offset_data, sizeof(sensor->dev.offset_data));
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    snprintf(key, sizeof(key), "xt_%u_%u", sensor->id, sensor->dev.module_type);
+
+    nvs_handle_t handle;
+    if (!open_cal_nvs(&handle)) {
+        return true;
+    }
+    tof_cal_record_t* record = &s_cal_record;
+    nvs_cal_read_t read = { .handle = handle, .err = ESP_OK };
+    tof_cal_load_result_t result = tof_cal_load(read_cal_blob, &read, key, record, sensor->id,
+                                                sensor->dev.module_type, offset_crc);
+    if (result == TOF_CAL_LOADED) {
+        memcpy(sensor->dev.xtalk_data, record->xtalk, sizeof(record->xtalk));
+        nvs_close(handle);
+        ESP_LOGI(TAG, "Sensor %u: xtalk carregado do cache (%s).", sensor->id, key);
+        return true;
+    }
+    ESP_LOGW(TAG, "Sensor %u: cache de calibração %s.", sensor->id,
+             result == TOF_CAL_MISSING ? "ausente" : result == TOF_CAL_MISMATCH ? "de outro módulo ou corrompido"
+                                                                                : esp_err_to_name(read.err));
+
+#if SENSOR_CAL_RECALIBRATE
+    ESP_LOGI(TAG, "Sensor %u: calibrando o xtalk (alvo de %d%% a %d mm).", sensor->id,
+             SENSOR_CAL_XTALK_REFLECTANCE_PCT, SENSOR_CAL_XTALK_DISTANCE_MM);
+    uint8_t status = vl53lmz_calibrate_xtalk(&sensor->dev, SENSOR_CAL_XTALK_REFLECTANCE_PCT,
+                                             SENSOR_CAL_XTALK_SAMPLES, SENSOR_CAL_XTALK_DISTANCE_MM);
+    if (status != VL53LMZ_STATUS_OK) {
+        nvs_close(handle);
+        ESP_LOGE(TAG, "Sensor %u: vl53lmz_calibrate_xtalk falhou (status %u).", sensor->id, status);
+        return false;
+    }
+    tof_cal_record_make(record, sensor->id, sensor->dev.module_type, offset_crc, sensor->dev.xtalk_data);
+    esp_err_t err = nvs_set_blob(handle, key, record, sizeof(*record));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Sensor %u: falha ao gravar o cache de calibração (%s).", sensor->id, esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "Sensor %u: xtalk calibrado e gravado em %s.", sensor->id, key);
+    }
+#else
+    ESP_LOGW(TAG, "Sensor %u: usando o xtalk padrão do driver (SENSOR_CAL_RECALIBRATE desligado).", sensor->id);
+#endif
+    nvs_close(handle);
+    return true;
+}
+
+/**
+ * @brief Abre o namespace de calibração, inicializando a partição NVS na primeira chamada.
+ *
+ * Uma partição sem páginas livres ou gravada por outra versão do ESP-IDF é
+ * apagada: o cache só perde os registros, que são refeitos na calibração.
+ *
+ * @param handle Handle aberto em modo leitura e escrita.
+ * @return true se o namespace foi aberto; false deixa o sensor com o xtalk padrão.
+ */
+static bool open_cal_nvs(nvs_handle_t* handle) {
+    if (!s_cal_nvs_ready) {
+        esp_err_t err = nvs_flash_init();
+        if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+            ESP_LOGW(TAG, "Partição NVS incompatível (%s); apagando.", esp_err_to_name(err));
+            err = nvs_flash_erase();
+            if (err == ESP_OK) {
+                err = nvs_flash_init();
+            }
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Falha ao inicializar a NVS (%s); cache de calibração desativado.", esp_err_to_name(err));
+            return false;
+        }
+        s_cal_nvs_ready = true;
+    }
+    esp_err_t err = nvs_open(SENSOR_CAL_NVS_NAMESPACE, NVS_READWRITE, handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Falha ao abrir o namespace \"%s\" (%s).", SENSOR_CAL_NVS_NAMESPACE, esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Leitura de blob de tof_cal_load() sobre nvs_get_blob().
+ * @param ctx nvs_cal_read_t com o namespace aberto; guarda o erro da NVS para o log.
+ * @return Situação da leitura no formato de tof_cal.
+ */
+static tof_cal_read_status_t read_cal_blob(void* ctx, const char* key, void* out, size_t* len) {
+    nvs_cal_read_t* read = ctx;
+    read->err = nvs_get_blob(read->handle, key, out, len);
+    return read->err == ESP_OK ? TOF_CAL_READ_OK
+         : read->err == ESP_ERR_NVS_NOT_FOUND ? TOF_CAL_READ_NOT_FOUND : TOF_CAL_READ_FAILED;
+}
+#endif
+
+/**
+ * @brief Aplica a resolução, a frequência de ranging e, com SENSOR_SYNC_GPIO, o pino de sincronismo.
+ *
+ * Com o sincronismo habilitado o sensor só inicia cada medição no pulso do
+ * pino SYNC, e a frequência programada passa a ser o limite superior.
+ *
+ * @param sensor Sensor a ser configurado.
+ * @return true se o sensor aceitou a configuração.
+ */
+static bool vl53l8ch_configure(tof_sensor_t* sensor) {
+    uint8_t status = vl53lmz_set_resolution(&sensor->dev, SENSOR_RESOLUTION);
+    status |= vl53lmz_set_ranging_frequency_hz(&sensor->dev, SENSOR_RANGING_FREQUENCY_HZ);
+    sensor->resolution = SENSOR_RESOLUTION;
+    sensor->frequency_hz = SENSOR_RANGING_FREQUENCY_HZ;
+#if SENSOR_EVENT_MODE
+    if (status == VL53LMZ_STATUS_OK && !vl53l8ch_configure_event_mode(sensor)) {
+        return false;
+    }
+#endif
+#if SENSOR_MOTION_MODE
+    if (status == VL53LMZ_STATUS_OK && !vl53l8ch_configure_motion_mode(sensor)) {
+        return false;
+    }
+#endif
+#if SENSOR_CNH_MODE
+    if (status == VL53LMZ_STATUS_OK && !vl53l8ch_configure_cnh_mode(sensor)) {
+        return false;
+    }
+#endif
+#if SENSOR_RATE_MODE
+    if (status == VL53LMZ_STATUS_OK && !vl53l8ch_configure_rate_mode(sensor)) {
+        return false;
+    }
+#endif
+#if SENSOR_ROI_MODE
+    if (status == VL53LMZ_STATUS_OK && !vl53l8ch_configure_roi_mode(sensor)) {
+        return false;
+    }
+#endif
+#if SENSOR_SYNC_GPIO >= 0
+    status |= vl53lmz_set_external_sync_pin_enable(&sensor->dev, 1);
+#endif
+    if (status != VL53LMZ_STATUS_OK) {
+        ESP_LOGE(TAG, "Sensor %u: falha ao configurar resolução e frequência (status %u).", sensor->id, status);
+        return false;
+    }
+
+    ESP_LOGI(TAG, "VL53L8CH %u inicializado (módulo %u, revisão %u).",
+             sensor->id, sensor->dev.module_type, sensor->dev.revision_id);
+    return true;
+}
+
+#if SENSOR_MOTION_MODE
+/**
+ * @brief Configura o indicador de movimento do sensor.
+ *
+ * vl53lmz_motion_indicator_init() programa os agregados da resolução (uma
+ * zona por agregado em 4x4, pares de zonas em 8x8) e a faixa de distâncias
+ * define a janela do histograma em que o sensor procura mudanças. A
+ * configuração só é usada durante a chamada e fica em um buffer estático,
+ * já que só a tarefa de aquisição configura os sensores.
+ *
+ * @param sensor Sensor já com a resolução programada.
+ * @return true se o sensor aceitou a configuração.
+ */
+static bool vl53l8ch_configure_motion_mode(tof_sensor_t* sensor) {
+    static VL53LMZ_Motion_Configuration motion_config;
+    uint8_t status = vl53lmz_motion_indicator_init(&sensor->dev, &motion_config, SENSOR_RESOLUTION);
+    status |= vl53lmz_motion_indicator_set_distance_motion(&sensor->dev, &motion_config,
+                                                           SENSOR_MOTION_DISTANCE_MIN_MM, SENSOR_MOTION_DISTANCE_MAX_MM);
+    if (status != VL53LMZ_STATUS_OK) {
+        ESP_LOGE(TAG, "Sensor %u: falha ao configurar o indicador de movimento (status %u).", sensor->id, status);
+        return false;
+    }
+    ESP_LOGI(TAG, "Sensor %u: indicador de movimento entre %d e %d mm, %u agregados.",
+             sensor->id, SENSOR_MOTION_DISTANCE_MIN_MM, SENSOR_MOTION_DISTANCE_MAX_MM,
+             (unsigned)motion_config.nb_of_aggregates);
+    return true;
+}
+#endif
+
+#if SENSOR_CNH_MODE
+/**
+ * @brief Programa a captura CNH do sensor.
+ *
+ * Os agregados cobrem a matriz em quadrados de SENSOR_CNH_AGG_MERGE zonas
+ * por lado, cada um com SENSOR_CNH_NUM_BINS bins que somam
+ * SENSOR_CNH_SUB_SAMPLE bins do histograma do sensor a partir de
+ * SENSOR_CNH_START_BIN. Todos os sensores usam a mesma configuração, que
+ * fica em s_cnh_config para o consumidor localizar os agregados no bloco. O
+ * bloco CNH entra na saída do sensor em vl53l8ch_start_ranging().
+ *
+ * @param sensor Sensor já com a resolução programada.
+ * @return true se o sensor aceitou a configuração.
+ */
+static bool vl53l8ch_configure_cnh_mode(tof_sensor_t* sensor) {
+    uint32_t size = 0;
+    uint8_t status = vl53lmz_motion_indicator_init(&sensor->dev, &s_cnh_config, SENSOR_RESOLUTION);
+    status |= vl53lmz_cnh_init_config(&s_cnh_config, SENSOR_CNH_START_BIN, SENSOR_CNH_NUM_BINS, SENSOR_CNH_SUB_SAMPLE);
+    status |= vl53lmz_cnh_create_agg_map(&s_cnh_config, SENSOR_RESOLUTION, 0, 0, SENSOR_CNH_AGG_MERGE,
+                                         SENSOR_CNH_AGG_MERGE, SENSOR_CNH_AGG_SIDE, SENSOR_CNH_AGG_SIDE);
+    status |= vl53lmz_cnh_calc_required_memory(&s_cnh_config, &size);
+    if (status == VL53LMZ_STATUS_OK) {
+        status |= vl53lmz_cnh_send_config(&sensor->dev, &s_cnh_config);
+    }
+    if (status != VL53LMZ_STATUS_OK) {
+        ESP_LOGE(TAG, "Sensor %u: falha ao configurar o CNH (status %u, bloco de %lu bytes).",
+                 sensor->id, status, (unsigned long)size);
+        return false;
+    }
+    s_cnh_words = size / sizeof(uint32_t);
+    int16_t min_mm = 0;
+    int16_t max_mm = 0;
+    vl53lmz_cnh_calc_min_max_distance(&s_cnh_config, &min_mm, &max_mm);
+    ESP_LOGI(TAG, "Sensor %u: CNH com %u agregados x %u bins entre %d e %d mm, bloco de %lu bytes por frame.",
+             sensor->id, (unsigned)s_cnh_config.nb_of_aggregates, (unsigned)s_cnh_config.feature_length,
+             min_mm, max_mm, (unsigned long)size);
+    return true;
+}
+
+/**
+ * @brief Copia o bloco CNH da visão para o slot livre do ping-pong.
+ *
+ * Chamada pela tarefa de aquisição enquanto a visão ainda aponta para o
+ * buffer temporário; se o consumidor ainda não devolveu o slot, o bloco é
+ * descartado e contabilizado, sem esperar. A sequência é a que
+ * acquire_sensor_frame() atribui ao frame lido.
+ * @param sensor Sensor lido.
+ * @param view Visão com VL53LMZ_VIEW_CNH_DATA.
+ */
+static void capture_cnh_block(const tof_sensor_t* sensor, const VL53LMZ_ResultsView* view) {
+    sensor_cnh_slot_t* slot = &s_cnh_slots[s_cnh_head & 1u];
+    if (atomic_load_explicit(&slot->ready, memory_order_acquire)) {
+        atomic_fetch_add_explicit(&s_cnh_dropped, 1, memory_order_relaxed);
+        return;
+    }
+    if (vl53lmz_view_copy_cnh_data(view, slot->words, (uint16_t)s_cnh_words) < s_cnh_words) {
+        return;
+    }
+    slot->timestamp_us = esp_timer_get_time();
+    slot->sequence = sensor->sequence;
+    slot->sensor_id = sensor->id;
+    atomic_store_explicit(&slot->ready, true, memory_order_release);
+    s_cnh_head++;
+}
+#endif
+
+#if SENSOR_EVENT_MODE
+/**
+ * @brief Programa os limiares de detecção e o ranging autônomo do modo de eventos.
+ *
+ * Cada regra de s_event_windows vira um limiar do driver por zona coberta,
+ * agrupados zona a zona como o firmware do sensor exige. Com os limiares
+ * habilitados o sensor continua medindo a SENSOR_EVENT_RANGING_FREQUENCY_HZ,
+ * mas só gera a interrupção nos frames em que alguma zona dispara; a
+ * integração curta do modo autônomo reduz também o consumo do sensor.
+ *
+ * @param sensor Sensor já com a resolução programada.
+ * @return true se o sensor aceitou a configuração.
+ */
+static bool vl53l8ch_configure_event_mode(tof_sensor_t* sensor) {
+    static VL53LMZ_DetectionThresholds thresholds[VL53LMZ_NB_THRESHOLDS];
+    const size_t rules = sizeof(s_event_windows) / sizeof(s_event_windows[0]);
+    const int zones = SENSOR_RESOLUTION;
+    size_t count = 0;
+
+    memset(thresholds, 0, sizeof(thresholds));
+    for (int z = 0; z < zones; z++) {
+        bool first = true;
+        for (size_t r = 0; r < rules; r++) {
+            const sensor_event_window_t* rule = &s_event_windows[r];
+            if (rule->zone != SENSOR_EVENT_ALL_ZONES && rule->zone != z) {
+                continue;
+            }
+            if (count == VL53LMZ_NB_THRESHOLDS) {
+                ESP_LOGE(TAG, "Sensor %u: as regras de eventos precisam de mais de %d limiares.",
+                         sensor->id, VL53LMZ_NB_THRESHOLDS);
+                return false;
+            }
+            thresholds[count++] = (VL53LMZ_DetectionThresholds){
+                .param_low_thresh = rule->low,
+                .param_high_thresh = rule->high,
+                .measurement = rule->measurement,
+                .type = rule->type,
+                .zone_num = (uint8_t)z,
+                .mathematic_operation = first ? VL53LMZ_OPERATION_OR : rule->operation,
+            };
+            first = false;
+        }
+    }
+    if (count == 0) {
+        ESP_LOGE(TAG, "Sensor %u: nenhuma regra de eventos cobre as zonas do sensor.", sensor->id);
+        return false;
+    }
+    thresholds[count - 1].zone_num |= VL53LMZ_LAST_THRESHOLD;
+
+    uint8_t status = vl53lmz_set_ranging_mode(&sensor->dev, VL53LMZ_RANGING_MODE_AUTONOMOUS);
+    status |= vl53lmz_set_integration_time_ms(&sensor->dev, SENSOR_EVENT_INTEGRATION_MS);
+    status |= vl53lmz_set_detection_thresholds(&sensor->dev, thresholds);
+    status |= vl53lmz_set_detection_thresholds_enable(&sensor->dev, 1);
+    if (status != VL53LMZ_STATUS_OK) {
+        ESP_LOGE(TAG, "Sensor %u: falha ao programar os limiares de detecção (status %u).", sensor->id, status);
+        return false;
+    }
+    ESP_LOGI(TAG, "Sensor %u: modo de eventos com %u limiares, ranging autônomo a %d Hz (%d ms de integração).",
+             sensor->id, (unsigned)count, SENSOR_EVENT_RANGING_FREQUENCY_HZ, SENSOR_EVENT_INTEGRATION_MS);
+    return true;
+}
+
+/**
+ * @brief Deixa o ESP32 entrar em light sleep sempre que todas as tarefas estiverem bloqueadas.
+ *
+ * Usa o light sleep automático do gerenciador de energia (tickless idle). O
+ * ESP32 só desperta do light sleep por nível de GPIO, e gpio_wakeup_enable()
+ * troca o tipo de interrupção do pino: com o nível baixo armado o tempo todo,
+ * a ISR do INT dispararia repetidamente enquanto o pino segue baixo. Por isso
+ * o despertar por nível baixo de cada pino INT só é armado nos callbacks de
+ * entrada no sleep, com as interrupções desligadas, e a borda de descida é
+ * restaurada na saída, antes de a ISR voltar a rodar; um pulso que acordou o
+ * chip deixa a interrupção pendente e é atendido uma vez. Exige
+ * CONFIG_PM_ENABLE e CONFIG_FREERTOS_USE_TICKLESS_IDLE no sdkconfig; sem eles
+ * o modo de eventos funciona, com a CPU apenas ociosa. Sem
+ * CONFIG_PM_LIGHT_SLEEP_CALLBACKS o chip dorme, mas só acorda nos timeouts
+ * das tarefas (SENSOR_EVENT_POLL_MS na aquisição).
+ */
+static void setup_event_sleep(void) {
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t cbs = {
+        .enter_cb = event_sleep_enter_cb,
+        .exit_cb = event_sleep_exit_cb,
+    };
+    if (esp_pm_light_sleep_register_cbs(&cbs) == ESP_OK) {
+        esp_sleep_enable_gpio_wakeup();
+    } else {
+        ESP_LOGW(TAG, "Pinos INT não podem despertar o light sleep (callbacks de sleep recusados).");
+    }
+#else
+    ESP_LOGW(TAG, "Sem CONFIG_PM_LIGHT_SLEEP_CALLBACKS os pinos INT não despertam o light sleep; "
+                  "os eventos são lidos a cada SENSOR_EVENT_POLL_MS.");
+#endif
+    const esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_XTAL_FREQ,
+        .light_sleep_enable = true,
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Light sleep automático indisponível (%s).", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "Light sleep automático habilitado entre os eventos.");
+#else
+    ESP_LOGW(TAG, "Modo de eventos sem light sleep: habilite CONFIG_PM_ENABLE e CONFIG_FREERTOS_USE_TICKLESS_IDLE.");
+#endif
+}
+
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE && CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+/**
+ * @brief Arma o despertar por nível baixo em cada pino INT (chamado pelo gerenciador de energia).
+ * @return ESP_OK sempre: um pino que não pode despertar só atrasa o evento até o timeout.
+ */
+static esp_err_t event_sleep_enter_cb(int64_t sleep_time_us, void* arg) {
+    (void)sleep_time_us;
+    (void)arg;
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        gpio_wakeup_enable(s_sensor_pins[i].int_gpio, GPIO_INTR_LOW_LEVEL);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Desarma o despertar e restaura a borda de descida configurada por setup_sensor_int_gpio().
+ * @return ESP_OK sempre.
+ */
+static esp_err_t event_sleep_exit_cb(int64_t sleep_time_us, void* arg) {
+    (void)sleep_time_us;
+    (void)arg;
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        gpio_wakeup_disable(s_sensor_pins[i].int_gpio);
+        gpio_set_intr_type(s_sensor_pins[i].int_gpio, GPIO_INTR_NEGEDGE);
+    }
+    return ESP_OK;
+}
+#endif
+#endif
+
+/**
+ * @brief Inicia a aquisição contínua de dados.
+ * @param sensor Sensor a ser iniciado.
+ * @return true se o sensor aceitou o comando.
+ */
+static bool vl53l8ch_start_ranging(tof_sensor_t* sensor) {
+#if SENSOR_CNH_MODE
+    // Mesmo que vl53lmz_start_ranging(), com o bloco CNH na saída; o tamanho
+    // vai em palavras de 32 bits (VL53LMZ_CNH_DATA_BH não cabe no campo de 12 bits)
+    union Block_header cnh_bh = { .bytes = 0 };
+    cnh_bh.idx = VL53LMZ_CNH_DATA_IDX;
+    cnh_bh.type = 4;
+    cnh_bh.size = s_cnh_words;
+    uint8_t status = vl53lmz_create_output_config(&sensor->dev);
+    status |= vl53lmz_add_output_block(&sensor->dev, cnh_bh.bytes);
+    status |= vl53lmz_send_output_config_and_start(&sensor->dev);
+#else
+    uint8_t status = vl53lmz_start_ranging(&sensor->dev);
+#endif
+    if (status != VL53LMZ_STATUS_OK) {
+        ESP_LOGE(TAG, "Sensor %u: vl53lmz_start_ranging falhou (status %u).", sensor->id, status);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Inicia o ranging de todos os sensores.
+ *
+ * Sem sincronismo por hardware as partidas são escalonadas em 1/SENSOR_COUNT
+ * do período de ranging: os frames dos sensores ficam prontos em instantes
+ * espalhados, e a leitura SPI de um sensor acontece durante a integração dos
+ * outros, sem rajadas no barramento compartilhado com o CAN. Os osciladores
+ * dos sensores derivam devagar; quando duas fases se encontram, as leituras
+ * apenas passam a ser feitas em sequência no mesmo despertar.
+ *
+ * Com SENSOR_SYNC_GPIO todos os sensores medem ao mesmo tempo a cada pulso
+ * do timer (cobertura coerente entre os sensores), e as leituras são feitas em
+ * sequência enquanto a medição seguinte já integra. Nos dois casos cada sensor
+ * mantém SENSOR_RANGING_FREQUENCY_HZ enquanto SENSOR_COUNT leituras couberem
+ * em um período.
+ *
+ * @return true se todos os sensores iniciaram o ranging.
+ */
+static bool start_all_sensors(void) {
+    static const tof_filter_config_t filter_config = TOF_FILTER_CONFIG_DEFAULT(SENSOR_FILTER_MODE);
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        tof_sensor_t* sensor = &s_sensors[i];
+        tof_filter_init(&sensor->filter, &filter_config);
+        tof_motion_init(&sensor->motion, NULL);
+        if (!vl53l8ch_start_ranging(sensor)) {
+            return false;
+        }
+        ESP_LOGI(TAG, "Sensor %u: ranging iniciado a %u Hz (perfil %s: %lu bytes por frame, buffer do driver de %u bytes).",
+                 sensor->id, sensor->frequency_hz, VL53LMZ_PROFILE_NAME,
+                 (unsigned long)sensor->dev.data_read_size, (unsigned)VL53LMZ_TEMPORARY_BUFFER_SIZE);
+#if SENSOR_SYNC_GPIO < 0
+        if (i + 1 < SENSOR_COUNT) {
+            vTaskDelay(pdMS_TO_TICKS(1000 / (SENSOR_RANGING_FREQUENCY_HZ * SENSOR_COUNT)));
+        }
+#endif
+    }
+#if SENSOR_SYNC_GPIO >= 0
+    return setup_sync_output();
+#else
+    return true;
+#endif
+}
+
+#if SENSOR_SYNC_GPIO >= 0
+/**
+ * @brief Configura o pino de sincronismo e inicia o timer periódico que gera os pulsos.
+ * @return true se o timer foi iniciado.
+ */
+static bool setup_sync_output(void) {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << SENSOR_SYNC_GPIO,
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    if (gpio_config(&io_conf) != ESP_OK) {
+        return false;
+    }
+    gpio_set_level(SENSOR_SYNC_GPIO, 0);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = sensor_sync_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "tof_sync",
+    };
+    if (esp_timer_create(&timer_args, &s_sync_timer) != ESP_OK ||
+        esp_timer_start_periodic(s_sync_timer, 1000000ULL / SENSOR_RANGING_FREQUENCY_HZ) != ESP_OK) {
+        ESP_LOGE(TAG, "Falha ao iniciar o timer de sincronismo dos sensores.");
+        return false;
+    }
+    return true;
+}
+#endif
+
+/**
+ * @brief Consulta o sensor para saber se há um novo frame disponível (vl53lmz_check_data_ready).
+ * @param sensor Sensor a ser consultado.
+ * @param[out] is_ready Recebe true quando há um novo frame disponível no sensor.
+ * @return true se a consulta foi feita com sucesso.
+ */
+static bool vl53l8ch_check_data_ready(tof_sensor_t* sensor, bool* is_ready) {
+    uint8_t ready = 0;
+    if (vl53lmz_check_data_ready(&sensor->dev, &ready) != VL53LMZ_STATUS_OK) {
+        return false;
+    }
+    *is_ready = ready != 0;
+    return true;
+}
+
+/**
+ * @brief Lê os resultados do sensor e os copia em largura total para um frame do pipeline.
+ *
+ * Os resultados não passam pela VL53LMZ_ResultsData: a visão localiza no
+ * buffer do driver apenas os blocos usados pelo frame, e cada campo é
+ * convertido em uma única passagem direto para o frame. Campos cujo bloco
+ * não veio do sensor (VL53LMZ_DISABLE_*) ficam zerados; sem
+ * nb_target_detected, todos os alvos são considerados detectados e a
+ * validade depende apenas do status. O frame tem a resolução programada
+ * (sensor->resolution), e as zonas além dela ficam zeradas. O indicador de
+ * movimento, quando está no perfil de saída, liga TOF_FRAME_FLAG_MOTION.
+ * @param sensor Sensor a ser lido.
+ * @param[out] frame Frame a ser preenchido (exceto timestamp, sequência e sensor_id).
+ * @return true se a leitura foi feita com sucesso.
+ */
+static bool vl53l8ch_get_data(tof_sensor_t* sensor, tof_frame_t* frame) {
+    const uint32_t blocks = VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_NB_TARGET_DETECTED) |
+                            VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_DISTANCE_MM) |
+                            VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_RANGE_SIGMA_MM) |
+                            VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_SIGNAL_PER_SPAD) |
+                            VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_TARGET_STATUS) |
+                            VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_MOTION_INDICATOR) |
+                            VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_CNH_DATA);
+    VL53LMZ_ResultsView view;
+    uint32_t start = tof_time_cycles();
+    if (vl53lmz_read_ranging_results(&sensor->dev) != VL53LMZ_STATUS_OK) {
+        return false;
+    }
+    record_latency(TOF_LATENCY_SPI_READ, start);
+    start = tof_time_cycles();
+    if (vl53lmz_parse_ranging_view(&sensor->dev, blocks, &view) != VL53LMZ_STATUS_OK) {
+        return false;
+    }
+    record_latency(TOF_LATENCY_PARSE, start);
+    start = tof_time_cycles();
+#if SENSOR_CNH_MODE
+    capture_cnh_block(sensor, &view);
+#endif
+
+    frame->streamcount = view.streamcount;
+    // Em 4x4 os blocos têm só 16 zonas: as posições seguintes são zeradas
+    const uint16_t zones = sensor->resolution;
+    const uint16_t targets = zones * TOF_FRAME_TARGETS_PER_ZONE;
+    frame->resolution = (uint8_t)zones;
+    frame->silicon_temp_degc = view.silicon_temp_degc;
+    uint16_t n = vl53lmz_view_copy_nb_target_detected(&view, frame->nb_target_detected, zones);
+    if (n == 0) {
+        memset(frame->nb_target_detected, TOF_FRAME_TARGETS_PER_ZONE, zones);
+        n = zones;
+    }
+    memset(frame->nb_target_detected + n, 0, TOF_FRAME_MAX_ZONES - n);
+    n = vl53lmz_view_copy_distance_mm(&view, frame->distance_mm, targets);
+    memset(frame->distance_mm + n, 0, (TOF_FRAME_MAX_TARGETS - n) * sizeof(frame->distance_mm[0]));
+    n = vl53lmz_view_copy_range_sigma_mm(&view, frame->range_sigma_mm, targets);
+    memset(frame->range_sigma_mm + n, 0, (TOF_FRAME_MAX_TARGETS - n) * sizeof(frame->range_sigma_mm[0]));
+    n = vl53lmz_view_copy_signal_per_spad(&view, frame->signal_per_spad, targets);
+    memset(frame->signal_per_spad + n, 0, (TOF_FRAME_MAX_TARGETS - n) * sizeof(frame->signal_per_spad[0]));
+    n = vl53lmz_view_copy_target_status(&view, frame->target_status, targets);
+    memset(frame->target_status + n, 0, TOF_FRAME_MAX_TARGETS - n);
+    frame->flags = 0;
+#ifndef VL53LMZ_DISABLE_MOTION_INDICATOR
+    VL53LMZ_ViewMotionIndicator motion;
+    if (vl53lmz_view_copy_motion_indicator(&view, &motion) > 0) {
+        frame->flags |= TOF_FRAME_FLAG_MOTION;
+        frame->motion.global_indicator_1 = motion.global_indicator_1;
+        frame->motion.global_indicator_2 = motion.global_indicator_2;
+        frame->motion.status = motion.status;
+        frame->motion.nb_detected_aggregates = motion.nb_of_detected_aggregates;
+        frame->motion.nb_aggregates = motion.nb_of_aggregates;
+        frame->motion.active_mask = 0;
+        memcpy(frame->motion.aggregate, motion.motion, sizeof(frame->motion.aggregate));
+    }
+#endif
+    record_latency(TOF_LATENCY_CONVERT, start);
+    return true;
+}
@@ -3,23 +3,128 @@
  * @brief Interface pública para o componente do sensor de ToF VL53L8CH.
  *
  * Este cabeçalho expõe as funções necessárias para inicializar e gerenciar a tarefa
- * de aquisição de dados do sensor Time-of-Flight.
+ * de aquisição de dados do sensor Time-of-Flight, e a leitura do último frame
+ * de cada sensor por outras tarefas do firmware (CAN, fusão com o GPS).
  */
 
 #ifndef SENSOR_CODE_H
 #define SENSOR_CODE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "tof_frame.h"
+#include "tof_obstacle.h"
+
+/**
+ * @brief Formatos de saída dos frames na UART.
+ */
+typedef enum {
+    TOF_UART_OUTPUT_HEX = 0,                        /**< Dump hexadecimal legível (depuração). */
+    TOF_UART_OUTPUT_STREAM = 1,                     /**< Pacotes binários COBS com CRC16 (ver tof_stream.h). */
+} tof_uart_output_mode_t;
+
 /**
- * @brief Inicializa e cria a tarefa RTOS para o sensor VL53L8CH.
+ * @brief Inicializa e cria as tarefas RTOS para o sensor VL53L8CH.
  *
- * Esta função aloca os recursos e inicia uma nova tarefa FreeRTOS dedicada
- * ao gerenciamento do sensor. A tarefa é responsável por todo o ciclo de vida
- * da aquisição de dados, incluindo inicialização do hardware, medições periódicas,
- * logging para depuração via UART e persistência dos dados em um cartão SD.
+ * Esta função aloca os recursos e inicia o pipeline de tarefas FreeRTOS do
+ * sensor: uma tarefa de aquisição (inicialização do hardware e leitura dos
+ * frames), fixa em um core, que alimenta por filas lock-free as tarefas de
+ * logging para depuração via UART e de persistência dos dados em um cartão SD,
+ * fixas no outro core.
  *
  * @param None
  * @return None
  */
 void start_tof_sensor_task(void);
 
+/**
+ * @brief Seleciona o formato de saída dos frames na UART em tempo de execução.
+ *
+ * Também pode ser trocado enviando 'b' (streaming) ou 'h' (hexadecimal) pela
+ * UART do console. Se o driver da UART não puder ser instalado, a saída
+ * permanece no dump hexadecimal.
+ *
+ * @param mode Novo modo de saída.
+ * @return None
+ */
+void tof_set_uart_output_mode(tof_uart_output_mode_t mode);
+
+/**
+ * @brief Referencia o último frame publicado de um sensor, sem cópia, sem mutex e sem bloquear.
+ *
+ * O frame é lido diretamente no slot da publicação e não muda até ser
+ * liberado por tof_sensor_release(), o que deve acontecer logo após o uso:
+ * cada sensor tem slots para poucos leitores simultâneos, e um frame retido
+ * nunca atrasa a aquisição, mas pode fazer os frames seguintes deixarem de ser
+ * publicados. Um leitor periódico reconhece um frame já visto pela sequence.
+ * Válida após start_tof_sensor_task().
+ *
+ * @param sensor_id Sensor de origem (0 a tof_sensor_count() - 1).
+ * @return Frame mais recente, ou NULL se o sensor não existe ou ainda não publicou nenhum frame.
+ */
+const tof_frame_t* tof_sensor_acquire_latest(uint8_t sensor_id);
+
+/**
+ * @brief Libera um frame retornado por tof_sensor_acquire_latest().
+ * @param frame Frame a ser liberado (NULL é ignorado).
+ * @return None
+ */
+void tof_sensor_release(const tof_frame_t* frame);
+
+/**
+ * @brief Registra uma tarefa para ser notificada a cada frame publicado, de qualquer sensor.
+ *
+ * A notificação liga notify_bits (eSetBits) na tarefa; ela então lê os
+ * frames com tof_sensor_acquire_latest(). Não há cancelamento do registro.
+ *
+ * @param task Tarefa a ser notificada.
+ * @param notify_bits Bits da notificação reservados pela tarefa para os frames ToF.
+ * @return true se a tarefa foi registrada, false sem entradas livres.
+ */
+bool tof_sensor_subscribe(TaskHandle_t task, uint32_t notify_bits);
+
+/**
+ * @brief Função que envia um frame CAN, fornecida pelo dono do barramento CAN.
+ * @param frame Frame a enviar.
+ * @param ctx Contexto registrado em tof_set_can_transmit().
+ * @return true se o frame foi aceito (por exemplo, enfileirado no controlador).
+ */
+typedef bool (*tof_can_transmit_fn)(const tof_can_frame_t* frame, void* ctx);
+
+/**
+ * @brief Registra a função que envia os frames CAN do estágio de obstáculos (SENSOR_OBSTACLE_MODE).
+ *
+ * A cada frame novo, a tarefa do CAN envia a distância mais próxima de cada
+ * setor e o alvo mais próximo rastreado em 2 ou 3 frames CAN (formato em
+ * tof_obstacle.h). A função é chamada pela tarefa do CAN e não deve
+ * bloquear: um frame recusado só é contabilizado, porque o resultado
+ * seguinte o substitui. Sem função registrada, os frames são descartados.
+ *
+ * @param transmit Função de envio (NULL = descartar os frames).
+ * @param ctx Contexto repassado à função.
+ * @return None
+ */
+void tof_set_can_transmit(tof_can_transmit_fn transmit, void* ctx);
+
+/**
+ * @brief Número de sensores do conjunto.
+ * @return Sensores com sensor_id de 0 a tof_sensor_count() - 1.
+ */
+uint8_t tof_sensor_count(void);
+
+/**
+ * @brief Instante atual no relógio dos frames, para alinhar os frames a outras medições.
+ *
+ * frame->timestamp_us é esp_timer_get_time() no instante em que o sensor
+ * confirmou o frame, antes da leitura SPI; a medição terminou pouco antes.
+ * A idade de um frame é tof_sensor_time_us() - frame->timestamp_us.
+ *
+ * @return esp_timer_get_time(), em µs desde o reset.
+ */
+int64_t tof_sensor_time_us(void);
+
 #endif // TOF_SENSOR_H
\ No newline at end of file
@@ -0,0 +1,825 @@
+/**
+ * @file batch_ingest.c
+ * @brief Decodificação paralela de vários logs com roubo de trabalho e fusão por timestamp.
+ */
+
+#include "batch_ingest.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <glob.h>
+#include <unistd.h>
+#endif
+
+#include "tof_bin.h"
+#include "tof_csv.h"
+#include "tof_frame.h"
+#include "tof_log_writer.h"
+#include "tof_time.h"
+
+#include "log_replay.h"
+#include "sim_log.h"
+
+static const char *TAG = "TOF_BATCH";
+#define BATCH_DEFAULT_CSV_FILE "tof_batch.csv"
+#define BATCH_DEFAULT_TOFB_FILE "tof_batch.tofb"
+#define BATCH_CHUNK_BYTES (4 * 1024 * 1024)            /**< Tamanho nominal de um trecho de log (uma tarefa do pool). */
+#define BATCH_BYTES_PER_FRAME 512                       /**< Estimativa de bytes de log por frame, para dimensionar os vetores. */
+#define BATCH_FRAME_INTERVAL_MS 200                     /**< Intervalo entre frames nos logs sem horário (SENSOR_POLLING_RATE_MS do simulador). */
+#define BATCH_DAY_MS (24LL * 60 * 60 * 1000)
+#define BATCH_HALF_DAY_MS (BATCH_DAY_MS / 2)            /**< Recuo do horário a partir do qual se considera que a meia-noite passou. */
+#define BATCH_WRITE_BUFFER_SIZE (1024 * 1024)
+#define BATCH_FSYNC_INTERVAL_MS 60000
+
+/**
+ * @brief Frame decodificado de um log, na forma compacta guardada até a fusão.
+ */
+typedef struct {
+    int64_t time_ms;                                /**< Horário do monitor (mais os dias do trecho); após a consolidação, ms desde a época. */
+    uint32_t sequence;                              /**< Índice do frame no seu arquivo (preenchido na consolidação). */
+    uint8_t resolution;                             /**< Zonas do frame (16 ou 64). */
+    int16_t distance_mm[TOF_FRAME_MAX_ZONES];       /**< Distância do primeiro alvo de cada zona. */
+    uint8_t target_status[TOF_FRAME_MAX_ZONES];     /**< Status do primeiro alvo de cada zona. */
+} batch_record_t;
+
+/**
+ * @brief Trecho de um log decodificado por uma tarefa do pool.
+ */
+typedef struct {
+    uint32_t file;                                  /**< Índice do arquivo de origem. */
+    size_t begin;                                   /**< Primeiro byte do trecho (início de linha). */
+    size_t end;                                     /**< Fim do trecho (início de linha ou fim do arquivo). */
+    batch_record_t* records;                        /**< Frames decodificados, em ordem do arquivo. */
+    size_t count;                                   /**< Frames em records. */
+    size_t capacity;                                /**< Capacidade de records. */
+    uint64_t rejected;                              /**< Linhas HEX DATA descartadas. */
+    bool timed;                                     /**< Todos os frames têm o horário do monitor. */
+    int32_t first_tod_ms;                           /**< Horário do primeiro frame (-1 se nenhum). */
+    int32_t last_tod_ms;                            /**< Horário do último frame (-1 se nenhum). */
+    int32_t local_days;                             /**< Viradas da meia-noite dentro do trecho. */
+    int64_t busy_us;                                /**< Tempo de decodificação. */
+    bool out_of_memory;                             /**< A decodificação parou por falta de memória. */
+} batch_chunk_t;
+
+/**
+ * @brief Log de entrada do lote.
+ */
+typedef struct {
+    char* path;                                     /**< Caminho do arquivo. */
+    log_replay_t log;                               /**< Log mapeado em memória. */
+    int64_t date_ms;                                /**< Meia-noite da data no nome do arquivo, em ms desde a época (0 se ausente). */
+    int32_t start_tod_ms;                           /**< Horário no nome do arquivo (-1 se ausente). */
+    uint32_t first_chunk;                           /**< Primeiro trecho do arquivo em g_chunks. */
+    uint32_t chunk_count;                           /**< Trechos do arquivo. */
+    uint64_t frames;                                /**< Frames decodificados. */
+    uint64_t rejected;                              /**< Linhas descartadas. */
+    int64_t busy_us;                                /**< Soma do tempo de decodificação dos trechos. */
+    uint32_t cursor_chunk;                          /**< Trecho do próximo frame na fusão (relativo a first_chunk). */
+    size_t cursor_index;                            /**< Posição do próximo frame no trecho. */
+} batch_file_t;
+
+/**
+ * @brief Thread do pool e a sua fila de trechos.
+ *
+ * A fila é o intervalo [head, tail) de índices de trecho: a dona consome pela
+ * frente, em ordem do arquivo, e as outras threads roubam por trás.
+ */
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;                           /**< Protege head e tail. */
+    uint32_t head;                                  /**< Próximo trecho da dona. */
+    uint32_t tail;                                  /**< Fim da fila (exclusivo). */
+    int index;                                      /**< Posição da thread em g_workers. */
+    uint32_t chunks_done;                           /**< Trechos decodificados pela thread. */
+    uint32_t steals;                                /**< Trechos roubados de outras filas. */
+    int64_t busy_us;                                /**< Tempo gasto decodificando. */
+} batch_worker_t;
+
+static batch_file_t* g_files = NULL;
+static size_t g_file_count = 0;
+static size_t g_file_capacity = 0;
+static batch_chunk_t* g_chunks = NULL;
+static uint32_t g_chunk_count = 0;
+static uint32_t g_chunk_capacity = 0;
+static batch_worker_t* g_workers = NULL;
+static int g_worker_count = 0;
+
+
+/** @brief Expande as entradas (arquivos, diretórios e padrões glob) em g_files, em ordem de nome. */
+static bool collect_inputs(const batch_config_t* config);
+/** @brief Acrescenta um arquivo à lista de entradas. */
+static bool add_input_file(const char* path);
+/** @brief Acrescenta todos os *.log de um diretório. */
+static bool add_input_directory(const char* path);
+/** @brief Ordena as entradas por caminho e remove as repetidas. */
+static void sort_inputs(void);
+/** @brief Ordenação de arquivos por caminho. */
+static int compare_file_paths(const void* a, const void* b);
+/** @brief Extrai a data e o horário do nome device-monitor-AAMMDD-HHMMSS.log. */
+static void parse_file_date(batch_file_t* file);
+/** @brief Dias desde 1970-01-01 de uma data do calendário gregoriano. */
+static int64_t days_from_civil(int year, int month, int day);
+/** @brief Mapeia um arquivo e divide-o em trechos alinhados a linhas. */
+static bool split_file(uint32_t file_index);
+/** @brief Distribui os trechos entre as filas, executa o pool e espera o fim. */
+static bool run_workers(int jobs);
+/** @brief Laço de uma thread do pool. */
+static void* worker_main(void* arg);
+/** @brief Retira o próximo trecho da própria fila. */
+static bool worker_take(batch_worker_t* worker, uint32_t* chunk);
+/** @brief Rouba o último trecho pendente da fila de outra thread. */
+static bool worker_steal(batch_worker_t* thief, uint32_t* chunk);
+/** @brief Decodifica os frames de um trecho. */
+static void decode_chunk(batch_chunk_t* chunk);
+/** @brief Reserva o próximo registro do trecho, ampliando o vetor se preciso. */
+static batch_record_t* chunk_append(batch_chunk_t* chunk);
+/** @brief Converte os horários dos trechos de um arquivo em ms desde a época e numera os frames. */
+static void consolidate_file(batch_file_t* file);
+/** @brief Reordena por timestamp os frames de um arquivo cujo relógio andou para trás. */
+static void sort_file_records(batch_file_t* file);
+/** @brief Ordenação de registros por timestamp e, no empate, por sequência. */
+static int compare_records(const void* a, const void* b);
+/** @brief Intercala os frames de todos os arquivos em ordem de timestamp no arquivo de saída. */
+static bool write_merged_output(const batch_config_t* config, const char* path, int64_t epoch_ms, uint64_t* frames_written);
+/** @brief Posiciona o cursor de fusão no próximo trecho não vazio; false no fim do arquivo. */
+static bool file_cursor_valid(batch_file_t* file);
+/** @brief Registro sob o cursor de fusão do arquivo. */
+static const batch_record_t* file_cursor(const batch_file_t* file);
+/** @brief Indica se o arquivo a deve sair antes do arquivo b na fusão. */
+static bool merge_before(uint32_t a, uint32_t b);
+/** @brief Restaura a propriedade do heap de fusão a partir da posição pos. */
+static void merge_sift_down(uint32_t* heap, size_t count, size_t pos);
+/** @brief Relatório por arquivo, por thread e total. */
+static void report(int64_t decode_us, int64_t merge_us, uint64_t frames_written, int64_t epoch_ms, const char* output_path);
+/** @brief Número de núcleos disponíveis. */
+static int online_cpus(void);
+/** @brief Libera os mapeamentos, os trechos e as filas. */
+static void batch_cleanup(void);
+
+// =========================================================================
+// IMPLEMENTAÇÃO DA LÓGICA PRINCIPAL
+// =========================================================================
+
+int run_batch_ingest(const batch_config_t* config) {
+    const char* output_path = config->output_filename;
+    if (output_path == NULL) {
+        output_path = config->output_format == SIM_OUTPUT_TOFB ? BATCH_DEFAULT_TOFB_FILE : BATCH_DEFAULT_CSV_FILE;
+    }
+
+    if (!collect_inputs(config)) {
+        batch_cleanup();
+        return -1;
+    }
+    if (g_file_count == 0) {
+        ESP_LOGE(TAG, "Nenhum arquivo .log encontrado nas entradas.");
+        batch_cleanup();
+        return -1;
+    }
+
+    int64_t start_us = tof_time_us();
+    for (uint32_t f = 0; f < g_file_count; f++) {
+        if (!split_file(f)) {
+            batch_cleanup();
+            return -1;
+        }
+    }
+    int jobs = config->jobs > 0 ? config->jobs : online_cpus();
+    ESP_LOGI(TAG, "Lote: %zu arquivos em %u trechos, %d threads", g_file_count, g_chunk_count, jobs);
+    if (!run_workers(jobs)) {
+        batch_cleanup();
+        return -1;
+    }
+    for (uint32_t c = 0; c < g_chunk_count; c++) {
+        if (g_chunks[c].out_of_memory) {
+            ESP_LOGE(TAG, "ERRO: Memoria insuficiente para os frames de %s", g_files[g_chunks[c].file].path);
+            batch_cleanup();
+            return -1;
+        }
+    }
+
+    // A época da saída é o frame mais antigo: os arquivos já estão ordenados
+    // internamente, então basta o primeiro frame de cada um
+    int64_t epoch_ms = INT64_MAX;
+    for (size_t f = 0; f < g_file_count; f++) {
+        consolidate_file(&g_files[f]);
+        if (file_cursor_valid(&g_files[f]) && file_cursor(&g_files[f])->time_ms < epoch_ms) {
+            epoch_ms = file_cursor(&g_files[f])->time_ms;
+        }
+    }
+    if (epoch_ms == INT64_MAX) {
+        epoch_ms = 0;
+    }
+    int64_t decode_us = tof_time_us() - start_us;
+
+    uint64_t frames_written = 0;
+    start_us = tof_time_us();
+    bool ok = write_merged_output(config, output_path, epoch_ms, &frames_written);
+    int64_t merge_us = tof_time_us() - start_us;
+
+    if (ok) {
+        report(decode_us, merge_us, frames_written, epoch_ms, output_path);
+    }
+    batch_cleanup();
+    return ok ? 0 : -1;
+}
+
+// =========================================================================
+// IMPLEMENTAÇÃO DAS FUNÇÕES AUXILIARES
+// =========================================================================
+
+static bool collect_inputs(const batch_config_t* config) {
+    for (int i = 0; i < config->input_count; i++) {
+        const char* input = config->inputs[i];
+        struct stat st;
+        bool ok;
+        if (stat(input, &st) == 0) {
+            ok = S_ISDIR(st.st_mode) ? add_input_directory(input) : add_input_file(input);
+        } else {
+#ifdef _WIN32
+            ESP_LOGW(TAG, "Entrada inexistente: %s", input);
+            ok = true;
+#else
+            // O shell não expandiu o padrão (entre aspas, ou longo demais): expande aqui
+            glob_t matches;
+            int rc = glob(input, 0, NULL, &matches);
+            ok = true;
+            if (rc == 0) {
+                for (size_t m = 0; m < matches.gl_pathc && ok; m++) {
+                    ok = add_input_file(matches.gl_pathv[m]);
+                }
+            } else {
+                ESP_LOGW(TAG, "Nenhum arquivo corresponde a: %s", input);
+            }
+            globfree(&matches);
+#endif
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    sort_inputs();
+    return true;
+}
+
+static bool add_input_file(const char* path) {
+    if (g_file_count == g_file_capacity) {
+        size_t capacity = g_file_capacity ? g_file_capacity * 2 : 64;
+        batch_file_t* files = (batch_file_t*)realloc(g_files, capacity * sizeof(*files));
+        if (files == NULL) {
+            ESP_LOGE(TAG, "ERRO: Memoria insuficiente para a lista de arquivos.");
+            return false;
+        }
+        g_files = files;
+        g_file_capacity = capacity;
+    }
+    batch_file_t* file = &g_files[g_file_count];
+    memset(file, 0, sizeof(*file));
+    file->path = strdup(path);
+    if (file->path == NULL) {
+        ESP_LOGE(TAG, "ERRO: Memoria insuficiente para a lista de arquivos.");
+        return false;
+    }
+    g_file_count++;
+    return true;
+}
+
+static bool add_input_directory(const char* path) {
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        ESP_LOGW(TAG, "Nao foi possivel abrir o diretorio %s", path);
+        return true;
+    }
+    bool ok = true;
+    struct dirent* entry;
+    char full_path[4096];
+    while (ok && (entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len <= 4 || strcmp(entry->d_name + len - 4, ".log") != 0) {
+            continue;
+        }
+        snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
+        ok = add_input_file(full_path);
+    }
+    closedir(dir);
+    return ok;
+}
+
+static int compare_file_paths(const void* a, const void* b) {
+    return strcmp(((const batch_file_t*)a)->path, ((const batch_file_t*)b)->path);
+}
+
+static void sort_inputs(void) {
+    qsort(g_files, g_file_count, sizeof(*g_files), compare_file_paths);
+    size_t unique = 0;
+    for (size_t f = 0; f < g_file_count; f++) {
+        if (unique > 0 && strcmp(g_files[unique - 1].path, g_files[f].path) == 0) {
+            free(g_files[f].path);
+            continue;
+        }
+        g_files[unique++] = g_files[f];
+    }
+    g_file_count = unique;
+}
+
+static void parse_file_date(batch_file_t* file) {
+    const char* name = strrchr(file->path, '/');
+    name = name ? name + 1 : file->path;
+    const char* stamp = strstr(name, "monitor-");
+    int yy, mo, dd, hh, mi, ss;
+    file->date_ms = 0;
+    file->start_tod_ms = -1;
+    if (stamp && sscanf(stamp + strlen("monitor-"), "%2d%2d%2d-%2d%2d%2d", &yy, &mo, &dd, &hh, &mi, &ss) == 6 &&
+        mo >= 1 && mo <= 12 && dd >= 1 && dd <= 31 && hh < 24 && mi < 60 && ss < 60) {
+        file->date_ms = days_from_civil(2000 + yy, mo, dd) * BATCH_DAY_MS;
+        file->start_tod_ms = ((hh * 60 + mi) * 60 + ss) * 1000;
+    }
+}
+
+static int64_t days_from_civil(int year, int month, int day) {
+    // Algoritmo de H. Hinnant: ano deslocado para começar em março
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yoe = year - era * 400;
+    int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static bool split_file(uint32_t file_index) {
+    batch_file_t* file = &g_files[file_index];
+    if (!log_replay_open(&file->log, file->path)) {
+        ESP_LOGE(TAG, "ERRO: Nao foi possivel abrir o arquivo de log %s", file->path);
+        return false;
+    }
+    parse_file_date(file);
+    file->first_chunk = g_chunk_count;
+
+    const char* data = file->log.data;
+    size_t size = file->log.size;
+    size_t begin = 0;
+    do {
+        size_t end = begin + BATCH_CHUNK_BYTES;
+        if (end >= size) {
+            end = size;
+        } else {
+            // Termina o trecho no início de uma linha, para que nenhum marcador seja partido
+            const char* eol = (const char*)memchr(data + end, '\n', size - end);
+            end = eol ? (size_t)(eol - data) + 1 : size;
+        }
+        if (g_chunk_count == g_chunk_capacity) {
+            uint32_t capacity = g_chunk_capacity ? g_chunk_capacity * 2 : 256;
+            batch_chunk_t* chunks = (batch_chunk_t*)realloc(g_chunks, capacity * sizeof(*chunks));
+            if (chunks == NULL) {
+                ESP_LOGE(TAG, "ERRO: Memoria insuficiente para os trechos de %s", file->path);
+                return false;
+            }
+            g_chunks = chunks;
+            g_chunk_capacity = capacity;
+        }
+        batch_chunk_t* chunk = &g_chunks[g_chunk_count++];
+        memset(chunk, 0, sizeof(*chunk));
+        chunk->file = file_index;
+        chunk->begin = begin;
+        chunk->end = end;
+        file->chunk_count++;
+        begin = end;
+    } while (begin < size);
+    return true;
+}
+
+static bool run_workers(int jobs) {
+    if (jobs > (int)g_chunk_count) {
+        jobs = (int)g_chunk_count;
+    }
+    if (jobs < 1) {
+        jobs = 1;
+    }
+    g_workers = (batch_worker_t*)calloc((size_t)jobs, sizeof(*g_workers));
+    if (g_workers == NULL) {
+        ESP_LOGE(TAG, "ERRO: Memoria insuficiente para o pool de threads.");
+        return false;
+    }
+
+    // Cada fila começa com uma faixa contígua de trechos: a dona lê os
+    // arquivos em sequência e os roubos ficam no fim das faixas
+    for (int w = 0; w < jobs; w++) {
+        batch_worker_t* worker = &g_workers[w];
+        worker->index = w;
+        worker->head = (uint32_t)((uint64_t)g_chunk_count * w / jobs);
+        worker->tail = (uint32_t)((uint64_t)g_chunk_count * (w + 1) / jobs);
+        pthread_mutex_init(&worker->lock, NULL);
+    }
+    g_worker_count = jobs;
+
+    int started = 0;
+    for (; started < jobs; started++) {
+        if (pthread_create(&g_workers[started].thread, NULL, worker_main, &g_workers[started]) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        ESP_LOGE(TAG, "ERRO: Nao foi possivel criar as threads de decodificacao.");
+        return false;
+    }
+    if (started < jobs) {
+        // As filas das threads não criadas são esvaziadas pelo roubo das demais
+        ESP_LOGW(TAG, "Apenas %d de %d threads foram criadas.", started, jobs);
+    }
+    for (int w = 0; w < started; w++) {
+        pthread_join(g_workers[w].thread, NULL);
+    }
+    return true;
+}
+
+static void* worker_main(void* arg) {
+    batch_worker_t* self = (batch_worker_t*)arg;
+    uint32_t c;
+    // Nenhuma tarefa é criada durante a execução: quando a própria fila e
+    // todas as outras estão vazias, o trabalho acabou
+    while (worker_take(self, &c) || worker_steal(self, &c)) {
+        decode_chunk(&g_chunks[c]);
+        self->chunks_done++;
+        self->busy_us += g_chunks[c].busy_us;
+    }
+    return NULL;
+}
+
+static bool worker_take(batch_worker_t* worker, uint32_t* chunk) {
+    bool found = false;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->head < worker->tail) {
+        *chunk = worker->head++;
+        found = true;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return found;
+}
+
+static bool worker_steal(batch_worker_t* thief, uint32_t* chunk) {
+    for (int k = 1; k < g_worker_count; k++) {
+        batch_worker_t* victim = &g_workers[(thief->index + k) % g_worker_count];
+        bool found = false;
+        pthread_mutex_lock(&victim->lock);
+        if (victim->head < victim->tail) {
+            *chunk = --victim->tail;
+            found = true;
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (found) {
+            thief->steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void decode_chunk(batch_chunk_t* chunk) {
+    int64_t start_us = tof_time_us();
+    log_replay_t slice;
+    log_replay_slice(&g_files[chunk->file].log, chunk->begin, chunk->end, &slice);
+
+    size_t expected = (chunk->end - chunk->begin) / BATCH_BYTES_PER_FRAME + 1;
+    chunk->records = (batch_record_t*)malloc(expected * sizeof(*chunk->records));
+    chunk->capacity = chunk->records ? expected : 0;
+    chunk->timed = true;
+    chunk->first_tod_ms = -1;
+    chunk->last_tod_ms = -1;
+
+    tof_frame_t frame;
+    while (log_replay_next(&slice, &frame)) {
+        batch_record_t* record = chunk_append(chunk);
+        if (record == NULL) {
+            chunk->out_of_memory = true;
+            break;
+        }
+        int32_t tod = slice.time_of_day_ms;
+        if (tod < 0) {
+            chunk->timed = false;
+        } else {
+            if (chunk->first_tod_ms < 0) {
+                chunk->first_tod_ms = tod;
+            } else if (tod + BATCH_HALF_DAY_MS < chunk->last_tod_ms) {
+                chunk->local_days++;
+            }
+            chunk->last_tod_ms = tod;
+        }
+        record->time_ms = chunk->local_days * BATCH_DAY_MS + tod;
+        record->resolution = frame.resolution;
+        for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+            record->distance_mm[z] = frame.distance_mm[TOF_FRAME_TARGET_IDX(z, 0)];
+            record->target_status[z] = frame.target_status[TOF_FRAME_TARGET_IDX(z, 0)];
+        }
+    }
+    chunk->rejected = slice.rejected;
+    chunk->busy_us = tof_time_us() - start_us;
+}
+
+static batch_record_t* chunk_append(batch_chunk_t* chunk) {
+    if (chunk->count == chunk->capacity) {
+        size_t capacity = chunk->capacity ? chunk->capacity * 2 : 64;
+        batch_record_t* records = (batch_record_t*)realloc(chunk->records, capacity * sizeof(*records));
+        if (records == NULL) {
+            return NULL;
+        }
+        chunk->records = records;
+        chunk->capacity = capacity;
+    }
+    return &chunk->records[chunk->count++];
+}
+
+static void consolidate_file(batch_file_t* file) {
+    batch_chunk_t* chunks = &g_chunks[file->first_chunk];
+    bool timed = true;
+    for (uint32_t c = 0; c < file->chunk_count; c++) {
+        timed = timed && chunks[c].timed;
+    }
+
+    // O horário do monitor só tem hora do dia: os dias são somados em ordem,
+    // trecho a trecho, a partir do horário do nome do arquivo
+    int64_t day = 0;
+    int32_t last_tod = file->start_tod_ms;
+    int64_t untimed_base_ms = file->date_ms + (file->start_tod_ms > 0 ? file->start_tod_ms : 0);
+    uint32_t sequence = 0;
+    int64_t previous_ms = INT64_MIN;
+    bool sorted = true;
+    for (uint32_t c = 0; c < file->chunk_count; c++) {
+        batch_chunk_t* chunk = &chunks[c];
+        int64_t base_ms = 0;
+        if (timed && chunk->count > 0) {
+            if (last_tod >= 0 && chunk->first_tod_ms + BATCH_HALF_DAY_MS < last_tod) {
+                day++;
+            }
+            base_ms = file->date_ms + day * BATCH_DAY_MS;
+            day += chunk->local_days;
+            last_tod = chunk->last_tod_ms;
+        }
+        for (size_t i = 0; i < chunk->count; i++) {
+            batch_record_t* record = &chunk->records[i];
+            record->time_ms = timed ? base_ms + record->time_ms
+                                    : untimed_base_ms + (int64_t)sequence * BATCH_FRAME_INTERVAL_MS;
+            record->sequence = sequence++;
+            sorted = sorted && record->time_ms >= previous_ms;
+            previous_ms = record->time_ms;
+        }
+        file->frames += chunk->count;
+        file->rejected += chunk->rejected;
+        file->busy_us += chunk->busy_us;
+    }
+    if (!sorted) {
+        ESP_LOGW(TAG, "%s: horario fora de ordem, reordenando os frames.", file->path);
+        sort_file_records(file);
+    }
+}
+
+static void sort_file_records(batch_file_t* file) {
+    // Concentra os frames no primeiro trecho para ordenar o arquivo inteiro
+    batch_chunk_t* chunks = &g_chunks[file->first_chunk];
+    batch_record_t* all = (batch_record_t*)malloc(file->frames * sizeof(*all));
+    if (all == NULL) {
+        ESP_LOGW(TAG, "%s: memoria insuficiente para reordenar; a saida deste arquivo segue a ordem do log.", file->path);
+        return;
+    }
+    size_t n = 0;
+    for (uint32_t c = 0; c < file->chunk_count; c++) {
+        memcpy(all + n, chunks[c].records, chunks[c].count * sizeof(*all));
+        n += chunks[c].count;
+        free(chunks[c].records);
+        chunks[c].records = NULL;
+        chunks[c].count = 0;
+        chunks[c].capacity = 0;
+    }
+    qsort(all, n, sizeof(*all), compare_records);
+    chunks[0].records = all;
+    chunks[0].count = n;
+    chunks[0].capacity = n;
+}
+
+static int compare_records(const void* a, const void* b) {
+    const batch_record_t* ra = (const batch_record_t*)a;
+    const batch_record_t* rb = (const batch_record_t*)b;
+    if (ra->time_ms != rb->time_ms) {
+        return ra->time_ms < rb->time_ms ? -1 : 1;
+    }
+    return ra->sequence < rb->sequence ? -1 : ra->sequence > rb->sequence;
+}
+
+static bool write_merged_output(const batch_config_t* config, const char* path, int64_t epoch_ms, uint64_t* frames_written) {
+    static uint8_t write_buffer[BATCH_WRITE_BUFFER_SIZE] __attribute__((aligned(4)));
+    static tof_bin_block_t block;
+    static tof_frame_t frame;
+
+    bool tofb = config->output_format == SIM_OUTPUT_TOFB;
+    tof_bin_file_header_t bin_header;
+    const void* header = TOF_CSV_HEADER;
+    size_t header_len = strlen(TOF_CSV_HEADER);
+    if (tofb) {
+        tof_bin_make_file_header(&bin_header);
+        tof_bin_block_reset(&block);
+        header = &bin_header;
+        header_len = sizeof(bin_header);
+    }
+    // Sem descarga por tempo: o lote não tem leitor concorrente, só importa a vazão
+    const tof_log_writer_config_t writer_config = {
+        .flush_threshold_bytes = BATCH_WRITE_BUFFER_SIZE / 2,
+        .flush_interval_ms = 0,
+        .fsync_interval_ms = BATCH_FSYNC_INTERVAL_MS,
+    };
+    tof_log_writer_t writer;
+    if (!tof_log_writer_open(&writer, path, true, header, header_len,
+                             write_buffer, sizeof(write_buffer), &writer_config)) {
+        ESP_LOGE(TAG, "ERRO: Nao foi possivel criar o arquivo de saida %s", path);
+        return false;
+    }
+
+    uint32_t* heap = (uint32_t*)malloc(g_file_count * sizeof(*heap));
+    if (heap == NULL) {
+        ESP_LOGE(TAG, "ERRO: Memoria insuficiente para a fusao.");
+        tof_log_writer_close(&writer);
+        return false;
+    }
+    size_t heap_count = 0;
+    for (uint32_t f = 0; f < g_file_count; f++) {
+        g_files[f].cursor_chunk = 0;
+        g_files[f].cursor_index = 0;
+        if (file_cursor_valid(&g_files[f])) {
+            heap[heap_count++] = f;
+        }
+    }
+    for (size_t i = heap_count / 2; i-- > 0;) {
+        merge_sift_down(heap, heap_count, i);
+    }
+
+    memset(&frame, 0, sizeof(frame));
+    memset(frame.nb_target_detected, 1, sizeof(frame.nb_target_detected));
+
+    bool ok = true;
+    uint64_t written = 0;
+    while (heap_count > 0 && ok) {
+        batch_file_t* file = &g_files[heap[0]];
+        const batch_record_t* record = file_cursor(file);
+        frame.timestamp_us = (record->time_ms - epoch_ms) * 1000;
+        frame.sequence = record->sequence;
+        frame.resolution = record->resolution;
+        for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+            frame.distance_mm[TOF_FRAME_TARGET_IDX(z, 0)] = record->distance_mm[z];
+            frame.target_status[TOF_FRAME_TARGET_IDX(z, 0)] = record->target_status[z];
+        }
+
+        if (tofb) {
+            tof_bin_block_add_frame(&block, &frame);
+            if (tof_bin_block_is_full(&block)) {
+                size_t size = tof_bin_block_encoded_size(&block);
+                uint8_t* dst = tof_log_writer_reserve(&writer, size);
+                ok = dst != NULL && tof_log_writer_commit(&writer, tof_bin_block_encode(&block, dst, size));
+                tof_bin_block_reset(&block);
+            }
+        } else {
+            char* row = (char*)tof_log_writer_reserve(&writer, TOF_CSV_MAX_FRAME_LEN);
+            ok = row != NULL && tof_log_writer_commit(&writer, tof_csv_format_frame(row, TOF_CSV_MAX_FRAME_LEN, &frame));
+        }
+        written++;
+
+        file->cursor_index++;
+        if (!file_cursor_valid(file)) {
+            heap[0] = heap[--heap_count];
+        }
+        merge_sift_down(heap, heap_count, 0);
+    }
+    if (ok && tofb && block.frame_count > 0) {
+        size_t size = tof_bin_block_encoded_size(&block);
+        uint8_t* dst = tof_log_writer_reserve(&writer, size);
+        ok = dst != NULL && tof_log_writer_commit(&writer, tof_bin_block_encode(&block, dst, size));
+    }
+    free(heap);
+    ok = tof_log_writer_close(&writer) && ok;
+    if (!ok) {
+        ESP_LOGE(TAG, "Falha ao escrever no arquivo de saida %s", path);
+    }
+    *frames_written = written;
+    return ok;
+}
+
+static bool file_cursor_valid(batch_file_t* file) {
+    while (file->cursor_chunk < file->chunk_count &&
+           file->cursor_index >= g_chunks[file->first_chunk + file->cursor_chunk].count) {
+        file->cursor_chunk++;
+        file->cursor_index = 0;
+    }
+    return file->cursor_chunk < file->chunk_count;
+}
+
+static const batch_record_t* file_cursor(const batch_file_t* file) {
+    return &g_chunks[file->first_chunk + file->cursor_chunk].records[file->cursor_index];
+}
+
+static bool merge_before(uint32_t a, uint32_t b) {
+    int64_t ta = file_cursor(&g_files[a])->time_ms;
+    int64_t tb = file_cursor(&g_files[b])->time_ms;
+    // Empates saem na ordem dos nomes dos arquivos: a saída é determinística
+    return ta < tb || (ta == tb && a < b);
+}
+
+static void merge_sift_down(uint32_t* heap, size_t count, size_t pos) {
+    for (;;) {
+        size_t smallest = pos;
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+        if (left < count && merge_before(heap[left], heap[smallest])) {
+            smallest = left;
+        }
+        if (right < count && merge_before(heap[right], heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            return;
+        }
+        uint32_t tmp = heap[pos];
+        heap[pos] = heap[smallest];
+        heap[smallest] = tmp;
+        pos = smallest;
+    }
+}
+
+static void report(int64_t decode_us, int64_t merge_us, uint64_t frames_written, int64_t epoch_ms, const char* output_path) {
+    uint64_t total_bytes = 0;
+    uint64_t total_frames = 0;
+    uint64_t total_rejected = 0;
+    for (size_t f = 0; f < g_file_count; f++) {
+        const batch_file_t* file = &g_files[f];
+        double mb = file->log.size / (1024.0 * 1024.0);
+        double busy_s = file->busy_us / 1e6;
+        ESP_LOGI(TAG, "%s: %llu frames, %llu descartados, %.1f MB em %u trechos, %.0f MB/s (%.0f frames/s) por thread",
+                 file->path, (unsigned long long)file->frames, (unsigned long long)file->rejected, mb,
+                 file->chunk_count, busy_s > 0 ? mb / busy_s : 0.0, busy_s > 0 ? file->frames / busy_s : 0.0);
+        total_bytes += file->log.size;
+        total_frames += file->frames;
+        total_rejected += file->rejected;
+    }
+
+    double decode_s = decode_us / 1e6;
+    for (int w = 0; w < g_worker_count; w++) {
+        const batch_worker_t* worker = &g_workers[w];
+        ESP_LOGI(TAG, "Thread %d: %u trechos (%u roubados), ocupada %.0f%% do tempo",
+                 w, worker->chunks_done, worker->steals,
+                 decode_us > 0 ? 100.0 * worker->busy_us / decode_us : 0.0);
+    }
+
+    double mb = total_bytes / (1024.0 * 1024.0);
+    ESP_LOGI(TAG, "Decodificacao: %llu frames (%llu descartados) de %.1f MB em %.3f s (%.0f MB/s, %.0f frames/s) com %d threads",
+             (unsigned long long)total_frames, (unsigned long long)total_rejected, mb, decode_s,
+             decode_s > 0 ? mb / decode_s : 0.0, decode_s > 0 ? total_frames / decode_s : 0.0, g_worker_count);
+    ESP_LOGI(TAG, "Fusao: %llu frames gravados em %s em %.3f s", (unsigned long long)frames_written,
+             output_path, merge_us / 1e6);
+
+    time_t epoch_s = (time_t)(epoch_ms / 1000);
+    struct tm* t = gmtime(&epoch_s);
+    char when[32] = "?";
+    if (t) {
+        strftime(when, sizeof(when), epoch_ms >= BATCH_DAY_MS ? "%Y-%m-%d %H:%M:%S" : "%H:%M:%S", t);
+    }
+    ESP_LOGI(TAG, "Timestamp 0 da saida = %s.%03d (horario do monitor serial)", when, (int)(epoch_ms % 1000));
+}
+
+static int online_cpus(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static void batch_cleanup(void) {
+    for (uint32_t c = 0; c < g_chunk_count; c++) {
+        free(g_chunks[c].records);
+    }
+    free(g_chunks);
+    g_chunks = NULL;
+    g_chunk_count = 0;
+    g_chunk_capacity = 0;
+    for (size_t f = 0; f < g_file_count; f++) {
+        log_replay_close(&g_files[f].log);
+        free(g_files[f].path);
+    }
+    free(g_files);
+    g_files = NULL;
+    g_file_count = 0;
+    g_file_capacity = 0;
+    for (int w = 0; w < g_worker_count; w++) {
+        pthread_mutex_destroy(&g_workers[w].lock);
+    }
+    free(g_workers);
+    g_workers = NULL;
+    g_worker_count = 0;
+}
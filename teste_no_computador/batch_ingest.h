@@ -0,0 +1,43 @@
+/**
+ * @file batch_ingest.h
+ * @brief Processamento em lote de vários logs do monitor serial, em paralelo.
+ *
+ * Os logs de entrada (arquivos, diretórios ou padrões glob) são mapeados em
+ * memória e divididos em trechos de alguns MB alinhados ao início de uma
+ * linha. Os trechos são decodificados por um pool de threads com roubo de
+ * trabalho: cada thread consome os seus trechos em ordem e, ao terminar,
+ * rouba os últimos trechos pendentes das outras. Os frames de todos os
+ * arquivos são então intercalados em ordem de timestamp em um único CSV ou
+ * .tofb, e a vazão de cada arquivo é reportada.
+ *
+ * O timestamp de cada frame combina a data do nome do arquivo
+ * (device-monitor-AAMMDD-HHMMSS.log) com o horário "HH:MM:SS.mmm" que o
+ * monitor serial põe em cada linha, tratando a virada da meia-noite. Nos
+ * arquivos de saída, os timestamps são contados a partir do frame mais antigo
+ * do lote, que é informado no relatório.
+ */
+
+#ifndef BATCH_INGEST_H
+#define BATCH_INGEST_H
+
+#include "sensor_code.h"
+
+/**
+ * @brief Parâmetros do processamento em lote.
+ */
+typedef struct {
+    const char* const* inputs;          /**< Arquivos .log, diretórios (todos os *.log contidos) ou padrões glob. */
+    int input_count;                    /**< Número de entradas. */
+    int jobs;                           /**< Threads de decodificação (0 = uma por núcleo). */
+    sim_output_format_t output_format;  /**< Formato do arquivo de saída. */
+    const char* output_filename;        /**< Arquivo de saída (NULL = tof_batch.csv ou tof_batch.tofb). */
+} batch_config_t;
+
+/**
+ * @brief Decodifica todos os logs de entrada e grava a saída intercalada.
+ * @param config Parâmetros do lote.
+ * @return 0 em caso de sucesso, -1 em caso de falha.
+ */
+int run_batch_ingest(const batch_config_t* config);
+
+#endif // BATCH_INGEST_H
@@ -0,0 +1,170 @@
+/**
+ * @file bench_frame_stats.c
+ * @brief Verificação e microbenchmark do núcleo de validade e estatísticas por frame (tof_frame_stats).
+ *
+ * Gera frames sintéticos com status, contagens de alvos, distâncias e
+ * resoluções aleatórios (inclusive distâncias negativas e acima do
+ * histograma) e compara tof_frame_compute_stats() com uma referência escalar
+ * escrita com tof_frame_target_is_valid(), campo a campo. Depois mede os
+ * ciclos por frame da referência e do núcleo. Compile com
+ * -DTOF_FRAME_STATS_NO_SIMD para medir no PC o caminho portátil usado no ESP32
+ * e com -DTOF_FRAME_TARGETS_PER_ZONE=2 para o caminho de vários alvos (ver README).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "tof_frame.h"
+#include "tof_frame_stats.h"
+
+#define BENCH_FRAMES 4096                           /**< Frames sintéticos distintos. */
+#define BENCH_CHECK_ROUNDS 64                       /**< Conjuntos de frames aleatórios verificados. */
+#define BENCH_ITERATIONS 200                        /**< Passadas sobre os frames por medição. */
+
+static tof_frame_t s_frames[BENCH_FRAMES];
+
+/** @brief Preenche os frames com valores pseudoaleatórios. */
+static void build_frames(uint32_t seed);
+
+/** @brief Estatísticas calculadas zona a zona com tof_frame_target_is_valid(), como referência. */
+static void reference_stats(const tof_frame_t *frame, int target, tof_frame_stats_t *stats);
+
+/** @brief Lê o contador de ciclos (TSC no x86) ou, sem ele, o relógio em ns. */
+static uint64_t read_cycles(void);
+
+/** @brief Lê o relógio monotônico em ns. */
+static uint64_t read_ns(void);
+
+int main(void) {
+    int failures = 0;
+    tof_frame_stats_t kernel, reference;
+
+    for (uint32_t round = 0; round < BENCH_CHECK_ROUNDS && failures == 0; round++) {
+        build_frames(round + 1);
+        for (int f = 0; f < BENCH_FRAMES; f++) {
+            for (int t = 0; t < TOF_FRAME_TARGETS_PER_ZONE; t++) {
+                tof_frame_compute_stats(&s_frames[f], t, &kernel);
+                reference_stats(&s_frames[f], t, &reference);
+                if (memcmp(&kernel, &reference, sizeof(kernel)) != 0) {
+                    printf("Frame %d (rodada %u, alvo %d): núcleo e referência diferem "
+                           "(máscara %016llx / %016llx, mín %d / %d, máx %d / %d, média %d / %d)\n",
+                           f, round, t, (unsigned long long)kernel.valid_mask,
+                           (unsigned long long)reference.valid_mask, kernel.min_mm, reference.min_mm,
+                           kernel.max_mm, reference.max_mm, kernel.mean_mm, reference.mean_mm);
+                    failures++;
+                    break;
+                }
+            }
+        }
+    }
+    if (failures != 0) {
+        return 1;
+    }
+
+    printf("Alvos por zona: %d, caminho %s, %d frames verificados\n", TOF_FRAME_TARGETS_PER_ZONE,
+#if defined(TOF_FRAME_STATS_NO_SIMD)
+           "portátil",
+#else
+           "padrão",
+#endif
+           BENCH_CHECK_ROUNDS * BENCH_FRAMES);
+    printf("%-22s %12s %10s\n", "operação", "ciclos/frame", "ns/frame");
+
+    volatile uint64_t sink = 0;
+    for (int op = 0; op < 4; op++) {
+        uint64_t start_cycles = read_cycles();
+        uint64_t start_ns = read_ns();
+        for (int it = 0; it < BENCH_ITERATIONS; it++) {
+            for (int f = 0; f < BENCH_FRAMES; f++) {
+                const tof_frame_t *frame = &s_frames[f];
+                if (op == 0) {
+                    uint64_t mask = 0;
+                    for (int z = 0; z < frame->resolution; z++) {
+                        mask |= (uint64_t)tof_frame_target_is_valid(frame, z, 0) << z;
+                    }
+                    sink += mask;
+                } else if (op == 1) {
+                    sink += tof_frame_valid_mask(frame, 0);
+                } else if (op == 2) {
+                    reference_stats(frame, 0, &reference);
+                    sink += (uint64_t)reference.sum_mm;
+                } else {
+                    tof_frame_compute_stats(frame, 0, &kernel);
+                    sink += (uint64_t)kernel.sum_mm;
+                }
+            }
+        }
+        uint64_t frames = (uint64_t)BENCH_ITERATIONS * BENCH_FRAMES;
+        uint64_t cycles = read_cycles() - start_cycles;
+        uint64_t ns = read_ns() - start_ns;
+        static const char *names[] = { "máscara (referência)", "máscara (núcleo)",
+                                       "estatísticas (ref.)", "estatísticas (núcleo)" };
+        printf("%-22s %12.1f %10.1f\n", names[op], (double)cycles / frames, (double)ns / frames);
+    }
+    return 0;
+}
+
+static void build_frames(uint32_t seed) {
+    // Distribuição parecida com a do sensor: a maioria das zonas com status 5,
+    // algumas com 9 e outros status, e contagens de 0 a 2 alvos
+    static const uint8_t statuses[] = { 5, 5, 5, 5, 9, 0, 4, 6, 10, 255 };
+    srand(seed);
+    memset(s_frames, 0, sizeof(s_frames));
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        tof_frame_t *frame = &s_frames[f];
+        frame->resolution = (rand() % 4 == 0) ? 16 : 64;
+        for (int z = 0; z < TOF_FRAME_MAX_ZONES; z++) {
+            frame->nb_target_detected[z] = (uint8_t)(rand() % 3);
+        }
+        for (int i = 0; i < TOF_FRAME_MAX_TARGETS; i++) {
+            frame->target_status[i] = statuses[rand() % sizeof(statuses)];
+            frame->distance_mm[i] = (int16_t)(rand() % 5200 - 100);
+        }
+    }
+}
+
+static void reference_stats(const tof_frame_t *frame, int target, tof_frame_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    int32_t sum = 0;
+    for (int z = 0; z < frame->resolution && z < TOF_FRAME_MAX_ZONES; z++) {
+        if (!tof_frame_target_is_valid(frame, z, target)) {
+            continue;
+        }
+        int16_t d = frame->distance_mm[TOF_FRAME_TARGET_IDX(z, target)];
+        if (stats->valid_count == 0 || d < stats->min_mm) {
+            stats->min_mm = d;
+        }
+        if (stats->valid_count == 0 || d > stats->max_mm) {
+            stats->max_mm = d;
+        }
+        int bin = d < 0 ? 0 : d / (1 << TOF_FRAME_STATS_BIN_SHIFT);
+        stats->histogram[bin < TOF_FRAME_STATS_BINS ? bin : TOF_FRAME_STATS_BINS - 1]++;
+        stats->valid_mask |= (uint64_t)1 << z;
+        stats->valid_count++;
+        sum += d;
+    }
+    stats->sum_mm = sum;
+    if (stats->valid_count > 0) {
+        double mean = (double)sum / stats->valid_count;
+        stats->mean_mm = (int16_t)(mean >= 0 ? mean + 0.5 : mean - 0.5);
+    }
+}
+
+static uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return read_ns();
+#endif
+}
+
+static uint64_t read_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file bench_results_parse.c
+ * @brief Microbenchmark da decodificação de um frame de resultados do VL53LMZ.
+ *
+ * Compara, para 4x4 e 8x8, o custo por frame de:
+ *  - "original": o algoritmo do driver da ST até a versão 2.0.10 (SwapBuffer
+ *    de todo o buffer, depois o percurso dos cabeçalhos e um memcpy por bloco),
+ *    reproduzido aqui como referência;
+ *  - "fundido": vl53lmz_get_ranging_data() atual, que troca a ordem de bytes
+ *    dos cabeçalhos e dos blocos no mesmo percurso em que os decodifica;
+ *  - "visão": vl53lmz_get_ranging_view() mais as cópias para o frame do
+ *    pipeline, como no firmware.
+ * Os resultados de "original" e "fundido" são comparados campo a campo antes
+ * da medição. O número de alvos por zona é fixado na compilação; para medir de
+ * 1 a 4 alvos, compile uma vez para cada valor (ver README). A plataforma
+ * mínima e o gerador dos frames ficam em platform.c.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "vl53lmz_api.h"
+#include "vl53lmz_results_view.h"
+
+#define BENCH_ITERATIONS 20000                      /**< Frames decodificados por medição. */
+
+static VL53LMZ_Configuration s_dev;                 /**< Estado do driver (usa apenas temp_buffer e data_read_size). */
+static VL53LMZ_ResultsData s_reference;             /**< Resultado do algoritmo original. */
+static VL53LMZ_ResultsData s_fused;                 /**< Resultado do algoritmo fundido. */
+
+/** @brief Algoritmo original de vl53lmz_get_ranging_data(), como referência. */
+static uint8_t reference_get_ranging_data(VL53LMZ_Configuration *p_dev, VL53LMZ_ResultsData *p_results);
+
+/** @brief Lê o contador de ciclos (TSC no x86) ou, sem ele, o relógio em ns. */
+static uint64_t read_cycles(void);
+
+/** @brief Lê o relógio monotônico em ns. */
+static uint64_t read_ns(void);
+
+int main(void) {
+    static uint8_t frame[BENCH_MAX_FRAME];
+    const uint8_t resolutions[] = { VL53LMZ_RESOLUTION_4X4, VL53LMZ_RESOLUTION_8X8 };
+    int failures = 0;
+
+    printf("Alvos por zona: %u, %d frames por medição\n", (unsigned)VL53LMZ_NB_TARGET_PER_ZONE, BENCH_ITERATIONS);
+    printf("%-5s %6s  %-9s %12s %10s\n", "res", "bytes", "algoritmo", "ciclos/frame", "ns/frame");
+
+    for (size_t r = 0; r < sizeof(resolutions); r++) {
+        uint8_t resolution = resolutions[r];
+        uint32_t size = bench_build_results_frame(frame, resolution);
+        bench_set_frame(frame, size);
+        s_dev.data_read_size = size;
+
+        uint8_t ref_status = reference_get_ranging_data(&s_dev, &s_reference);
+        uint8_t fused_status = vl53lmz_get_ranging_data(&s_dev, &s_fused);
+        if (ref_status != fused_status || memcmp(&s_reference, &s_fused, sizeof(s_reference)) != 0) {
+            printf("%ux%u: resultados diferentes entre o algoritmo original e o fundido\n",
+                   resolution == VL53LMZ_RESOLUTION_4X4 ? 4 : 8, resolution == VL53LMZ_RESOLUTION_4X4 ? 4 : 8);
+            failures++;
+        }
+
+        static int16_t distance[VL53LMZ_RESOLUTION_8X8 * VL53LMZ_NB_TARGET_PER_ZONE];
+        static uint16_t sigma[VL53LMZ_RESOLUTION_8X8 * VL53LMZ_NB_TARGET_PER_ZONE];
+        static uint32_t signal[VL53LMZ_RESOLUTION_8X8 * VL53LMZ_NB_TARGET_PER_ZONE];
+        static uint8_t status[VL53LMZ_RESOLUTION_8X8 * VL53LMZ_NB_TARGET_PER_ZONE];
+        static uint8_t nb_target[VL53LMZ_RESOLUTION_8X8];
+        const uint32_t view_blocks = VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_NB_TARGET_DETECTED) |
+                                     VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_DISTANCE_MM) |
+                                     VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_RANGE_SIGMA_MM) |
+                                     VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_SIGNAL_PER_SPAD) |
+                                     VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_TARGET_STATUS);
+        const uint16_t targets = (uint16_t)(resolution * VL53LMZ_NB_TARGET_PER_ZONE);
+
+        for (int algo = 0; algo < 3; algo++) {
+            uint64_t start_cycles = read_cycles();
+            uint64_t start_ns = read_ns();
+            for (int it = 0; it < BENCH_ITERATIONS; it++) {
+                if (algo == 0) {
+                    reference_get_ranging_data(&s_dev, &s_reference);
+                } else if (algo == 1) {
+                    vl53lmz_get_ranging_data(&s_dev, &s_fused);
+                } else {
+                    VL53LMZ_ResultsView view;
+                    vl53lmz_get_ranging_view(&s_dev, view_blocks, &view);
+                    vl53lmz_view_copy_nb_target_detected(&view, nb_target, resolution);
+                    vl53lmz_view_copy_distance_mm(&view, distance, targets);
+                    vl53lmz_view_copy_range_sigma_mm(&view, sigma, targets);
+                    vl53lmz_view_copy_signal_per_spad(&view, signal, targets);
+                    vl53lmz_view_copy_target_status(&view, status, targets);
+                }
+            }
+            uint64_t cycles = read_cycles() - start_cycles;
+            uint64_t ns = read_ns() - start_ns;
+            printf("%-5s %6lu  %-9s %12.0f %10.0f\n",
+                   resolution == VL53LMZ_RESOLUTION_4X4 ? "4x4" : "8x8", (unsigned long)size,
+                   algo == 0 ? "original" : (algo == 1 ? "fundido" : "visão"),
+                   (double)cycles / BENCH_ITERATIONS, (double)ns / BENCH_ITERATIONS);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+static uint8_t reference_get_ranging_data(VL53LMZ_Configuration *p_dev, VL53LMZ_ResultsData *p_results) {
+    uint8_t status = VL53LMZ_STATUS_OK;
+    union Block_header *bh_ptr;
+    uint32_t i, j, msize;
+
+    status |= RdMulti(&(p_dev->platform), 0x0, p_dev->temp_buffer, p_dev->data_read_size);
+    p_dev->streamcount = p_dev->temp_buffer[0];
+    SwapBuffer(p_dev->temp_buffer, (uint16_t)p_dev->data_read_size);
+
+    for (i = 16; i < p_dev->data_read_size; i += 4) {
+        bh_ptr = (union Block_header *)&(p_dev->temp_buffer[i]);
+        msize = (bh_ptr->type > 0x1 && bh_ptr->type < 0xd) ? bh_ptr->type * bh_ptr->size : bh_ptr->size;
+        uint8_t *src = &(p_dev->temp_buffer[i + 4]);
+        switch (bh_ptr->idx) {
+            case VL53LMZ_METADATA_IDX: p_results->silicon_temp_degc = (int8_t)p_dev->temp_buffer[i + 12]; break;
+            case VL53LMZ_AMBIENT_RATE_IDX: memcpy(p_results->ambient_per_spad, src, msize); break;
+            case VL53LMZ_SPAD_COUNT_IDX: memcpy(p_results->nb_spads_enabled, src, msize); break;
+            case VL53LMZ_NB_TARGET_DETECTED_IDX: memcpy(p_results->nb_target_detected, src, msize); break;
+            case VL53LMZ_SIGNAL_RATE_IDX: memcpy(p_results->signal_per_spad, src, msize); break;
+            case VL53LMZ_RANGE_SIGMA_MM_IDX: memcpy(p_results->range_sigma_mm, src, msize); break;
+            case VL53LMZ_DISTANCE_IDX: memcpy(p_results->distance_mm, src, msize); break;
+            case VL53LMZ_REFLECTANCE_EST_PC_IDX: memcpy(p_results->reflectance, src, msize); break;
+            case VL53LMZ_TARGET_STATUS_IDX: memcpy(p_results->target_status, src, msize); break;
+            case VL53LMZ_MOTION_DETEC_IDX: memcpy(&p_results->motion_indicator, src, msize); break;
+            default: break;
+        }
+        i += msize;
+    }
+
+    for (i = 0; i < VL53LMZ_RESOLUTION_8X8; i++) {
+        p_results->ambient_per_spad[i] /= 2048;
+    }
+    for (i = 0; i < VL53LMZ_RESOLUTION_8X8 * VL53LMZ_NB_TARGET_PER_ZONE; i++) {
+        p_results->distance_mm[i] /= 4;
+        if (p_results->distance_mm[i] < 0) {
+            p_results->distance_mm[i] = 0;
+        }
+        p_results->reflectance[i] /= 2;
+        p_results->range_sigma_mm[i] /= 128;
+        p_results->signal_per_spad[i] /= 2048;
+    }
+    for (i = 0; i < VL53LMZ_RESOLUTION_8X8; i++) {
+        if (p_results->nb_target_detected[i] == 0) {
+            for (j = 0; j < VL53LMZ_NB_TARGET_PER_ZONE; j++) {
+                p_results->target_status[VL53LMZ_NB_TARGET_PER_ZONE * i + j] = 255;
+            }
+        }
+    }
+    for (i = 0; i < 32; i++) {
+        p_results->motion_indicator.motion[i] /= 65535;
+    }
+
+    uint16_t header_id = (uint16_t)((p_dev->temp_buffer[0x8] << 8) | p_dev->temp_buffer[0x9]);
+    uint16_t footer_id = (uint16_t)((p_dev->temp_buffer[p_dev->data_read_size - 4] << 8) |
+                                    p_dev->temp_buffer[p_dev->data_read_size - 3]);
+    if (header_id != footer_id) {
+        status |= VL53LMZ_STATUS_CORRUPTED_FRAME;
+    }
+    return status;
+}
+
+static uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return read_ns();
+#endif
+}
+
+static uint64_t read_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
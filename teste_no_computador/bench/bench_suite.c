@@ -0,0 +1,566 @@
+/**
+ * @file bench_suite.c
+ * @brief Suíte de benchmarks de regressão do caminho de um frame no PC.
+ *
+ * Mede, com os mesmos fontes do firmware e do simulador:
+ *  - o driver: vl53lmz_get_ranging_data() e a visão sem cópia sobre frames
+ *    sintéticos 4x4 e 8x8 (platform.c) e, com --capture, sobre frames de
+ *    resultados gravados do sensor;
+ *  - o decodificador dos pares HEX DATA / TARGET STATUS do log de texto
+ *    (log_replay.c);
+ *  - os núcleos por frame: máscara de validade, estatísticas e a mediana de
+ *    tof_filter, sobre os frames do log;
+ *  - os escritores: linha CSV, bloco .tofb (completo e delta) e pacote do
+ *    streaming da UART.
+ *
+ * Cada caso reporta ns/frame (a menor de BENCH_TRIALS medições de ao menos
+ * BENCH_MIN_TRIAL_NS, alternadas entre os casos) e bytes/frame: a entrada no
+ * driver e no decodificador, a saída nos escritores e 0 nos núcleos. Com
+ * --json o resultado é gravado em um arquivo e, com --baseline, comparado com
+ * um resultado anterior: o programa encerra com erro se os bytes/frame de
+ * algum caso mudarem ou se o tempo passar da referência mais a tolerância.
+ *
+ * Uma captura (--capture) é uma sequência de registros
+ *
+ *     uint32 tamanho (little-endian)
+ *     tamanho x uint8                               (temp_buffer como lido por RdMulti, na ordem do sensor)
+ *
+ * gravados com o mesmo VL53LMZ_NB_TARGET_PER_ZONE da compilação.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vl53lmz_api.h"
+#include "vl53lmz_results_view.h"
+
+#include "tof_bin.h"
+#include "tof_csv.h"
+#include "tof_filter.h"
+#include "tof_frame.h"
+#include "tof_frame_stats.h"
+#include "tof_stream.h"
+
+#include "log_replay.h"
+
+#ifndef BENCH_DEFAULT_LOG
+#define BENCH_DEFAULT_LOG "device-monitor-250706-173207.log"
+#endif
+
+#define BENCH_DRIVER_BATCH 1024                     /**< Frames sintéticos decodificados por passada. */
+#define BENCH_TRIALS 9                              /**< Medições por caso (vale a menor). */
+#define BENCH_MIN_TRIAL_NS 10000000ULL              /**< Duração mínima de uma medição. */
+#define BENCH_MAX_CASES 16                          /**< Casos de uma execução. */
+#define BENCH_NAME_LEN 48                           /**< Tamanho máximo do nome de um caso. */
+#define BENCH_DEFAULT_TOLERANCE 0.25                /**< Aumento de tempo aceito em relação à referência. */
+#define BENCH_DELTA_KEYFRAME_INTERVAL 32            /**< Keyframes do caso delta (o exemplo do README). */
+#define BENCH_DELTA_THRESHOLD_MM 20                 /**< Limiar do caso delta. */
+
+/**
+ * @brief Um caso: uma passada processa um lote fixo de frames.
+ */
+typedef struct {
+    const char *name;                               /**< Nome no relatório e no JSON. */
+    uint64_t (*pass)(uint64_t *bytes);              /**< Processa o lote; retorna os frames e soma os bytes. */
+} bench_case_t;
+
+/**
+ * @brief Resultado de um caso.
+ */
+typedef struct {
+    char name[BENCH_NAME_LEN];                      /**< Nome do caso. */
+    double ns_per_frame;                            /**< Menor tempo médio por frame entre as medições. */
+    double bytes_per_frame;                         /**< Bytes por frame da primeira passada. */
+} bench_result_t;
+
+/**
+ * @brief Frames de resultados gravados do sensor.
+ */
+typedef struct {
+    uint8_t *data;                                  /**< Registros do arquivo, sem os tamanhos. */
+    uint32_t *offset;                               /**< Início de cada frame em data. */
+    uint32_t *size;                                 /**< Tamanho de cada frame. */
+    size_t count;                                   /**< Frames. */
+} bench_capture_t;
+
+static VL53LMZ_Configuration s_dev;                 /**< Estado do driver (usa apenas temp_buffer e data_read_size). */
+static VL53LMZ_ResultsData s_results;               /**< Saída de vl53lmz_get_ranging_data(). */
+static uint8_t s_synthetic[2][BENCH_MAX_FRAME];     /**< Frames sintéticos 4x4 e 8x8. */
+static uint32_t s_synthetic_size[2];                /**< Tamanho de cada frame sintético. */
+static bench_capture_t s_capture;                   /**< Frames de --capture. */
+
+static log_replay_t s_log;                          /**< Log de texto mapeado. */
+static tof_frame_t *s_frames;                       /**< Frames decodificados do log. */
+static tof_frame_t *s_filter_frames;                /**< Cópia filtrada no lugar pelo caso da mediana. */
+static size_t s_frame_count;                        /**< Frames em s_frames. */
+
+static tof_bin_block_t s_block;                     /**< Bloco dos casos .tofb. */
+static tof_bin_delta_t s_delta;                     /**< Codificador do caso delta. */
+static tof_filter_t s_filter;                       /**< Filtro do caso da mediana. */
+static uint8_t s_out[TOF_BIN_MAX_BLOCK_SIZE];       /**< Saída dos escritores (o maior deles). */
+static volatile uint64_t s_sink;                    /**< Consome os resultados para que o compilador não os descarte. */
+
+/** @brief Decodifica BENCH_DRIVER_BATCH vezes um frame sintético com vl53lmz_get_ranging_data(). */
+static uint64_t driver_pass(int synthetic, uint64_t *bytes);
+
+/** @brief Passadas do driver sobre o frame 4x4 e o 8x8. */
+static uint64_t pass_driver_4x4(uint64_t *bytes);
+static uint64_t pass_driver_8x8(uint64_t *bytes);
+
+/** @brief Visão sem cópia e cópias para o frame do pipeline, como no firmware, sobre o frame 8x8. */
+static uint64_t pass_driver_view_8x8(uint64_t *bytes);
+
+/** @brief vl53lmz_get_ranging_data() sobre cada frame da captura. */
+static uint64_t pass_driver_capture(uint64_t *bytes);
+
+/** @brief Decodifica todo o log de texto. */
+static uint64_t pass_hex_decode(uint64_t *bytes);
+
+/** @brief Máscara de validade do primeiro alvo de cada frame do log. */
+static uint64_t pass_valid_mask(uint64_t *bytes);
+
+/** @brief Estatísticas do primeiro alvo de cada frame do log. */
+static uint64_t pass_frame_stats(uint64_t *bytes);
+
+/** @brief Mediana de 3 frames sobre a sequência do log. */
+static uint64_t pass_filter_median(uint64_t *bytes);
+
+/** @brief Linhas CSV de cada frame do log. */
+static uint64_t pass_csv(uint64_t *bytes);
+
+/** @brief Blocos .tofb completos ou delta com os frames do log. */
+static uint64_t tofb_pass(bool delta, uint64_t *bytes);
+static uint64_t pass_tofb(uint64_t *bytes);
+static uint64_t pass_tofb_delta(uint64_t *bytes);
+
+/** @brief Pacotes do streaming da UART com os frames do log. */
+static uint64_t pass_stream(uint64_t *bytes);
+
+/** @brief Passada de aquecimento de um caso (caches, preditores e a contagem de bytes). */
+static void prepare_case(const bench_case_t *bench_case, bench_result_t *result);
+
+/** @brief Uma medição de um caso; guarda a menor. */
+static void measure_case(const bench_case_t *bench_case, bench_result_t *result);
+
+/** @brief Lê uma captura de frames de resultados. */
+static bool load_capture(const char *path, bench_capture_t *capture);
+
+/** @brief Decodifica o log inteiro em s_frames. */
+static bool load_log(const char *path);
+
+/** @brief Grava os resultados em JSON, um caso por linha. */
+static bool write_json(const char *path, const bench_result_t *results, size_t count);
+
+/** @brief Lê os casos de um JSON gravado por write_json(); retorna quantos leu ou -1 se não abrir. */
+static int read_json(const char *path, bench_result_t *results, size_t capacity);
+
+/** @brief Lê o relógio monotônico em ns. */
+static uint64_t read_ns(void);
+
+int main(int argc, char **argv) {
+    const char *log_path = BENCH_DEFAULT_LOG;
+    const char *capture_path = NULL;
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+    double tolerance = BENCH_DEFAULT_TOLERANCE;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            log_path = argv[++i];
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "uso: %s [--log LOG] [--capture CAPTURA] [--json SAIDA.json] "
+                            "[--baseline REFERENCIA.json] [--tolerance FRACAO]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    s_synthetic_size[0] = bench_build_results_frame(s_synthetic[0], VL53LMZ_RESOLUTION_4X4);
+    s_synthetic_size[1] = bench_build_results_frame(s_synthetic[1], VL53LMZ_RESOLUTION_8X8);
+    if (!load_log(log_path)) {
+        fprintf(stderr, "Erro: não foi possível ler frames de %s\n", log_path);
+        return 2;
+    }
+    if (capture_path != NULL && !load_capture(capture_path, &s_capture)) {
+        fprintf(stderr, "Erro: captura inválida: %s\n", capture_path);
+        return 2;
+    }
+
+    bench_case_t cases[BENCH_MAX_CASES];
+    size_t case_count = 0;
+    cases[case_count++] = (bench_case_t){ "driver_get_ranging_data_4x4", pass_driver_4x4 };
+    cases[case_count++] = (bench_case_t){ "driver_get_ranging_data_8x8", pass_driver_8x8 };
+    cases[case_count++] = (bench_case_t){ "driver_ranging_view_8x8", pass_driver_view_8x8 };
+    if (s_capture.count > 0) {
+        cases[case_count++] = (bench_case_t){ "driver_get_ranging_data_capture", pass_driver_capture };
+    }
+    cases[case_count++] = (bench_case_t){ "log_hex_decode", pass_hex_decode };
+    cases[case_count++] = (bench_case_t){ "frame_valid_mask", pass_valid_mask };
+    cases[case_count++] = (bench_case_t){ "frame_stats", pass_frame_stats };
+    cases[case_count++] = (bench_case_t){ "filter_median", pass_filter_median };
+    cases[case_count++] = (bench_case_t){ "csv_format_frame", pass_csv };
+    cases[case_count++] = (bench_case_t){ "tofb_block", pass_tofb };
+    cases[case_count++] = (bench_case_t){ "tofb_block_delta", pass_tofb_delta };
+    cases[case_count++] = (bench_case_t){ "stream_encode_frame", pass_stream };
+
+    bench_result_t baseline[BENCH_MAX_CASES * 2];
+    int baseline_count = 0;
+    if (baseline_path != NULL && (baseline_count = read_json(baseline_path, baseline, BENCH_MAX_CASES * 2)) < 0) {
+        fprintf(stderr, "Erro: não foi possível abrir %s\n", baseline_path);
+        return 2;
+    }
+
+    printf("Alvos por zona: %u, %lu frames do log", (unsigned)VL53LMZ_NB_TARGET_PER_ZONE,
+           (unsigned long)s_frame_count);
+    if (s_capture.count > 0) {
+        printf(", %lu frames da captura", (unsigned long)s_capture.count);
+    }
+    printf("\n%-32s %10s %12s", "caso", "ns/frame", "bytes/frame");
+    if (baseline_path != NULL) {
+        printf(" %10s %7s", "referência", "razão");
+    }
+    printf("\n");
+
+    // As medições se alternam entre os casos, para que uma rajada de carga na máquina não pegue só um deles
+    bench_result_t results[BENCH_MAX_CASES];
+    for (size_t c = 0; c < case_count; c++) {
+        prepare_case(&cases[c], &results[c]);
+    }
+    for (int trial = 0; trial < BENCH_TRIALS; trial++) {
+        for (size_t c = 0; c < case_count; c++) {
+            measure_case(&cases[c], &results[c]);
+        }
+    }
+
+    int failures = 0;
+    for (size_t c = 0; c < case_count; c++) {
+        printf("%-32s %10.1f %12.1f", results[c].name, results[c].ns_per_frame, results[c].bytes_per_frame);
+
+        const bench_result_t *ref = NULL;
+        for (int b = 0; b < baseline_count; b++) {
+            if (strcmp(baseline[b].name, results[c].name) == 0) {
+                ref = &baseline[b];
+            }
+        }
+        if (baseline_path != NULL && ref == NULL) {
+            printf(" %10s", "(novo)");
+        } else if (ref != NULL) {
+            double ratio = ref->ns_per_frame > 0 ? results[c].ns_per_frame / ref->ns_per_frame : 1.0;
+            printf(" %10.1f %6.2fx", ref->ns_per_frame, ratio);
+            // Os bytes/frame são determinísticos: qualquer diferença é uma mudança de formato ou de entrada
+            if (results[c].bytes_per_frame > ref->bytes_per_frame + 0.05 ||
+                results[c].bytes_per_frame < ref->bytes_per_frame - 0.05) {
+                printf("  BYTES (referência %.1f)", ref->bytes_per_frame);
+                failures++;
+            } else if (ratio > 1.0 + tolerance) {
+                printf("  REGRESSÃO");
+                failures++;
+            }
+        }
+        printf("\n");
+    }
+
+    if (json_path != NULL && !write_json(json_path, results, case_count)) {
+        fprintf(stderr, "Erro: não foi possível gravar %s\n", json_path);
+        failures++;
+    }
+    if (baseline_path != NULL) {
+        printf("%d caso(s) fora da referência (tolerância de %.0f%%)\n", failures, tolerance * 100);
+    }
+
+    log_replay_close(&s_log);
+    return failures == 0 ? 0 : 1;
+}
+
+static uint64_t driver_pass(int synthetic, uint64_t *bytes) {
+    bench_set_frame(s_synthetic[synthetic], s_synthetic_size[synthetic]);
+    s_dev.data_read_size = s_synthetic_size[synthetic];
+    for (int i = 0; i < BENCH_DRIVER_BATCH; i++) {
+        s_sink += vl53lmz_get_ranging_data(&s_dev, &s_results);
+    }
+    s_sink += (uint64_t)s_results.distance_mm[0];
+    *bytes += (uint64_t)BENCH_DRIVER_BATCH * s_synthetic_size[synthetic];
+    return BENCH_DRIVER_BATCH;
+}
+
+static uint64_t pass_driver_4x4(uint64_t *bytes) {
+    return driver_pass(0, bytes);
+}
+
+static uint64_t pass_driver_8x8(uint64_t *bytes) {
+    return driver_pass(1, bytes);
+}
+
+static uint64_t pass_driver_view_8x8(uint64_t *bytes) {
+    static int16_t distance[VL53LMZ_RESOLUTION_8X8 * VL53LMZ_NB_TARGET_PER_ZONE];
+    static uint16_t sigma[VL53LMZ_RESOLUTION_8X8 * VL53LMZ_NB_TARGET_PER_ZONE];
+    static uint32_t signal[VL53LMZ_RESOLUTION_8X8 * VL53LMZ_NB_TARGET_PER_ZONE];
+    static uint8_t status[VL53LMZ_RESOLUTION_8X8 * VL53LMZ_NB_TARGET_PER_ZONE];
+    static uint8_t nb_target[VL53LMZ_RESOLUTION_8X8];
+    const uint32_t view_blocks = VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_NB_TARGET_DETECTED) |
+                                 VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_DISTANCE_MM) |
+                                 VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_RANGE_SIGMA_MM) |
+                                 VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_SIGNAL_PER_SPAD) |
+                                 VL53LMZ_VIEW_MASK(VL53LMZ_VIEW_TARGET_STATUS);
+    const uint16_t targets = (uint16_t)(VL53LMZ_RESOLUTION_8X8 * VL53LMZ_NB_TARGET_PER_ZONE);
+
+    bench_set_frame(s_synthetic[1], s_synthetic_size[1]);
+    s_dev.data_read_size = s_synthetic_size[1];
+    for (int i = 0; i < BENCH_DRIVER_BATCH; i++) {
+        VL53LMZ_ResultsView view;
+        s_sink += vl53lmz_get_ranging_view(&s_dev, view_blocks, &view);
+        vl53lmz_view_copy_nb_target_detected(&view, nb_target, VL53LMZ_RESOLUTION_8X8);
+        vl53lmz_view_copy_distance_mm(&view, distance, targets);
+        vl53lmz_view_copy_range_sigma_mm(&view, sigma, targets);
+        vl53lmz_view_copy_signal_per_spad(&view, signal, targets);
+        vl53lmz_view_copy_target_status(&view, status, targets);
+    }
+    s_sink += (uint64_t)distance[0] + sigma[0] + signal[0] + status[0] + nb_target[0];
+    *bytes += (uint64_t)BENCH_DRIVER_BATCH * s_synthetic_size[1];
+    return BENCH_DRIVER_BATCH;
+}
+
+static uint64_t pass_driver_capture(uint64_t *bytes) {
+    for (size_t i = 0; i < s_capture.count; i++) {
+        bench_set_frame(&s_capture.data[s_capture.offset[i]], s_capture.size[i]);
+        s_dev.data_read_size = s_capture.size[i];
+        s_sink += vl53lmz_get_ranging_data(&s_dev, &s_results);
+        *bytes += s_capture.size[i];
+    }
+    s_sink += (uint64_t)s_results.distance_mm[0];
+    return s_capture.count;
+}
+
+static uint64_t pass_hex_decode(uint64_t *bytes) {
+    log_replay_t slice;
+    tof_frame_t frame;
+    uint64_t frames = 0;
+    log_replay_slice(&s_log, 0, s_log.size, &slice);
+    while (log_replay_next(&slice, &frame)) {
+        s_sink += (uint64_t)frame.distance_mm[0];
+        frames++;
+    }
+    *bytes += s_log.size;
+    return frames;
+}
+
+static uint64_t pass_valid_mask(uint64_t *bytes) {
+    (void)bytes;
+    uint64_t acc = 0;
+    for (size_t i = 0; i < s_frame_count; i++) {
+        acc ^= tof_frame_valid_mask(&s_frames[i], 0);
+    }
+    s_sink += acc;
+    return s_frame_count;
+}
+
+static uint64_t pass_frame_stats(uint64_t *bytes) {
+    (void)bytes;
+    tof_frame_stats_t stats;
+    for (size_t i = 0; i < s_frame_count; i++) {
+        tof_frame_compute_stats(&s_frames[i], 0, &stats);
+        s_sink += stats.valid_mask;
+    }
+    return s_frame_count;
+}
+
+static uint64_t pass_filter_median(uint64_t *bytes) {
+    (void)bytes;
+    const tof_filter_config_t config = TOF_FILTER_CONFIG_DEFAULT(TOF_FILTER_MEDIAN);
+    tof_filter_init(&s_filter, &config);
+    for (size_t i = 0; i < s_frame_count; i++) {
+        tof_filter_apply(&s_filter, &s_filter_frames[i]);
+    }
+    s_sink += (uint64_t)s_filter_frames[s_frame_count - 1].distance_mm[0];
+    return s_frame_count;
+}
+
+static uint64_t pass_csv(uint64_t *bytes) {
+    static char line[TOF_CSV_MAX_FRAME_LEN];
+    for (size_t i = 0; i < s_frame_count; i++) {
+        size_t len = tof_csv_format_frame(line, sizeof(line), &s_frames[i]);
+        s_sink += (uint8_t)line[0];
+        *bytes += len;
+    }
+    return s_frame_count;
+}
+
+static uint64_t tofb_pass(bool delta, uint64_t *bytes) {
+    const tof_bin_delta_config_t delta_config = {
+        .keyframe_interval = BENCH_DELTA_KEYFRAME_INTERVAL,
+        .threshold_mm = BENCH_DELTA_THRESHOLD_MM,
+    };
+    // Cada passada começa um "arquivo" novo, para que os bytes não dependam das anteriores
+    tof_bin_delta_init(&s_delta, &delta_config);
+    tof_bin_block_reset(&s_block);
+    for (size_t i = 0; i < s_frame_count; i++) {
+        if (delta) {
+            tof_bin_block_add_delta_frame(&s_block, &s_delta, &s_frames[i]);
+        } else {
+            tof_bin_block_add_frame(&s_block, &s_frames[i]);
+        }
+        if (tof_bin_block_is_full(&s_block) || i + 1 == s_frame_count) {
+            *bytes += tof_bin_block_encode(&s_block, s_out, sizeof(s_out));
+            s_sink += s_out[0];
+            tof_bin_block_reset(&s_block);
+        }
+    }
+    return s_frame_count;
+}
+
+static uint64_t pass_tofb(uint64_t *bytes) {
+    return tofb_pass(false, bytes);
+}
+
+static uint64_t pass_tofb_delta(uint64_t *bytes) {
+    return tofb_pass(true, bytes);
+}
+
+static uint64_t pass_stream(uint64_t *bytes) {
+    for (size_t i = 0; i < s_frame_count; i++) {
+        *bytes += tof_stream_encode_frame(&s_frames[i], s_out, sizeof(s_out));
+        s_sink += s_out[1];
+    }
+    return s_frame_count;
+}
+
+static void prepare_case(const bench_case_t *bench_case, bench_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    snprintf(result->name, sizeof(result->name), "%s", bench_case->name);
+    uint64_t bytes = 0;
+    uint64_t frames = bench_case->pass(&bytes);
+    result->bytes_per_frame = frames > 0 ? (double)bytes / (double)frames : 0;
+    result->ns_per_frame = -1;
+}
+
+static void measure_case(const bench_case_t *bench_case, bench_result_t *result) {
+    uint64_t frames = 0;
+    uint64_t start = read_ns();
+    uint64_t elapsed;
+    do {
+        uint64_t ignored = 0;
+        frames += bench_case->pass(&ignored);
+        elapsed = read_ns() - start;
+    } while (elapsed < BENCH_MIN_TRIAL_NS);
+    double ns = frames > 0 ? (double)elapsed / (double)frames : 0;
+    if (result->ns_per_frame < 0 || ns < result->ns_per_frame) {
+        result->ns_per_frame = ns;
+    }
+}
+
+static bool load_capture(const char *path, bench_capture_t *capture) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    // Cada frame ocupa ao menos 4 + 1 bytes, o que limita o número de registros
+    size_t max_frames = file_size > 0 ? (size_t)file_size / 5 : 0;
+    capture->data = malloc(file_size > 0 ? (size_t)file_size : 1);
+    capture->offset = malloc((max_frames + 1) * sizeof(uint32_t));
+    capture->size = malloc((max_frames + 1) * sizeof(uint32_t));
+    capture->count = 0;
+    if (capture->data == NULL || capture->offset == NULL || capture->size == NULL) {
+        fclose(file);
+        return false;
+    }
+
+    uint32_t used = 0;
+    uint8_t len_le[4];
+    bool ok = true;
+    while (fread(len_le, 1, sizeof(len_le), file) == sizeof(len_le)) {
+        uint32_t size = (uint32_t)len_le[0] | ((uint32_t)len_le[1] << 8) | ((uint32_t)len_le[2] << 16) |
+                        ((uint32_t)len_le[3] << 24);
+        if (size < 16 + 4 || size > BENCH_MAX_FRAME || size > VL53LMZ_TEMPORARY_BUFFER_SIZE ||
+            fread(&capture->data[used], 1, size, file) != size) {
+            ok = false;
+            break;
+        }
+        capture->offset[capture->count] = used;
+        capture->size[capture->count] = size;
+        capture->count++;
+        used += size;
+    }
+    fclose(file);
+    return ok && capture->count > 0;
+}
+
+static bool load_log(const char *path) {
+    if (!log_replay_open(&s_log, path)) {
+        return false;
+    }
+    // Primeira leitura só para contar os frames
+    log_replay_t slice;
+    tof_frame_t frame;
+    log_replay_slice(&s_log, 0, s_log.size, &slice);
+    while (log_replay_next(&slice, &frame)) {
+        s_frame_count++;
+    }
+    if (s_frame_count == 0) {
+        return false;
+    }
+
+    s_frames = malloc(s_frame_count * sizeof(tof_frame_t));
+    s_filter_frames = malloc(s_frame_count * sizeof(tof_frame_t));
+    if (s_frames == NULL || s_filter_frames == NULL) {
+        return false;
+    }
+    log_replay_slice(&s_log, 0, s_log.size, &slice);
+    for (size_t i = 0; i < s_frame_count && log_replay_next(&slice, &s_frames[i]); i++) {
+        s_frames[i].sequence = (uint32_t)i;
+        s_frames[i].timestamp_us = (int64_t)i * 100000;
+    }
+    memcpy(s_filter_frames, s_frames, s_frame_count * sizeof(tof_frame_t));
+    return true;
+}
+
+static bool write_json(const char *path, const bench_result_t *results, size_t count) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "{\n  \"targets_per_zone\": %u,\n  \"cases\": [\n", (unsigned)VL53LMZ_NB_TARGET_PER_ZONE);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(file, "    {\"name\": \"%s\", \"ns_per_frame\": %.1f, \"bytes_per_frame\": %.1f}%s\n",
+                results[i].name, results[i].ns_per_frame, results[i].bytes_per_frame, i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+static int read_json(const char *path, bench_result_t *results, size_t capacity) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    char line[256];
+    int count = 0;
+    while (fgets(line, sizeof(line), file) != NULL && (size_t)count < capacity) {
+        const char *entry = strstr(line, "{\"name\"");
+        bench_result_t *result = &results[count];
+        if (entry != NULL &&
+            sscanf(entry, "{\"name\": \"%47[^\"]\", \"ns_per_frame\": %lf, \"bytes_per_frame\": %lf",
+                   result->name, &result->ns_per_frame, &result->bytes_per_frame) == 3) {
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+static uint64_t read_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
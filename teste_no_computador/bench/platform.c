@@ -0,0 +1,96 @@
+/**
+ * @file platform.c
+ * @brief Plataforma mínima do driver VL53LMZ para os benchmarks no PC e o gerador de frames sintéticos.
+ */
+
+#include "platform.h"
+
+#include <stdlib.h>
+
+#include "vl53lmz_api.h"
+
+static const uint8_t *s_frame;                      /**< Frame devolvido por RdMulti(). */
+static uint32_t s_frame_size;                       /**< Tamanho de s_frame. */
+
+/** @brief Escreve um cabeçalho de bloco e seu conteúdo pseudoaleatório, na ordem de bytes do sensor; retorna a nova posição. */
+static uint32_t put_block(uint8_t *out, uint32_t pos, uint16_t idx, uint8_t type, uint16_t count);
+
+void bench_set_frame(const uint8_t *data, uint32_t size) {
+    s_frame = data;
+    s_frame_size = size;
+}
+
+uint8_t RdByte(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_value) {
+    (void)p_platform; (void)RegisterAdress;
+    *p_value = 0;
+    return 0;
+}
+
+uint8_t WrByte(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t value) {
+    (void)p_platform; (void)RegisterAdress; (void)value;
+    return 0;
+}
+
+uint8_t RdMulti(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_values, uint32_t size) {
+    (void)p_platform; (void)RegisterAdress;
+    memcpy(p_values, s_frame, size <= s_frame_size ? size : s_frame_size);
+    return 0;
+}
+
+uint8_t WrMulti(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_values, uint32_t size) {
+    (void)p_platform; (void)RegisterAdress; (void)p_values; (void)size;
+    return 0;
+}
+
+void SwapBuffer(uint8_t *buffer, uint16_t size) {
+    for (uint16_t i = 0; i + 4 <= size; i += 4) {
+        uint32_t word;
+        memcpy(&word, &buffer[i], sizeof(word));
+        word = __builtin_bswap32(word);
+        memcpy(&buffer[i], &word, sizeof(word));
+    }
+}
+
+uint8_t WaitMs(VL53LMZ_Platform *p_platform, uint32_t TimeMs) {
+    (void)p_platform; (void)TimeMs;
+    return 0;
+}
+
+uint32_t bench_build_results_frame(uint8_t *out, uint8_t resolution) {
+    const uint16_t per_target = (uint16_t)(resolution * VL53LMZ_NB_TARGET_PER_ZONE);
+    srand(resolution);
+    uint32_t pos = 0;
+    for (; pos < 16; pos++) {
+        out[pos] = (uint8_t)rand();
+    }
+    pos = put_block(out, pos, VL53LMZ_METADATA_IDX, 0, 12);
+    pos = put_block(out, pos, VL53LMZ_COMMONDATA_IDX, 0, 4);
+    pos = put_block(out, pos, VL53LMZ_AMBIENT_RATE_IDX, 4, resolution);
+    pos = put_block(out, pos, VL53LMZ_SPAD_COUNT_IDX, 4, resolution);
+    pos = put_block(out, pos, VL53LMZ_NB_TARGET_DETECTED_IDX, 1, resolution);
+    pos = put_block(out, pos, VL53LMZ_SIGNAL_RATE_IDX, 4, per_target);
+    pos = put_block(out, pos, VL53LMZ_RANGE_SIGMA_MM_IDX, 2, per_target);
+    pos = put_block(out, pos, VL53LMZ_DISTANCE_IDX, 2, per_target);
+    pos = put_block(out, pos, VL53LMZ_REFLECTANCE_EST_PC_IDX, 1, per_target);
+    pos = put_block(out, pos, VL53LMZ_TARGET_STATUS_IDX, 1, per_target);
+    pos = put_block(out, pos, VL53LMZ_MOTION_DETEC_IDX, 0, 140);
+    // Rodapé com o mesmo identificador do cabeçalho (bytes 0xA e 0xB na ordem do sensor)
+    out[pos++] = 0;
+    out[pos++] = 0;
+    out[pos++] = out[0xA];
+    out[pos++] = out[0xB];
+    return pos;
+}
+
+static uint32_t put_block(uint8_t *out, uint32_t pos, uint16_t idx, uint8_t type, uint16_t count) {
+    uint32_t header = ((uint32_t)idx << 16) | ((uint32_t)count << 4) | type;
+    uint32_t msize = (type > 1 && type < 0xD) ? (uint32_t)type * count : count;
+    out[pos++] = (uint8_t)(header >> 24);
+    out[pos++] = (uint8_t)(header >> 16);
+    out[pos++] = (uint8_t)(header >> 8);
+    out[pos++] = (uint8_t)header;
+    for (uint32_t i = 0; i < msize; i++) {
+        out[pos++] = (uint8_t)rand();
+    }
+    return pos;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file platform.h
+ * @brief Camada de plataforma mínima do driver VL53LMZ para os benchmarks no PC.
+ *
+ * Substitui firmware/components/vl53l8ch_driver/platform/platform.h: não há
+ * barramento, e RdMulti() devolve o frame definido pelo benchmark
+ * (bench_set_frame()), sintético ou gravado. As funções ficam em platform.c. O número de alvos por zona vem da linha de compilação
+ * (-DVL53LMZ_NB_TARGET_PER_ZONE=N), como no firmware.
+ */
+
+#ifndef VL53LMZ_PLATFORM_H_
+#define VL53LMZ_PLATFORM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef VL53LMZ_NB_TARGET_PER_ZONE
+#define VL53LMZ_NB_TARGET_PER_ZONE 1U
+#endif
+
+/**
+ * @brief Contexto de comunicação exigido pela API; sem uso no PC.
+ */
+typedef struct {
+    uint16_t address;                               /**< Endereço exigido pela API. */
+} VL53LMZ_Platform;
+
+#define BENCH_MAX_FRAME 4096                        /**< Maior frame de resultados (8x8 com 4 alvos por zona). */
+
+/**
+ * @brief Define o frame devolvido pelas próximas leituras do driver.
+ * @param data Frame na ordem de bytes do sensor; não é copiado e deve continuar válido.
+ * @param size Tamanho do frame.
+ */
+void bench_set_frame(const uint8_t *data, uint32_t size);
+
+/**
+ * @brief Monta um frame sintético com todos os blocos de saída padrão do driver.
+ *
+ * O conteúdo dos blocos é pseudoaleatório, mas repetível: a mesma resolução
+ * gera sempre o mesmo frame.
+ * @param out Saída com ao menos BENCH_MAX_FRAME bytes.
+ * @param resolution VL53LMZ_RESOLUTION_4X4 ou VL53LMZ_RESOLUTION_8X8.
+ * @return Tamanho do frame (o data_read_size correspondente).
+ */
+uint32_t bench_build_results_frame(uint8_t *out, uint8_t resolution);
+
+uint8_t RdByte(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_value);
+uint8_t WrByte(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t value);
+uint8_t RdMulti(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_values, uint32_t size);
+uint8_t WrMulti(VL53LMZ_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_values, uint32_t size);
+void SwapBuffer(uint8_t *buffer, uint16_t size);
+uint8_t WaitMs(VL53LMZ_Platform *p_platform, uint32_t TimeMs);
+
+#endif /* VL53LMZ_PLATFORM_H_ */
@@ -0,0 +1,321 @@
+/**
+ * @file log_replay.c
+ * @brief Leitura do log do monitor serial mapeado em memória, com decodificação hexadecimal vetorizada.
+ */
+
+#include "log_replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define LOG_REPLAY_HAVE_MMAP 0
+#else
+#define LOG_REPLAY_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LOG_REPLAY_HAVE_SSE2 1
+#else
+#define LOG_REPLAY_HAVE_SSE2 0
+#endif
+
+#define REPLAY_ZONES 64                                 /**< Zonas por frame no log em 8x8. */
+#define REPLAY_ZONES_4X4 16                             /**< Zonas por frame no log em 4x4. */
+#define HEX_DATA_MARKER "TOF: HEX DATA:"                /**< Início da linha de distâncias. */
+#define TARGET_STATUS_MARKER "TOF: TARGET STATUS:"      /**< Início da linha de status. */
+
+/** @brief Valor de cada caractere como dígito hexadecimal, ou -1. */
+static int8_t s_hex_lut[256];
+static bool s_hex_lut_ready = false;
+
+/** @brief Preenche s_hex_lut na primeira chamada. */
+static void hex_lut_init(void);
+
+/** @brief Decodificação por tabela; acumula em *bad os dígitos inválidos. */
+static void hex_decode_scalar(const char* hex, size_t len, uint8_t* out, uint8_t* bad);
+
+/** @brief Procura um marcador a partir de pos, até end. */
+static const char* find_marker(const char* pos, const char* end, const char* marker, size_t marker_len);
+
+/** @brief Fim da linha que começa em pos (posição do '\n' ou end). */
+static const char* line_end(const char* pos, const char* end);
+
+/** @brief Início do payload após o marcador e seu tamanho sem o '\r' final. */
+static const char* line_payload(const char* after_marker, const char* eol, size_t* len);
+
+/** @brief Horário "HH:MM:SS.mmm" no início da linha que contém marker, em ms, ou -1. */
+static int32_t line_time_of_day_ms(const char* data, const char* marker);
+
+bool log_replay_open(log_replay_t* replay, const char* path) {
+    memset(replay, 0, sizeof(*replay));
+    replay->time_of_day_ms = -1;
+    hex_lut_init();
+#if LOG_REPLAY_HAVE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    replay->size = (size_t)st.st_size;
+    if (replay->size > 0) {
+        void* data = mmap(NULL, replay->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        // O log é lido uma única vez do início ao fim: leitura antecipada agressiva
+        madvise(data, replay->size, MADV_SEQUENTIAL);
+        replay->data = (const char*)data;
+        replay->mapped = true;
+    }
+    close(fd);  // O mapeamento continua válido após fechar o descritor
+    replay->limit = replay->size;
+    return true;
+#else
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = size > 0 ? (char*)malloc((size_t)size) : NULL;
+    if (size > 0 && (data == NULL || fread(data, 1, (size_t)size, f) != (size_t)size)) {
+        free(data);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+    replay->data = data;
+    replay->size = size > 0 ? (size_t)size : 0;
+    replay->limit = replay->size;
+    return true;
+#endif
+}
+
+void log_replay_close(log_replay_t* replay) {
+#if LOG_REPLAY_HAVE_MMAP
+    if (replay->mapped) {
+        munmap((void*)replay->data, replay->size);
+    }
+#else
+    free((void*)replay->data);
+#endif
+    replay->data = NULL;
+    replay->size = 0;
+    replay->mapped = false;
+}
+
+void log_replay_slice(const log_replay_t* file, size_t begin, size_t end, log_replay_t* slice) {
+    memset(slice, 0, sizeof(*slice));
+    slice->data = file->data;
+    slice->size = file->size;
+    slice->limit = end < file->size ? end : file->size;
+    slice->pos = begin < slice->limit ? begin : slice->limit;
+    slice->time_of_day_ms = -1;
+}
+
+bool log_replay_next(log_replay_t* replay, tof_frame_t* frame) {
+    const char* end = replay->data + replay->size;
+    const char* limit = replay->data + replay->limit;
+    const char* pos = replay->data + replay->pos;
+    uint8_t raw[REPLAY_ZONES * 2];
+
+    while (pos < limit) {
+        // O marcador pode terminar depois de limit, mas precisa começar antes
+        const char* marker = find_marker(pos, end, HEX_DATA_MARKER, sizeof(HEX_DATA_MARKER) - 1);
+        if (marker == NULL || marker >= limit) {
+            break;
+        }
+        const char* eol = line_end(marker, end);
+        pos = eol < end ? eol + 1 : end;
+
+        size_t hex_len;
+        const char* hex = line_payload(marker + sizeof(HEX_DATA_MARKER) - 1, eol, &hex_len);
+        // Logs antigos têm 2 dígitos por zona (distância truncada em 8 bits, só em
+        // 8x8); os atuais, 4, com 16 ou 64 zonas
+        bool wide = hex_len == REPLAY_ZONES * 4 || hex_len == REPLAY_ZONES_4X4 * 4;
+        int zones = hex_len == REPLAY_ZONES_4X4 * 4 ? REPLAY_ZONES_4X4 : REPLAY_ZONES;
+        if ((!wide && hex_len != REPLAY_ZONES * 2) || !log_replay_hex_decode(hex, hex_len, raw)) {
+            replay->rejected++;
+            continue;
+        }
+
+        // O status vem obrigatoriamente na linha seguinte
+        const char* status_eol = line_end(pos, end);
+        const char* status_marker = find_marker(pos, status_eol, TARGET_STATUS_MARKER, sizeof(TARGET_STATUS_MARKER) - 1);
+        if (status_marker == NULL) {
+            replay->rejected++;
+            continue;
+        }
+        size_t status_len;
+        const char* status = line_payload(status_marker + sizeof(TARGET_STATUS_MARKER) - 1, status_eol, &status_len);
+        memset(frame, 0, sizeof(*frame));
+        if (status_len != (size_t)zones * 2 || !log_replay_hex_decode(status, status_len, frame->target_status)) {
+            replay->rejected++;
+            continue;
+        }
+        pos = status_eol < end ? status_eol + 1 : end;
+        replay->time_of_day_ms = line_time_of_day_ms(replay->data, marker);
+
+        frame->resolution = (uint8_t)zones;
+        for (int z = 0; z < zones; z++) {
+            frame->nb_target_detected[z] = 1;
+            frame->distance_mm[TOF_FRAME_TARGET_IDX(z, 0)] =
+                wide ? (int16_t)((raw[2 * z] << 8) | raw[2 * z + 1]) : raw[z];
+        }
+        replay->pos = (size_t)(pos - replay->data);
+        replay->frames++;
+        return true;
+    }
+    replay->pos = replay->limit;
+    return false;
+}
+
+#if LOG_REPLAY_HAVE_SSE2
+/**
+ * @brief Converte 16 dígitos ASCII em 16 nibbles, marcando em *bad os bytes que não são dígitos.
+ */
+static inline __m128i hex_nibbles_sse2(__m128i v, __m128i* bad) {
+    // Maiúsculas e minúsculas se igualam com o bit 0x20; os dígitos não mudam
+    const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                        _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    const __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                        _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    *bad = _mm_or_si128(*bad, _mm_andnot_si128(_mm_or_si128(digit, alpha), _mm_set1_epi8(-1)));
+    // Dígito: c - '0'; letra: (c | 0x20) - '0' - 39 = (c | 0x20) - 'a' + 10
+    const __m128i nibble = _mm_sub_epi8(lower, _mm_set1_epi8('0'));
+    return _mm_sub_epi8(nibble, _mm_and_si128(alpha, _mm_set1_epi8('a' - '0' - 10)));
+}
+
+/**
+ * @brief Junta pares de nibbles (alto no byte par) em 8 bytes, um em cada palavra de 16 bits.
+ */
+static inline __m128i hex_pairs_sse2(__m128i nibbles) {
+    const __m128i high = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00FF)), 4);
+    return _mm_or_si128(high, _mm_srli_epi16(nibbles, 8));
+}
+#endif
+
+bool log_replay_hex_decode(const char* hex, size_t len, uint8_t* out) {
+    if (len % 2 != 0) {
+        return false;
+    }
+    uint8_t bad = 0;
+#if LOG_REPLAY_HAVE_SSE2
+    __m128i bad_v = _mm_setzero_si128();
+    for (; len >= 32; hex += 32, out += 16, len -= 32) {
+        __m128i a = hex_pairs_sse2(hex_nibbles_sse2(_mm_loadu_si128((const __m128i*)hex), &bad_v));
+        __m128i b = hex_pairs_sse2(hex_nibbles_sse2(_mm_loadu_si128((const __m128i*)(hex + 16)), &bad_v));
+        _mm_storeu_si128((__m128i*)out, _mm_packus_epi16(a, b));
+    }
+    bad = _mm_movemask_epi8(bad_v) != 0;
+#endif
+    hex_lut_init();
+    hex_decode_scalar(hex, len, out, &bad);
+    return bad == 0;
+}
+
+static void hex_decode_scalar(const char* hex, size_t len, uint8_t* out, uint8_t* bad) {
+    uint8_t invalid = 0;
+    for (size_t i = 0; i < len / 2; i++) {
+        int8_t high = s_hex_lut[(uint8_t)hex[2 * i]];
+        int8_t low = s_hex_lut[(uint8_t)hex[2 * i + 1]];
+        invalid |= (uint8_t)(high | low);
+        out[i] = (uint8_t)(((uint8_t)high << 4) | ((uint8_t)low & 0x0F));
+    }
+    // Só os inválidos (-1) têm o bit 7 ligado
+    *bad |= invalid >> 7;
+}
+
+static void hex_lut_init(void) {
+    if (s_hex_lut_ready) {
+        return;
+    }
+    memset(s_hex_lut, -1, sizeof(s_hex_lut));
+    for (int i = 0; i < 10; i++) {
+        s_hex_lut['0' + i] = (int8_t)i;
+    }
+    for (int i = 0; i < 6; i++) {
+        s_hex_lut['A' + i] = (int8_t)(10 + i);
+        s_hex_lut['a' + i] = (int8_t)(10 + i);
+    }
+    s_hex_lut_ready = true;
+}
+
+static const char* find_marker(const char* pos, const char* end, const char* marker, size_t marker_len) {
+    // 'T' nunca aparece nos dígitos hexadecimais, então memchr atravessa os
+    // payloads (a maior parte do log) sem parar
+    while (pos < end && (size_t)(end - pos) >= marker_len) {
+        const char* t = (const char*)memchr(pos, marker[0], (size_t)(end - pos) - marker_len + 1);
+        if (t == NULL) {
+            return NULL;
+        }
+        if (memcmp(t, marker, marker_len) == 0) {
+            return t;
+        }
+        pos = t + 1;
+    }
+    return NULL;
+}
+
+static const char* line_end(const char* pos, const char* end) {
+    const char* eol = pos < end ? (const char*)memchr(pos, '\n', (size_t)(end - pos)) : NULL;
+    return eol != NULL ? eol : end;
+}
+
+static const char* line_payload(const char* after_marker, const char* eol, size_t* len) {
+    const char* p = after_marker;
+    while (p < eol && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    const char* stop = eol;
+    while (stop > p && stop[-1] == '\r') {
+        stop--;
+    }
+    *len = (size_t)(stop - p);
+    return p;
+}
+
+static int32_t line_time_of_day_ms(const char* data, const char* marker) {
+    // O monitor serial prefixa cada linha com "HH:MM:SS.mmm > "
+    const char* line = marker;
+    while (line > data && line[-1] != '\n' && marker - line < 32) {
+        line--;
+    }
+    if (marker - line < 12) {
+        return -1;
+    }
+    static const char pattern[] = "00:00:00.000";
+    int32_t fields[4] = {0, 0, 0, 0};
+    int field = 0;
+    for (int i = 0; i < 12; i++) {
+        char c = line[i];
+        if (pattern[i] != '0') {
+            if (c != pattern[i]) {
+                return -1;
+            }
+            field++;
+        } else if (c >= '0' && c <= '9') {
+            fields[field] = fields[field] * 10 + (c - '0');
+        } else {
+            return -1;
+        }
+    }
+    if (fields[0] > 23 || fields[1] > 59 || fields[2] > 59) {
+        return -1;
+    }
+    return ((fields[0] * 60 + fields[1]) * 60 + fields[2]) * 1000 + fields[3];
+}
@@ -0,0 +1,84 @@
+/**
+ * @file log_replay.h
+ * @brief Leitura rápida do log do monitor serial para o modo de replay do simulador.
+ *
+ * O log inteiro é mapeado em memória (mmap) e percorrido sem cópia: os
+ * marcadores "TOF: HEX DATA:" / "TOF: TARGET STATUS:" são localizados com
+ * memchr (vetorizado na libc) e os dígitos hexadecimais são decodificados em
+ * blocos de 32 caracteres com SSE2, ou por tabela nas outras arquiteturas.
+ */
+
+#ifndef LOG_REPLAY_H
+#define LOG_REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tof_frame.h"
+
+/**
+ * @brief Log de entrada mapeado em memória e posição de leitura.
+ */
+typedef struct {
+    const char* data;           /**< Início do log. */
+    size_t size;                /**< Tamanho do log, em bytes. */
+    size_t pos;                 /**< Próximo byte a ser examinado. */
+    size_t limit;               /**< Fim da região lida: só os pares cujo HEX DATA começa antes de limit. */
+    bool mapped;                /**< data veio de mmap (senão, de malloc). */
+    uint64_t frames;            /**< Pares HEX DATA / TARGET STATUS decodificados. */
+    uint64_t rejected;          /**< Linhas HEX DATA descartadas (tamanho, dígito inválido ou sem TARGET STATUS). */
+    int32_t time_of_day_ms;     /**< Horário "HH:MM:SS.mmm" do monitor na linha HEX DATA do último frame, em ms (-1 se ausente). */
+} log_replay_t;
+
+/**
+ * @brief Mapeia o log em memória.
+ * @param replay Estado a ser inicializado.
+ * @param path Caminho do log.
+ * @return true se o arquivo foi aberto.
+ */
+bool log_replay_open(log_replay_t* replay, const char* path);
+
+/**
+ * @brief Prepara a leitura de um trecho de um log já aberto.
+ *
+ * O trecho lê os pares cujo HEX DATA começa em [begin, end); a linha de
+ * TARGET STATUS pode estar além de end. Trechos disjuntos do mesmo log podem
+ * ser lidos em paralelo. O trecho compartilha o mapeamento do log e não deve
+ * ser fechado com log_replay_close().
+ *
+ * @param file Log aberto com log_replay_open().
+ * @param begin Início do trecho, de preferência no começo de uma linha.
+ * @param end Fim do trecho (limitado ao tamanho do log).
+ * @param[out] slice Estado de leitura do trecho.
+ */
+void log_replay_slice(const log_replay_t* file, size_t begin, size_t end, log_replay_t* slice);
+
+/**
+ * @brief Decodifica o próximo par HEX DATA / TARGET STATUS do log.
+ *
+ * Aceita as distâncias com 4 dígitos por zona (int16), em 8x8 ou 4x4 (o
+ * frame sai com resolution 64 ou 16), e os logs antigos de 8x8 com 2 dígitos
+ * (distância truncada em 8 bits), como o leitor por linhas.
+ *
+ * @param replay Log aberto.
+ * @param[out] frame Frame preenchido (exceto timestamp e sequência).
+ * @return true se um frame foi lido; false no fim do log.
+ */
+bool log_replay_next(log_replay_t* replay, tof_frame_t* frame);
+
+/**
+ * @brief Libera o mapeamento do log.
+ */
+void log_replay_close(log_replay_t* replay);
+
+/**
+ * @brief Converte uma string hexadecimal em bytes.
+ * @param hex Dígitos (maiúsculos ou minúsculos), sem separadores.
+ * @param len Número de dígitos (par).
+ * @param out Saída com ao menos len / 2 bytes.
+ * @return true se todos os dígitos são válidos.
+ */
+bool log_replay_hex_decode(const char* hex, size_t len, uint8_t* out);
+
+#endif // LOG_REPLAY_H
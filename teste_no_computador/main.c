@@ -1,20 +1,116 @@
 #include "sensor_code.h"
+#include "batch_ingest.h"
 #include <stdio.h>
+#include <string.h>
 
 /**
  * @file main.c
  * @brief Ponto de entrada para a simulação do sensor ToF no PC.
+ *
+ * Uso: simulador_pc [--tofb] [--uart-stream saida.tofs] [--replay] [--speed N]
+ *                   [--filter none|median|ema|kalman] [--delta N] [--delta-threshold MM]
+ *                   [--rate] [--roi] [--can saida.log] [arquivo.log | captura.tofs]
+ *      simulador_pc --batch [--tofb] [--jobs N] [--output arquivo] entrada...
+ *
+ * Arquivos de entrada com extensão .tofs são lidos como captura bruta da UART
+ * no modo de streaming binário do firmware. --replay processa a entrada uma
+ * única vez, o mais rápido possível, e --speed N faz o mesmo a N vezes a taxa
+ * do firmware. --filter escolhe o filtro temporal das distâncias (ver
+ * tof_filter.h); o padrão é nenhum, para a saída reproduzir o log. --delta N
+ * grava o .tofb no modo delta, com um keyframe a cada N frames e, nos demais,
+ * só as zonas que mudaram mais de --delta-threshold mm (padrão 20). --rate
+ * passa cada frame pelo controle de frequência adaptativa do firmware (ver
+ * tof_rate.h) e só repassa os frames que o sensor mediria na frequência
+ * pedida, omitindo os sonos entre rajadas. --roi emula a troca de resolução
+ * pela ROI (ver tof_roi.h): enquanto não há alvo na ROI, cada frame 8x8 é
+ * reduzido a 4x4 antes do filtro e da saída. --can passa cada frame da saída
+ * pelo estágio de obstáculos do firmware (ver tof_obstacle.h) e grava os
+ * frames CAN resultantes no formato do candump -L.
+ *
+ * --batch decodifica em paralelo todas as entradas (arquivos .log, diretórios
+ * ou padrões glob) e grava um único arquivo intercalado por timestamp (ver
+ * batch_ingest.h); --jobs N fixa o número de threads.
  */
+#include <stdlib.h>
 
-int main() {
+int main(int argc, char** argv) {
     // Nome do arquivo de log que você forneceu.
     // Ele DEVE estar na mesma pasta que o executável.
-    const char* log_file = "device-monitor-250706-173207.log";
-    
+    sim_config_t config = {
+        .log_filename = "device-monitor-250706-173207.log",
+        .input_format = SIM_INPUT_HEX_LOG,
+        .output_format = SIM_OUTPUT_CSV,
+        .uart_stream_filename = NULL,
+        .replay = false,
+        .replay_speed = 0.0,
+        .filter_mode = TOF_FILTER_NONE,
+        .delta_keyframe_interval = 0,
+        .delta_threshold_mm = 20,
+        .adaptive_rate = false,
+        .roi_switching = false,
+        .can_filename = NULL,
+    };
+    batch_config_t batch = {
+        .inputs = (const char* const*)&argv[1],
+        .input_count = 0,
+        .jobs = 0,
+        .output_filename = NULL,
+    };
+    bool batch_mode = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tofb") == 0) {
+            config.output_format = SIM_OUTPUT_TOFB;
+        } else if (strcmp(argv[i], "--uart-stream") == 0 && i + 1 < argc) {
+            config.uart_stream_filename = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            config.replay = true;
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            config.replay = true;
+            config.replay_speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            if (!tof_filter_mode_from_name(argv[++i], &config.filter_mode)) {
+                fprintf(stderr, "Filtro desconhecido: %s (use none, median, ema ou kalman)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--delta") == 0 && i + 1 < argc) {
+            config.output_format = SIM_OUTPUT_TOFB;
+            config.delta_keyframe_interval = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--delta-threshold") == 0 && i + 1 < argc) {
+            config.delta_threshold_mm = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0) {
+            config.adaptive_rate = true;
+        } else if (strcmp(argv[i], "--roi") == 0) {
+            config.roi_switching = true;
+        } else if (strcmp(argv[i], "--can") == 0 && i + 1 < argc) {
+            config.can_filename = argv[++i];
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch_mode = true;
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            batch.jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            batch.output_filename = argv[++i];
+        } else {
+            config.log_filename = argv[i];
+            // As entradas do lote são compactadas no início de argv[1..]
+            argv[1 + batch.input_count++] = argv[i];
+        }
+    }
+
+    if (batch_mode) {
+        batch.output_format = config.output_format;
+        return run_batch_ingest(&batch) == 0 ? 0 : 1;
+    }
+
+    size_t name_len = strlen(config.log_filename);
+    if (name_len > 5 && strcmp(config.log_filename + name_len - 5, ".tofs") == 0) {
+        config.input_format = SIM_INPUT_STREAM;
+    }
+
     printf("Iniciando simulador...\n");
 
     // Inicia a simulação
-    run_sensor_simulation(log_file);
+    run_sensor_simulation(&config);
 
     return 0; // Retorna 0 ao final
 }
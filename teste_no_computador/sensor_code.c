@@ -14,6 +14,7 @@
 #include <time.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <signal.h>
 
 // Bloco para compatibilidade de delay entre Windows e Linux/macOS
 #ifdef _WIN32
@@ -26,68 +27,186 @@
 
 #include "sensor_code.h"
 
+// Componentes comuns ao firmware e ao simulador (firmware/components/tof_common)
+#include "tof_frame.h"
+#include "tof_log_writer.h"
+#include "tof_log_index.h"
+#include "tof_csv.h"
+#include "tof_bin.h"
+#include "tof_stream.h"
+#include "tof_cnh.h"
+#include "tof_time.h"
+#include "tof_filter.h"
+#include "tof_latency.h"
+#include "tof_rate.h"
+#include "tof_roi.h"
+#include "tof_obstacle.h"
 
-static inline const char* get_log_timestamp() {
-    static char buffer[10];
-    time_t now = time(NULL);
-    struct tm* t = localtime(&now);
-    if (t) {
-        strftime(buffer, sizeof(buffer), "%H:%M:%S", t);
-    }
-    return buffer;
-}
-
-#define ESP_LOGI(tag, format, ...) printf("%s I (%s): " format "\n", get_log_timestamp(), tag, ##__VA_ARGS__)
-#define ESP_LOGW(tag, format, ...) printf("%s W (%s): " format "\n", get_log_timestamp(), tag, ##__VA_ARGS__)
-#define ESP_LOGE(tag, format, ...) printf("%s E (%s): " format "\n", get_log_timestamp(), tag, ##__VA_ARGS__)
-#define ESP_LOGD(tag, format, ...) printf("%s D (%s): " format "\n", get_log_timestamp(), tag, ##__VA_ARGS__)
+#include "log_replay.h"
+#include "sim_log.h"
 
 
 static const char *TAG = "TOF_SIM";
 #define OUTPUT_CSV_FILE "tof_log.csv"
+#define OUTPUT_TOFB_FILE "tof_log.tofb"
+#define OUTPUT_INDEX_FILE "tof_log.idx"
 #define SENSOR_POLLING_RATE_MS 200
-#define SENSOR_DATA_BUFFER_SIZE 64
-#define LOG_LINE_MAX_LEN 256
+#define SENSOR_ZONES 64
+#define SENSOR_ZONES_4X4 16
+#define LOG_LINE_MAX_LEN 512
+#define OUTPUT_WRITE_BUFFER_SIZE (16 * 1024)
+#define OUTPUT_FLUSH_THRESHOLD_BYTES (8 * 1024)
+#define OUTPUT_FLUSH_INTERVAL_MS 1000
+#define OUTPUT_FSYNC_INTERVAL_MS 5000
 
 static FILE* g_log_file = NULL;
+static tof_log_writer_t g_out_writer = { .fd = -1 };
+static tof_log_index_t g_out_index = { .writer = { .fd = -1 } };
+static long long g_out_sync_ms = 0;
+static uint8_t g_out_write_buffer[OUTPUT_WRITE_BUFFER_SIZE] __attribute__((aligned(4)));
+static volatile sig_atomic_t g_stop_requested = 0;
+static sim_output_format_t g_output_format = SIM_OUTPUT_CSV;
+static tof_bin_block_t g_out_block;
+static tof_bin_delta_t g_out_delta;
+static bool g_delta = false;
+static sim_input_format_t g_input_format = SIM_INPUT_HEX_LOG;
+static FILE* g_uart_stream_file = NULL;
+static unsigned long g_stream_packets = 0;
+static unsigned long g_stream_rejected = 0;
+static unsigned long g_stream_motion_packets = 0;
+static unsigned long g_stream_cnh_packets = 0;
+static unsigned long long g_stream_cnh_bins = 0;
+static unsigned long long g_stream_cnh_bytes = 0;
+static bool g_replay = false;
+static double g_replay_speed = 0.0;
+static log_replay_t g_replay_log;
+static tof_filter_t g_filter;
+static int64_t g_filter_busy_ns = 0;
+static tof_latency_hist_t g_latency[TOF_LATENCY_STAGE_COUNT];
+static unsigned long g_stream_telemetry_packets = 0;
+static bool g_rate_enabled = false;
+static tof_rate_t g_rate;
+static tof_rate_decision_t g_rate_decision;
+static int64_t g_rate_next_us = 0;
+static unsigned long g_rate_skipped = 0;
+static bool g_roi_enabled = false;
+static tof_roi_t g_roi;
+static uint8_t g_roi_resolution = TOF_ROI_RESOLUTION_8X8;
+static FILE* g_can_file = NULL;
+static tof_obstacle_t g_obstacle;
+static unsigned long g_can_frames = 0;
+static unsigned long long g_can_raw_bytes = 0;
 
 
-static bool simulation_init(const char* log_filename);
+static bool simulation_init(const sim_config_t* config);
+static void simulation_close_input(void);
 static void simulation_deinit(void);
-static bool get_sensor_data_from_log(uint8_t* dist_buf, uint8_t* status_buf);
-static void print_raw_data_as_hex(const char* prefix, uint8_t* buffer, size_t len);
-static void save_data_to_csv(uint8_t* dist_buf, uint8_t* status_buf);
+static bool get_sensor_data_from_log(tof_frame_t* frame);
+static bool get_sensor_data_from_stream(tof_frame_t* frame);
+static void output_frame_to_uart(const tof_frame_t* frame);
+static void print_raw_data_as_hex(const char* prefix, const uint8_t* buffer, size_t len);
+static void save_frame_to_output(const tof_frame_t* frame);
+static void flush_output_block(void);
 static int hex_char_to_int(char c);
+static size_t hex_payload_len(const char* hex_str);
 static bool hex_string_to_bytes(const char* hex_str, uint8_t* byte_array, size_t array_len);
 static long long get_simulated_timestamp_ms();
+static void replay_pace(uint32_t frame_index, int64_t start_us);
+static void replay_report(uint32_t frames, int64_t start_us);
+static void handle_stop_signal(int sig);
+static uint32_t record_latency(tof_latency_stage_t stage, uint32_t start_cycles);
+static void report_latency(void);
+static bool rate_gate(const tof_frame_t* frame);
+static void downsample_to_4x4(tof_frame_t* frame);
+static void obstacle_to_can(const tof_frame_t* frame);
 
 // =========================================================================
 // IMPLEMENTAÇÃO DA LÓGICA PRINCIPAL
 // =========================================================================
 
-int run_sensor_simulation(const char* log_filename) {
+int run_sensor_simulation(const sim_config_t* config) {
     ESP_LOGI(TAG, "Iniciando simulação do firmware do sensor ToF.");
 
-    if (!simulation_init(log_filename)) {
+    if (!simulation_init(config)) {
         return -1;
     }
 
-    uint8_t distance_data[SENSOR_DATA_BUFFER_SIZE];
-    uint8_t status_data[SENSOR_DATA_BUFFER_SIZE];
+    static tof_frame_t frame;
+    uint32_t sequence = 0;
+    int64_t start_us = tof_time_us();
 
-    while (1) {
-        if (get_sensor_data_from_log(distance_data, status_data)) {
-            ESP_LOGD(TAG, "Par de dados lido do log com sucesso.");
-            print_raw_data_as_hex("TOF: HEX DATA", distance_data, sizeof(distance_data));
-            print_raw_data_as_hex("TOF: TARGET STATUS", status_data, sizeof(status_data));
-            save_data_to_csv(distance_data, status_data);
+    while (!g_stop_requested) {
+        bool have_data;
+        uint32_t stage_start = tof_time_cycles();
+        if (g_input_format == SIM_INPUT_STREAM) {
+            have_data = get_sensor_data_from_stream(&frame);
+        } else if (g_replay) {
+            have_data = log_replay_next(&g_replay_log, &frame);
+        } else {
+            have_data = get_sensor_data_from_log(&frame);
+        }
+        if (have_data) {
+            record_latency(TOF_LATENCY_PARSE, stage_start);
+            if (!g_replay) {
+                ESP_LOGD(TAG, "Par de dados lido do log com sucesso.");
+            }
+            // No replay o tempo é o do firmware (um frame a cada SENSOR_POLLING_RATE_MS),
+            // para que a saída seja idêntica entre execuções e comparável em regressão
+            frame.timestamp_us = g_replay ? (int64_t)sequence * SENSOR_POLLING_RATE_MS * 1000
+                                          : get_simulated_timestamp_ms() * 1000;
+            frame.sequence = sequence++;
+            if (g_roi_enabled && g_roi_resolution == TOF_ROI_RESOLUTION_4X4) {
+                downsample_to_4x4(&frame);
+            }
+            stage_start = tof_time_cycles();
+            tof_filter_apply(&g_filter, &frame);
+            g_filter_busy_ns += record_latency(TOF_LATENCY_FILTER, stage_start);
+            if (rate_gate(&frame)) {
+                if (!g_replay || g_uart_stream_file != NULL) {
+                    stage_start = tof_time_cycles();
+                    output_frame_to_uart(&frame);
+                    record_latency(TOF_LATENCY_UART_EMIT, stage_start);
+                }
+                stage_start = tof_time_cycles();
+                save_frame_to_output(&frame);
+                record_latency(TOF_LATENCY_SD_WRITE, stage_start);
+                if (g_roi_enabled) {
+                    tof_roi_update(&g_roi, &frame, &g_roi_resolution);
+                }
+                if (g_can_file != NULL) {
+                    obstacle_to_can(&frame);
+                }
+            }
+        } else if (g_replay) {
+            break;
         } else {
             ESP_LOGW(TAG, "Fim do arquivo de log alcançado. Reiniciando a leitura para loop contínuo.");
             rewind(g_log_file); 
         }
-        msleep(SENSOR_POLLING_RATE_MS);
+        long long now_ms = g_replay ? frame.timestamp_us / 1000 : get_simulated_timestamp_ms();
+        if (g_output_format == SIM_OUTPUT_TOFB && g_out_block.frame_count > 0 &&
+            now_ms - g_out_block.first_frame_us / 1000 >= OUTPUT_FLUSH_INTERVAL_MS) {
+            flush_output_block();
+        }
+        if (g_replay && now_ms - g_out_sync_ms >= OUTPUT_FSYNC_INTERVAL_MS) {
+            // O replay corre mais rápido que o relógio: o fsync segue a cadência do
+            // firmware no tempo do log, para que o índice tenha a mesma granularidade
+            tof_log_writer_flush(&g_out_writer, true);
+            g_out_sync_ms = now_ms;
+        }
+        tof_log_writer_poll(&g_out_writer);
+        tof_log_index_sync(&g_out_index, &g_out_writer);
+        if (!g_replay) {
+            msleep(SENSOR_POLLING_RATE_MS);
+        } else if (g_replay_speed > 0) {
+            replay_pace(sequence, start_us);
+        }
     }
 
+    if (g_replay) {
+        replay_report(sequence, start_us);
+    }
+    report_latency();
     simulation_deinit();
     return 0;
 }
@@ -96,48 +215,216 @@ int run_sensor_simulation(const char* log_filename) {
 // IMPLEMENTAÇÃO DAS FUNÇÕES AUXILIARES
 // =========================================================================
 
-static bool simulation_init(const char* log_filename) {
+static bool simulation_init(const sim_config_t* sim_config) {
+    const char* log_filename = sim_config->log_filename;
     ESP_LOGI(TAG, "Abrindo arquivo de log de entrada: %s", log_filename);
-    g_log_file = fopen(log_filename, "r");
-    if (g_log_file == NULL) {
+    g_input_format = sim_config->input_format;
+    g_replay = sim_config->replay;
+    g_replay_speed = sim_config->replay_speed;
+    g_rate_enabled = sim_config->adaptive_rate;
+    if (g_rate_enabled) {
+        tof_rate_init(&g_rate, NULL, &g_rate_decision);
+    }
+    g_roi_enabled = sim_config->roi_switching;
+    if (g_roi_enabled) {
+        tof_roi_init(&g_roi, NULL);
+        g_roi_resolution = g_roi.resolution;
+    }
+    const tof_filter_config_t filter_config = TOF_FILTER_CONFIG_DEFAULT(sim_config->filter_mode);
+    tof_filter_init(&g_filter, &filter_config);
+    bool opened;
+    if (g_replay && g_input_format == SIM_INPUT_HEX_LOG) {
+        opened = log_replay_open(&g_replay_log, log_filename);
+    } else {
+        g_log_file = fopen(log_filename, g_input_format == SIM_INPUT_STREAM ? "rb" : "r");
+        opened = g_log_file != NULL;
+    }
+    if (!opened) {
         ESP_LOGE(TAG, "ERRO: Nao foi possivel abrir o arquivo de log! Verifique se '%s' esta na mesma pasta.", log_filename);
         return false;
     }
 
-    FILE* f = fopen(OUTPUT_CSV_FILE, "w");
-    if (f == NULL) {
-        ESP_LOGE(TAG, "ERRO: Nao foi possivel criar o arquivo de saida %s", OUTPUT_CSV_FILE);
-        fclose(g_log_file);
+    g_output_format = sim_config->output_format;
+    const char* output_filename = OUTPUT_CSV_FILE;
+    const void* header = TOF_CSV_HEADER;
+    size_t header_len = strlen(TOF_CSV_HEADER);
+    tof_bin_file_header_t bin_header;
+    if (g_output_format == SIM_OUTPUT_TOFB) {
+        tof_bin_make_file_header(&bin_header);
+        tof_bin_block_reset(&g_out_block);
+        g_delta = sim_config->delta_keyframe_interval > 0;
+        const tof_bin_delta_config_t delta_config = {
+            .keyframe_interval = sim_config->delta_keyframe_interval,
+            .threshold_mm = sim_config->delta_threshold_mm,
+        };
+        tof_bin_delta_init(&g_out_delta, &delta_config);
+        output_filename = OUTPUT_TOFB_FILE;
+        header = &bin_header;
+        header_len = sizeof(bin_header);
+    }
+
+    const tof_log_writer_config_t config = {
+        .flush_threshold_bytes = OUTPUT_FLUSH_THRESHOLD_BYTES,
+        .flush_interval_ms = OUTPUT_FLUSH_INTERVAL_MS,
+        .fsync_interval_ms = OUTPUT_FSYNC_INTERVAL_MS,
+    };
+    if (!tof_log_writer_open(&g_out_writer, output_filename, true, header, header_len,
+                             g_out_write_buffer, sizeof(g_out_write_buffer), &config)) {
+        ESP_LOGE(TAG, "ERRO: Nao foi possivel criar o arquivo de saida %s", output_filename);
+        simulation_close_input();
         return false;
     }
-    fprintf(f, "timestamp_ms,zone_id,distance_mm,status\n");
-    fclose(f);
+    if (!tof_log_index_open(&g_out_index, OUTPUT_INDEX_FILE)) {
+        ESP_LOGW(TAG, "Nao foi possivel criar o indice %s; saida sem indice", OUTPUT_INDEX_FILE);
+    }
+
+    if (sim_config->uart_stream_filename) {
+        g_uart_stream_file = fopen(sim_config->uart_stream_filename, "wb");
+        if (g_uart_stream_file == NULL) {
+            ESP_LOGE(TAG, "ERRO: Nao foi possivel criar o arquivo de streaming %s", sim_config->uart_stream_filename);
+            tof_log_writer_close(&g_out_writer);
+            tof_log_index_close(&g_out_index, &g_out_writer);
+            simulation_close_input();
+            return false;
+        }
+        ESP_LOGI(TAG, "Saida da UART em pacotes COBS: %s", sim_config->uart_stream_filename);
+    }
+
+    if (sim_config->can_filename) {
+        g_can_file = fopen(sim_config->can_filename, "w");
+        if (g_can_file == NULL) {
+            ESP_LOGE(TAG, "ERRO: Nao foi possivel criar o arquivo CAN %s", sim_config->can_filename);
+            if (g_uart_stream_file) {
+                fclose(g_uart_stream_file);
+                g_uart_stream_file = NULL;
+            }
+            tof_log_writer_close(&g_out_writer);
+            tof_log_index_close(&g_out_index, &g_out_writer);
+            simulation_close_input();
+            return false;
+        }
+        tof_obstacle_init(&g_obstacle, NULL);
+        ESP_LOGI(TAG, "Frames CAN de obstaculos: %s", sim_config->can_filename);
+    }
+
+    // Ctrl+C encerra o loop de forma ordenada, descarregando o buffer de saída
+    signal(SIGINT, handle_stop_signal);
 
     ESP_LOGI(TAG, "Simulador inicializado. Pressione Ctrl+C para encerrar.");
     return true;
 }
 
-static void simulation_deinit(void) {
+static void simulation_close_input(void) {
     if (g_log_file) {
         fclose(g_log_file);
+        g_log_file = NULL;
+    }
+    log_replay_close(&g_replay_log);
+}
+
+static void simulation_deinit(void) {
+    simulation_close_input();
+    if (g_replay && g_input_format == SIM_INPUT_HEX_LOG) {
+        ESP_LOGI(TAG, "Replay: %llu frames decodificados, %llu linhas descartadas",
+                 (unsigned long long)g_replay_log.frames, (unsigned long long)g_replay_log.rejected);
+    }
+    if (g_uart_stream_file) {
+        fclose(g_uart_stream_file);
+    }
+    if (g_filter.config.mode != TOF_FILTER_NONE) {
+        tof_filter_stats_t filter_stats = tof_filter_get_stats(&g_filter);
+        ESP_LOGI(TAG, "Filtro %s: %u frames, mudancas > %d mm %u -> %u, %u medidas rejeitadas, %.2f us/frame",
+                 tof_filter_mode_name(g_filter.config.mode), filter_stats.frames, TOF_FILTER_CHANGE_MM,
+                 filter_stats.raw_changes, filter_stats.filtered_changes, filter_stats.rejected,
+                 filter_stats.frames > 0 ? g_filter_busy_ns / 1e3 / filter_stats.frames : 0.0);
+    }
+    if (g_input_format == SIM_INPUT_STREAM) {
+        ESP_LOGI(TAG, "Streaming: %lu pacotes decodificados, %lu pacotes de movimento, %lu de telemetria, %lu trechos descartados",
+                 g_stream_packets, g_stream_motion_packets, g_stream_telemetry_packets, g_stream_rejected);
+        if (g_stream_cnh_packets > 0) {
+            ESP_LOGI(TAG, "CNH: %lu pacotes, %llu bins, %.2f bytes por bin (5 no bloco do sensor)",
+                     g_stream_cnh_packets, g_stream_cnh_bins,
+                     g_stream_cnh_bins > 0 ? (double)g_stream_cnh_bytes / g_stream_cnh_bins : 0.0);
+        }
+    }
+    if (g_rate_enabled) {
+        tof_rate_stats_t rate_stats = tof_rate_get_stats(&g_rate);
+        ESP_LOGI(TAG, "Frequencia adaptativa: %u de %u frames ativos, %lu frames nao medidos, %u mudancas, %u sonos, final %u Hz",
+                 rate_stats.active_frames, rate_stats.frames, g_rate_skipped, rate_stats.rate_changes,
+                 rate_stats.sleeps, g_rate_decision.frequency_hz);
+    }
+    if (g_roi_enabled) {
+        tof_roi_stats_t roi_stats = tof_roi_get_stats(&g_roi);
+        ESP_LOGI(TAG, "ROI: %u de %u frames com alvo na ROI, %u em 8x8, %u trocas para 8x8, %u para 4x4",
+                 roi_stats.roi_frames, roi_stats.frames, roi_stats.frames_8x8,
+                 roi_stats.switches_up, roi_stats.switches_down);
+    }
+    if (g_can_file) {
+        fclose(g_can_file);
+        tof_obstacle_stats_t obstacle_stats = tof_obstacle_get_stats(&g_obstacle);
+        unsigned long long can_bytes = (unsigned long long)g_can_frames * TOF_OBSTACLE_CAN_DLC;
+        ESP_LOGI(TAG, "Obstaculos: %u de %u frames com alvo, %u alvos rastreados, %u perdidos; %lu frames CAN, "
+                 "%llu bytes de dados (%.1f%% dos %llu bytes das zonas cruas)",
+                 obstacle_stats.target_frames, obstacle_stats.frames, obstacle_stats.tracks, obstacle_stats.lost,
+                 g_can_frames, can_bytes, g_can_raw_bytes > 0 ? 100.0 * can_bytes / g_can_raw_bytes : 0.0,
+                 g_can_raw_bytes);
+    }
+    if (g_output_format == SIM_OUTPUT_TOFB) {
+        flush_output_block();
     }
+    tof_log_writer_close(&g_out_writer);
+    if (tof_log_index_close(&g_out_index, &g_out_writer)) {
+        ESP_LOGI(TAG, "Indice: %u entradas em %s", tof_log_index_get_stats(&g_out_index).entries, OUTPUT_INDEX_FILE);
+    }
+    if (g_delta) {
+        const tof_bin_delta_stats_t* delta = &g_out_delta.stats;
+        uint32_t zones = delta->zones_written + delta->zones_skipped;
+        ESP_LOGI(TAG, "Delta: %u keyframes, %u frames delta, %u de %u zonas dos frames delta gravadas (%.1f%%)",
+                 delta->keyframes, delta->delta_frames, delta->zones_written, zones,
+                 zones > 0 ? 100.0 * delta->zones_written / zones : 0.0);
+    }
+
+    tof_log_writer_stats_t stats = tof_log_writer_get_stats(&g_out_writer);
+    double busy_s = stats.busy_time_us / 1e6;
+    ESP_LOGI(TAG, "Saida: %llu bytes em %u descargas e %u fsyncs (%.1f KB/s durante escrita), pior descarga %u us, pior fsync %u us, %u erros",
+             (unsigned long long)stats.bytes_written, stats.flushes, stats.fsyncs,
+             busy_s > 0 ? stats.bytes_written / 1024.0 / busy_s : 0.0,
+             stats.max_flush_us, stats.max_fsync_us, stats.write_errors);
+}
+
+static void handle_stop_signal(int sig) {
+    (void)sig;
+    g_stop_requested = 1;
 }
 
-static bool get_sensor_data_from_log(uint8_t* dist_buf, uint8_t* status_buf) {
+static bool get_sensor_data_from_log(tof_frame_t* frame) {
     char line[LOG_LINE_MAX_LEN];
     char* hex_data_ptr = NULL;
+    uint8_t raw[SENSOR_ZONES * 2];
 
     while (fgets(line, sizeof(line), g_log_file)) {
         if ((hex_data_ptr = strstr(line, "TOF: HEX DATA:"))) {
             hex_data_ptr += strlen("TOF: HEX DATA:");
-            while (*hex_data_ptr == ' ') hex_data_ptr++;
-            if (!hex_string_to_bytes(hex_data_ptr, dist_buf, SENSOR_DATA_BUFFER_SIZE)) continue;
+            while (*hex_data_ptr == ' ' || *hex_data_ptr == '\t') hex_data_ptr++;
+            // Logs antigos têm 2 dígitos por zona (distância truncada em 8 bits, só em
+            // 8x8); os atuais, 4, com 16 ou 64 zonas
+            size_t hex_len = hex_payload_len(hex_data_ptr);
+            bool wide = hex_len == SENSOR_ZONES * 4 || hex_len == SENSOR_ZONES_4X4 * 4;
+            int zones = hex_len == SENSOR_ZONES_4X4 * 4 ? SENSOR_ZONES_4X4 : SENSOR_ZONES;
+            if (!hex_string_to_bytes(hex_data_ptr, raw, wide ? zones * 2 : zones)) continue;
 
             if (fgets(line, sizeof(line), g_log_file)) {
                 if ((hex_data_ptr = strstr(line, "TOF: TARGET STATUS:"))) {
                     hex_data_ptr += strlen("TOF: TARGET STATUS:");
-                    while (*hex_data_ptr == ' ') hex_data_ptr++;
-                    if (!hex_string_to_bytes(hex_data_ptr, status_buf, SENSOR_DATA_BUFFER_SIZE)) continue;
+                    while (*hex_data_ptr == ' ' || *hex_data_ptr == '\t') hex_data_ptr++;
+                    memset(frame, 0, sizeof(*frame));
+                    if (!hex_string_to_bytes(hex_data_ptr, frame->target_status, zones)) continue;
+                    frame->resolution = (uint8_t)zones;
+                    for (int z = 0; z < zones; z++) {
+                        frame->nb_target_detected[z] = 1;
+                        frame->distance_mm[TOF_FRAME_TARGET_IDX(z, 0)] =
+                            wide ? (int16_t)((raw[2 * z] << 8) | raw[2 * z + 1]) : raw[z];
+                    }
                     return true;
                 }
             }
@@ -146,7 +433,106 @@ static bool get_sensor_data_from_log(uint8_t* dist_buf, uint8_t* status_buf) {
     return false;
 }
 
-static void print_raw_data_as_hex(const char* prefix, uint8_t* buffer, size_t len) {
+/**
+ * @brief Conta um pacote CNH (SENSOR_CNH_MODE) da captura; os histogramas não entram no pipeline do simulador.
+ * @return true se o trecho é um pacote CNH válido.
+ */
+static bool count_cnh_packet(const uint8_t* chunk, size_t len) {
+    static uint8_t packet[TOF_CNH_MAX_PACKET];
+    static tof_cnh_frame_t cnh;
+    size_t n = tof_cobs_decode(chunk, len, packet, sizeof(packet));
+    if (n == 0 || !tof_cnh_decode_packet(packet, n, &cnh)) {
+        return false;
+    }
+    g_stream_cnh_packets++;
+    g_stream_cnh_bins += (unsigned long long)cnh.header.nb_aggregates * cnh.header.nb_bins;
+    g_stream_cnh_bytes += len + 2;
+    return true;
+}
+
+/**
+ * @brief Imprime as latências por etapa de um pacote de telemetria do firmware (SENSOR_LATENCY_STATS).
+ * @return true se o trecho é um pacote de telemetria válido.
+ */
+static bool print_telemetry_packet(const uint8_t* chunk, size_t len) {
+    uint8_t packet[TOF_LATENCY_TELEMETRY_PACKET];
+    tof_latency_telemetry_header_t header;
+    tof_latency_summary_t summaries[TOF_LATENCY_STAGE_COUNT];
+    size_t n = tof_cobs_decode(chunk, len, packet, sizeof(packet));
+    if (n == 0 || !tof_latency_decode_telemetry(packet, n, &header, summaries)) {
+        return false;
+    }
+    for (int stage = 0; stage < TOF_LATENCY_STAGE_COUNT; stage++) {
+        if (summaries[stage].count > 0) {
+            ESP_LOGI(TAG, "Firmware t=%u ms: latencia %-12s %u amostras em %u ms, p50 %.1f us, p99 %.1f us, max %.1f us",
+                     header.uptime_ms, tof_latency_stage_name((tof_latency_stage_t)stage), summaries[stage].count,
+                     header.interval_ms, summaries[stage].p50_ns / 1e3, summaries[stage].p99_ns / 1e3,
+                     summaries[stage].max_ns / 1e3);
+        }
+    }
+    return true;
+}
+
+static bool get_sensor_data_from_stream(tof_frame_t* frame) {
+    // Estático: o trecho precisa caber um pacote CNH inteiro
+    static uint8_t chunk[TOF_CNH_ENCODED_BOUND(TOF_CNH_MAX_PACKET)];
+    size_t len = 0;
+    bool overflow = false;
+    int c;
+
+    // Acumula os bytes entre delimitadores 0x00; texto de log intercalado na
+    // captura e pacotes corrompidos falham no COBS ou no CRC e são descartados
+    while ((c = fgetc(g_log_file)) != EOF) {
+        if (c != 0x00) {
+            if (len < sizeof(chunk)) {
+                chunk[len++] = (uint8_t)c;
+            } else {
+                overflow = true;
+            }
+            continue;
+        }
+        if (len == 0) {
+            continue;
+        }
+        if (!overflow && tof_stream_decode_frame(chunk, len, frame)) {
+            g_stream_packets++;
+            return true;
+        }
+        // Pacotes de movimento (SENSOR_MOTION_MODE) não trazem distâncias
+        if (!overflow && tof_stream_decode_motion(chunk, len, frame)) {
+            g_stream_motion_packets++;
+        } else if (!overflow && count_cnh_packet(chunk, len)) {
+            // Histogramas CNH (SENSOR_CNH_MODE): apenas contabilizados
+        } else if (!overflow && print_telemetry_packet(chunk, len)) {
+            g_stream_telemetry_packets++;
+        } else {
+            g_stream_rejected++;
+        }
+        len = 0;
+        overflow = false;
+    }
+    return false;
+}
+
+static void output_frame_to_uart(const tof_frame_t* frame) {
+    if (g_uart_stream_file == NULL) {
+        size_t targets = (size_t)frame->resolution * TOF_FRAME_TARGETS_PER_ZONE;
+        printf("TOF: HEX DATA: \t");
+        for (size_t i = 0; i < targets; i++) {
+            printf("%04X", (uint16_t)frame->distance_mm[i]);
+        }
+        printf("\n");
+        print_raw_data_as_hex("TOF: TARGET STATUS", frame->target_status, targets);
+        return;
+    }
+
+    uint8_t packet[TOF_STREAM_MAX_ENCODED];
+    size_t len = tof_stream_encode_frame(frame, packet, sizeof(packet));
+    fwrite(packet, 1, len, g_uart_stream_file);
+    fflush(g_uart_stream_file);
+}
+
+static void print_raw_data_as_hex(const char* prefix, const uint8_t* buffer, size_t len) {
     printf("%s: \t", prefix);
     for (size_t i = 0; i < len; i++) {
         printf("%02X", buffer[i]);
@@ -154,19 +540,48 @@ static void print_raw_data_as_hex(const char* prefix, uint8_t* buffer, size_t le
     printf("\n");
 }
 
-static void save_data_to_csv(uint8_t* dist_buf, uint8_t* status_buf) {
-    FILE* f = fopen(OUTPUT_CSV_FILE, "a");
-    if (f == NULL) {
-        ESP_LOGE(TAG, "Falha ao abrir o arquivo CSV para escrita.");
+static void save_frame_to_output(const tof_frame_t* frame) {
+    if (g_output_format == SIM_OUTPUT_TOFB) {
+        if (g_delta) {
+            tof_bin_block_add_delta_frame(&g_out_block, &g_out_delta, frame);
+        } else {
+            tof_bin_block_add_frame(&g_out_block, frame);
+        }
+        if (tof_bin_block_is_full(&g_out_block)) {
+            flush_output_block();
+        }
+        return;
+    }
+
+    char* row = (char*)tof_log_writer_reserve(&g_out_writer, TOF_CSV_MAX_FRAME_LEN);
+    if (row == NULL) {
+        ESP_LOGE(TAG, "Falha ao escrever no arquivo CSV.");
+        return;
+    }
+    uint64_t offset = tof_log_writer_position(&g_out_writer);
+    if (tof_log_writer_commit(&g_out_writer, tof_csv_format_frame(row, TOF_CSV_MAX_FRAME_LEN, frame))) {
+        tof_log_index_mark(&g_out_index, frame->timestamp_us, offset);
+    }
+}
+
+static void flush_output_block(void) {
+    if (g_out_block.frame_count == 0) {
         return;
     }
-    long long timestamp = get_simulated_timestamp_ms();
-    for (int i = 0; i < SENSOR_DATA_BUFFER_SIZE; i++) {
-        if (status_buf[i] == 5 || status_buf[i] == 9) {
-            fprintf(f, "%lld,%d,%d,%d\n", timestamp, i, dist_buf[i], status_buf[i]);
+    size_t size = tof_bin_block_encoded_size(&g_out_block);
+    uint8_t* dst = tof_log_writer_reserve(&g_out_writer, size);
+    if (dst == NULL) {
+        ESP_LOGE(TAG, "Falha ao escrever no arquivo .tofb.");
+        // Os frames delta seguintes dependeriam do bloco perdido
+        tof_bin_delta_init(&g_out_delta, &g_out_delta.config);
+    } else {
+        // Marca só o bloco confirmado, no deslocamento em que foi reservado
+        uint64_t offset = tof_log_writer_position(&g_out_writer);
+        if (tof_log_writer_commit(&g_out_writer, tof_bin_block_encode(&g_out_block, dst, size))) {
+            tof_log_index_mark(&g_out_index, g_out_block.first_frame_us, offset);
         }
     }
-    fclose(f);
+    tof_bin_block_reset(&g_out_block);
 }
 
 static int hex_char_to_int(char c) {
@@ -176,14 +591,16 @@ static int hex_char_to_int(char c) {
     return -1;
 }
 
-static bool hex_string_to_bytes(const char* hex_str, uint8_t* byte_array, size_t array_len) {
+static size_t hex_payload_len(const char* hex_str) {
     size_t hex_len = strlen(hex_str);
-    if (hex_str[hex_len - 1] == '\n' || hex_str[hex_len - 1] == '\r') {
-        hex_len--;
-    }
-    if (hex_str[hex_len - 1] == '\r') {
+    while (hex_len > 0 && (hex_str[hex_len - 1] == '\n' || hex_str[hex_len - 1] == '\r')) {
         hex_len--;
     }
+    return hex_len;
+}
+
+static bool hex_string_to_bytes(const char* hex_str, uint8_t* byte_array, size_t array_len) {
+    size_t hex_len = hex_payload_len(hex_str);
     if (hex_len != array_len * 2) {
         ESP_LOGE(TAG, "Comprimento de string HEX invalido. Esperado: %zu, Recebido: %zu", array_len * 2, hex_len);
         return false;
@@ -200,6 +617,140 @@ static bool hex_string_to_bytes(const char* hex_str, uint8_t* byte_array, size_t
     return true;
 }
 
+static void replay_pace(uint32_t frame_index, int64_t start_us) {
+    // Prazo absoluto do próximo frame: os atrasos de escrita não se acumulam
+    int64_t deadline_us = start_us + (int64_t)(frame_index * (SENSOR_POLLING_RATE_MS * 1000.0) / g_replay_speed);
+    int64_t wait_us = deadline_us - tof_time_us();
+    if (wait_us >= 1000) {
+        msleep((unsigned)(wait_us / 1000));
+    }
+}
+
+static void replay_report(uint32_t frames, int64_t start_us) {
+    double elapsed_s = (tof_time_us() - start_us) / 1e6;
+    double input_mb = g_input_format == SIM_INPUT_HEX_LOG ? g_replay_log.size / (1024.0 * 1024.0) : 0.0;
+    ESP_LOGI(TAG, "Replay: %u frames em %.3f s (%.0f frames/s, %.1f MB/s de entrada, %.0fx a taxa do firmware)",
+             frames, elapsed_s, elapsed_s > 0 ? frames / elapsed_s : 0.0,
+             elapsed_s > 0 ? input_mb / elapsed_s : 0.0,
+             elapsed_s > 0 ? frames / elapsed_s * SENSOR_POLLING_RATE_MS / 1000.0 : 0.0);
+}
+
+static uint32_t record_latency(tof_latency_stage_t stage, uint32_t start_cycles) {
+    uint32_t ns = tof_time_cycles_to_ns(tof_time_cycles() - start_cycles);
+    tof_latency_record(&g_latency[stage], ns);
+    return ns;
+}
+
+/**
+ * @brief Imprime p50/p99/máximo das etapas do simulador (leitura da entrada, filtro, saída no console e no arquivo).
+ */
+static void report_latency(void) {
+    for (int stage = 0; stage < TOF_LATENCY_STAGE_COUNT; stage++) {
+        tof_latency_summary_t summary;
+        tof_latency_take(&g_latency[stage], &summary);
+        if (summary.count > 0) {
+            ESP_LOGI(TAG, "Latencia %-12s %u amostras, p50 %.1f us, p99 %.1f us, max %.1f us",
+                     tof_latency_stage_name((tof_latency_stage_t)stage), summary.count,
+                     summary.p50_ns / 1e3, summary.p99_ns / 1e3, summary.max_ns / 1e3);
+        }
+    }
+}
+
 static long long get_simulated_timestamp_ms() {
     return (long long)(clock() * 1000 / CLOCKS_PER_SEC);
 }
+
+/**
+ * @brief Emula a frequência adaptativa: decide se o sensor mediria o frame e o passa ao controle.
+ *
+ * Um frame só é medido se chegou depois do período da frequência pedida (e
+ * do sono, quando houver) desde o último frame medido. A carga das filas é
+ * considerada nula.
+ *
+ * @return true se o frame segue para a saída.
+ */
+static bool rate_gate(const tof_frame_t* frame) {
+    if (!g_rate_enabled) {
+        return true;
+    }
+    if (frame->timestamp_us < g_rate_next_us) {
+        g_rate_skipped++;
+        return false;
+    }
+    tof_rate_update(&g_rate, frame, 0, &g_rate_decision);
+    g_rate_next_us = frame->timestamp_us + 1000000 / g_rate_decision.frequency_hz
+                   + (int64_t)g_rate_decision.sleep_ms * 1000;
+    return true;
+}
+
+/**
+ * @brief Reduz um frame 8x8 a 4x4, como o sensor o mediria com a resolução menor.
+ *
+ * Cada zona 4x4 recebe o alvo mais próximo entre as zonas válidas do seu
+ * quadrado de 2x2; sem nenhuma válida, ela fica sem alvo. Frames que não são
+ * 8x8 não mudam.
+ */
+static void downsample_to_4x4(tof_frame_t* frame) {
+    if (frame->resolution != TOF_ROI_RESOLUTION_8X8) {
+        return;
+    }
+    static tof_frame_t full;
+    full = *frame;
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            int best = -1;
+            for (int i = 0; i < 4; i++) {
+                int z = (2 * row + i / 2) * 8 + 2 * col + i % 2;
+                if (tof_frame_target_is_valid(&full, z, 0) &&
+                    (best < 0 || full.distance_mm[TOF_FRAME_TARGET_IDX(z, 0)] < full.distance_mm[TOF_FRAME_TARGET_IDX(best, 0)])) {
+                    best = z;
+                }
+            }
+            int zone = row * 4 + col;
+            int src = best < 0 ? (2 * row) * 8 + 2 * col : best;
+            frame->nb_target_detected[zone] = best < 0 ? 0 : full.nb_target_detected[src];
+            for (int t = 0; t < TOF_FRAME_TARGETS_PER_ZONE; t++) {
+                int to = TOF_FRAME_TARGET_IDX(zone, t);
+                int from = TOF_FRAME_TARGET_IDX(src, t);
+                frame->distance_mm[to] = full.distance_mm[from];
+                frame->range_sigma_mm[to] = full.range_sigma_mm[from];
+                frame->signal_per_spad[to] = full.signal_per_spad[from];
+                frame->target_status[to] = full.target_status[from];
+            }
+        }
+    }
+    for (int z = TOF_ROI_RESOLUTION_4X4; z < TOF_FRAME_MAX_ZONES; z++) {
+        frame->nb_target_detected[z] = 0;
+        for (int t = 0; t < TOF_FRAME_TARGETS_PER_ZONE; t++) {
+            int idx = TOF_FRAME_TARGET_IDX(z, t);
+            frame->distance_mm[idx] = 0;
+            frame->range_sigma_mm[idx] = 0;
+            frame->signal_per_spad[idx] = 0;
+            frame->target_status[idx] = 0;
+        }
+    }
+    frame->resolution = TOF_ROI_RESOLUTION_4X4;
+}
+
+/**
+ * @brief Passa um frame pelo estágio de obstáculos e grava os frames CAN no formato do candump -L.
+ *
+ * Cada linha é "(segundos.micro) can0 ID#DADOS", com o timestamp do frame
+ * de origem, e pode ser reproduzida em um barramento com o canplayer.
+ */
+static void obstacle_to_can(const tof_frame_t* frame) {
+    tof_obstacle_result_t result;
+    tof_can_frame_t can_frames[TOF_OBSTACLE_MAX_CAN_FRAMES];
+    tof_obstacle_update(&g_obstacle, frame, &result);
+    size_t count = tof_obstacle_pack_can(&g_obstacle.config, &result, can_frames, TOF_OBSTACLE_MAX_CAN_FRAMES);
+    for (size_t k = 0; k < count; k++) {
+        fprintf(g_can_file, "(%lld.%06lld) can0 %03X#", (long long)(frame->timestamp_us / 1000000),
+                (long long)(frame->timestamp_us % 1000000), (unsigned)can_frames[k].id);
+        for (int b = 0; b < can_frames[k].dlc; b++) {
+            fprintf(g_can_file, "%02X", can_frames[k].data[b]);
+        }
+        fputc('\n', g_can_file);
+    }
+    g_can_frames += count;
+    g_can_raw_bytes += (unsigned long long)result.sector_count * result.sector_count * 3;
+}
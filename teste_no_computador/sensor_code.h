@@ -10,11 +10,47 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "tof_filter.h"
+
+/**
+ * @brief Formato do arquivo de saída gerado pela simulação.
+ */
+typedef enum {
+    SIM_OUTPUT_CSV,     /**< tof_log.csv: uma linha por zona válida. */
+    SIM_OUTPUT_TOFB     /**< tof_log.tofb: formato binário compacto (ver tof_bin.h). */
+} sim_output_format_t;
+
+/**
+ * @brief Formato do arquivo de entrada da simulação.
+ */
+typedef enum {
+    SIM_INPUT_HEX_LOG,  /**< Log do monitor serial com as linhas "TOF: HEX DATA" / "TOF: TARGET STATUS". */
+    SIM_INPUT_STREAM    /**< Captura bruta da UART no modo de streaming COBS (ver tof_stream.h). */
+} sim_input_format_t;
+
+/**
+ * @brief Parâmetros da simulação.
+ */
+typedef struct {
+    const char* log_filename;           /**< Arquivo de log de entrada a ser lido. */
+    sim_input_format_t input_format;    /**< Formato do arquivo de entrada. */
+    sim_output_format_t output_format;  /**< Formato do arquivo de saída. */
+    const char* uart_stream_filename;   /**< Se não nulo, a saída da UART vai em pacotes COBS para este arquivo em vez do dump hexadecimal. */
+    bool replay;                        /**< Replay: lê a entrada uma única vez, sem esperas e sem o dump no console, e reporta a vazão. */
+    double replay_speed;                /**< Multiplicador da taxa do firmware no replay (0 = o mais rápido possível). */
+    tof_filter_mode_t filter_mode;      /**< Filtro temporal aplicado às distâncias antes da saída, como no firmware. */
+    uint16_t delta_keyframe_interval;   /**< Na saída .tofb, frames entre keyframes do modo delta (0 = todos os frames completos). */
+    uint16_t delta_threshold_mm;        /**< No modo delta, variação de distância a partir da qual uma zona é regravada. */
+    bool adaptive_rate;                 /**< Emula a frequência adaptativa do firmware (tof_rate.h), descartando os frames que o sensor não mediria. */
+    bool roi_switching;                 /**< Emula a troca de resolução pela ROI (tof_roi.h), reduzindo a 4x4 os frames 8x8 do log enquanto não há alvo na ROI. */
+    const char* can_filename;           /**< Se não nulo, os frames CAN do estágio de obstáculos (tof_obstacle.h) vão para este arquivo no formato do candump -L. */
+} sim_config_t;
+
 /**
  * @brief Inicia a simulação do firmware do sensor ToF.
- * @param log_filename O nome do arquivo de log de entrada a ser lido.
+ * @param config Parâmetros da simulação.
  * @return 0 em caso de sucesso, -1 em caso de falha.
  */
-int run_sensor_simulation(const char* log_filename);
+int run_sensor_simulation(const sim_config_t* config);
 
 #endif // SENSOR_CODE_H
@@ -0,0 +1,27 @@
+/**
+ * @file sim_log.h
+ * @brief Substitutos das macros ESP_LOGx do ESP-IDF para os programas do simulador.
+ */
+
+#ifndef SIM_LOG_H
+#define SIM_LOG_H
+
+#include <stdio.h>
+#include <time.h>
+
+static inline const char* get_log_timestamp() {
+    static char buffer[10];
+    time_t now = time(NULL);
+    struct tm* t = localtime(&now);
+    if (t) {
+        strftime(buffer, sizeof(buffer), "%H:%M:%S", t);
+    }
+    return buffer;
+}
+
+#define ESP_LOGI(tag, format, ...) printf("%s I (%s): " format "\n", get_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) printf("%s W (%s): " format "\n", get_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGE(tag, format, ...) printf("%s E (%s): " format "\n", get_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) printf("%s D (%s): " format "\n", get_log_timestamp(), tag, ##__VA_ARGS__)
+
+#endif // SIM_LOG_H
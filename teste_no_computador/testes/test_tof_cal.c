@@ -0,0 +1,131 @@
+/**
+ * @file test_tof_cal.c
+ * @brief Teste do caminho de carga do cache de calibração (tof_cal) sobre uma NVS simulada.
+ *
+ * A NVS simulada reproduz a semântica de nvs_get_blob(): *len entra com a
+ * capacidade do destino e sai com o tamanho gravado, e um blob maior que a
+ * capacidade é recusado sem cópia. Assim uma capacidade errada na leitura (por
+ * exemplo sizeof de um ponteiro) faz o registro válido falhar aqui em vez de
+ * só no sensor. Executado pelo ctest.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tof_cal.h"
+
+#define TEST_SENSOR_ID 1                            /**< Sensor do registro de teste. */
+#define TEST_MODULE_TYPE 2                          /**< Módulo do registro de teste. */
+#define TEST_OFFSET_CRC 0xA5A5F00Du                 /**< CRC de offsets do registro de teste. */
+#define TEST_KEY "xt_1_2"                           /**< Chave no formato do firmware. */
+
+/**
+ * @brief Uma chave gravada na NVS simulada.
+ */
+typedef struct {
+    const char *key;                                /**< Chave do blob (NULL = NVS vazia). */
+    uint8_t data[sizeof(tof_cal_record_t) + 16];    /**< Blob gravado. */
+    size_t size;                                    /**< Bytes gravados. */
+    int reads;                                      /**< Leituras feitas. */
+} fake_nvs_t;
+
+static int s_failures = 0;
+
+/** @brief Leitura com a semântica de nvs_get_blob(). */
+static tof_cal_read_status_t fake_nvs_read(void *ctx, const char *key, void *out, size_t *len);
+
+/** @brief Grava um blob na NVS simulada. */
+static void fake_nvs_set(fake_nvs_t *nvs, const char *key, const void *data, size_t size);
+
+/** @brief Carrega TEST_KEY para o módulo de teste e compara com o resultado esperado. */
+static void expect_load(const char *name, fake_nvs_t *nvs, uint8_t sensor_id, uint8_t module_type,
+                        uint32_t offset_crc, tof_cal_load_result_t expected);
+
+int main(void) {
+    uint8_t xtalk[TOF_CAL_XTALK_SIZE];
+    for (size_t i = 0; i < sizeof(xtalk); i++) {
+        xtalk[i] = (uint8_t)(i * 7u + 3u);
+    }
+    tof_cal_record_t record;
+    tof_cal_record_make(&record, TEST_SENSOR_ID, TEST_MODULE_TYPE, TEST_OFFSET_CRC, xtalk);
+    fake_nvs_t nvs = { 0 };
+
+    expect_load("NVS vazia", &nvs, TEST_SENSOR_ID, TEST_MODULE_TYPE, TEST_OFFSET_CRC, TOF_CAL_MISSING);
+
+    fake_nvs_set(&nvs, TEST_KEY, &record, sizeof(record));
+    expect_load("registro válido", &nvs, TEST_SENSOR_ID, TEST_MODULE_TYPE, TEST_OFFSET_CRC, TOF_CAL_LOADED);
+    tof_cal_record_t loaded;
+    if (tof_cal_load(fake_nvs_read, &nvs, TEST_KEY, &loaded, TEST_SENSOR_ID, TEST_MODULE_TYPE,
+                     TEST_OFFSET_CRC) != TOF_CAL_LOADED || memcmp(loaded.xtalk, xtalk, sizeof(xtalk)) != 0) {
+        printf("FALHA registro válido: xtalk lido difere do gravado\n");
+        s_failures++;
+    }
+    expect_load("outro módulo", &nvs, TEST_SENSOR_ID, TEST_MODULE_TYPE + 1, TEST_OFFSET_CRC, TOF_CAL_MISMATCH);
+    expect_load("outros offsets", &nvs, TEST_SENSOR_ID, TEST_MODULE_TYPE, TEST_OFFSET_CRC ^ 1u, TOF_CAL_MISMATCH);
+    expect_load("outro sensor", &nvs, TEST_SENSOR_ID + 1, TEST_MODULE_TYPE, TEST_OFFSET_CRC, TOF_CAL_MISMATCH);
+
+    tof_cal_record_t corrupted = record;
+    corrupted.xtalk[100] ^= 0x10;
+    fake_nvs_set(&nvs, TEST_KEY, &corrupted, sizeof(corrupted));
+    expect_load("byte corrompido", &nvs, TEST_SENSOR_ID, TEST_MODULE_TYPE, TEST_OFFSET_CRC, TOF_CAL_MISMATCH);
+
+    tof_cal_record_t old_version = record;
+    old_version.version = TOF_CAL_VERSION + 1;
+    fake_nvs_set(&nvs, TEST_KEY, &old_version, sizeof(old_version));
+    expect_load("outra versão", &nvs, TEST_SENSOR_ID, TEST_MODULE_TYPE, TEST_OFFSET_CRC, TOF_CAL_MISMATCH);
+
+    fake_nvs_set(&nvs, TEST_KEY, &record, sizeof(record) - 4);
+    expect_load("blob curto", &nvs, TEST_SENSOR_ID, TEST_MODULE_TYPE, TEST_OFFSET_CRC, TOF_CAL_MISMATCH);
+
+    fake_nvs_set(&nvs, TEST_KEY, &record, sizeof(record) + 4);
+    expect_load("blob longo", &nvs, TEST_SENSOR_ID, TEST_MODULE_TYPE, TEST_OFFSET_CRC, TOF_CAL_READ_ERROR);
+
+    fake_nvs_set(&nvs, "xt_0_2", &record, sizeof(record));
+    expect_load("outra chave", &nvs, TEST_SENSOR_ID, TEST_MODULE_TYPE, TEST_OFFSET_CRC, TOF_CAL_MISSING);
+
+    // Identificação zero (primeiro sensor) não é confundida com registro vazio
+    tof_cal_record_make(&record, 0, TEST_MODULE_TYPE, TEST_OFFSET_CRC, xtalk);
+    fake_nvs_set(&nvs, TEST_KEY, &record, sizeof(record));
+    expect_load("sensor 0", &nvs, 0, TEST_MODULE_TYPE, TEST_OFFSET_CRC, TOF_CAL_LOADED);
+
+    if (s_failures == 0) {
+        printf("tof_cal: todos os casos passaram\n");
+    }
+    return s_failures == 0 ? 0 : 1;
+}
+
+static tof_cal_read_status_t fake_nvs_read(void *ctx, const char *key, void *out, size_t *len) {
+    fake_nvs_t *nvs = ctx;
+    nvs->reads++;
+    if (nvs->key == NULL || strcmp(nvs->key, key) != 0) {
+        return TOF_CAL_READ_NOT_FOUND;
+    }
+    // nvs_get_blob() recusa um destino menor que o blob (ESP_ERR_NVS_INVALID_LENGTH)
+    if (*len < nvs->size) {
+        *len = nvs->size;
+        return TOF_CAL_READ_FAILED;
+    }
+    memcpy(out, nvs->data, nvs->size);
+    *len = nvs->size;
+    return TOF_CAL_READ_OK;
+}
+
+static void fake_nvs_set(fake_nvs_t *nvs, const char *key, const void *data, size_t size) {
+    nvs->key = key;
+    memset(nvs->data, 0, sizeof(nvs->data));
+    memcpy(nvs->data, data, size <= sizeof(tof_cal_record_t) ? size : sizeof(tof_cal_record_t));
+    nvs->size = size;
+}
+
+static void expect_load(const char *name, fake_nvs_t *nvs, uint8_t sensor_id, uint8_t module_type,
+                        uint32_t offset_crc, tof_cal_load_result_t expected) {
+    tof_cal_record_t record;
+    memset(&record, 0xEE, sizeof(record));
+    int reads = nvs->reads;
+    tof_cal_load_result_t result = tof_cal_load(fake_nvs_read, nvs, TEST_KEY, &record, sensor_id,
+                                                module_type, offset_crc);
+    if (result != expected || nvs->reads != reads + 1) {
+        printf("FALHA %s: resultado %d, esperado %d\n", name, (int)result, (int)expected);
+        s_failures++;
+    }
+}
@@ -0,0 +1,253 @@
+/**
+ * @file test_tof_log_index.c
+ * @brief Teste da recuperação de um log após queda de energia pelo índice lateral (tof_log_index).
+ *
+ * Cada caso grava um log de dados e seu índice com tof_log_writer e
+ * tof_log_index, "derruba a energia" fechando os descritores sem descarga
+ * nem truncamento, estraga a cauda dos dois arquivos como uma gravação
+ * interrompida faria (bytes além do último fsync, uma entrada de índice com
+ * CRC inválido e uma entrada parcial) e confere o tamanho deixado por
+ * tof_log_index_recover(). Executado pelo ctest, no diretório de build.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tof_log_index.h"
+#include "tof_log_writer.h"
+
+#define TEST_DATA_PATH "test_tof_log_index.bin"     /**< Log de dados dos casos. */
+#define TEST_INDEX_PATH "test_tof_log_index.idx"    /**< Índice do log de dados. */
+#define TEST_BUFFER_SIZE 4096                       /**< Buffer de escrita do log de dados. */
+#define TEST_PREALLOCATED_BYTES (64 * 1024)         /**< Tamanho reservado no caso pré-alocado. */
+
+static uint8_t s_buffer[TEST_BUFFER_SIZE];
+static tof_log_writer_t s_data;
+static tof_log_index_t s_index;
+static int s_failures = 0;
+
+/** @brief Abre o log de dados (opcionalmente pré-alocado) e o índice. */
+static bool open_log(bool preallocated);
+
+/** @brief Grava um registro de len bytes, marcado no índice com timestamp_us. */
+static void write_record(int64_t timestamp_us, size_t len);
+
+/** @brief Descarrega o log, faz o fsync e grava a entrada do índice, como a tarefa do SD. */
+static void sync_log(void);
+
+/** @brief Simula a queda de energia: fecha os arquivos sem descarga, fsync nem truncamento. */
+static void power_loss(void);
+
+/** @brief Acrescenta len bytes ao fim de um arquivo. */
+static void append_bytes(const char *path, const void *data, size_t len);
+
+/** @brief Tamanho atual de um arquivo (-1 se não existe). */
+static long file_size(const char *path);
+
+/** @brief Registra uma falha se a condição for falsa. */
+static void check(bool ok, const char *name, const char *what);
+
+/** @brief Log com dois registros sincronizados, um só descarregado e caudas estragadas nos dois arquivos. */
+static void test_torn_tail(void);
+
+/** @brief Log pré-alocado: o tamanho reservado é truncado no fim confiável. */
+static void test_preallocated(void);
+
+/** @brief Índice só com o cabeçalho: nada do log foi garantido e ele é truncado em zero. */
+static void test_header_only(void);
+
+/** @brief Sem índice legível, o log de dados não é alterado. */
+static void test_unreadable_index(void);
+
+int main(void) {
+    test_torn_tail();
+    test_preallocated();
+    test_header_only();
+    test_unreadable_index();
+    remove(TEST_DATA_PATH);
+    remove(TEST_INDEX_PATH);
+
+    if (s_failures == 0) {
+        printf("tof_log_index: todos os casos passaram\n");
+    }
+    return s_failures == 0 ? 0 : 1;
+}
+
+static void test_torn_tail(void) {
+    const char *name = "cauda estragada";
+    if (!open_log(false)) {
+        check(false, name, "abertura do log");
+        return;
+    }
+    write_record(1000, 100);
+    sync_log();
+    write_record(2000, 50);
+    write_record(2500, 20);
+    sync_log();
+    // Descarregado mas sem fsync, logo sem entrada: não é confiável
+    write_record(3000, 30);
+    tof_log_writer_flush(&s_data, false);
+    power_loss();
+
+    uint8_t expected[170];
+    FILE *f = fopen(TEST_DATA_PATH, "rb");
+    check(f != NULL && fread(expected, 1, sizeof(expected), f) == sizeof(expected), name, "leitura dos dados");
+    if (f != NULL) {
+        fclose(f);
+    }
+
+    const uint8_t garbage[40] = { 0xDE, 0xAD, 0xBE, 0xEF };
+    append_bytes(TEST_DATA_PATH, garbage, sizeof(garbage));
+    tof_log_index_entry_t torn = { .timestamp_us = 4000, .offset = 200, .durable_end = 240, .crc32 = 0 };
+    append_bytes(TEST_INDEX_PATH, &torn, sizeof(torn));
+    append_bytes(TEST_INDEX_PATH, &torn, 7);
+    check(file_size(TEST_DATA_PATH) == 240, name, "tamanho antes da recuperação");
+
+    tof_log_index_entry_t last;
+    check(tof_log_index_read_last(TEST_INDEX_PATH, &last), name, "última entrada válida");
+    // Só a primeira marca desde a entrada anterior é guardada
+    check(last.timestamp_us == 2000 && last.offset == 100 && last.durable_end == 170, name,
+          "a última entrada válida é a do segundo fsync");
+
+    uint64_t size = 0;
+    check(tof_log_index_recover(TEST_DATA_PATH, TEST_INDEX_PATH, &size), name, "recuperação trunca");
+    check(size == 170 && file_size(TEST_DATA_PATH) == 170, name, "tamanho após a recuperação");
+
+    uint8_t actual[170];
+    f = fopen(TEST_DATA_PATH, "rb");
+    check(f != NULL && fread(actual, 1, sizeof(actual), f) == sizeof(actual) &&
+          memcmp(actual, expected, sizeof(actual)) == 0, name, "registros confiáveis intactos");
+    if (f != NULL) {
+        fclose(f);
+    }
+
+    // Uma segunda recuperação não tem o que truncar
+    check(!tof_log_index_recover(TEST_DATA_PATH, TEST_INDEX_PATH, &size) && size == 170, name,
+          "segunda recuperação não altera o arquivo");
+}
+
+static void test_preallocated(void) {
+    const char *name = "pré-alocado";
+    remove(TEST_DATA_PATH);
+    int fd = open(TEST_DATA_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    check(fd >= 0 && ftruncate(fd, TEST_PREALLOCATED_BYTES) == 0, name, "reserva do arquivo");
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (!open_log(true)) {
+        check(false, name, "abertura do log");
+        return;
+    }
+    write_record(1000, 700);
+    sync_log();
+    write_record(2000, 300);
+    tof_log_writer_flush(&s_data, false);
+    power_loss();
+    check(file_size(TEST_DATA_PATH) == TEST_PREALLOCATED_BYTES, name, "tamanho reservado antes da recuperação");
+
+    uint64_t size = 0;
+    check(tof_log_index_recover(TEST_DATA_PATH, TEST_INDEX_PATH, &size), name, "recuperação trunca");
+    check(size == 700 && file_size(TEST_DATA_PATH) == 700, name, "tamanho após a recuperação");
+}
+
+static void test_header_only(void) {
+    const char *name = "índice sem entradas";
+    if (!open_log(false)) {
+        check(false, name, "abertura do log");
+        return;
+    }
+    write_record(1000, 300);
+    tof_log_writer_flush(&s_data, true);
+    // A energia cai antes de tof_log_index_sync(): o índice só tem o cabeçalho
+    power_loss();
+    check(file_size(TEST_INDEX_PATH) == (long)sizeof(tof_log_index_header_t), name, "índice só com o cabeçalho");
+
+    tof_log_index_entry_t last;
+    check(!tof_log_index_read_last(TEST_INDEX_PATH, &last), name, "nenhuma entrada válida");
+    uint64_t size = 1;
+    check(tof_log_index_recover(TEST_DATA_PATH, TEST_INDEX_PATH, &size), name, "recuperação trunca");
+    check(size == 0 && file_size(TEST_DATA_PATH) == 0, name, "log truncado em zero");
+}
+
+static void test_unreadable_index(void) {
+    const char *name = "índice ilegível";
+    remove(TEST_DATA_PATH);
+    remove(TEST_INDEX_PATH);
+    const uint8_t data[123] = { 1, 2, 3 };
+    append_bytes(TEST_DATA_PATH, data, sizeof(data));
+
+    uint64_t size = 0;
+    check(!tof_log_index_recover(TEST_DATA_PATH, TEST_INDEX_PATH, &size) && size == sizeof(data), name,
+          "sem arquivo de índice");
+
+    const char bad_header[] = "XIDX\x01\x00\x14\x00";
+    append_bytes(TEST_INDEX_PATH, bad_header, sizeof(tof_log_index_header_t));
+    check(!tof_log_index_recover(TEST_DATA_PATH, TEST_INDEX_PATH, &size), name, "assinatura inválida");
+    check(file_size(TEST_DATA_PATH) == (long)sizeof(data), name, "log de dados inalterado");
+}
+
+static bool open_log(bool preallocated) {
+    if (!preallocated) {
+        remove(TEST_DATA_PATH);
+    }
+    const tof_log_writer_config_t config = {
+        .flush_threshold_bytes = TEST_BUFFER_SIZE,
+        .flush_interval_ms = 0,
+        .fsync_interval_ms = 0,
+        .preallocated = preallocated,
+    };
+    return tof_log_writer_open(&s_data, TEST_DATA_PATH, true, NULL, 0, s_buffer, sizeof(s_buffer), &config) &&
+           tof_log_index_open(&s_index, TEST_INDEX_PATH);
+}
+
+static void write_record(int64_t timestamp_us, size_t len) {
+    uint8_t *dst = tof_log_writer_reserve(&s_data, len);
+    if (dst == NULL) {
+        check(false, "registro", "reserva no buffer");
+        return;
+    }
+    uint64_t offset = tof_log_writer_position(&s_data);
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = (uint8_t)(offset + i);
+    }
+    if (tof_log_writer_commit(&s_data, len)) {
+        tof_log_index_mark(&s_index, timestamp_us, offset);
+    }
+}
+
+static void sync_log(void) {
+    check(tof_log_writer_flush(&s_data, true) && tof_log_index_sync(&s_index, &s_data), "sincronismo",
+          "fsync do log e entrada do índice");
+}
+
+static void power_loss(void) {
+    close(s_data.fd);
+    s_data.fd = -1;
+    close(s_index.writer.fd);
+    s_index.writer.fd = -1;
+}
+
+static void append_bytes(const char *path, const void *data, size_t len) {
+    FILE *f = fopen(path, "ab");
+    if (f == NULL || fwrite(data, 1, len, f) != len) {
+        check(false, path, "escrita no fim do arquivo");
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+}
+
+static long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static void check(bool ok, const char *name, const char *what) {
+    if (!ok) {
+        printf("FALHA %s: %s\n", name, what);
+        s_failures++;
+    }
+}